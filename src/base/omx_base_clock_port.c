@@ -190,14 +190,20 @@ OMX_ERRORTYPE base_clock_port_SendBufferFunction(
 
   /* And notify the buffer management thread we have a fresh new buffer to manage */
   if(!PORT_IS_BEING_FLUSHED(openmaxStandPort) && !(PORT_IS_BEING_DISABLED(openmaxStandPort) && PORT_IS_TUNNELED_N_BUFFER_SUPPLIER(openmaxStandPort))){
-    queue(openmaxStandPort->pBufferQueue, pBuffer);
+    if (queue(openmaxStandPort->pBufferQueue, pBuffer) != 0) {
+      DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+      return OMX_ErrorInsufficientResources;
+    }
     tsem_up(openmaxStandPort->pBufferSem);
     DEBUG(DEB_LEV_PARAMS, "In %s Signalling bMgmtSem Port Index=%d\n",__func__, (int)portIndex);
     tsem_up(omx_base_component_Private->bMgmtSem);
   }else if(PORT_IS_BUFFER_SUPPLIER(openmaxStandPort)){
     DEBUG(DEB_LEV_FULL_SEQ, "In %s: Comp %s received io:%d buffer\n",
         __func__,omx_base_component_Private->name,(int)openmaxStandPort->sPortParam.nPortIndex);
-    queue(openmaxStandPort->pBufferQueue, pBuffer);
+    if (queue(openmaxStandPort->pBufferQueue, pBuffer) != 0) {
+      DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+      return OMX_ErrorInsufficientResources;
+    }
     tsem_up(openmaxStandPort->pBufferSem);
   }
   else { // If port being flushed and not tunneled then return error
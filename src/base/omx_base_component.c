@@ -36,6 +36,7 @@ extern "C" {
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
 
 #include <OMX_Core.h>
 #include <OMX_Component.h>
@@ -45,6 +46,8 @@ extern "C" {
 
 #include "tsemaphore.h"
 #include "queue.h"
+#include "omx_trace.h"
+#include "omx_executor.h"
 
 /**
  * @brief The base contructor for the OpenMAX st components
@@ -142,8 +145,12 @@ OMX_ERRORTYPE omx_base_component_Constructor(OMX_COMPONENTTYPE *openmaxStandComp
   omx_base_component_Private->messageHandler = omx_base_component_MessageHandler;
   omx_base_component_Private->destructor = omx_base_component_Destructor;
   omx_base_component_Private->bufferMgmtThreadID = -1;
+  omx_base_component_Private->BufferMgmtStep = NULL;
+  omx_base_component_Private->bufferMgmtTask = NULL;
   omx_base_component_Private->bIsEOSReached = OMX_FALSE;
 
+  memset(&omx_base_component_Private->sPerfCounters, 0, sizeof(perfCountersType));
+
   pthread_mutex_init(&omx_base_component_Private->flush_mutex, NULL);
 
   if(!omx_base_component_Private->flush_all_condition) {
@@ -200,6 +207,11 @@ OMX_ERRORTYPE omx_base_component_Destructor(OMX_COMPONENTTYPE *openmaxStandComp)
     DEBUG(DEB_LEV_FUNCTION_NAME,"In %s pthread_join returned err=%d\n", __func__, err);
   }
 
+  if(omx_base_component_Private->bufferMgmtTask) {
+    omx_task_destroy(omx_base_component_Private->bufferMgmtTask);
+    omx_base_component_Private->bufferMgmtTask = NULL;
+  }
+
   /*Deinitialize and free buffer management semaphore*/
   if(omx_base_component_Private->bMgmtSem){
     tsem_deinit(omx_base_component_Private->bMgmtSem);
@@ -264,6 +276,47 @@ OMX_ERRORTYPE omx_base_component_ComponentDeInit(
   return OMX_ErrorNone;
 }
 
+/** Starts processing the buffers: on the shared executor if it is enabled
+ * and the component provides a BufferMgmtStep, on a thread of its own
+ * otherwise. The semaphores the step waits on wake its task.
+ *
+ * @return 0 on success, as pthread_create
+ */
+static int omx_base_component_StartBufferMgmt(OMX_COMPONENTTYPE *openmaxStandComp) {
+  omx_base_component_PrivateType* omx_base_component_Private = (omx_base_component_PrivateType*)openmaxStandComp->pComponentPrivate;
+  omx_task_t* task;
+
+  if(omx_executor_enabled() && omx_base_component_Private->BufferMgmtStep) {
+    if(!omx_base_component_Private->bufferMgmtTask) {
+      omx_base_component_Private->bufferMgmtTask = omx_task_create(omx_base_component_Private->BufferMgmtStep, openmaxStandComp);
+    }
+    task = omx_base_component_Private->bufferMgmtTask;
+    if(task) {
+      tsem_set_notify(omx_base_component_Private->bMgmtSem, omx_task_wake, task);
+      tsem_set_notify(omx_base_component_Private->bStateSem, omx_task_wake, task);
+      tsem_set_notify(omx_base_component_Private->flush_condition, omx_task_wake, task);
+      omx_task_start(task);
+      return 0;
+    }
+    DEBUG(DEB_LEV_ERR, "In %s cannot create the executor task, using a thread\n", __func__);
+  }
+  return pthread_create(&omx_base_component_Private->bufferMgmtThread,
+    NULL,
+    omx_base_component_Private->BufferMgmtFunction,
+    openmaxStandComp);
+}
+
+/** Waits for the end of the buffer management thread or task */
+static void omx_base_component_JoinBufferMgmt(omx_base_component_PrivateType* omx_base_component_Private) {
+  if(omx_base_component_Private->bufferMgmtTask && omx_task_join(omx_base_component_Private->bufferMgmtTask) == 0) {
+    tsem_set_notify(omx_base_component_Private->bMgmtSem, NULL, NULL);
+    tsem_set_notify(omx_base_component_Private->bStateSem, NULL, NULL);
+    tsem_set_notify(omx_base_component_Private->flush_condition, NULL, NULL);
+  } else {
+    pthread_join(omx_base_component_Private->bufferMgmtThread,NULL);
+  }
+}
+
 /** Changes the state of a component taking proper actions depending on
  * the transiotion requested. This base function cover only the state
  * changes that do not involve any port
@@ -304,9 +357,9 @@ OMX_ERRORTYPE omx_base_component_DoStateSet(OMX_COMPONENTTYPE *openmaxStandComp,
 
           pPort = omx_base_component_Private->ports[i];
           if (PORT_IS_TUNNELED(pPort) && PORT_IS_BUFFER_SUPPLIER(pPort)) {
-            while(pPort->pBufferQueue->nelem > 0) {
+            while(getquenelem(pPort->pBufferQueue) > 0) {
               DEBUG(DEB_LEV_PARAMS, "In %s Buffer %d remained in the port %d queue of comp%s\n",
-                   __func__,(int)pPort->pBufferQueue->nelem,(int)i,omx_base_component_Private->name);
+                   __func__,(int)getquenelem(pPort->pBufferQueue),(int)i,omx_base_component_Private->name);
               dequeue(pPort->pBufferQueue);
             }
             /* Freeing here the buffers allocated for the tunneling:*/
@@ -341,7 +394,7 @@ OMX_ERRORTYPE omx_base_component_DoStateSet(OMX_COMPONENTTYPE *openmaxStandComp,
       if(omx_base_component_Private->bufferMgmtThreadID == 0 ){
         /*Signal Buffer Management thread to exit*/
         tsem_up(omx_base_component_Private->bMgmtSem);
-        pthread_join(omx_base_component_Private->bufferMgmtThread,NULL);
+        omx_base_component_JoinBufferMgmt(omx_base_component_Private);
         omx_base_component_Private->bufferMgmtThreadID = -1;
         if(err != 0) {
           DEBUG(DEB_LEV_FUNCTION_NAME,"In %s pthread_join returned err=%d\n",__func__,err);
@@ -414,12 +467,9 @@ OMX_ERRORTYPE omx_base_component_DoStateSet(OMX_COMPONENTTYPE *openmaxStandComp,
         }
       }
       omx_base_component_Private->state = OMX_StateIdle;
-      /** starting buffer management thread */
-      omx_base_component_Private->bufferMgmtThreadID = pthread_create(&omx_base_component_Private->bufferMgmtThread,
-      NULL,
-      omx_base_component_Private->BufferMgmtFunction,
-      openmaxStandComp);
-      if(omx_base_component_Private->bufferMgmtThreadID < 0){
+      /** starting buffer management thread, or task on the shared executor */
+      omx_base_component_Private->bufferMgmtThreadID = omx_base_component_StartBufferMgmt(openmaxStandComp);
+      if(omx_base_component_Private->bufferMgmtThreadID != 0){
         DEBUG(DEB_LEV_ERR, "Starting buffer management thread failed\n");
         return OMX_ErrorUndefined;
       }
@@ -437,6 +487,7 @@ OMX_ERRORTYPE omx_base_component_DoStateSet(OMX_COMPONENTTYPE *openmaxStandComp,
           DEBUG(DEB_LEV_FULL_SEQ, "Flushing Port %i\n",(int)i);
           pPort = omx_base_component_Private->ports[i];
           if(PORT_IS_ENABLED(pPort)) {
+            PERF_COUNTER_ADD(pPort->sPerfCounters.nFlushes, 1);
             pPort->FlushProcessingBuffers(pPort);
           }
         }
@@ -516,10 +567,10 @@ OMX_ERRORTYPE omx_base_component_DoStateSet(OMX_COMPONENTTYPE *openmaxStandComp,
 
           pPort=omx_base_component_Private->ports[i];
           DEBUG(DEB_LEV_PARAMS, "In %s: state transition Paused 2 Executing, nelem=%d,semval=%d,Buf Count Actual=%d\n", __func__,
-            pPort->pBufferQueue->nelem,pPort->pBufferSem->semval,(int)pPort->sPortParam.nBufferCountActual);
+            getquenelem(pPort->pBufferQueue),pPort->pBufferSem->semval,(int)pPort->sPortParam.nBufferCountActual);
 
           if (PORT_IS_TUNNELED_N_BUFFER_SUPPLIER(pPort) &&
-            (pPort->pBufferQueue->nelem == (pPort->pBufferSem->semval + pPort->sPortParam.nBufferCountActual))) {
+            (getquenelem(pPort->pBufferQueue) == (pPort->pBufferSem->semval + pPort->sPortParam.nBufferCountActual))) {
             for(k=0; k < pPort->sPortParam.nBufferCountActual;k++) {
               tsem_up(pPort->pBufferSem);
               tsem_up(omx_base_component_Private->bMgmtSem);
@@ -552,7 +603,7 @@ OMX_ERRORTYPE omx_base_component_DoStateSet(OMX_COMPONENTTYPE *openmaxStandComp,
       if(omx_base_component_Private->bufferMgmtThreadID == 0 ){
         /*Signal Buffer Management Thread to Exit*/
         tsem_up(omx_base_component_Private->bMgmtSem);
-        pthread_join(omx_base_component_Private->bufferMgmtThread,NULL);
+        omx_base_component_JoinBufferMgmt(omx_base_component_Private);
         omx_base_component_Private->bufferMgmtThreadID = -1;
         if(err!=0) {
           DEBUG(DEB_LEV_FUNCTION_NAME,"In %s pthread_join returned err=%d\n",__func__,err);
@@ -968,6 +1019,10 @@ OMX_ERRORTYPE omx_base_component_SetParameter(
             pPort->bBufferStateAllocated[j] = BUFFER_FREE;
           }
         }
+        if(queue_resize(pPort->pBufferQueue, pPort->sPortParam.nBufferCountActual) != 0) {
+          DEBUG(DEB_LEV_ERR, "In %s could not resize the queue of port %d\n", __func__, (int)pPortDef->nPortIndex);
+          return OMX_ErrorInsufficientResources;
+        }
       }
     }
     break;
@@ -1069,6 +1124,49 @@ OMX_ERRORTYPE omx_base_component_GetConfig(
   OMX_IN  OMX_HANDLETYPE hComponent,
   OMX_IN  OMX_INDEXTYPE nIndex,
   OMX_INOUT OMX_PTR pComponentConfigStructure) {
+  omx_base_component_PrivateType* omx_base_component_Private = (omx_base_component_PrivateType*)((OMX_COMPONENTTYPE*)hComponent)->pComponentPrivate;
+  OMX_VENDOR_PERFCOUNTERSTYPE* pPerfCounters;
+  perfCountersType* pCounters;
+  perfCountersType* pPortCounters;
+  OMX_U32 nPorts, i, nHighWater;
+  OMX_ERRORTYPE err;
+
+  if ((OMX_U32)nIndex == OMX_IndexVendorPerfCounters) {
+    pPerfCounters = (OMX_VENDOR_PERFCOUNTERSTYPE*)pComponentConfigStructure;
+    if ((err = checkHeader(pPerfCounters, sizeof(OMX_VENDOR_PERFCOUNTERSTYPE))) != OMX_ErrorNone) {
+      return err;
+    }
+    nPorts = omx_base_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts +
+             omx_base_component_Private->sPortTypesParam[OMX_PortDomainVideo].nPorts +
+             omx_base_component_Private->sPortTypesParam[OMX_PortDomainImage].nPorts +
+             omx_base_component_Private->sPortTypesParam[OMX_PortDomainOther].nPorts;
+    pCounters = &pPerfCounters->sCounters;
+    memset(pCounters, 0, sizeof(perfCountersType));
+    if (pPerfCounters->nPortIndex == OMX_ALL) {
+      pCounters->nMgmtWaitTime = PERF_COUNTER_READ(omx_base_component_Private->sPerfCounters.nMgmtWaitTime);
+      pCounters->nCallbackTime = PERF_COUNTER_READ(omx_base_component_Private->sPerfCounters.nCallbackTime);
+      pCounters->nCallbacks = PERF_COUNTER_READ(omx_base_component_Private->sPerfCounters.nCallbacks);
+      i = 0;
+    } else if (pPerfCounters->nPortIndex < nPorts) {
+      i = pPerfCounters->nPortIndex;
+      nPorts = i + 1;
+    } else {
+      return OMX_ErrorBadPortIndex;
+    }
+    for (; i < nPorts; i++) {
+      pPortCounters = &omx_base_component_Private->ports[i]->sPerfCounters;
+      pCounters->nBuffersIn += PERF_COUNTER_READ(pPortCounters->nBuffersIn);
+      pCounters->nBuffersOut += PERF_COUNTER_READ(pPortCounters->nBuffersOut);
+      pCounters->nBytesIn += PERF_COUNTER_READ(pPortCounters->nBytesIn);
+      pCounters->nBytesOut += PERF_COUNTER_READ(pPortCounters->nBytesOut);
+      pCounters->nEOS += PERF_COUNTER_READ(pPortCounters->nEOS);
+      pCounters->nFlushes += PERF_COUNTER_READ(pPortCounters->nFlushes);
+      nHighWater = PERF_COUNTER_READ(pPortCounters->nQueueHighWater);
+      if (nHighWater > pCounters->nQueueHighWater) {
+        pCounters->nQueueHighWater = nHighWater;
+      }
+    }
+  }
   return OMX_ErrorNone;
 }
 
@@ -1098,6 +1196,10 @@ OMX_ERRORTYPE omx_base_component_GetExtensionIndex(
 
   DEBUG(DEB_LEV_FUNCTION_NAME,"In  %s \n",__func__);
 
+  if(strcmp(cParameterName, OMX_VENDOR_PERFCOUNTERS_NAME) == 0) {
+    *pIndexType = (OMX_INDEXTYPE)OMX_IndexVendorPerfCounters;
+    return OMX_ErrorNone;
+  }
   return OMX_ErrorBadParameter;
 }
 
@@ -1169,12 +1271,23 @@ OMX_ERRORTYPE omx_base_component_SendCommand(
           for(k=0; k < pPort->sPortParam.nBufferCountActual; k++) {
             pPort->bBufferStateAllocated[k] = BUFFER_FREE;
           }
+
+          /* No buffer is queued before Idle, so the queue can be resized and switched now */
+          if(queue_resize(pPort->pBufferQueue, pPort->sPortParam.nBufferCountActual) != 0) {
+            DEBUG(DEB_LEV_ERR, "In %s could not resize the queue of port %d\n", __func__, (int)i);
+            free(message);
+            return OMX_ErrorInsufficientResources;
+          }
+          base_port_SelectQueueType(pPort);
         }
       }
 
       omx_base_component_Private->transientState = OMX_TransStateLoadedToIdle;
+      /* The ports now accept the buffers of their tunneled suppliers */
+      base_port_SignalTunnelStateChange();
     } else if ((nParam == OMX_StateLoaded) && (omx_base_component_Private->state == OMX_StateIdle)) {
       omx_base_component_Private->transientState = OMX_TransStateIdleToLoaded;
+      base_port_SignalTunnelStateChange();
     } else if ((nParam == OMX_StateIdle) && (omx_base_component_Private->state == OMX_StateExecuting)) {
       omx_base_component_Private->transientState = OMX_TransStateExecutingToIdle;
     }
@@ -1208,6 +1321,7 @@ OMX_ERRORTYPE omx_base_component_SendCommand(
     } else {
       omx_base_component_Private->ports[message->messageParam]->bIsTransientToDisabled = OMX_TRUE;
     }
+    base_port_SignalTunnelStateChange();
     break;
   case OMX_CommandPortEnable:
     if (nParam >= (omx_base_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts +
@@ -1229,6 +1343,7 @@ OMX_ERRORTYPE omx_base_component_SendCommand(
     } else {
       omx_base_component_Private->ports[message->messageParam]->bIsTransientToEnabled = OMX_TRUE;
     }
+    base_port_SignalTunnelStateChange();
     break;
   case OMX_CommandMarkBuffer:
     if (nParam >= (omx_base_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts +
@@ -1246,7 +1361,14 @@ OMX_ERRORTYPE omx_base_component_SendCommand(
 
   if (err == OMX_ErrorNone)
   {
-    queue(messageQueue, message);
+    /* A client may send a command per port, e.g. to disable them, before
+     * the message handler runs: grow the queue rather than fail */
+    if (queue(messageQueue, message) != 0 &&
+        (queue_grow(messageQueue) != 0 || queue(messageQueue, message) != 0)) {
+      DEBUG(DEB_LEV_ERR, "In %s message queue is full\n", __func__);
+      free(message);
+      return OMX_ErrorInsufficientResources;
+    }
     tsem_up(messageSem);
   }
 
@@ -1361,12 +1483,14 @@ OMX_ERRORTYPE omx_base_component_MessageHandler(OMX_COMPONENTTYPE *openmaxStandC
         i < omx_base_component_Private->sPortTypesParam[j].nStartPortNumber +
           omx_base_component_Private->sPortTypesParam[j].nPorts; i++) {
           pPort=omx_base_component_Private->ports[i];
+          PERF_COUNTER_ADD(pPort->sPerfCounters.nFlushes, 1);
           err = pPort->FlushProcessingBuffers(pPort);
         }
       }
     }
     else {
       pPort=omx_base_component_Private->ports[message->messageParam];
+      PERF_COUNTER_ADD(pPort->sPerfCounters.nFlushes, 1);
       err = pPort->FlushProcessingBuffers(pPort);
     }
     if (err != OMX_ErrorNone) {
@@ -1435,6 +1559,7 @@ OMX_ERRORTYPE omx_base_component_MessageHandler(OMX_COMPONENTTYPE *openmaxStandC
           i < omx_base_component_Private->sPortTypesParam[j].nStartPortNumber +
             omx_base_component_Private->sPortTypesParam[j].nPorts; i++) {
           pPort=omx_base_component_Private->ports[i];
+          PERF_COUNTER_ADD(pPort->sPerfCounters.nFlushes, 1);
           err = pPort->FlushProcessingBuffers(pPort);
           }
         }
@@ -1452,6 +1577,7 @@ OMX_ERRORTYPE omx_base_component_MessageHandler(OMX_COMPONENTTYPE *openmaxStandC
     else {
       pPort=omx_base_component_Private->ports[message->messageParam];
       if(omx_base_component_Private->state!=OMX_StateLoaded) {
+        PERF_COUNTER_ADD(pPort->sPerfCounters.nFlushes, 1);
         err = pPort->FlushProcessingBuffers(pPort);
         DEBUG(DEB_LEV_FULL_SEQ, "In %s: Port Flush completed for Comp %s\n",__func__,omx_base_component_Private->name);
       }
@@ -1670,11 +1796,37 @@ OMX_ERRORTYPE omx_base_component_FreeBuffer(
                                 pBuffer);
 }
 
+/** @brief Returns the monotonic time in microseconds, used to update the
+ * time performance counters
+ */
+OMX_U64 omx_base_component_PerfTime(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (OMX_U64)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/** Updates the performance counters of a port that accepted a buffer.
+ * The length and flags are read before the buffer is handed to the port.
+ */
+static void omx_base_component_CountBufferIn(omx_base_PortType *pPort, OMX_U32 nFilledLen, OMX_U32 nFlags) {
+  int nQueued = getquenelem(pPort->pBufferQueue);
+
+  PERF_COUNTER_ADD(pPort->sPerfCounters.nBuffersIn, 1);
+  PERF_COUNTER_ADD(pPort->sPerfCounters.nBytesIn, nFilledLen);
+  if (nFlags & OMX_BUFFERFLAG_EOS) {
+    PERF_COUNTER_ADD(pPort->sPerfCounters.nEOS, 1);
+  }
+  PERF_COUNTER_MAX(pPort->sPerfCounters.nQueueHighWater, nQueued);
+}
+
 OMX_ERRORTYPE omx_base_component_EmptyThisBuffer(
             OMX_IN  OMX_HANDLETYPE hComponent,
             OMX_IN  OMX_BUFFERHEADERTYPE* pBuffer) {
   omx_base_component_PrivateType* omx_base_component_Private = (omx_base_component_PrivateType*)((OMX_COMPONENTTYPE*)hComponent)->pComponentPrivate;
   omx_base_PortType *pPort;
+  OMX_U32 nFilledLen, nFlags;
+  OMX_ERRORTYPE err;
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
 
   if (pBuffer->nInputPortIndex >= (omx_base_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts +
@@ -1689,7 +1841,14 @@ OMX_ERRORTYPE omx_base_component_EmptyThisBuffer(
     DEBUG(DEB_LEV_ERR, "In %s: wrong port direction in Component %s\n", __func__,omx_base_component_Private->name);
     return OMX_ErrorBadPortIndex;
   }
-  return pPort->Port_SendBufferFunction(pPort, pBuffer);
+  OMX_TRACE(OMX_TRACE_EMPTY_THIS_BUFFER, omx_base_component_Private->name, pBuffer->nInputPortIndex, pBuffer);
+  nFilledLen = pBuffer->nFilledLen;
+  nFlags = pBuffer->nFlags;
+  err = pPort->Port_SendBufferFunction(pPort, pBuffer);
+  if (err == OMX_ErrorNone) {
+    omx_base_component_CountBufferIn(pPort, nFilledLen, nFlags);
+  }
+  return err;
 }
 
 OMX_ERRORTYPE omx_base_component_FillThisBuffer(
@@ -1698,6 +1857,8 @@ OMX_ERRORTYPE omx_base_component_FillThisBuffer(
 
   omx_base_component_PrivateType* omx_base_component_Private = (omx_base_component_PrivateType*)((OMX_COMPONENTTYPE*)hComponent)->pComponentPrivate;
   omx_base_PortType *pPort;
+  OMX_U32 nFilledLen, nFlags;
+  OMX_ERRORTYPE err;
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
   if (pBuffer->nOutputPortIndex >= (omx_base_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts +
                                     omx_base_component_Private->sPortTypesParam[OMX_PortDomainVideo].nPorts +
@@ -1712,7 +1873,14 @@ OMX_ERRORTYPE omx_base_component_FillThisBuffer(
       (int)pBuffer->nOutputPortIndex, (int)pPort->sPortParam.eDir,(int)pBuffer,omx_base_component_Private->name);
     return OMX_ErrorBadPortIndex;
   }
-  return pPort->Port_SendBufferFunction(pPort,  pBuffer);
+  OMX_TRACE(OMX_TRACE_FILL_THIS_BUFFER, omx_base_component_Private->name, pBuffer->nOutputPortIndex, pBuffer);
+  nFilledLen = pBuffer->nFilledLen;
+  nFlags = pBuffer->nFlags;
+  err = pPort->Port_SendBufferFunction(pPort,  pBuffer);
+  if (err == OMX_ErrorNone) {
+    omx_base_component_CountBufferIn(pPort, nFilledLen, nFlags);
+  }
+  return err;
 }
 
 OMX_ERRORTYPE omx_base_component_ComponentTunnelRequest(
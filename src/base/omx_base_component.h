@@ -35,6 +35,7 @@
 
 #include "tsemaphore.h"
 #include "queue.h"
+#include "omx_executor.h"
 #include "omx_classmagic.h"
 #include "omx_base_port.h"
 
@@ -65,9 +66,30 @@ typedef enum OMX_INDEXVENDORTYPE {
   /** only one index for file reader component input file */
   OMX_IndexVendorInputFilename          = 0xFF000001,
   OMX_IndexVendorOutputFilename         = 0xFF000002,
-  OMX_IndexVendorCompPropTunnelFlags    = 0xFF000003 /* Will use OMX_TUNNELSETUPTYPE structure*/
+  OMX_IndexVendorCompPropTunnelFlags    = 0xFF000003, /* Will use OMX_TUNNELSETUPTYPE structure*/
+  OMX_IndexVendorPerfCounters           = 0xFF000004, /* Will use OMX_VENDOR_PERFCOUNTERSTYPE structure*/
+  OMX_IndexVendorDecodeThreads          = 0xFF000005, /* Will use OMX_PARAM_U32TYPE structure*/
+  OMX_IndexVendorMixerInputs            = 0xFF000006, /* Will use OMX_PARAM_U32TYPE structure*/
+  OMX_IndexVendorResamplerQuality       = 0xFF000007, /* Will use OMX_PARAM_U32TYPE structure*/
+  OMX_IndexVendorEncodeThreads          = 0xFF000008  /* Will use OMX_PARAM_U32TYPE structure*/
 } OMX_INDEXVENDORTYPE;
 
+/** The extension name of OMX_IndexVendorPerfCounters */
+#define OMX_VENDOR_PERFCOUNTERS_NAME "OMX.st.index.config.perfcounters"
+
+/** @brief Performance counters returned by GetConfig
+ *
+ * With nPortIndex set to a port index sCounters holds the counters of the port.
+ * With OMX_ALL it holds the time counters of the component, and the sum of the
+ * counters of all its ports, except nQueueHighWater that is their maximum.
+ */
+typedef struct OMX_VENDOR_PERFCOUNTERSTYPE {
+  OMX_U32 nSize;
+  OMX_VERSIONTYPE nVersion;
+  OMX_U32 nPortIndex;
+  perfCountersType sCounters;
+} OMX_VENDOR_PERFCOUNTERSTYPE;
+
 /** This enum defines the transition states of the Component*/
 typedef enum OMX_TRANS_STATETYPE {
     OMX_TransStateInvalid,
@@ -139,9 +161,12 @@ CLASS(omx_base_component_PrivateType)
 	pthread_t bufferMgmtThread; /** @param  bufferMgmtThread This field contains the reference to the thread that process buffers */ \
 	void *loader; /**< pointer to the loader that created this component, used for destruction */ \
 	void* (*BufferMgmtFunction)(void* param); /** @param BufferMgmtFunction This function processes input output buffers */ \
+	int (*BufferMgmtStep)(void* param, omx_task_wait_t* wait); /** @param BufferMgmtStep If set, processes input output buffers until it would block, and is run by the shared executor instead of BufferMgmtFunction when enabled */ \
+	omx_task_t* bufferMgmtTask; /** @param bufferMgmtTask The task running BufferMgmtStep on the shared executor, NULL until it is first used */ \
 	OMX_ERRORTYPE (*messageHandler)(OMX_COMPONENTTYPE*,internalRequestMessageType*);/** This function receives messages from the message queue. It is needed for each Linux ST OpenMAX component */ \
 	OMX_ERRORTYPE (*DoStateSet)(OMX_COMPONENTTYPE *openmaxStandComp, OMX_U32); /**< @param DoStateSet internal function called when a generic state transition is requested*/ \
-	OMX_ERRORTYPE (*destructor)(OMX_COMPONENTTYPE *openmaxStandComp); /** Component Destructor*/
+	OMX_ERRORTYPE (*destructor)(OMX_COMPONENTTYPE *openmaxStandComp); /** Component Destructor*/ \
+	perfCountersType sPerfCounters; /**< @param sPerfCounters Time counters of the buffer management thread */
 ENDCLASS(omx_base_component_PrivateType)
 
 /**
@@ -207,6 +232,11 @@ OMX_ERRORTYPE checkHeader(OMX_PTR header, OMX_U32 size);
  */
 void setHeader(OMX_PTR header, OMX_U32 size);
 
+/** @brief Returns the monotonic time in microseconds, used to update the
+ * time performance counters
+ */
+OMX_U64 omx_base_component_PerfTime(void);
+
 /** @brief standard openmax function
  *
  * it returns the version of the component. See OMX_Core.h
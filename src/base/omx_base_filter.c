@@ -30,9 +30,18 @@
 */
 
 #include <omxcore.h>
+#include <omx_trace.h>
 
 #include "omx_base_filter.h"
 
+/** Stages of omx_base_filter_BufferMgmtStep: where the next step resumes */
+#define OMX_BASE_FILTER_STAGE_START     0 /**< checks the flush, then waits for an input buffer */
+#define OMX_BASE_FILTER_STAGE_INPUT     1 /**< waits for an output buffer */
+#define OMX_BASE_FILTER_STAGE_OUTPUT    2 /**< takes the buffers and processes them */
+#define OMX_BASE_FILTER_STAGE_BATCH     3 /**< returns the processed batch, then goes on as OUTPUT */
+#define OMX_BASE_FILTER_STAGE_PROCESSED 4 /**< returns the processed output buffer */
+#define OMX_BASE_FILTER_STAGE_RETURN    5 /**< returns the consumed input buffer */
+
 OMX_ERRORTYPE omx_base_filter_Constructor(OMX_COMPONENTTYPE *openmaxStandComp,OMX_STRING cComponentName) {
   OMX_ERRORTYPE err = OMX_ErrorNone;
   omx_base_filter_PrivateType* omx_base_filter_Private;
@@ -55,6 +64,17 @@ OMX_ERRORTYPE omx_base_filter_Constructor(OMX_COMPONENTTYPE *openmaxStandComp,OM
   omx_base_filter_Private = openmaxStandComp->pComponentPrivate;
 
   omx_base_filter_Private->BufferMgmtFunction = omx_base_filter_BufferMgmtFunction;
+  omx_base_filter_Private->BufferMgmtStep = omx_base_filter_BufferMgmtStep;
+  omx_base_filter_Private->pMgmtInputBuffer = NULL;
+  omx_base_filter_Private->pMgmtOutputBuffer = NULL;
+  omx_base_filter_Private->bMgmtOutputAliased = OMX_FALSE;
+  omx_base_filter_Private->nMgmtStage = OMX_BASE_FILTER_STAGE_START;
+  omx_base_filter_Private->bInPlaceProcessing = OMX_FALSE;
+  omx_base_filter_Private->nAliases = 0;
+  omx_base_filter_Private->bDrainOnEOS = OMX_FALSE;
+  omx_base_filter_Private->BufferMgmtFlushCallback = NULL;
+  omx_base_filter_Private->BufferMgmtBatchCallback = NULL;
+  omx_base_filter_Private->nBatchBuffers = 0;
 
   return err;
 }
@@ -64,12 +84,243 @@ OMX_ERRORTYPE omx_base_filter_Destructor(OMX_COMPONENTTYPE *openmaxStandComp) {
   return omx_base_component_Destructor(openmaxStandComp);
 }
 
-/** This is the central function for component processing. It
-  * is executed in a separate thread, is synchronized with
-  * semaphores at each port, those are released each time a new buffer
-  * is available on the given port.
+/** Returns true if the payload of the input buffer can be lent to an output
+  * buffer: the component works in place and the output port is tunneled,
+  * whichever side supplies the buffers. The payload stays valid as long as
+  * the input buffer is held, whoever allocated it. Output buffers going to
+  * an IL client are never aliased, since the client may look them up by
+  * their payload.
   */
-void* omx_base_filter_BufferMgmtFunction (void* param) {
+static OMX_BOOL omx_base_filter_CanAliasBuffer(omx_base_filter_PrivateType* omx_base_filter_Private, OMX_BUFFERHEADERTYPE* pInputBuffer) {
+  omx_base_PortType *pOutPort=(omx_base_PortType *)omx_base_filter_Private->ports[OMX_BASE_FILTER_OUTPUTPORT_INDEX];
+
+  if (!omx_base_filter_Private->bInPlaceProcessing || pInputBuffer->nFilledLen == 0 ||
+      omx_base_filter_Private->nAliases == OMX_BASE_FILTER_MAX_ALIASES || !PORT_IS_TUNNELED(pOutPort)) {
+    return OMX_FALSE;
+  }
+  return OMX_TRUE;
+}
+
+/** Lends the payload of the input buffer to the output buffer. The input
+  * buffer header is not modified.
+  */
+static void omx_base_filter_AliasBuffer(omx_base_filter_PrivateType* omx_base_filter_Private, OMX_BUFFERHEADERTYPE* pOutputBuffer, OMX_BUFFERHEADERTYPE* pInputBuffer) {
+  omx_base_filter_AliasType* pAlias = &omx_base_filter_Private->sAliases[omx_base_filter_Private->nAliases++];
+
+  pAlias->pOutputBuffer = pOutputBuffer;
+  pAlias->pInputBuffer = pInputBuffer;
+  pAlias->pBuffer = pOutputBuffer->pBuffer;
+  pAlias->nAllocLen = pOutputBuffer->nAllocLen;
+  pOutputBuffer->pBuffer = pInputBuffer->pBuffer;
+  pOutputBuffer->nAllocLen = pInputBuffer->nAllocLen;
+}
+
+/** Gives an output buffer its own payload back if it was lent the payload
+  * of an input buffer.
+  *
+  * @return the input buffer it was lent the payload of, NULL if none
+  */
+static OMX_BUFFERHEADERTYPE* omx_base_filter_UnaliasBuffer(omx_base_filter_PrivateType* omx_base_filter_Private, OMX_BUFFERHEADERTYPE* pOutputBuffer) {
+  OMX_BUFFERHEADERTYPE* pInputBuffer;
+  OMX_U32 i;
+
+  for (i = 0; i < omx_base_filter_Private->nAliases; i++) {
+    if (omx_base_filter_Private->sAliases[i].pOutputBuffer == pOutputBuffer) {
+      pInputBuffer = omx_base_filter_Private->sAliases[i].pInputBuffer;
+      pOutputBuffer->pBuffer = omx_base_filter_Private->sAliases[i].pBuffer;
+      pOutputBuffer->nAllocLen = omx_base_filter_Private->sAliases[i].nAllocLen;
+      omx_base_filter_Private->sAliases[i] = omx_base_filter_Private->sAliases[--omx_base_filter_Private->nAliases];
+      return pInputBuffer;
+    }
+  }
+  return NULL;
+}
+
+/** Called by the buffer management thread on each output buffer it takes
+  * from the output port: if the buffer was lent the payload of an input
+  * buffer, that input buffer is returned now that nothing reads it anymore.
+  */
+static void omx_base_filter_ReleaseAliasedBuffer(omx_base_filter_PrivateType* omx_base_filter_Private, OMX_BUFFERHEADERTYPE* pOutputBuffer) {
+  omx_base_PortType *pInPort=(omx_base_PortType *)omx_base_filter_Private->ports[OMX_BASE_FILTER_INPUTPORT_INDEX];
+  OMX_BUFFERHEADERTYPE* pInputBuffer;
+
+  if (omx_base_filter_Private->nAliases > 0 && (pInputBuffer = omx_base_filter_UnaliasBuffer(omx_base_filter_Private, pOutputBuffer)) != NULL) {
+    DEBUG(DEB_LEV_FULL_SEQ, "In %s returning the input buffer aliased by %p\n", __func__, pOutputBuffer);
+    pInputBuffer->nFilledLen = 0;
+    pInPort->ReturnBufferFunction(pInPort, pInputBuffer);
+  }
+}
+
+/** Gives an output buffer still downstream its own payload back, with a
+  * copy of the data of the input buffer it was lent, and returns that input
+  * buffer. The output buffer header is shared with the tunneled component,
+  * which then finds the same data in the payload it frees later.
+  */
+static void omx_base_filter_DetachAliasedBuffer(omx_base_filter_PrivateType* omx_base_filter_Private, omx_base_filter_AliasType* pAlias) {
+  OMX_BUFFERHEADERTYPE* pOutputBuffer = pAlias->pOutputBuffer;
+  OMX_U32 nLen = pOutputBuffer->nOffset + pOutputBuffer->nFilledLen;
+
+  DEBUG(DEB_LEV_FULL_SEQ, "In %s copying the input buffer aliased by %p\n", __func__, pOutputBuffer);
+  if (nLen > pAlias->nAllocLen) {
+    DEBUG(DEB_LEV_ERR, "In %s output buffer %p too small for its data, truncated\n", __func__, pOutputBuffer);
+    nLen = pAlias->nAllocLen;
+    if (pOutputBuffer->nOffset > nLen) {
+      pOutputBuffer->nOffset = nLen;
+    }
+    pOutputBuffer->nFilledLen = nLen - pOutputBuffer->nOffset;
+  }
+  memcpy(pAlias->pBuffer, pOutputBuffer->pBuffer, nLen);
+  omx_base_filter_ReleaseAliasedBuffer(omx_base_filter_Private, pOutputBuffer);
+}
+
+/** Called by the buffer management thread when a port is flushed: waits
+  * up to OMX_BASE_FILTER_ALIAS_FLUSH_MSEC for the output buffers lent the
+  * payload of an input buffer to come back, and returns their input
+  * buffers. The other output buffers coming back meanwhile are queued
+  * again in the output port. The output buffers held downstream beyond
+  * that, e.g. by a paused component, are detached from their input buffer.
+  */
+static void omx_base_filter_WaitAliasedBuffers(omx_base_filter_PrivateType* omx_base_filter_Private) {
+  omx_base_PortType *pOutPort=(omx_base_PortType *)omx_base_filter_Private->ports[OMX_BASE_FILTER_OUTPUTPORT_INDEX];
+  OMX_BUFFERHEADERTYPE** pHomeBuffers;
+  OMX_BUFFERHEADERTYPE* pBuffer;
+  OMX_U32 nHomeBuffers = 0, i;
+  struct timespec deadline;
+
+  pHomeBuffers = calloc(pOutPort->sPortParam.nBufferCountActual, sizeof(OMX_BUFFERHEADERTYPE*));
+  if (pHomeBuffers != NULL) {
+    tsem_deadline(&deadline, OMX_BASE_FILTER_ALIAS_FLUSH_MSEC);
+    while (omx_base_filter_Private->nAliases > 0 && nHomeBuffers < pOutPort->sPortParam.nBufferCountActual) {
+      DEBUG(DEB_LEV_FULL_SEQ, "In %s waiting for %d aliased buffers\n", __func__, (int)omx_base_filter_Private->nAliases);
+      if (tsem_timed_down(pOutPort->pBufferSem, &deadline) != 0) {
+        break;
+      }
+      pBuffer = dequeue(pOutPort->pBufferQueue);
+      if (pBuffer == NULL) {
+        DEBUG(DEB_LEV_ERR, "Had NULL output buffer!!\n");
+        break;
+      }
+      omx_base_filter_ReleaseAliasedBuffer(omx_base_filter_Private, pBuffer);
+      pHomeBuffers[nHomeBuffers++] = pBuffer;
+    }
+    for (i = 0; i < nHomeBuffers; i++) {
+      if (queue(pOutPort->pBufferQueue, pHomeBuffers[i]) != 0) {
+        DEBUG(DEB_LEV_ERR, "In %s: buffer queue of output port is full\n", __func__);
+        continue;
+      }
+      tsem_up(pOutPort->pBufferSem);
+    }
+    free(pHomeBuffers);
+  }
+  while (omx_base_filter_Private->nAliases > 0) {
+    omx_base_filter_DetachAliasedBuffer(omx_base_filter_Private, &omx_base_filter_Private->sAliases[omx_base_filter_Private->nAliases - 1]);
+  }
+}
+
+/** Dequeues the buffers ready at the same time on both ports and processes
+  * them with a single call of BufferMgmtBatchCallback. They are kept in
+  * pBatchInputBuffers and pBatchOutputBuffers until ReturnBatch. The batch
+  * stops at the first input buffer carrying a flag, a mark or no data: that
+  * buffer is returned to the caller, which processes it with
+  * BufferMgmtCallback.
+  *
+  * @return the input buffer left to process, or NULL
+  */
+static OMX_BUFFERHEADERTYPE* omx_base_filter_ProcessBatch(OMX_COMPONENTTYPE* openmaxStandComp) {
+  omx_base_filter_PrivateType* omx_base_filter_Private = (omx_base_filter_PrivateType*)openmaxStandComp->pComponentPrivate;
+  omx_base_PortType *pInPort=(omx_base_PortType *)omx_base_filter_Private->ports[OMX_BASE_FILTER_INPUTPORT_INDEX];
+  omx_base_PortType *pOutPort=(omx_base_PortType *)omx_base_filter_Private->ports[OMX_BASE_FILTER_OUTPUTPORT_INDEX];
+  OMX_BUFFERHEADERTYPE** inBufs = omx_base_filter_Private->pBatchInputBuffers;
+  OMX_BUFFERHEADERTYPE** outBufs = omx_base_filter_Private->pBatchOutputBuffers;
+  OMX_BOOL isAliased[OMX_BASE_FILTER_MAX_BATCH];
+  OMX_BUFFERHEADERTYPE* pInputBuffer;
+  OMX_BUFFERHEADERTYPE* pLeftBuffer = NULL;
+  OMX_U32 nBuffers = 0, i;
+  OMX_U64 nPerfTime;
+
+  while (nBuffers < OMX_BASE_FILTER_MAX_BATCH && pInPort->pBufferSem->semval > 0 && pOutPort->pBufferSem->semval > 0) {
+    tsem_down(pInPort->pBufferSem);
+    pInputBuffer = dequeue(pInPort->pBufferQueue);
+    if (pInputBuffer == NULL) {
+      DEBUG(DEB_LEV_ERR, "Had NULL input buffer!!\n");
+      break;
+    }
+    OMX_TRACE(OMX_TRACE_DEQUEUE, omx_base_filter_Private->name, pInPort->sPortParam.nPortIndex, pInputBuffer);
+    if (pInputBuffer->nFilledLen == 0 || pInputBuffer->nFlags != 0 || pInputBuffer->hMarkTargetComponent != NULL) {
+      pLeftBuffer = pInputBuffer;
+      break;
+    }
+    tsem_down(pOutPort->pBufferSem);
+    outBufs[nBuffers] = dequeue(pOutPort->pBufferQueue);
+    if (outBufs[nBuffers] == NULL) {
+      DEBUG(DEB_LEV_ERR, "Had NULL output buffer!!\n");
+      pLeftBuffer = pInputBuffer;
+      break;
+    }
+    OMX_TRACE(OMX_TRACE_DEQUEUE, omx_base_filter_Private->name, pOutPort->sPortParam.nPortIndex, outBufs[nBuffers]);
+    omx_base_filter_ReleaseAliasedBuffer(omx_base_filter_Private, outBufs[nBuffers]);
+    inBufs[nBuffers++] = pInputBuffer;
+  }
+  if (nBuffers == 0) {
+    return pLeftBuffer;
+  }
+
+  for (i = 0; i < nBuffers; i++) {
+    if (omx_base_filter_Private->pMark.hMarkTargetComponent != NULL) {
+      outBufs[i]->hMarkTargetComponent = omx_base_filter_Private->pMark.hMarkTargetComponent;
+      outBufs[i]->pMarkData            = omx_base_filter_Private->pMark.pMarkData;
+      omx_base_filter_Private->pMark.hMarkTargetComponent = NULL;
+      omx_base_filter_Private->pMark.pMarkData            = NULL;
+    }
+    outBufs[i]->nTimeStamp = inBufs[i]->nTimeStamp;
+    isAliased[i] = omx_base_filter_CanAliasBuffer(omx_base_filter_Private, inBufs[i]);
+    if (isAliased[i]) {
+      omx_base_filter_AliasBuffer(omx_base_filter_Private, outBufs[i], inBufs[i]);
+    }
+    OMX_TRACE(OMX_TRACE_CALLBACK_START, omx_base_filter_Private->name, pInPort->sPortParam.nPortIndex, inBufs[i]);
+  }
+  nPerfTime = omx_base_component_PerfTime();
+  (*(omx_base_filter_Private->BufferMgmtBatchCallback))(openmaxStandComp, inBufs, nBuffers, outBufs, nBuffers);
+  PERF_COUNTER_ADD(omx_base_filter_Private->sPerfCounters.nCallbackTime, omx_base_component_PerfTime() - nPerfTime);
+  PERF_COUNTER_ADD(omx_base_filter_Private->sPerfCounters.nCallbacks, nBuffers);
+  for (i = 0; i < nBuffers; i++) {
+    OMX_TRACE(OMX_TRACE_CALLBACK_END, omx_base_filter_Private->name, pOutPort->sPortParam.nPortIndex, outBufs[i]);
+    if (isAliased[i]) {
+      /* The input buffer is held until the output buffer comes back */
+      inBufs[i]->nFilledLen = 0;
+      inBufs[i] = NULL;
+    }
+  }
+  omx_base_filter_Private->nBatchBuffers = nBuffers;
+  return pLeftBuffer;
+}
+
+/** Sends out the output buffers of the batch processed by ProcessBatch,
+  * and returns its input buffers
+  */
+static void omx_base_filter_ReturnBatch(omx_base_filter_PrivateType* omx_base_filter_Private) {
+  omx_base_PortType *pInPort=(omx_base_PortType *)omx_base_filter_Private->ports[OMX_BASE_FILTER_INPUTPORT_INDEX];
+  omx_base_PortType *pOutPort=(omx_base_PortType *)omx_base_filter_Private->ports[OMX_BASE_FILTER_OUTPUTPORT_INDEX];
+  OMX_U32 i;
+
+  for (i = 0; i < omx_base_filter_Private->nBatchBuffers; i++) {
+    pOutPort->ReturnBufferFunction(pOutPort, omx_base_filter_Private->pBatchOutputBuffers[i]);
+    if (omx_base_filter_Private->pBatchInputBuffers[i] != NULL) {
+      omx_base_filter_Private->pBatchInputBuffers[i]->nFilledLen = 0;
+      pInPort->ReturnBufferFunction(pInPort, omx_base_filter_Private->pBatchInputBuffers[i]);
+    }
+  }
+  omx_base_filter_Private->nBatchBuffers = 0;
+}
+
+/** Processes the buffers of the component until it has to wait. It
+  * resumes where the previous step stopped, after the wait it returned
+  * is over: a buffer, the end of a flush, or a state change.
+  *
+  * @return 0 if another step has to run, non zero when the component
+  * leaves the Idle, Executing and Pause states
+  */
+int omx_base_filter_BufferMgmtStep(void* param, omx_task_wait_t* wait) {
   OMX_COMPONENTTYPE* openmaxStandComp = (OMX_COMPONENTTYPE*)param;
   omx_base_component_PrivateType* omx_base_component_Private=(omx_base_component_PrivateType*)openmaxStandComp->pComponentPrivate;
   omx_base_filter_PrivateType* omx_base_filter_Private = (omx_base_filter_PrivateType*)omx_base_component_Private;
@@ -79,27 +330,32 @@ void* omx_base_filter_BufferMgmtFunction (void* param) {
   tsem_t* pOutputSem = pOutPort->pBufferSem;
   queue_t* pInputQueue = pInPort->pBufferQueue;
   queue_t* pOutputQueue = pOutPort->pBufferQueue;
-  OMX_BUFFERHEADERTYPE* pOutputBuffer=NULL;
-  OMX_BUFFERHEADERTYPE* pInputBuffer=NULL;
-  OMX_BOOL isInputBufferNeeded=OMX_TRUE,isOutputBufferNeeded=OMX_TRUE;
-  int inBufExchanged=0,outBufExchanged=0;
-
-  DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
-  while(omx_base_filter_Private->state == OMX_StateIdle || omx_base_filter_Private->state == OMX_StateExecuting ||  omx_base_filter_Private->state == OMX_StatePause ||
-    omx_base_filter_Private->transientState == OMX_TransStateLoadedToIdle){
+  OMX_BUFFERHEADERTYPE* pOutputBuffer=omx_base_filter_Private->pMgmtOutputBuffer;
+  OMX_BUFFERHEADERTYPE* pInputBuffer=omx_base_filter_Private->pMgmtInputBuffer;
+  OMX_BOOL isInputBufferNeeded=pInputBuffer ? OMX_FALSE : OMX_TRUE;
+  OMX_BOOL isOutputBufferNeeded=pOutputBuffer ? OMX_FALSE : OMX_TRUE;
+  OMX_U64 nPerfTime;
+
+  wait->tsem = NULL;
+  wait->bGeneration = 0;
+  switch(omx_base_filter_Private->nMgmtStage) {
+  case OMX_BASE_FILTER_STAGE_START:
+    if(!(omx_base_filter_Private->state == OMX_StateIdle || omx_base_filter_Private->state == OMX_StateExecuting ||  omx_base_filter_Private->state == OMX_StatePause ||
+      omx_base_filter_Private->transientState == OMX_TransStateLoadedToIdle)) {
+      goto exit;
+    }
 
     /*Wait till the ports are being flushed*/
     pthread_mutex_lock(&omx_base_filter_Private->flush_mutex);
-    while( PORT_IS_BEING_FLUSHED(pInPort) ||
-           PORT_IS_BEING_FLUSHED(pOutPort)) {
+    if( PORT_IS_BEING_FLUSHED(pInPort) ||
+        PORT_IS_BEING_FLUSHED(pOutPort)) {
       pthread_mutex_unlock(&omx_base_filter_Private->flush_mutex);
 
-      DEBUG(DEB_LEV_FULL_SEQ, "In %s 1 signalling flush all cond iE=%d,iF=%d,oE=%d,oF=%d iSemVal=%d,oSemval=%d\n",
-        __func__,inBufExchanged,isInputBufferNeeded,outBufExchanged,isOutputBufferNeeded,pInputSem->semval,pOutputSem->semval);
+      DEBUG(DEB_LEV_FULL_SEQ, "In %s 1 signalling flush all cond iF=%d,oF=%d iSemVal=%d,oSemval=%d\n",
+        __func__,isInputBufferNeeded,isOutputBufferNeeded,pInputSem->semval,pOutputSem->semval);
 
       if(isOutputBufferNeeded==OMX_FALSE && PORT_IS_BEING_FLUSHED(pOutPort)) {
         pOutPort->ReturnBufferFunction(pOutPort,pOutputBuffer);
-        outBufExchanged--;
         pOutputBuffer=NULL;
         isOutputBufferNeeded=OMX_TRUE;
         DEBUG(DEB_LEV_FULL_SEQ, "Ports are flushing,so returning output buffer\n");
@@ -107,18 +363,27 @@ void* omx_base_filter_BufferMgmtFunction (void* param) {
 
       if(isInputBufferNeeded==OMX_FALSE && PORT_IS_BEING_FLUSHED(pInPort)) {
         pInPort->ReturnBufferFunction(pInPort,pInputBuffer);
-        inBufExchanged--;
         pInputBuffer=NULL;
         isInputBufferNeeded=OMX_TRUE;
         DEBUG(DEB_LEV_FULL_SEQ, "Ports are flushing,so returning input buffer\n");
       }
 
-      DEBUG(DEB_LEV_FULL_SEQ, "In %s 2 signalling flush all cond iE=%d,iF=%d,oE=%d,oF=%d iSemVal=%d,oSemval=%d\n",
-        __func__,inBufExchanged,isInputBufferNeeded,outBufExchanged,isOutputBufferNeeded,pInputSem->semval,pOutputSem->semval);
+      /* The input buffers lent to output buffers are returned once these come back */
+      if(omx_base_filter_Private->nAliases > 0) {
+        omx_base_filter_WaitAliasedBuffers(omx_base_filter_Private);
+      }
 
+      if(omx_base_filter_Private->BufferMgmtFlushCallback) {
+        (*(omx_base_filter_Private->BufferMgmtFlushCallback))(openmaxStandComp);
+      }
+
+      DEBUG(DEB_LEV_FULL_SEQ, "In %s 2 signalling flush all cond iF=%d,oF=%d iSemVal=%d,oSemval=%d\n",
+        __func__,isInputBufferNeeded,isOutputBufferNeeded,pInputSem->semval,pOutputSem->semval);
+
+      /* The flush is checked again once it is over */
       tsem_up(omx_base_filter_Private->flush_all_condition);
-      tsem_down(omx_base_filter_Private->flush_condition);
-      pthread_mutex_lock(&omx_base_filter_Private->flush_mutex);
+      wait->tsem = omx_base_filter_Private->flush_condition;
+      goto wait;
     }
     pthread_mutex_unlock(&omx_base_filter_Private->flush_mutex);
 
@@ -127,50 +392,79 @@ void* omx_base_filter_BufferMgmtFunction (void* param) {
       (omx_base_filter_Private->state != OMX_StateLoaded && omx_base_filter_Private->state != OMX_StateInvalid)) {
       //Signalled from EmptyThisBuffer or FillThisBuffer or some thing else
       DEBUG(DEB_LEV_FULL_SEQ, "Waiting for next input/output buffer\n");
-      tsem_down(omx_base_filter_Private->bMgmtSem);
-
+      omx_base_filter_Private->nMgmtStage = OMX_BASE_FILTER_STAGE_INPUT;
+      wait->tsem = omx_base_filter_Private->bMgmtSem;
+      goto wait;
     }
+    /* fall through */
+  case OMX_BASE_FILTER_STAGE_INPUT:
     if(omx_base_filter_Private->state == OMX_StateLoaded || omx_base_filter_Private->state == OMX_StateInvalid) {
-      DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s Buffer Management Thread is exiting\n",__func__);
-      break;
+      goto exit;
     }
     if((isOutputBufferNeeded==OMX_TRUE && pOutputSem->semval==0) &&
       (omx_base_filter_Private->state != OMX_StateLoaded && omx_base_filter_Private->state != OMX_StateInvalid) &&
        !(PORT_IS_BEING_FLUSHED(pInPort) || PORT_IS_BEING_FLUSHED(pOutPort))) {
       //Signalled from EmptyThisBuffer or FillThisBuffer or some thing else
       DEBUG(DEB_LEV_FULL_SEQ, "Waiting for next input/output buffer\n");
-      tsem_down(omx_base_filter_Private->bMgmtSem);
-
+      omx_base_filter_Private->nMgmtStage = OMX_BASE_FILTER_STAGE_OUTPUT;
+      wait->tsem = omx_base_filter_Private->bMgmtSem;
+      goto wait;
     }
+    /* fall through */
+  case OMX_BASE_FILTER_STAGE_OUTPUT:
     if(omx_base_filter_Private->state == OMX_StateLoaded || omx_base_filter_Private->state == OMX_StateInvalid) {
-      DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s Buffer Management Thread is exiting\n",__func__);
-      break;
+      goto exit;
+    }
+
+    /*Process together all the buffers ready on both ports*/
+    if(omx_base_filter_Private->BufferMgmtBatchCallback && omx_base_filter_Private->state == OMX_StateExecuting &&
+       isInputBufferNeeded==OMX_TRUE && isOutputBufferNeeded==OMX_TRUE &&
+       pInputSem->semval>1 && pOutputSem->semval>1) {
+      pInputBuffer = omx_base_filter_ProcessBatch(openmaxStandComp);
+      if(pInputBuffer != NULL) {
+        isInputBufferNeeded=OMX_FALSE;
+      }
+      wait->gen = tsem_get_gen(omx_base_component_Private->bStateSem);
+      if(omx_base_filter_Private->nBatchBuffers > 0 &&
+         omx_base_filter_Private->state==OMX_StatePause && !(PORT_IS_BEING_FLUSHED(pInPort) || PORT_IS_BEING_FLUSHED(pOutPort))) {
+        /*Waiting at paused state*/
+        omx_base_filter_Private->nMgmtStage = OMX_BASE_FILTER_STAGE_BATCH;
+        wait->tsem = omx_base_component_Private->bStateSem;
+        wait->bGeneration = 1;
+        goto wait;
+      }
+    }
+    /* fall through */
+  case OMX_BASE_FILTER_STAGE_BATCH:
+    if(omx_base_filter_Private->nBatchBuffers > 0) {
+      omx_base_filter_ReturnBatch(omx_base_filter_Private);
     }
 
     DEBUG(DEB_LEV_SIMPLE_SEQ, "Waiting for input buffer semval=%d \n",pInputSem->semval);
     if(pInputSem->semval>0 && isInputBufferNeeded==OMX_TRUE ) {
       tsem_down(pInputSem);
-      if(pInputQueue->nelem>0){
-        inBufExchanged++;
+      if(getquenelem(pInputQueue)>0){
         isInputBufferNeeded=OMX_FALSE;
         pInputBuffer = dequeue(pInputQueue);
         if(pInputBuffer == NULL){
           DEBUG(DEB_LEV_ERR, "Had NULL input buffer!!\n");
-          break;
+          goto exit;
         }
+        OMX_TRACE(OMX_TRACE_DEQUEUE, omx_base_filter_Private->name, pInPort->sPortParam.nPortIndex, pInputBuffer);
       }
     }
     /*When we have input buffer to process then get one output buffer*/
     if(pOutputSem->semval>0 && isOutputBufferNeeded==OMX_TRUE) {
       tsem_down(pOutputSem);
-      if(pOutputQueue->nelem>0){
-        outBufExchanged++;
+      if(getquenelem(pOutputQueue)>0){
         isOutputBufferNeeded=OMX_FALSE;
         pOutputBuffer = dequeue(pOutputQueue);
         if(pOutputBuffer == NULL){
-          DEBUG(DEB_LEV_ERR, "Had NULL output buffer!! op is=%d,iq=%d\n",pOutputSem->semval,pOutputQueue->nelem);
-          break;
+          DEBUG(DEB_LEV_ERR, "Had NULL output buffer!! op is=%d,iq=%d\n",pOutputSem->semval,getquenelem(pOutputQueue));
+          goto exit;
         }
+        OMX_TRACE(OMX_TRACE_DEQUEUE, omx_base_filter_Private->name, pOutPort->sPortParam.nPortIndex, pOutputBuffer);
+        omx_base_filter_ReleaseAliasedBuffer(omx_base_filter_Private, pOutputBuffer);
       }
     }
 
@@ -194,6 +488,7 @@ void* omx_base_filter_BufferMgmtFunction (void* param) {
       }
     }
 
+    omx_base_filter_Private->bMgmtOutputAliased = OMX_FALSE;
     if(isInputBufferNeeded==OMX_FALSE && isOutputBufferNeeded==OMX_FALSE) {
 
       if(omx_base_filter_Private->pMark.hMarkTargetComponent != NULL){
@@ -211,8 +506,19 @@ void* omx_base_filter_BufferMgmtFunction (void* param) {
       }
 
       if(omx_base_filter_Private->state == OMX_StateExecuting)  {
-        if (omx_base_filter_Private->BufferMgmtCallback && pInputBuffer->nFilledLen > 0) {
+        if (omx_base_filter_Private->BufferMgmtCallback && (pInputBuffer->nFilledLen > 0 ||
+            (omx_base_filter_Private->bDrainOnEOS && (pInputBuffer->nFlags & OMX_BUFFERFLAG_EOS)))) {
+          /* In place processing: the output buffer goes downstream with the payload of the input buffer */
+          if (omx_base_filter_CanAliasBuffer(omx_base_filter_Private, pInputBuffer)) {
+            omx_base_filter_AliasBuffer(omx_base_filter_Private, pOutputBuffer, pInputBuffer);
+            omx_base_filter_Private->bMgmtOutputAliased = OMX_TRUE;
+          }
+          OMX_TRACE(OMX_TRACE_CALLBACK_START, omx_base_filter_Private->name, pInPort->sPortParam.nPortIndex, pInputBuffer);
+          nPerfTime = omx_base_component_PerfTime();
           (*(omx_base_filter_Private->BufferMgmtCallback))(openmaxStandComp, pInputBuffer, pOutputBuffer);
+          PERF_COUNTER_ADD(omx_base_filter_Private->sPerfCounters.nCallbackTime, omx_base_component_PerfTime() - nPerfTime);
+          OMX_TRACE(OMX_TRACE_CALLBACK_END, omx_base_filter_Private->name, pOutPort->sPortParam.nPortIndex, pOutputBuffer);
+          PERF_COUNTER_ADD(omx_base_filter_Private->sPerfCounters.nCallbacks, 1);
         } else {
           /*It no buffer management call back the explicitly consume input buffer*/
           pInputBuffer->nFilledLen = 0;
@@ -223,9 +529,12 @@ void* omx_base_filter_BufferMgmtFunction (void* param) {
           pInputBuffer->nFilledLen = 0;
       }
 
-      if(pInputBuffer->nFlags==OMX_BUFFERFLAG_EOS && pInputBuffer->nFilledLen==0) {
+      /* A component draining its held data at EOS keeps the flag until it writes nothing more */
+      if((pInputBuffer->nFlags & OMX_BUFFERFLAG_EOS) && pInputBuffer->nFilledLen==0 &&
+         !(omx_base_filter_Private->bDrainOnEOS && omx_base_filter_Private->state == OMX_StateExecuting && pOutputBuffer->nFilledLen != 0)) {
         DEBUG(DEB_LEV_FULL_SEQ, "Detected EOS flags in input buffer filled len=%d\n", (int)pInputBuffer->nFilledLen);
-        pOutputBuffer->nFlags=pInputBuffer->nFlags;
+        /* The other flags of the input buffer go with EOS, the ones set by the callback are kept */
+        pOutputBuffer->nFlags |= pInputBuffer->nFlags;
         pInputBuffer->nFlags=0;
         (*(omx_base_filter_Private->callbacks->EventHandler))
           (openmaxStandComp,
@@ -236,33 +545,89 @@ void* omx_base_filter_BufferMgmtFunction (void* param) {
           NULL);
         omx_base_filter_Private->bIsEOSReached = OMX_TRUE;
       }
+      wait->gen = tsem_get_gen(omx_base_component_Private->bStateSem);
       if(omx_base_filter_Private->state==OMX_StatePause && !(PORT_IS_BEING_FLUSHED(pInPort) || PORT_IS_BEING_FLUSHED(pOutPort))) {
         /*Waiting at paused state*/
-        tsem_wait(omx_base_component_Private->bStateSem);
+        omx_base_filter_Private->nMgmtStage = OMX_BASE_FILTER_STAGE_PROCESSED;
+        wait->tsem = omx_base_component_Private->bStateSem;
+        wait->bGeneration = 1;
+        goto wait;
       }
-
+    }
+    /* fall through */
+  case OMX_BASE_FILTER_STAGE_PROCESSED:
+    if(isInputBufferNeeded==OMX_FALSE && isOutputBufferNeeded==OMX_FALSE) {
       /*If EOS and Input buffer Filled Len Zero then Return output buffer immediately*/
-      if((pOutputBuffer->nFilledLen != 0) || (pOutputBuffer->nFlags==OMX_BUFFERFLAG_EOS) || (omx_base_filter_Private->bIsEOSReached == OMX_TRUE)) {
+      if((pOutputBuffer->nFilledLen != 0) || (pOutputBuffer->nFlags & OMX_BUFFERFLAG_EOS) || (omx_base_filter_Private->bIsEOSReached == OMX_TRUE)) {
+        if(omx_base_filter_Private->bMgmtOutputAliased) {
+          /* The input buffer is held until the output buffer comes back */
+          pInputBuffer->nFilledLen = 0;
+          pInputBuffer=NULL;
+          isInputBufferNeeded=OMX_TRUE;
+        }
         pOutPort->ReturnBufferFunction(pOutPort,pOutputBuffer);
-        outBufExchanged--;
         pOutputBuffer=NULL;
         isOutputBufferNeeded=OMX_TRUE;
+      } else if(omx_base_filter_Private->bMgmtOutputAliased) {
+        omx_base_filter_UnaliasBuffer(omx_base_filter_Private, pOutputBuffer);
       }
     }
 
+    wait->gen = tsem_get_gen(omx_base_component_Private->bStateSem);
     if(omx_base_filter_Private->state==OMX_StatePause && !(PORT_IS_BEING_FLUSHED(pInPort) || PORT_IS_BEING_FLUSHED(pOutPort))) {
       /*Waiting at paused state*/
-      tsem_wait(omx_base_component_Private->bStateSem);
+      omx_base_filter_Private->nMgmtStage = OMX_BASE_FILTER_STAGE_RETURN;
+      wait->tsem = omx_base_component_Private->bStateSem;
+      wait->bGeneration = 1;
+      goto wait;
     }
-
+    /* fall through */
+  case OMX_BASE_FILTER_STAGE_RETURN:
     /*Input Buffer has been completely consumed. So, return input buffer*/
-    if((isInputBufferNeeded == OMX_FALSE) && (pInputBuffer->nFilledLen==0)) {
+    if((isInputBufferNeeded == OMX_FALSE) && (pInputBuffer->nFilledLen==0) &&
+       !(omx_base_filter_Private->bDrainOnEOS && (pInputBuffer->nFlags & OMX_BUFFERFLAG_EOS))) {
       pInPort->ReturnBufferFunction(pInPort,pInputBuffer);
-      inBufExchanged--;
       pInputBuffer=NULL;
       isInputBufferNeeded=OMX_TRUE;
     }
   }
+  omx_base_filter_Private->nMgmtStage = OMX_BASE_FILTER_STAGE_START;
+
+wait:
+  omx_base_filter_Private->pMgmtInputBuffer = pInputBuffer;
+  omx_base_filter_Private->pMgmtOutputBuffer = pOutputBuffer;
+  return 0;
+
+exit:
+  DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s Buffer Management Thread is exiting\n",__func__);
+  omx_base_filter_Private->nMgmtStage = OMX_BASE_FILTER_STAGE_START;
+  omx_base_filter_Private->pMgmtInputBuffer = NULL;
+  omx_base_filter_Private->pMgmtOutputBuffer = NULL;
+  return 1;
+}
+
+/** This is the central function for component processing. It
+  * is executed in a separate thread, is synchronized with
+  * semaphores at each port, those are released each time a new buffer
+  * is available on the given port. It runs omx_base_filter_BufferMgmtStep
+  * and blocks on what each step waits for.
+  */
+void* omx_base_filter_BufferMgmtFunction (void* param) {
+  OMX_COMPONENTTYPE* openmaxStandComp = (OMX_COMPONENTTYPE*)param;
+  omx_base_filter_PrivateType* omx_base_filter_Private = (omx_base_filter_PrivateType*)openmaxStandComp->pComponentPrivate;
+  omx_task_wait_t wait;
+  OMX_U64 nPerfTime;
+
+  DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
+  while(omx_base_filter_BufferMgmtStep(openmaxStandComp, &wait) == 0) {
+    if(wait.tsem == omx_base_filter_Private->bMgmtSem) {
+      nPerfTime = omx_base_component_PerfTime();
+      omx_task_wait(&wait);
+      PERF_COUNTER_ADD(omx_base_filter_Private->sPerfCounters.nMgmtWaitTime, omx_base_component_PerfTime() - nPerfTime);
+    } else {
+      omx_task_wait(&wait);
+    }
+  }
   DEBUG(DEB_LEV_SIMPLE_SEQ,"Exiting Buffer Management Thread\n");
   return NULL;
 }
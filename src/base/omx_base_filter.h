@@ -52,6 +52,27 @@
  */
 #define OMX_BASE_FILTER_ALLPORT_INDEX -1
 
+/** OMX_BASE_FILTER_MAX_ALIASES is the largest number of output buffers downstream at once with the payload of an input buffer
+ */
+#define OMX_BASE_FILTER_MAX_ALIASES 32
+
+/** OMX_BASE_FILTER_ALIAS_FLUSH_MSEC is the longest time a flush waits for the aliased output buffers to come back
+ */
+#define OMX_BASE_FILTER_ALIAS_FLUSH_MSEC 50
+
+/** OMX_BASE_FILTER_MAX_BATCH is the largest number of buffer pairs passed at once to BufferMgmtBatchCallback
+ */
+#define OMX_BASE_FILTER_MAX_BATCH 16
+
+/** An output buffer sent downstream with the payload of an input buffer, see bInPlaceProcessing
+ */
+typedef struct omx_base_filter_AliasType {
+  OMX_BUFFERHEADERTYPE* pOutputBuffer; /**< the output buffer carrying the payload of pInputBuffer */
+  OMX_BUFFERHEADERTYPE* pInputBuffer;  /**< the input buffer, held until pOutputBuffer comes back */
+  OMX_U8* pBuffer;                     /**< the payload of pOutputBuffer */
+  OMX_U32 nAllocLen;                   /**< the size of pBuffer */
+} omx_base_filter_AliasType;
+
 /** Base Filter component private structure.
  */
 DERIVEDCLASS(omx_base_filter_PrivateType, omx_base_component_PrivateType)
@@ -59,7 +80,43 @@ DERIVEDCLASS(omx_base_filter_PrivateType, omx_base_component_PrivateType)
   /** @param pPendingOutputBuffer pending Output Buffer pointer */ \
   OMX_BUFFERHEADERTYPE* pPendingOutputBuffer; \
   /** @param BufferMgmtCallback function pointer for algorithm callback */ \
-  void (*BufferMgmtCallback)(OMX_COMPONENTTYPE* openmaxStandComp, OMX_BUFFERHEADERTYPE* inputbuffer, OMX_BUFFERHEADERTYPE* outputbuffer);
+  void (*BufferMgmtCallback)(OMX_COMPONENTTYPE* openmaxStandComp, OMX_BUFFERHEADERTYPE* inputbuffer, OMX_BUFFERHEADERTYPE* outputbuffer); \
+  /** @param bInPlaceProcessing set by derived components whose BufferMgmtCallback works when the output buffer \
+      shares the payload of the input buffer. The callback must then consume the whole input buffer. \
+      The payload is only lent when the output port is tunneled. The input buffer header is left untouched, \
+      and held until the output buffer comes back, or until a flush gives the output buffer a copy of the data */ \
+  OMX_BOOL bInPlaceProcessing; \
+  /** @param sAliases the output buffers downstream with the payload of an input buffer, \
+      only used by the buffer management thread */ \
+  omx_base_filter_AliasType sAliases[OMX_BASE_FILTER_MAX_ALIASES]; \
+  /** @param nAliases number of entries in sAliases */ \
+  OMX_U32 nAliases; \
+  /** @param bDrainOnEOS set by derived components that hold data back, like decoders with an output delay. \
+      BufferMgmtCallback is then also called with the input buffer flagged EOS once it has no data left, \
+      and again until it leaves the output buffer empty: only then is the EOS flag sent out */ \
+  OMX_BOOL bDrainOnEOS; \
+  /** @param BufferMgmtFlushCallback optional function pointer called by the buffer management thread \
+      when the ports are flushed, once it holds no buffer, to drop the data the component holds back */ \
+  void (*BufferMgmtFlushCallback)(OMX_COMPONENTTYPE* openmaxStandComp); \
+  /** @param BufferMgmtBatchCallback optional function pointer called with the buffers queued at the same \
+      time on both ports, in the Executing state. inBufs[i] is processed into outBufs[i], nIn and nOut are \
+      equal; each input buffer must be consumed entirely, and each output buffer is sent out even if left \
+      empty. Buffers carrying a flag, a mark or no data still go one at a time through BufferMgmtCallback */ \
+  void (*BufferMgmtBatchCallback)(OMX_COMPONENTTYPE* openmaxStandComp, OMX_BUFFERHEADERTYPE** inBufs, OMX_U32 nIn, OMX_BUFFERHEADERTYPE** outBufs, OMX_U32 nOut); \
+  /** @param pBatchInputBuffers the input buffers of the batch being processed, NULL for the ones lent to their output buffer */ \
+  OMX_BUFFERHEADERTYPE* pBatchInputBuffers[OMX_BASE_FILTER_MAX_BATCH]; \
+  /** @param pBatchOutputBuffers the output buffers of the batch being processed */ \
+  OMX_BUFFERHEADERTYPE* pBatchOutputBuffers[OMX_BASE_FILTER_MAX_BATCH]; \
+  /** @param nBatchBuffers number of buffer pairs in the batch, 0 if none is held */ \
+  OMX_U32 nBatchBuffers; \
+  /** @param pMgmtInputBuffer the input buffer held by the buffer management step, NULL if none */ \
+  OMX_BUFFERHEADERTYPE* pMgmtInputBuffer; \
+  /** @param pMgmtOutputBuffer the output buffer held by the buffer management step, NULL if none */ \
+  OMX_BUFFERHEADERTYPE* pMgmtOutputBuffer; \
+  /** @param bMgmtOutputAliased true if pMgmtOutputBuffer was lent the payload of pMgmtInputBuffer */ \
+  OMX_BOOL bMgmtOutputAliased; \
+  /** @param nMgmtStage where the next buffer management step resumes */ \
+  int nMgmtStage;
 ENDCLASS(omx_base_filter_PrivateType)
 
 /**
@@ -85,4 +142,13 @@ OMX_ERRORTYPE omx_base_filter_Destructor(OMX_COMPONENTTYPE *openmaxStandComp);
  */
 void* omx_base_filter_BufferMgmtFunction(void* param);
 
+/** Processes the buffers until it would block, and returns what it
+ * waits for. Run by omx_base_filter_BufferMgmtFunction, or as a task
+ * by the shared executor, see omx_executor.h
+ *
+ * @return 0 if another step has to run, non zero when the component
+ * leaves the Idle, Executing and Pause states
+ */
+int omx_base_filter_BufferMgmtStep(void* param, omx_task_wait_t* wait);
+
 #endif
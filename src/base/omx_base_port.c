@@ -26,6 +26,7 @@
   Author $Author$
 */
 
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <omxcore.h>
@@ -34,11 +35,117 @@
 
 #include "omx_base_component.h"
 #include "omx_base_port.h"
+#include "omx_trace.h"
 
 /** The default value for the number of needed buffers for each port. */
 #define DEFAULT_NUMBER_BUFFERS_PER_PORT 2
 /** The default value for the minimum number of needed buffers for each port. */
 #define DEFAULT_MIN_NUMBER_BUFFERS_PER_PORT 2
+/** The alignment of each payload slot of the port buffer pool. */
+#define BUFFER_POOL_SLOT_ALIGNMENT 64
+
+/** Process wide notification of the tunnel state changes, see
+ * base_port_SignalTunnelStateChange. Tunneled components can belong to
+ * different component libraries, but they share this one.
+ */
+static tsem_t tunnelStateSem;
+static pthread_once_t tunnelStateOnce = PTHREAD_ONCE_INIT;
+
+static void base_port_InitTunnelState(void) {
+  tsem_init(&tunnelStateSem, 0);
+}
+
+void base_port_SignalTunnelStateChange(void) {
+  pthread_once(&tunnelStateOnce, base_port_InitTunnelState);
+  tsem_signal(&tunnelStateSem);
+}
+
+unsigned int base_port_GetTunnelStateGen(void) {
+  pthread_once(&tunnelStateOnce, base_port_InitTunnelState);
+  return tsem_get_gen(&tunnelStateSem);
+}
+
+int base_port_WaitTunnelStateChange(unsigned int nGen, const struct timespec* deadline) {
+  pthread_once(&tunnelStateOnce, base_port_InitTunnelState);
+  return tsem_timed_wait_gen(&tunnelStateSem, nGen, deadline);
+}
+
+/** Releases the buffer pool of a port. No pooled buffer must be in use.
+ */
+static void base_port_FreePool(omx_base_PortType *openmaxStandPort) {
+  if(openmaxStandPort->pBufferPool) {
+    free(openmaxStandPort->pBufferPool);
+    openmaxStandPort->pBufferPool = NULL;
+  }
+  if(openmaxStandPort->pHeaderPool) {
+    free(openmaxStandPort->pHeaderPool);
+    openmaxStandPort->pHeaderPool = NULL;
+  }
+  openmaxStandPort->nBufferPoolSlotSize = 0;
+  openmaxStandPort->nBufferPoolCount = 0;
+}
+
+/** Makes sure the buffer pool of a port has a slot of at least nSizeBytes
+ * for each of the nBufferCountActual buffers. The current pool is kept if it
+ * is big enough, otherwise it is replaced, unless some of its slots are in use.
+ * Payloads are not cleared, they are going to be overwritten by the producer.
+ *
+ * @return OMX_ErrorNone if the pool can be used
+ */
+static OMX_ERRORTYPE base_port_PreparePool(omx_base_PortType *openmaxStandPort, OMX_U32 nSizeBytes) {
+  OMX_U32 nCount = openmaxStandPort->sPortParam.nBufferCountActual;
+  OMX_U32 nSlotSize;
+  long nPageSize = sysconf(_SC_PAGESIZE);
+  void* pPool;
+  unsigned int i;
+
+  if (nPageSize <= 0) {
+    nPageSize = 4096;
+  }
+  if (nSizeBytes < openmaxStandPort->sPortParam.nBufferSize) {
+    nSizeBytes = openmaxStandPort->sPortParam.nBufferSize;
+  }
+  /* Keep every slot cache line aligned, and page aligned for big payloads */
+  if (nSizeBytes >= (OMX_U32)nPageSize) {
+    nSlotSize = (nSizeBytes + nPageSize - 1) & ~(nPageSize - 1);
+  } else {
+    nSlotSize = (nSizeBytes + BUFFER_POOL_SLOT_ALIGNMENT - 1) & ~(BUFFER_POOL_SLOT_ALIGNMENT - 1);
+  }
+  if (nSlotSize == 0 || nCount == 0) {
+    return OMX_ErrorBadParameter;
+  }
+
+  if (openmaxStandPort->pBufferPool &&
+      openmaxStandPort->nBufferPoolSlotSize >= nSlotSize &&
+      openmaxStandPort->nBufferPoolCount >= nCount) {
+    return OMX_ErrorNone;
+  }
+
+  for(i=0; i < nCount; i++) {
+    if (openmaxStandPort->bBufferStateAllocated[i] & POOL_ALLOCATED) {
+      DEBUG(DEB_LEV_FULL_SEQ, "In %s pool of port %d in use, cannot grow it\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+      return OMX_ErrorInsufficientResources;
+    }
+  }
+  base_port_FreePool(openmaxStandPort);
+
+  if ((size_t)nSlotSize * nCount / nCount != nSlotSize ||
+      posix_memalign(&pPool, nPageSize, (size_t)nSlotSize * nCount) != 0) {
+    return OMX_ErrorInsufficientResources;
+  }
+  openmaxStandPort->pHeaderPool = calloc(nCount, sizeof(OMX_BUFFERHEADERTYPE));
+  if (!openmaxStandPort->pHeaderPool) {
+    free(pPool);
+    return OMX_ErrorInsufficientResources;
+  }
+  openmaxStandPort->pBufferPool = pPool;
+  openmaxStandPort->nBufferPoolSlotSize = nSlotSize;
+  openmaxStandPort->nBufferPoolCount = nCount;
+  DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s port %d pool of %d x %d bytes\n", __func__,
+    (int)openmaxStandPort->sPortParam.nPortIndex, (int)nCount, (int)nSlotSize);
+  return OMX_ErrorNone;
+}
+
 /**
   * @brief The base contructor for the generic OpenMAX ST port
   *
@@ -115,6 +222,11 @@ OMX_ERRORTYPE base_port_Constructor(OMX_COMPONENTTYPE *openmaxStandComp,omx_base
   (*openmaxStandPort)->bIsEmptyOfBuffers=OMX_FALSE;
   (*openmaxStandPort)->bBufferStateAllocated = NULL;
   (*openmaxStandPort)->pInternalBufferStorage = NULL;
+  (*openmaxStandPort)->pBufferPool = NULL;
+  (*openmaxStandPort)->pHeaderPool = NULL;
+  (*openmaxStandPort)->nBufferPoolSlotSize = 0;
+  (*openmaxStandPort)->nBufferPoolCount = 0;
+  memset(&(*openmaxStandPort)->sPerfCounters, 0, sizeof(perfCountersType));
 
   (*openmaxStandPort)->PortDestructor = &base_port_Destructor;
   (*openmaxStandPort)->Port_AllocateBuffer = &base_port_AllocateBuffer;
@@ -152,6 +264,8 @@ OMX_ERRORTYPE base_port_Destructor(omx_base_PortType *openmaxStandPort){
     openmaxStandPort->pBufferSem=NULL;
   }
 
+  base_port_FreePool(openmaxStandPort);
+
   free(openmaxStandPort);
   openmaxStandPort = NULL;
   return OMX_ErrorNone;
@@ -171,15 +285,12 @@ OMX_ERRORTYPE base_port_FlushProcessingBuffers(omx_base_PortType *openmaxStandPo
   if(openmaxStandPort->sPortParam.eDomain!=OMX_PortDomainOther) { /* clock buffers not used in the clients buffer managment function */
     pthread_mutex_lock(&omx_base_component_Private->flush_mutex);
     openmaxStandPort->bIsPortFlushed=OMX_TRUE;
-    /*Signal the buffer management thread of port flush,if it is waiting for buffers*/
-    if(omx_base_component_Private->bMgmtSem->semval==0) {
-      tsem_up(omx_base_component_Private->bMgmtSem);
-    }
+    /* Always wake the buffer management thread: it may have seen the port not flushed
+     * yet and be about to wait. The count left over is reset once the flush is done */
+    tsem_up(omx_base_component_Private->bMgmtSem);
 
-    if(omx_base_component_Private->state != OMX_StateExecuting ) {
-      /*Waiting at paused state*/
-      tsem_signal(omx_base_component_Private->bStateSem);
-    }
+    /* Wake it up if it waits at paused state */
+    tsem_signal(omx_base_component_Private->bStateSem);
     DEBUG(DEB_LEV_FULL_SEQ, "In %s waiting for flush all condition port index =%d\n", __func__,(int)openmaxStandPort->sPortParam.nPortIndex);
     /* Wait until flush is completed */
     pthread_mutex_unlock(&omx_base_component_Private->flush_mutex);
@@ -192,7 +303,7 @@ OMX_ERRORTYPE base_port_FlushProcessingBuffers(omx_base_PortType *openmaxStandPo
   while (openmaxStandPort->pBufferSem->semval > 0) {
     DEBUG(DEB_LEV_FULL_SEQ, "In %s TFlag=%x Flusing Port=%d,Semval=%d Qelem=%d\n",
     __func__,(int)openmaxStandPort->nTunnelFlags,(int)openmaxStandPort->sPortParam.nPortIndex,
-    (int)openmaxStandPort->pBufferSem->semval,(int)openmaxStandPort->pBufferQueue->nelem);
+    (int)openmaxStandPort->pBufferSem->semval,(int)getquenelem(openmaxStandPort->pBufferQueue));
 
     tsem_down(openmaxStandPort->pBufferSem);
     pBuffer = dequeue(openmaxStandPort->pBufferQueue);
@@ -205,7 +316,9 @@ OMX_ERRORTYPE base_port_FlushProcessingBuffers(omx_base_PortType *openmaxStandPo
         ((OMX_COMPONENTTYPE*)(openmaxStandPort->hTunneledComponent))->EmptyThisBuffer(openmaxStandPort->hTunneledComponent, pBuffer);
       }
     } else if (PORT_IS_TUNNELED_N_BUFFER_SUPPLIER(openmaxStandPort)) {
-      queue(openmaxStandPort->pBufferQueue,pBuffer);
+      if (queue(openmaxStandPort->pBufferQueue,pBuffer) != 0) {
+        DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+      }
     } else {
       (*(openmaxStandPort->BufferProcessedCallback))(
         openmaxStandPort->standCompContainer,
@@ -215,9 +328,9 @@ OMX_ERRORTYPE base_port_FlushProcessingBuffers(omx_base_PortType *openmaxStandPo
   }
   /*Port is tunneled and supplier and didn't received all it's buffer then wait for the buffers*/
   if (PORT_IS_TUNNELED_N_BUFFER_SUPPLIER(openmaxStandPort)) {
-    while(openmaxStandPort->pBufferQueue->nelem!= openmaxStandPort->nNumAssignedBuffers){
+    while(getquenelem(openmaxStandPort->pBufferQueue)!= openmaxStandPort->nNumAssignedBuffers){
       tsem_down(openmaxStandPort->pBufferSem);
-      DEBUG(DEB_LEV_PARAMS, "In %s Got a buffer qelem=%d\n",__func__,openmaxStandPort->pBufferQueue->nelem);
+      DEBUG(DEB_LEV_PARAMS, "In %s Got a buffer qelem=%d\n",__func__,getquenelem(openmaxStandPort->pBufferQueue));
     }
     tsem_reset(openmaxStandPort->pBufferSem);
   }
@@ -233,7 +346,7 @@ OMX_ERRORTYPE base_port_FlushProcessingBuffers(omx_base_PortType *openmaxStandPo
 
   DEBUG(DEB_LEV_PARAMS, "In %s TFlag=%x Qelem=%d BSem=%d bMgmtsem=%d component=%s\n", __func__,
     (int)openmaxStandPort->nTunnelFlags,
-    (int)openmaxStandPort->pBufferQueue->nelem,
+    (int)getquenelem(openmaxStandPort->pBufferQueue),
     (int)openmaxStandPort->pBufferSem->semval,
     (int)omx_base_component_Private->bMgmtSem->semval,
     omx_base_component_Private->name);
@@ -271,7 +384,7 @@ OMX_ERRORTYPE base_port_DisablePort(omx_base_PortType *openmaxStandPort) {
       tsem_reset(omx_base_component_Private->bMgmtSem);
     } else {
       /*Since port is being disabled then remove buffers from the queue*/
-      while(openmaxStandPort->pBufferQueue->nelem > 0) {
+      while(getquenelem(openmaxStandPort->pBufferQueue) > 0) {
         dequeue(openmaxStandPort->pBufferQueue);
       }
 
@@ -279,13 +392,13 @@ OMX_ERRORTYPE base_port_DisablePort(omx_base_PortType *openmaxStandPort) {
       if(err!=OMX_ErrorNone) {
         DEBUG(DEB_LEV_ERR, "In %s Freeing Tunnel Buffer Error=%x\n",__func__,err);
       }
-      DEBUG(DEB_LEV_PARAMS, "In %s Qelem=%d\n", __func__,openmaxStandPort->pBufferQueue->nelem);
+      DEBUG(DEB_LEV_PARAMS, "In %s Qelem=%d\n", __func__,getquenelem(openmaxStandPort->pBufferQueue));
     }
   }
 
   DEBUG(DEB_LEV_PARAMS, "In %s TFlag=%x Qelem=%d BSem=%d bMgmtsem=%d component=%s\n", __func__,
     (int)openmaxStandPort->nTunnelFlags,
-    (int)openmaxStandPort->pBufferQueue->nelem,
+    (int)getquenelem(openmaxStandPort->pBufferQueue),
     (int)openmaxStandPort->pBufferSem->semval,
     (int)omx_base_component_Private->bMgmtSem->semval,
     omx_base_component_Private->name);
@@ -297,6 +410,26 @@ OMX_ERRORTYPE base_port_DisablePort(omx_base_PortType *openmaxStandPort) {
   return err;
 }
 
+/** @brief Selects the buffer queue backend of the port.
+ *
+ * Clock ports are left on the mutex backend, since some components consume
+ * them from more than one thread.
+ *
+ * @param openmaxStandPort the reference to the port
+ */
+void base_port_SelectQueueType(omx_base_PortType *openmaxStandPort) {
+  QUEUE_TYPE type = QUEUE_TYPE_MUTEX;
+
+  if (PORT_IS_TUNNELED(openmaxStandPort) && !PORT_IS_BUFFER_SUPPLIER(openmaxStandPort) &&
+      openmaxStandPort->sPortParam.eDomain != OMX_PortDomainOther) {
+    type = QUEUE_TYPE_SPSC;
+  }
+  if (queue_set_type(openmaxStandPort->pBufferQueue, type) != 0) {
+    DEBUG(DEB_LEV_FULL_SEQ, "In %s keeping queue type %d on port %d\n", __func__,
+      (int)openmaxStandPort->pBufferQueue->type, (int)openmaxStandPort->sPortParam.nPortIndex);
+  }
+}
+
 /** @brief Enables the port.
  *
  * This function is called due to a request by the IL client
@@ -315,6 +448,12 @@ OMX_ERRORTYPE base_port_EnablePort(omx_base_PortType *openmaxStandPort) {
   }
   omx_base_component_Private = (omx_base_component_PrivateType*)openmaxStandPort->standCompContainer->pComponentPrivate;
 
+  /* The port holds no buffer while disabled */
+  if(queue_resize(openmaxStandPort->pBufferQueue, openmaxStandPort->sPortParam.nBufferCountActual) != 0) {
+    DEBUG(DEB_LEV_ERR, "In %s could not resize the queue of port %d\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+    return OMX_ErrorInsufficientResources;
+  }
+  base_port_SelectQueueType(openmaxStandPort);
   openmaxStandPort->sPortParam.bEnabled = OMX_TRUE;
 
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s port T flag=%x popu=%d state=%x\n", __func__,
@@ -342,7 +481,7 @@ OMX_ERRORTYPE base_port_EnablePort(omx_base_PortType *openmaxStandPort) {
         tsem_up(omx_base_component_Private->bMgmtSem);
       }
     }
-    DEBUG(DEB_LEV_PARAMS, "In %s Qelem=%d BSem=%d\n", __func__,openmaxStandPort->pBufferQueue->nelem,openmaxStandPort->pBufferSem->semval);
+    DEBUG(DEB_LEV_PARAMS, "In %s Qelem=%d BSem=%d\n", __func__,getquenelem(openmaxStandPort->pBufferQueue),openmaxStandPort->pBufferSem->semval);
   }
 
   openmaxStandPort->bIsTransientToEnabled = OMX_FALSE;
@@ -393,22 +532,32 @@ OMX_ERRORTYPE base_port_AllocateBuffer(
 
   for(i=0; i < openmaxStandPort->sPortParam.nBufferCountActual; i++){
     if (openmaxStandPort->bBufferStateAllocated[i] == BUFFER_FREE) {
-      openmaxStandPort->pInternalBufferStorage[i] = calloc(1,sizeof(OMX_BUFFERHEADERTYPE));
-      if (!openmaxStandPort->pInternalBufferStorage[i]) {
-        return OMX_ErrorInsufficientResources;
+      if (base_port_PreparePool(openmaxStandPort, nSizeBytes) == OMX_ErrorNone) {
+        /* take the header and the payload from the port pool */
+        openmaxStandPort->pInternalBufferStorage[i] = &openmaxStandPort->pHeaderPool[i];
+        memset(openmaxStandPort->pInternalBufferStorage[i], 0, sizeof(OMX_BUFFERHEADERTYPE));
+        openmaxStandPort->pInternalBufferStorage[i]->pBuffer = openmaxStandPort->pBufferPool + i * openmaxStandPort->nBufferPoolSlotSize;
+        openmaxStandPort->bBufferStateAllocated[i] = BUFFER_ALLOCATED | POOL_ALLOCATED;
+      } else {
+        openmaxStandPort->pInternalBufferStorage[i] = calloc(1,sizeof(OMX_BUFFERHEADERTYPE));
+        if (!openmaxStandPort->pInternalBufferStorage[i]) {
+          return OMX_ErrorInsufficientResources;
+        }
+        /* allocate the buffer */
+        openmaxStandPort->pInternalBufferStorage[i]->pBuffer = calloc(1,nSizeBytes);
+        if(openmaxStandPort->pInternalBufferStorage[i]->pBuffer==NULL) {
+          free(openmaxStandPort->pInternalBufferStorage[i]);
+          openmaxStandPort->pInternalBufferStorage[i] = NULL;
+          return OMX_ErrorInsufficientResources;
+        }
+        openmaxStandPort->bBufferStateAllocated[i] = BUFFER_ALLOCATED;
+        openmaxStandPort->bBufferStateAllocated[i] |= HEADER_ALLOCATED;
       }
       setHeader(openmaxStandPort->pInternalBufferStorage[i], sizeof(OMX_BUFFERHEADERTYPE));
-      /* allocate the buffer */
-      openmaxStandPort->pInternalBufferStorage[i]->pBuffer = calloc(1,nSizeBytes);
-      if(openmaxStandPort->pInternalBufferStorage[i]->pBuffer==NULL) {
-        return OMX_ErrorInsufficientResources;
-      }
       openmaxStandPort->pInternalBufferStorage[i]->nAllocLen = nSizeBytes;
       openmaxStandPort->pInternalBufferStorage[i]->pPlatformPrivate = openmaxStandPort;
       openmaxStandPort->pInternalBufferStorage[i]->pAppPrivate = pAppPrivate;
       *pBuffer = openmaxStandPort->pInternalBufferStorage[i];
-      openmaxStandPort->bBufferStateAllocated[i] = BUFFER_ALLOCATED;
-      openmaxStandPort->bBufferStateAllocated[i] |= HEADER_ALLOCATED;
       if (openmaxStandPort->sPortParam.eDir == OMX_DirInput) {
         openmaxStandPort->pInternalBufferStorage[i]->nInputPortIndex = openmaxStandPort->sPortParam.nPortIndex;
       } else {
@@ -556,7 +705,11 @@ OMX_ERRORTYPE base_port_FreeBuffer(
     if (openmaxStandPort->bBufferStateAllocated[i] & (BUFFER_ASSIGNED | BUFFER_ALLOCATED)) {
 
       openmaxStandPort->bIsFullOfBuffers = OMX_FALSE;
-      if (openmaxStandPort->bBufferStateAllocated[i] & BUFFER_ALLOCATED) {
+      if (openmaxStandPort->bBufferStateAllocated[i] & POOL_ALLOCATED) {
+        /* header and payload stay in the port pool for the next allocation */
+        openmaxStandPort->pInternalBufferStorage[i]->pBuffer=NULL;
+        openmaxStandPort->pInternalBufferStorage[i]=NULL;
+      } else if (openmaxStandPort->bBufferStateAllocated[i] & BUFFER_ALLOCATED) {
         if(openmaxStandPort->pInternalBufferStorage[i]->pBuffer){
           DEBUG(DEB_LEV_PARAMS, "In %s freeing %i pBuffer=%x\n",__func__, (int)i, (int)openmaxStandPort->pInternalBufferStorage[i]->pBuffer);
           free(openmaxStandPort->pInternalBufferStorage[i]->pBuffer);
@@ -596,7 +749,10 @@ OMX_ERRORTYPE base_port_AllocateTunnelBuffer(
   omx_base_component_PrivateType* omx_base_component_Private = (omx_base_component_PrivateType*)omxComponent->pComponentPrivate;
   OMX_U8* pBuffer=NULL;
   OMX_ERRORTYPE eError=OMX_ErrorNone,err;
-  OMX_U32 numRetry=0,nBufferSize = nSizeBytes;
+  OMX_U32 nBufferSize = nSizeBytes;
+  struct timespec deadline;
+  unsigned int nTunnelGen;
+  BUFFER_STATUS_FLAG nBufferState;
   OMX_PARAM_PORTDEFINITIONTYPE sPortDef;
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
 
@@ -624,27 +780,35 @@ OMX_ERRORTYPE base_port_AllocateTunnelBuffer(
     nBufferSize = (sPortDef.nBufferSize > nSizeBytes) ? sPortDef.nBufferSize: nSizeBytes;
   }
 
+  tsem_deadline(&deadline, TUNNEL_USE_BUFFER_TIMEOUT_MSEC);
   for(i=0; i < openmaxStandPort->sPortParam.nBufferCountActual; i++){
     if (openmaxStandPort->bBufferStateAllocated[i] == BUFFER_FREE) {
-      pBuffer = calloc(1,nBufferSize);
-      if(pBuffer==NULL) {
-        return OMX_ErrorInsufficientResources;
+      if (base_port_PreparePool(openmaxStandPort, nBufferSize) == OMX_ErrorNone) {
+        pBuffer = openmaxStandPort->pBufferPool + i * openmaxStandPort->nBufferPoolSlotSize;
+        nBufferState = BUFFER_ALLOCATED | POOL_ALLOCATED;
+      } else {
+        pBuffer = calloc(1,nBufferSize);
+        if(pBuffer==NULL) {
+          return OMX_ErrorInsufficientResources;
+        }
+        nBufferState = BUFFER_ALLOCATED;
       }
-      /*Retry more than once, if the tunneled component is not in Loaded->Idle State*/
-      while(numRetry <TUNNEL_USE_BUFFER_RETRY) {
+      /*Retry until the deadline, if the tunneled component is not in Loaded->Idle State*/
+      while(1) {
+        nTunnelGen = base_port_GetTunnelStateGen();
         eError=OMX_UseBuffer(openmaxStandPort->hTunneledComponent,&openmaxStandPort->pInternalBufferStorage[i],
                              openmaxStandPort->nTunneledPort,NULL,nBufferSize,pBuffer);
         if(eError!=OMX_ErrorNone) {
-          DEBUG(DEB_LEV_FULL_SEQ,"Tunneled Component Couldn't Use buffer %i From Comp=%s Retry=%d\n",
-          i,omx_base_component_Private->name,(int)numRetry);
+          DEBUG(DEB_LEV_FULL_SEQ,"Tunneled Component Couldn't Use buffer %i From Comp=%s\n",
+          i,omx_base_component_Private->name);
 
-          if((eError ==  OMX_ErrorIncorrectStateTransition) && numRetry<TUNNEL_USE_BUFFER_RETRY) {
-            DEBUG(DEB_LEV_FULL_SEQ,"Waiting for next try %i \n",(int)numRetry);
-            usleep(TUNNEL_USE_BUFFER_RETRY_USLEEP_TIME);
-            numRetry++;
+          if((eError ==  OMX_ErrorIncorrectStateTransition) && base_port_WaitTunnelStateChange(nTunnelGen, &deadline) == 0) {
+            DEBUG(DEB_LEV_FULL_SEQ,"Trying again after a tunnel state change\n");
             continue;
           }
-          free(pBuffer);
+          if (!(nBufferState & POOL_ALLOCATED)) {
+            free(pBuffer);
+          }
           pBuffer = NULL;
           return eError;
         }
@@ -653,12 +817,14 @@ OMX_ERRORTYPE base_port_AllocateTunnelBuffer(
         }
       }
       if(eError!=OMX_ErrorNone) {
-        free(pBuffer);
+        if (!(nBufferState & POOL_ALLOCATED)) {
+          free(pBuffer);
+        }
         pBuffer = NULL;
         DEBUG(DEB_LEV_ERR,"In %s Tunneled Component Couldn't Use Buffer %x \n",__func__,(int)eError);
         return eError;
       }
-      openmaxStandPort->bBufferStateAllocated[i] = BUFFER_ALLOCATED;
+      openmaxStandPort->bBufferStateAllocated[i] = nBufferState;
       openmaxStandPort->nNumAssignedBuffers++;
       DEBUG(DEB_LEV_PARAMS, "openmaxStandPort->nNumAssignedBuffers %i\n", (int)openmaxStandPort->nNumAssignedBuffers);
 
@@ -667,7 +833,10 @@ OMX_ERRORTYPE base_port_AllocateTunnelBuffer(
         openmaxStandPort->bIsFullOfBuffers = OMX_TRUE;
         DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s nPortIndex=%d\n",__func__, (int)nPortIndex);
       }
-      queue(openmaxStandPort->pBufferQueue, openmaxStandPort->pInternalBufferStorage[i]);
+      if (queue(openmaxStandPort->pBufferQueue, openmaxStandPort->pInternalBufferStorage[i]) != 0) {
+        DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)nPortIndex);
+        return OMX_ErrorInsufficientResources;
+      }
     }
   }
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s Allocated all buffers\n",__func__);
@@ -680,7 +849,8 @@ OMX_ERRORTYPE base_port_FreeTunnelBuffer(omx_base_PortType *openmaxStandPort,OMX
   OMX_COMPONENTTYPE* omxComponent = openmaxStandPort->standCompContainer;
   omx_base_component_PrivateType* omx_base_component_Private = (omx_base_component_PrivateType*)omxComponent->pComponentPrivate;
   OMX_ERRORTYPE eError=OMX_ErrorNone;
-  OMX_U32 numRetry=0;
+  struct timespec deadline;
+  unsigned int nTunnelGen;
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
 
   if (nPortIndex != openmaxStandPort->sPortParam.nPortIndex) {
@@ -705,23 +875,25 @@ OMX_ERRORTYPE base_port_FreeTunnelBuffer(omx_base_PortType *openmaxStandPort,OMX
     }
   }
 
+  tsem_deadline(&deadline, TUNNEL_USE_BUFFER_TIMEOUT_MSEC);
   for(i=0; i < openmaxStandPort->sPortParam.nBufferCountActual; i++){
     if (openmaxStandPort->bBufferStateAllocated[i] & (BUFFER_ASSIGNED | BUFFER_ALLOCATED)) {
 
       openmaxStandPort->bIsFullOfBuffers = OMX_FALSE;
       if (openmaxStandPort->bBufferStateAllocated[i] & BUFFER_ALLOCATED) {
-        free(openmaxStandPort->pInternalBufferStorage[i]->pBuffer);
+        if (!(openmaxStandPort->bBufferStateAllocated[i] & POOL_ALLOCATED)) {
+          free(openmaxStandPort->pInternalBufferStorage[i]->pBuffer);
+        }
         openmaxStandPort->pInternalBufferStorage[i]->pBuffer = NULL;
       }
-      /*Retry more than once, if the tunneled component is not in Idle->Loaded State*/
-      while(numRetry <TUNNEL_USE_BUFFER_RETRY) {
+      /*Retry until the deadline, if the tunneled component is not in Idle->Loaded State*/
+      while(1) {
+        nTunnelGen = base_port_GetTunnelStateGen();
         eError=OMX_FreeBuffer(openmaxStandPort->hTunneledComponent,openmaxStandPort->nTunneledPort,openmaxStandPort->pInternalBufferStorage[i]);
         if(eError!=OMX_ErrorNone) {
           DEBUG(DEB_LEV_ERR,"Tunneled Component Couldn't free buffer %i \n",i);
-          if((eError ==  OMX_ErrorIncorrectStateTransition) && numRetry<TUNNEL_USE_BUFFER_RETRY) {
-            DEBUG(DEB_LEV_ERR,"Waiting for next try %i \n",(int)numRetry);
-            usleep(TUNNEL_USE_BUFFER_RETRY_USLEEP_TIME);
-            numRetry++;
+          if((eError ==  OMX_ErrorIncorrectStateTransition) && base_port_WaitTunnelStateChange(nTunnelGen, &deadline) == 0) {
+            DEBUG(DEB_LEV_ERR,"Trying again after a tunnel state change\n");
             continue;
           }
           return eError;
@@ -741,7 +913,7 @@ OMX_ERRORTYPE base_port_FreeTunnelBuffer(omx_base_PortType *openmaxStandPort,OMX
       }
     }
   }
-  DEBUG(DEB_LEV_FUNCTION_NAME, "In %s Qelem=%d BSem=%d\n", __func__,openmaxStandPort->pBufferQueue->nelem,openmaxStandPort->pBufferSem->semval);
+  DEBUG(DEB_LEV_FUNCTION_NAME, "In %s Qelem=%d BSem=%d\n", __func__,getquenelem(openmaxStandPort->pBufferQueue),openmaxStandPort->pBufferSem->semval);
   return OMX_ErrorNone;
 }
 
@@ -812,14 +984,20 @@ OMX_ERRORTYPE base_port_SendBufferFunction(
 
   /* And notify the buffer management thread we have a fresh new buffer to manage */
   if(!PORT_IS_BEING_FLUSHED(openmaxStandPort) && !(PORT_IS_BEING_DISABLED(openmaxStandPort) && PORT_IS_TUNNELED_N_BUFFER_SUPPLIER(openmaxStandPort))){
-    queue(openmaxStandPort->pBufferQueue, pBuffer);
+    if (queue(openmaxStandPort->pBufferQueue, pBuffer) != 0) {
+      DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+      return OMX_ErrorInsufficientResources;
+    }
     tsem_up(openmaxStandPort->pBufferSem);
     DEBUG(DEB_LEV_PARAMS, "In %s Signalling bMgmtSem Port Index=%d\n",__func__, (int)portIndex);
     tsem_up(omx_base_component_Private->bMgmtSem);
   }else if(PORT_IS_BUFFER_SUPPLIER(openmaxStandPort)){
     DEBUG(DEB_LEV_FULL_SEQ, "In %s: Comp %s received io:%d buffer\n",
         __func__,omx_base_component_Private->name,(int)openmaxStandPort->sPortParam.nPortIndex);
-    queue(openmaxStandPort->pBufferQueue, pBuffer);
+    if (queue(openmaxStandPort->pBufferQueue, pBuffer) != 0) {
+      DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+      return OMX_ErrorInsufficientResources;
+    }
     tsem_up(openmaxStandPort->pBufferSem);
   }
   else { // If port being flushed and not tunneled then return error
@@ -839,6 +1017,12 @@ OMX_ERRORTYPE base_port_ReturnBufferFunction(omx_base_PortType* openmaxStandPort
   OMX_ERRORTYPE eError = OMX_ErrorNone;
 
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
+  OMX_TRACE(OMX_TRACE_RETURN_BUFFER, omx_base_component_Private->name, openmaxStandPort->sPortParam.nPortIndex, pBuffer);
+  PERF_COUNTER_ADD(openmaxStandPort->sPerfCounters.nBuffersOut, 1);
+  PERF_COUNTER_ADD(openmaxStandPort->sPerfCounters.nBytesOut, pBuffer->nFilledLen);
+  if (pBuffer->nFlags & OMX_BUFFERFLAG_EOS) {
+    PERF_COUNTER_ADD(openmaxStandPort->sPerfCounters.nEOS, 1);
+  }
   if (PORT_IS_TUNNELED(openmaxStandPort) &&
     ! PORT_IS_BUFFER_SUPPLIER(openmaxStandPort)) {
     if (openmaxStandPort->sPortParam.eDir == OMX_DirInput) {
@@ -867,7 +1051,10 @@ OMX_ERRORTYPE base_port_ReturnBufferFunction(omx_base_PortType* openmaxStandPort
         DEBUG(DEB_LEV_FULL_SEQ, "In %s eError %08x in FillThis Buffer from Component %s Supplier\n",
         __func__, eError,omx_base_component_Private->name);
         /*If Error Occured then queue the buffer*/
-        queue(pQueue, pBuffer);
+        if (queue(pQueue, pBuffer) != 0) {
+          DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+          return OMX_ErrorInsufficientResources;
+        }
         tsem_up(pSem);
       }
     } else {
@@ -876,7 +1063,10 @@ OMX_ERRORTYPE base_port_ReturnBufferFunction(omx_base_PortType* openmaxStandPort
         DEBUG(DEB_LEV_FULL_SEQ, "In %s eError %08x in EmptyThis Buffer from Component %s Supplier\n",
         __func__, eError,omx_base_component_Private->name);
         /*If Error Occured then queue the buffer*/
-        queue(pQueue, pBuffer);
+        if (queue(pQueue, pBuffer) != 0) {
+          DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+          return OMX_ErrorInsufficientResources;
+        }
         tsem_up(pSem);
       }
     }
@@ -887,7 +1077,10 @@ OMX_ERRORTYPE base_port_ReturnBufferFunction(omx_base_PortType* openmaxStandPort
       pBuffer);
   }
   else {
-    queue(pQueue,pBuffer);
+    if (queue(pQueue,pBuffer) != 0) {
+      DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+      return OMX_ErrorInsufficientResources;
+    }
     openmaxStandPort->nNumBufferFlushed++;
   }
 
@@ -34,8 +34,57 @@
 #ifndef __OMX_BASE_PORT_H__
 #define __OMX_BASE_PORT_H__
 
-#define TUNNEL_USE_BUFFER_RETRY 20
-#define TUNNEL_USE_BUFFER_RETRY_USLEEP_TIME 50000
+/** Maximum time, in milliseconds, a supplier port keeps trying to use or
+ * free the buffers of a tunneled port that is not yet in the proper
+ * transient state. It is tried again on each tunnel state notification
+ */
+#define TUNNEL_USE_BUFFER_TIMEOUT_MSEC 1000
+
+/** The performance counters are updated with relaxed atomic operations where
+ * available. Readers may see the fields of a block at slightly different times.
+ */
+#if defined(__GCC_ATOMIC_LLONG_LOCK_FREE) && __GCC_ATOMIC_LLONG_LOCK_FREE == 2
+#define PERF_COUNTER_ADD(counter, value) __atomic_fetch_add(&(counter), (value), __ATOMIC_RELAXED)
+#define PERF_COUNTER_READ(counter)       __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+#define PERF_COUNTER_MAX(counter, value) do { \
+    OMX_U32 nPerfCounterOld = __atomic_load_n(&(counter), __ATOMIC_RELAXED); \
+    while (nPerfCounterOld < (OMX_U32)(value) && \
+      !__atomic_compare_exchange_n(&(counter), &nPerfCounterOld, (OMX_U32)(value), 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)); \
+  } while (0)
+#else
+#define PERF_COUNTER_ADD(counter, value) ((counter) += (value))
+#define PERF_COUNTER_READ(counter)       (counter)
+#define PERF_COUNTER_MAX(counter, value) do { \
+    if ((counter) < (OMX_U32)(value)) { \
+      (counter) = (value); \
+    } \
+  } while (0)
+#endif
+
+/** @brief Performance counters of a port or of a component, returned by
+ * GetConfig with the OMX_IndexVendorPerfCounters index. The buffer, byte,
+ * queue and flush counters are kept by the ports, the time counters by the
+ * component. Times are in microseconds.
+ *
+ * Components with their own buffer management function count their
+ * processing step as the callback: the mix of the audio mixer, the image
+ * of the jpeg encoder and the clock update of the clock source. The jpeg
+ * decoder counts each band decoded by its threads, so its callback time
+ * adds up the time of all the threads. The camera source keeps only the
+ * port counters.
+ */
+typedef struct perfCountersType {
+  OMX_U32 nBuffersIn; /**< Buffers received through EmptyThisBuffer or FillThisBuffer */
+  OMX_U32 nBuffersOut; /**< Buffers given back to the client or to the tunneled component */
+  OMX_U64 nBytesIn; /**< Filled bytes of the received buffers */
+  OMX_U64 nBytesOut; /**< Filled bytes of the buffers given back */
+  OMX_U32 nQueueHighWater; /**< Maximum number of buffers waiting in the port queue */
+  OMX_U32 nEOS; /**< Buffers received or given back with the EOS flag */
+  OMX_U32 nFlushes; /**< Flushes of the port */
+  OMX_U64 nMgmtWaitTime; /**< Time the buffer management thread waited on bMgmtSem */
+  OMX_U64 nCallbackTime; /**< Time spent in the BufferMgmtCallback of the component */
+  OMX_U32 nCallbacks; /**< Calls to the BufferMgmtCallback of the component */
+} perfCountersType;
 
 /**
  * Port Specific Macro's
@@ -79,8 +128,10 @@ typedef enum BUFFER_STATUS_FLAG {
                  by the given port of the component */
   BUFFER_ASSIGNED = 0x0002, /**< This flag is applied to a buffer when it is assigned
                 from another port or by the IL client */
-  HEADER_ALLOCATED = 0x0004 /**< This flag is applied to a buffer when buffer header is allocated 
+  HEADER_ALLOCATED = 0x0004, /**< This flag is applied to a buffer when buffer header is allocated 
                 by the given port of the component */
+  POOL_ALLOCATED = 0x0008 /**< This flag is applied to a buffer when its payload, and its header if
+                the port provides it, are slots of the port buffer pool */
   } BUFFER_STATUS_FLAG;
 
 /** @brief the status of a port related to the tunneling with another component
@@ -122,6 +173,11 @@ CLASS(omx_base_PortType)
   OMX_PARAM_PORTDEFINITIONTYPE sPortParam; /**< @param sPortParam General OpenMAX port parameter */\
   OMX_BUFFERHEADERTYPE **pInternalBufferStorage; /**< This array contains the reference to all the buffers hadled by this port and already registered*/\
   BUFFER_STATUS_FLAG *bBufferStateAllocated; /**< @param bBufferStateAllocated The State of the Buffer whether assigned or allocated */\
+  OMX_U8* pBufferPool; /**< @param pBufferPool Page aligned block holding the payloads allocated by the port, kept across Idle->Loaded->Idle */\
+  OMX_BUFFERHEADERTYPE* pHeaderPool; /**< @param pHeaderPool Contiguous headers for the buffers allocated by the port */\
+  OMX_U32 nBufferPoolSlotSize; /**< @param nBufferPoolSlotSize Size of each payload slot in pBufferPool */\
+  OMX_U32 nBufferPoolCount; /**< @param nBufferPoolCount Number of slots in pBufferPool and pHeaderPool */\
+  perfCountersType sPerfCounters; /**< @param sPerfCounters Performance counters of the port */\
   OMX_COMPONENTTYPE *standCompContainer;/**< The OpenMAX component reference that contains this port */\
   OMX_BOOL bIsTransientToEnabled;/**< It indicates that the port is going from disabled to enabled */ \
   OMX_BOOL bIsTransientToDisabled;/**< It indicates that the port is going from enabled to disabled */ \
@@ -186,6 +242,44 @@ OMX_ERRORTYPE base_port_DisablePort(omx_base_PortType *openmaxStandPort);
  */
 OMX_ERRORTYPE base_port_EnablePort(omx_base_PortType *openmaxStandPort);
 
+/** @brief Selects the buffer queue backend of the port.
+ * 
+ * A tunneled, non supplier port only receives buffers from the buffer
+ * management thread of its peer and only releases them from its own one,
+ * so its queue can use the lock-free SPSC backend. All other ports keep
+ * the mutex backend. Must be called while the queue is empty.
+ * 
+ * @param openmaxStandPort the reference to the port
+ */
+void base_port_SelectQueueType(omx_base_PortType *openmaxStandPort);
+
+/** @brief Notifies the supplier ports of the process that a component
+ * entered a state in which its ports accept or release tunnel buffers.
+ *
+ * Called when a component starts the Loaded to Idle or Idle to Loaded
+ * transition, or when a port starts to be enabled or disabled.
+ */
+void base_port_SignalTunnelStateChange(void);
+
+/** @brief Returns the current generation of the tunnel state notification,
+ * to be read before trying an operation on the tunneled port.
+ */
+unsigned int base_port_GetTunnelStateGen(void);
+
+/** @brief Waits for a tunnel state notification following the generation
+ * read with base_port_GetTunnelStateGen.
+ *
+ * The notifications of all the components of the process wake the waiting
+ * ports, so the retries of a port are bounded by one absolute deadline
+ * rather than by a number of wake ups.
+ *
+ * @param nGen the generation read before the failed operation
+ * @param deadline the absolute time to give up, see tsem_deadline
+ *
+ * @return 0 if a notification arrived, -1 once the deadline has passed
+ */
+int base_port_WaitTunnelStateChange(unsigned int nGen, const struct timespec* deadline);
+
 /** @brief The entry point for sending buffers to the port
  * 
  * This function can be called by the EmptyThisBuffer or FillThisBuffer. It depends on
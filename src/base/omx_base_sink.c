@@ -29,6 +29,7 @@
 */
 
 #include <omxcore.h>
+#include <omx_trace.h>
 #include <omx_base_sink.h>
 
 OMX_ERRORTYPE omx_base_sink_Constructor(OMX_COMPONENTTYPE *openmaxStandComp,OMX_STRING cComponentName) {
@@ -78,6 +79,8 @@ void* omx_base_sink_BufferMgmtFunction (void* param) {
   OMX_COMPONENTTYPE*              target_component;
   OMX_BOOL                        isInputBufferNeeded         = OMX_TRUE;
   int                             inBufExchanged              = 0;
+  unsigned int nStateGen;
+  OMX_U64 nPerfTime;
 
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s \n", __func__);
   while(omx_base_component_Private->state == OMX_StateIdle || omx_base_component_Private->state == OMX_StateExecuting ||  omx_base_component_Private->state == OMX_StatePause ||
@@ -107,7 +110,9 @@ void* omx_base_sink_BufferMgmtFunction (void* param) {
     if((pInputSem->semval==0 && isInputBufferNeeded==OMX_TRUE ) &&
       (omx_base_sink_Private->state != OMX_StateLoaded && omx_base_sink_Private->state != OMX_StateInvalid)) {
       DEBUG(DEB_LEV_SIMPLE_SEQ, "Waiting for input buffer \n");
+      nPerfTime = omx_base_component_PerfTime();
       tsem_down(omx_base_sink_Private->bMgmtSem);
+      PERF_COUNTER_ADD(omx_base_sink_Private->sPerfCounters.nMgmtWaitTime, omx_base_component_PerfTime() - nPerfTime);
     }
 
     if(omx_base_sink_Private->state == OMX_StateLoaded || omx_base_sink_Private->state == OMX_StateInvalid) {
@@ -118,7 +123,7 @@ void* omx_base_sink_BufferMgmtFunction (void* param) {
     DEBUG(DEB_LEV_SIMPLE_SEQ, "Waiting for input buffer semval=%d \n",pInputSem->semval);
     if(pInputSem->semval>0 && isInputBufferNeeded==OMX_TRUE ) {
       tsem_down(pInputSem);
-      if(pInputQueue->nelem>0){
+      if(getquenelem(pInputQueue)>0){
         inBufExchanged++;
         isInputBufferNeeded=OMX_FALSE;
         pInputBuffer = dequeue(pInputQueue);
@@ -126,6 +131,7 @@ void* omx_base_sink_BufferMgmtFunction (void* param) {
           DEBUG(DEB_LEV_ERR, "Had NULL input buffer!!\n");
           break;
         }
+        OMX_TRACE(OMX_TRACE_DEQUEUE, omx_base_sink_Private->name, pInPort->sPortParam.nPortIndex, pInputBuffer);
       }
     }
 
@@ -160,7 +166,12 @@ void* omx_base_sink_BufferMgmtFunction (void* param) {
 
       if(omx_base_sink_Private->state == OMX_StateExecuting)  {
         if (omx_base_sink_Private->BufferMgmtCallback && pInputBuffer->nFilledLen > 0) {
+          OMX_TRACE(OMX_TRACE_CALLBACK_START, omx_base_sink_Private->name, pInPort->sPortParam.nPortIndex, pInputBuffer);
+          nPerfTime = omx_base_component_PerfTime();
           (*(omx_base_sink_Private->BufferMgmtCallback))(openmaxStandComp, pInputBuffer);
+          PERF_COUNTER_ADD(omx_base_sink_Private->sPerfCounters.nCallbackTime, omx_base_component_PerfTime() - nPerfTime);
+          OMX_TRACE(OMX_TRACE_CALLBACK_END, omx_base_sink_Private->name, pInPort->sPortParam.nPortIndex, pInputBuffer);
+          PERF_COUNTER_ADD(omx_base_sink_Private->sPerfCounters.nCallbacks, 1);
         }
         else {
           /*If no buffer management call back the explicitly consume input buffer*/
@@ -176,9 +187,10 @@ void* omx_base_sink_BufferMgmtFunction (void* param) {
       }
       /*Input Buffer has been completely consumed. So, get new input buffer*/
 
+      nStateGen = tsem_get_gen(omx_base_sink_Private->bStateSem);
       if(omx_base_sink_Private->state==OMX_StatePause && !PORT_IS_BEING_FLUSHED(pInPort)) {
         /*Waiting at paused state*/
-        tsem_wait(omx_base_sink_Private->bStateSem);
+        tsem_wait_gen(omx_base_sink_Private->bStateSem, nStateGen);
       }
 
       /*Input Buffer has been completely consumed. So, return input buffer*/
@@ -212,6 +224,8 @@ void* omx_base_sink_twoport_BufferMgmtFunction (void* param) {
   OMX_COMPONENTTYPE* target_component;
   OMX_BOOL isInputBufferNeeded[2];
   int i,outBufExchanged[2];
+  unsigned int nStateGen;
+  OMX_U64 nPerfTime;
 
   pInPort[0]=(omx_base_PortType *)omx_base_sink_Private->ports[OMX_BASE_SINK_INPUTPORT_INDEX];
   pInPort[1]=(omx_base_PortType *)omx_base_sink_Private->ports[OMX_BASE_SINK_INPUTPORT_INDEX_1];
@@ -266,7 +280,9 @@ void* omx_base_sink_twoport_BufferMgmtFunction (void* param) {
       (omx_base_sink_Private->state != OMX_StateLoaded && omx_base_sink_Private->state != OMX_StateInvalid)) {
       //Signalled from EmptyThisBuffer or FillThisBuffer or some thing else
       DEBUG(DEB_LEV_FULL_SEQ, "Waiting for next Input buffer 0\n");
+      nPerfTime = omx_base_component_PerfTime();
       tsem_down(omx_base_sink_Private->bMgmtSem);
+      PERF_COUNTER_ADD(omx_base_sink_Private->sPerfCounters.nMgmtWaitTime, omx_base_component_PerfTime() - nPerfTime);
 
     }
     if(omx_base_sink_Private->state == OMX_StateLoaded || omx_base_sink_Private->state == OMX_StateInvalid) {
@@ -278,7 +294,9 @@ void* omx_base_sink_twoport_BufferMgmtFunction (void* param) {
        !(PORT_IS_BEING_FLUSHED(pInPort[0]) || PORT_IS_BEING_FLUSHED(pInPort[1]))) {
       //Signalled from EmptyThisBuffer or FillThisBuffer or some thing else
       DEBUG(DEB_LEV_FULL_SEQ, "Waiting for next Input buffer 1\n");
+      nPerfTime = omx_base_component_PerfTime();
       tsem_down(omx_base_sink_Private->bMgmtSem);
+      PERF_COUNTER_ADD(omx_base_sink_Private->sPerfCounters.nMgmtWaitTime, omx_base_component_PerfTime() - nPerfTime);
 
     }
     if(omx_base_sink_Private->state == OMX_StateLoaded || omx_base_sink_Private->state == OMX_StateInvalid) {
@@ -289,7 +307,7 @@ void* omx_base_sink_twoport_BufferMgmtFunction (void* param) {
     DEBUG(DEB_LEV_SIMPLE_SEQ, "Waiting for Input buffer 0 semval=%d \n",pInputSem[0]->semval);
     if(pInputSem[0]->semval>0 && isInputBufferNeeded[0]==OMX_TRUE ) {
       tsem_down(pInputSem[0]);
-      if(pInputQueue[0]->nelem>0){
+      if(getquenelem(pInputQueue[0])>0){
         outBufExchanged[0]++;
         isInputBufferNeeded[0]=OMX_FALSE;
         pInputBuffer[0] = dequeue(pInputQueue[0]);
@@ -297,20 +315,22 @@ void* omx_base_sink_twoport_BufferMgmtFunction (void* param) {
           DEBUG(DEB_LEV_ERR, "Had NULL Input buffer!!\n");
           break;
         }
+        OMX_TRACE(OMX_TRACE_DEQUEUE, omx_base_sink_Private->name, pInPort[0]->sPortParam.nPortIndex, pInputBuffer[0]);
       }
     }
     /*When we have input buffer to process then get one Input buffer*/
     if(pInputSem[1]->semval>0 && isInputBufferNeeded[1]==OMX_TRUE) {
       tsem_down(pInputSem[1]);
       DEBUG(DEB_LEV_FULL_SEQ, "Wait over for Input buffer 1 semval=%d \n",pInputSem[1]->semval);
-      if(pInputQueue[1]->nelem>0){
+      if(getquenelem(pInputQueue[1])>0){
         outBufExchanged[1]++;
         isInputBufferNeeded[1]=OMX_FALSE;
         pInputBuffer[1] = dequeue(pInputQueue[1]);
         if(pInputBuffer[1] == NULL){
-          DEBUG(DEB_LEV_ERR, "Had NULL Input buffer!! op is=%d,iq=%d\n",pInputSem[1]->semval,pInputQueue[1]->nelem);
+          DEBUG(DEB_LEV_ERR, "Had NULL Input buffer!! op is=%d,iq=%d\n",pInputSem[1]->semval,getquenelem(pInputQueue[1]));
           break;
         }
+        OMX_TRACE(OMX_TRACE_DEQUEUE, omx_base_sink_Private->name, pInPort[1]->sPortParam.nPortIndex, pInputBuffer[1]);
       }
     }
 
@@ -348,7 +368,12 @@ void* omx_base_sink_twoport_BufferMgmtFunction (void* param) {
           if(omx_base_sink_Private->state == OMX_StateExecuting)  {
             if (omx_base_sink_Private->BufferMgmtCallback && pInputBuffer[i]->nFilledLen > 0) {
               //(*(omx_base_sink_Private->BufferMgmtCallback))(openmaxStandComp, pInputBuffer[0], pInputBuffer[1]);
+              OMX_TRACE(OMX_TRACE_CALLBACK_START, omx_base_sink_Private->name, pInPort[i]->sPortParam.nPortIndex, pInputBuffer[i]);
+              nPerfTime = omx_base_component_PerfTime();
               (*(omx_base_sink_Private->BufferMgmtCallback))(openmaxStandComp, pInputBuffer[i]);
+              PERF_COUNTER_ADD(omx_base_sink_Private->sPerfCounters.nCallbackTime, omx_base_component_PerfTime() - nPerfTime);
+              OMX_TRACE(OMX_TRACE_CALLBACK_END, omx_base_sink_Private->name, pInPort[i]->sPortParam.nPortIndex, pInputBuffer[i]);
+              PERF_COUNTER_ADD(omx_base_sink_Private->sPerfCounters.nCallbacks, 1);
             } else {
               /*If no buffer management call back then don't produce any Input buffer*/
               pInputBuffer[i]->nFilledLen = 0;
@@ -371,9 +396,10 @@ void* omx_base_sink_twoport_BufferMgmtFunction (void* param) {
               pInputBuffer[i]->nFlags, /* The state has been changed in message->messageParam2 */
               NULL);
           }
+          nStateGen = tsem_get_gen(omx_base_component_Private->bStateSem);
           if(omx_base_sink_Private->state==OMX_StatePause && !(PORT_IS_BEING_FLUSHED(pInPort[0]) || PORT_IS_BEING_FLUSHED(pInPort[1]))) {
             /*Waiting at paused state*/
-            tsem_wait(omx_base_component_Private->bStateSem);
+            tsem_wait_gen(omx_base_component_Private->bStateSem, nStateGen);
           }
 
            /*Input Buffer has been produced or EOS. So, return Input buffer and get new buffer*/
@@ -30,6 +30,7 @@
 */
 
 #include <omxcore.h>
+#include <omx_trace.h>
 #include <omx_base_source.h>
 
 OMX_ERRORTYPE omx_base_source_Constructor(OMX_COMPONENTTYPE *openmaxStandComp, OMX_STRING cComponentName) {
@@ -69,6 +70,8 @@ OMX_ERRORTYPE omx_base_source_Destructor(OMX_COMPONENTTYPE *openmaxStandComp) {
   * is available on the given port.
   */
 void* omx_base_source_BufferMgmtFunction (void* param) {
+  unsigned int nStateGen;
+  OMX_U64 nPerfTime;
 
   OMX_COMPONENTTYPE* openmaxStandComp = (OMX_COMPONENTTYPE*)param;
   omx_base_component_PrivateType* omx_base_component_Private = (omx_base_component_PrivateType*)openmaxStandComp->pComponentPrivate;
@@ -109,7 +112,9 @@ void* omx_base_source_BufferMgmtFunction (void* param) {
     if((isOutputBufferNeeded==OMX_TRUE && pOutputSem->semval==0) &&
       (omx_base_source_Private->state != OMX_StateLoaded && omx_base_source_Private->state != OMX_StateInvalid)) {
       DEBUG(DEB_LEV_SIMPLE_SEQ, "Waiting for output buffer \n");
+      nPerfTime = omx_base_component_PerfTime();
       tsem_down(omx_base_source_Private->bMgmtSem);
+      PERF_COUNTER_ADD(omx_base_source_Private->sPerfCounters.nMgmtWaitTime, omx_base_component_PerfTime() - nPerfTime);
     }
 
     if(omx_base_source_Private->state == OMX_StateLoaded || omx_base_source_Private->state == OMX_StateInvalid) {
@@ -120,7 +125,7 @@ void* omx_base_source_BufferMgmtFunction (void* param) {
     DEBUG(DEB_LEV_SIMPLE_SEQ, "Waiting for output buffer semval=%d \n",pOutputSem->semval);
     if(pOutputSem->semval > 0 && isOutputBufferNeeded == OMX_TRUE ) {
       tsem_down(pOutputSem);
-      if(pOutputQueue->nelem>0){
+      if(getquenelem(pOutputQueue)>0){
         outBufExchanged++;
         isOutputBufferNeeded = OMX_FALSE;
         pOutputBuffer = dequeue(pOutputQueue);
@@ -128,6 +133,7 @@ void* omx_base_source_BufferMgmtFunction (void* param) {
           DEBUG(DEB_LEV_ERR, "In %s Had NULL output buffer!!\n",__func__);
           break;
         }
+        OMX_TRACE(OMX_TRACE_DEQUEUE, omx_base_source_Private->name, pOutPort->sPortParam.nPortIndex, pOutputBuffer);
       }
     }
 
@@ -160,7 +166,12 @@ void* omx_base_source_BufferMgmtFunction (void* param) {
 
       if(omx_base_source_Private->state == OMX_StateExecuting)  {
         if (omx_base_source_Private->BufferMgmtCallback && pOutputBuffer->nFilledLen == 0) {
+          OMX_TRACE(OMX_TRACE_CALLBACK_START, omx_base_source_Private->name, pOutPort->sPortParam.nPortIndex, pOutputBuffer);
+          nPerfTime = omx_base_component_PerfTime();
           (*(omx_base_source_Private->BufferMgmtCallback))(openmaxStandComp, pOutputBuffer);
+          PERF_COUNTER_ADD(omx_base_source_Private->sPerfCounters.nCallbackTime, omx_base_component_PerfTime() - nPerfTime);
+          OMX_TRACE(OMX_TRACE_CALLBACK_END, omx_base_source_Private->name, pOutPort->sPortParam.nPortIndex, pOutputBuffer);
+          PERF_COUNTER_ADD(omx_base_source_Private->sPerfCounters.nCallbacks, 1);
         } else {
           /*It no buffer management call back then don't produce any output buffer*/
           pOutputBuffer->nFilledLen = 0;
@@ -168,9 +179,10 @@ void* omx_base_source_BufferMgmtFunction (void* param) {
       } else {
         DEBUG(DEB_LEV_ERR, "In %s Received Buffer in non-Executing State(%x)\n", __func__, (int)omx_base_source_Private->state);
       }
+      nStateGen = tsem_get_gen(omx_base_source_Private->bStateSem);
       if(omx_base_source_Private->state == OMX_StatePause && !PORT_IS_BEING_FLUSHED(pOutPort)) {
         /*Waiting at paused state*/
-        tsem_wait(omx_base_source_Private->bStateSem);
+        tsem_wait_gen(omx_base_source_Private->bStateSem, nStateGen);
       }
 
       if(pOutputBuffer->nFlags == OMX_BUFFERFLAG_EOS) {
@@ -222,6 +234,8 @@ void* omx_base_source_twoport_BufferMgmtFunction (void* param) {
   OMX_COMPONENTTYPE* target_component;
   OMX_BOOL isOutputBufferNeeded[2];
   int i,outBufExchanged[2];
+  unsigned int nStateGen;
+  OMX_U64 nPerfTime;
 
   pOutPort[0]=(omx_base_PortType *)omx_base_source_Private->ports[OMX_BASE_SOURCE_OUTPUTPORT_INDEX];
   pOutPort[1]=(omx_base_PortType *)omx_base_source_Private->ports[OMX_BASE_SOURCE_OUTPUTPORT_INDEX_1];
@@ -276,7 +290,9 @@ void* omx_base_source_twoport_BufferMgmtFunction (void* param) {
       (omx_base_source_Private->state != OMX_StateLoaded && omx_base_source_Private->state != OMX_StateInvalid)) {
       //Signalled from EmptyThisBuffer or FillThisBuffer or some thing else
       DEBUG(DEB_LEV_FULL_SEQ, "Waiting for next output buffer 0\n");
+      nPerfTime = omx_base_component_PerfTime();
       tsem_down(omx_base_source_Private->bMgmtSem);
+      PERF_COUNTER_ADD(omx_base_source_Private->sPerfCounters.nMgmtWaitTime, omx_base_component_PerfTime() - nPerfTime);
 
     }
     if(omx_base_source_Private->state == OMX_StateLoaded || omx_base_source_Private->state == OMX_StateInvalid) {
@@ -288,7 +304,9 @@ void* omx_base_source_twoport_BufferMgmtFunction (void* param) {
        !(PORT_IS_BEING_FLUSHED(pOutPort[0]) || PORT_IS_BEING_FLUSHED(pOutPort[1]))) {
       //Signalled from EmptyThisBuffer or FillThisBuffer or some thing else
       DEBUG(DEB_LEV_FULL_SEQ, "Waiting for next output buffer 1\n");
+      nPerfTime = omx_base_component_PerfTime();
       tsem_down(omx_base_source_Private->bMgmtSem);
+      PERF_COUNTER_ADD(omx_base_source_Private->sPerfCounters.nMgmtWaitTime, omx_base_component_PerfTime() - nPerfTime);
 
     }
     if(omx_base_source_Private->state == OMX_StateLoaded || omx_base_source_Private->state == OMX_StateInvalid) {
@@ -299,7 +317,7 @@ void* omx_base_source_twoport_BufferMgmtFunction (void* param) {
     DEBUG(DEB_LEV_SIMPLE_SEQ, "Waiting for output buffer 0 semval=%d \n",pOutputSem[0]->semval);
     if(pOutputSem[0]->semval>0 && isOutputBufferNeeded[0]==OMX_TRUE ) {
       tsem_down(pOutputSem[0]);
-      if(pOutputQueue[0]->nelem>0){
+      if(getquenelem(pOutputQueue[0])>0){
         outBufExchanged[0]++;
         isOutputBufferNeeded[0]=OMX_FALSE;
         pOutputBuffer[0] = dequeue(pOutputQueue[0]);
@@ -307,19 +325,21 @@ void* omx_base_source_twoport_BufferMgmtFunction (void* param) {
           DEBUG(DEB_LEV_ERR, "Had NULL output buffer!!\n");
           break;
         }
+        OMX_TRACE(OMX_TRACE_DEQUEUE, omx_base_source_Private->name, pOutPort[0]->sPortParam.nPortIndex, pOutputBuffer[0]);
       }
     }
     /*When we have input buffer to process then get one output buffer*/
     if(pOutputSem[1]->semval>0 && isOutputBufferNeeded[1]==OMX_TRUE) {
       tsem_down(pOutputSem[1]);
-      if(pOutputQueue[1]->nelem>0){
+      if(getquenelem(pOutputQueue[1])>0){
         outBufExchanged[1]++;
         isOutputBufferNeeded[1]=OMX_FALSE;
         pOutputBuffer[1] = dequeue(pOutputQueue[1]);
         if(pOutputBuffer[1] == NULL){
-          DEBUG(DEB_LEV_ERR, "Had NULL output buffer!! op is=%d,iq=%d\n",pOutputSem[1]->semval,pOutputQueue[1]->nelem);
+          DEBUG(DEB_LEV_ERR, "Had NULL output buffer!! op is=%d,iq=%d\n",pOutputSem[1]->semval,getquenelem(pOutputQueue[1]));
           break;
         }
+        OMX_TRACE(OMX_TRACE_DEQUEUE, omx_base_source_Private->name, pOutPort[1]->sPortParam.nPortIndex, pOutputBuffer[1]);
       }
     }
 
@@ -357,7 +377,12 @@ void* omx_base_source_twoport_BufferMgmtFunction (void* param) {
           if(omx_base_source_Private->state == OMX_StateExecuting)  {
             if (omx_base_source_Private->BufferMgmtCallback && pOutputBuffer[i]->nFilledLen == 0) {
               //(*(omx_base_source_Private->BufferMgmtCallback))(openmaxStandComp, pOutputBuffer[0], pOutputBuffer[1]);
+              OMX_TRACE(OMX_TRACE_CALLBACK_START, omx_base_source_Private->name, pOutPort[i]->sPortParam.nPortIndex, pOutputBuffer[i]);
+              nPerfTime = omx_base_component_PerfTime();
               (*(omx_base_source_Private->BufferMgmtCallback))(openmaxStandComp, pOutputBuffer[i]);
+              PERF_COUNTER_ADD(omx_base_source_Private->sPerfCounters.nCallbackTime, omx_base_component_PerfTime() - nPerfTime);
+              OMX_TRACE(OMX_TRACE_CALLBACK_END, omx_base_source_Private->name, pOutPort[i]->sPortParam.nPortIndex, pOutputBuffer[i]);
+              PERF_COUNTER_ADD(omx_base_source_Private->sPerfCounters.nCallbacks, 1);
             } else {
               /*If no buffer management call back then don't produce any output buffer*/
               pOutputBuffer[i]->nFilledLen = 0;
@@ -376,9 +401,10 @@ void* omx_base_source_twoport_BufferMgmtFunction (void* param) {
               pOutputBuffer[i]->nFlags, /* The state has been changed in message->messageParam2 */
               NULL);
           }
+          nStateGen = tsem_get_gen(omx_base_component_Private->bStateSem);
           if(omx_base_source_Private->state==OMX_StatePause && !(PORT_IS_BEING_FLUSHED(pOutPort[0]) || PORT_IS_BEING_FLUSHED(pOutPort[1]))) {
             /*Waiting at paused state*/
-            tsem_wait(omx_base_component_Private->bStateSem);
+            tsem_wait_gen(omx_base_component_Private->bStateSem, nStateGen);
           }
 
            /*Output Buffer has been produced or EOS. So, return output buffer and get new buffer*/
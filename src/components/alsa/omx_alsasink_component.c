@@ -290,14 +290,20 @@ OMX_ERRORTYPE omx_alsasink_component_port_SendBufferFunction(omx_base_PortType *
 
   /* And notify the buffer management thread we have a fresh new buffer to manage */
   if(!PORT_IS_BEING_FLUSHED(openmaxStandPort) && !(PORT_IS_BEING_DISABLED(openmaxStandPort) && PORT_IS_TUNNELED_N_BUFFER_SUPPLIER(openmaxStandPort))){
-      queue(openmaxStandPort->pBufferQueue, pBuffer);
+      if (queue(openmaxStandPort->pBufferQueue, pBuffer) != 0) {
+        DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+        return OMX_ErrorInsufficientResources;
+      }
       tsem_up(openmaxStandPort->pBufferSem);
       DEBUG(DEB_LEV_PARAMS, "In %s Signalling bMgmtSem Port Index=%d\n",__func__, (int)portIndex);
       tsem_up(omx_base_component_Private->bMgmtSem);
   }else if(PORT_IS_BUFFER_SUPPLIER(openmaxStandPort)){
       DEBUG(DEB_LEV_FULL_SEQ, "In %s: Comp %s received io:%d buffer\n",
         __func__,omx_base_component_Private->name,(int)openmaxStandPort->sPortParam.nPortIndex);
-      queue(openmaxStandPort->pBufferQueue, pBuffer);
+      if (queue(openmaxStandPort->pBufferQueue, pBuffer) != 0) {
+        DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+        return OMX_ErrorInsufficientResources;
+      }
       tsem_up(openmaxStandPort->pBufferSem);
   }
   else { // If port being flushed and not tunneled then return error
@@ -341,7 +347,7 @@ OMX_BOOL omx_alsasink_component_ClockPortHandleFunction(omx_alsasink_component_P
       tsem_down(pClockPort->pBufferSem); /* wait for state change notification from clock src*/
 
       /* update the clock state and clock scale info into the alsa sink private data */
-      if(pClockPort->pBufferQueue->nelem > 0) {
+      if(getquenelem(pClockPort->pBufferQueue) > 0) {
         clockBuffer = dequeue(pClockPort->pBufferQueue);
         pMediaTime  = (OMX_TIME_MEDIATIMETYPE*)clockBuffer->pBuffer;
         omx_alsasink_component_Private->eState = pMediaTime->eState;
@@ -362,7 +368,7 @@ OMX_BOOL omx_alsasink_component_ClockPortHandleFunction(omx_alsasink_component_P
   /* check for any scale change information from the clock component */
   if(pClockPort->pBufferSem->semval>0){
     tsem_down(pClockPort->pBufferSem);
-    if(pClockPort->pBufferQueue->nelem > 0) {
+    if(getquenelem(pClockPort->pBufferQueue) > 0) {
       clockBuffer = dequeue(pClockPort->pBufferQueue);
       pMediaTime  = (OMX_TIME_MEDIATIMETYPE*)clockBuffer->pBuffer;
       if(pMediaTime->eUpdateType==OMX_TIME_UpdateScaleChanged) {
@@ -400,7 +406,7 @@ OMX_BOOL omx_alsasink_component_ClockPortHandleFunction(omx_alsasink_component_P
       if(!PORT_IS_BEING_FLUSHED(pAudioPort) && !PORT_IS_BEING_FLUSHED(pClockPort) &&
         omx_alsasink_component_Private->transientState != OMX_TransStateExecutingToIdle) {
         tsem_down(pClockPort->pBufferSem); /* wait for the request fullfillment */
-        if(pClockPort->pBufferQueue->nelem > 0) {
+        if(getquenelem(pClockPort->pBufferQueue) > 0) {
           clockBuffer = dequeue(pClockPort->pBufferQueue);
           pMediaTime  = (OMX_TIME_MEDIATIMETYPE*)clockBuffer->pBuffer;
           if(pMediaTime->eUpdateType==OMX_TIME_UpdateScaleChanged) {
@@ -445,15 +451,12 @@ OMX_ERRORTYPE omx_alsasink_component_port_FlushProcessingBuffers(omx_base_PortTy
   if(openmaxStandPort->sPortParam.eDomain!=OMX_PortDomainOther) { /* clock buffers not used in the clients buffer managment function */
     pthread_mutex_lock(&omx_base_component_Private->flush_mutex);
     openmaxStandPort->bIsPortFlushed=OMX_TRUE;
-    /*Signal the buffer management thread of port flush,if it is waiting for buffers*/
-    if(omx_base_component_Private->bMgmtSem->semval==0) {
-      tsem_up(omx_base_component_Private->bMgmtSem);
-    }
+    /* Always wake the buffer management thread: it may have seen the port not flushed
+     * yet and be about to wait. The count left over is reset once the flush is done */
+    tsem_up(omx_base_component_Private->bMgmtSem);
 
-    if(omx_base_component_Private->state==OMX_StatePause ) {
-      /*Waiting at paused state*/
-      tsem_signal(omx_base_component_Private->bStateSem);
-    }
+    /* Wake it up if it waits at paused state */
+    tsem_signal(omx_base_component_Private->bStateSem);
     DEBUG(DEB_LEV_FULL_SEQ, "In %s waiting for flush all condition port index =%d\n", __func__,(int)openmaxStandPort->sPortParam.nPortIndex);
     /* Wait until flush is completed */
     pthread_mutex_unlock(&omx_base_component_Private->flush_mutex);
@@ -472,7 +475,7 @@ OMX_ERRORTYPE omx_alsasink_component_port_FlushProcessingBuffers(omx_base_PortTy
   while (openmaxStandPort->pBufferSem->semval > 0) {
     DEBUG(DEB_LEV_FULL_SEQ, "In %s TFlag=%x Flusing Port=%d,Semval=%d Qelem=%d\n",
     __func__,(int)openmaxStandPort->nTunnelFlags,(int)openmaxStandPort->sPortParam.nPortIndex,
-    (int)openmaxStandPort->pBufferSem->semval,(int)openmaxStandPort->pBufferQueue->nelem);
+    (int)openmaxStandPort->pBufferSem->semval,(int)getquenelem(openmaxStandPort->pBufferQueue));
 
     tsem_down(openmaxStandPort->pBufferSem);
     pBuffer = dequeue(openmaxStandPort->pBufferQueue);
@@ -485,7 +488,9 @@ OMX_ERRORTYPE omx_alsasink_component_port_FlushProcessingBuffers(omx_base_PortTy
         ((OMX_COMPONENTTYPE*)(openmaxStandPort->hTunneledComponent))->EmptyThisBuffer(openmaxStandPort->hTunneledComponent, pBuffer);
       }
     } else if (PORT_IS_TUNNELED_N_BUFFER_SUPPLIER(openmaxStandPort)) {
-      queue(openmaxStandPort->pBufferQueue,pBuffer);
+      if (queue(openmaxStandPort->pBufferQueue,pBuffer) != 0) {
+        DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+      }
     } else {
       (*(openmaxStandPort->BufferProcessedCallback))(
         openmaxStandPort->standCompContainer,
@@ -495,9 +500,9 @@ OMX_ERRORTYPE omx_alsasink_component_port_FlushProcessingBuffers(omx_base_PortTy
   }
   /*Port is tunneled and supplier and didn't received all it's buffer then wait for the buffers*/
   if (PORT_IS_TUNNELED_N_BUFFER_SUPPLIER(openmaxStandPort)) {
-    while(openmaxStandPort->pBufferQueue->nelem!= openmaxStandPort->nNumAssignedBuffers){
+    while(getquenelem(openmaxStandPort->pBufferQueue)!= openmaxStandPort->nNumAssignedBuffers){
       tsem_down(openmaxStandPort->pBufferSem);
-      DEBUG(DEB_LEV_PARAMS, "In %s Got a buffer qelem=%d\n",__func__,openmaxStandPort->pBufferQueue->nelem);
+      DEBUG(DEB_LEV_PARAMS, "In %s Got a buffer qelem=%d\n",__func__,getquenelem(openmaxStandPort->pBufferQueue));
     }
     tsem_reset(openmaxStandPort->pBufferSem);
   }
@@ -513,7 +518,7 @@ OMX_ERRORTYPE omx_alsasink_component_port_FlushProcessingBuffers(omx_base_PortTy
 
   DEBUG(DEB_LEV_PARAMS, "In %s TFlag=%x Qelem=%d BSem=%d bMgmtsem=%d component=%s\n", __func__,
     (int)openmaxStandPort->nTunnelFlags,
-    (int)openmaxStandPort->pBufferQueue->nelem,
+    (int)getquenelem(openmaxStandPort->pBufferQueue),
     (int)openmaxStandPort->pBufferSem->semval,
     (int)omx_base_component_Private->bMgmtSem->semval,
     omx_base_component_Private->name);
@@ -35,6 +35,7 @@
 #include <st_static_component_loader.h>
 #include <omx_volume_component.h>
 #include <omx_audiomixer_component.h>
+#include <omx_resampler_component.h>
 
 /** @brief The library entry point. It must have the same name for each
   * library of the components loaded by the ST static component loader.
@@ -55,7 +56,7 @@ int omx_component_library_Setup(stLoaderComponentType **stComponents) {
 
   if (stComponents == NULL) {
     DEBUG(DEB_LEV_FUNCTION_NAME, "Out of %s \n",__func__);
-    return 2; // Return Number of Components - one for audio volume component
+    return 3; // Return Number of Components - volume, audio mixer and resampler
   }
 
   /** component 1 - volume component */
@@ -124,6 +125,39 @@ int omx_component_library_Setup(stLoaderComponentType **stComponents) {
   strcpy(stComponents[1]->name_specific[0], "OMX.st.audio.mixer");
   strcpy(stComponents[1]->role_specific[0], "audio.mixer");
 
+  /** component 3 - resampler component */
+  stComponents[2]->componentVersion.s.nVersionMajor = 1;
+  stComponents[2]->componentVersion.s.nVersionMinor = 1;
+  stComponents[2]->componentVersion.s.nRevision = 1;
+  stComponents[2]->componentVersion.s.nStep = 1;
+
+  stComponents[2]->name = calloc(1, OMX_MAX_STRINGNAME_SIZE);
+  if (stComponents[2]->name == NULL) {
+    return OMX_ErrorInsufficientResources;
+  }
+  strcpy(stComponents[2]->name, "OMX.st.audio.resampler");
+  stComponents[2]->name_specific_length = 1;
+  stComponents[2]->constructor = omx_resampler_component_Constructor;
+
+  stComponents[2]->name_specific = calloc(stComponents[2]->name_specific_length,sizeof(char *));
+  stComponents[2]->role_specific = calloc(stComponents[2]->name_specific_length,sizeof(char *));
+
+  for(i=0;i<stComponents[2]->name_specific_length;i++) {
+    stComponents[2]->name_specific[i] = calloc(1, OMX_MAX_STRINGNAME_SIZE);
+    if (stComponents[2]->name_specific[i] == NULL) {
+      return OMX_ErrorInsufficientResources;
+    }
+  }
+  for(i=0;i<stComponents[2]->name_specific_length;i++) {
+    stComponents[2]->role_specific[i] = calloc(1, OMX_MAX_STRINGNAME_SIZE);
+    if (stComponents[2]->role_specific[i] == NULL) {
+      return OMX_ErrorInsufficientResources;
+    }
+  }
+
+  strcpy(stComponents[2]->name_specific[0], "OMX.st.audio.resampler");
+  strcpy(stComponents[2]->role_specific[0], "audio.resampler");
+
   DEBUG(DEB_LEV_FUNCTION_NAME, "Out of %s \n",__func__);
-  return 2;
+  return 3;
 }
@@ -30,6 +30,7 @@
 #include <omxcore.h>
 #include <omx_base_audio_port.h>
 #include <omx_audiomixer_component.h>
+#include <omx_pcm_kernels.h>
 #include<OMX_Audio.h>
 
 #define OMX_AUDIO_MIXER_INPUTPORT_INDEX      0
@@ -48,56 +49,69 @@
 static OMX_U32 noAudioMixerCompInstance = 0;
 
 
-OMX_ERRORTYPE omx_audio_mixer_component_Constructor(OMX_COMPONENTTYPE *openmaxStandComp, OMX_STRING cComponentName) {
-  OMX_ERRORTYPE err = OMX_ErrorNone;
-  omx_audio_mixer_component_PrivateType* omx_audio_mixer_component_Private;
-  omx_audio_mixer_component_PortType *pPort;//,*inPort1, *outPort;
+/** Marks the input port in the ready mask of the buffer management function
+  * before the buffer is queued, so the wake up done by the base port always
+  * finds the bit set. The buffer management thread arms the bit again if it
+  * sees it before the buffer is in the queue
+  */
+static OMX_ERRORTYPE omx_audio_mixer_port_SendBufferFunction(omx_base_PortType *openmaxStandPort, OMX_BUFFERHEADERTYPE* pBuffer) {
+  omx_audio_mixer_component_PrivateType* omx_audio_mixer_component_Private = openmaxStandPort->standCompContainer->pComponentPrivate;
+
+  __atomic_fetch_or(&omx_audio_mixer_component_Private->nReadyMask, (OMX_U64)1 << openmaxStandPort->sPortParam.nPortIndex, __ATOMIC_RELEASE);
+  return base_port_SendBufferFunction(openmaxStandPort, pBuffer);
+}
+
+/** Destroys the ports, if any */
+static void omx_audio_mixer_component_DestroyPorts(omx_audio_mixer_component_PrivateType* omx_audio_mixer_component_Private) {
   OMX_U32 i;
 
-  if (!openmaxStandComp->pComponentPrivate) {
-    DEBUG(DEB_LEV_FUNCTION_NAME, "In %s, allocating component\n",__func__);
-    openmaxStandComp->pComponentPrivate = calloc(1, sizeof(omx_audio_mixer_component_PrivateType));
-    if(openmaxStandComp->pComponentPrivate == NULL) {
-      return OMX_ErrorInsufficientResources;
+  if (omx_audio_mixer_component_Private->ports) {
+    for (i=0; i < omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts; i++) {
+      if(omx_audio_mixer_component_Private->ports[i])
+        omx_audio_mixer_component_Private->ports[i]->PortDestructor(omx_audio_mixer_component_Private->ports[i]);
     }
-  } else {
-    DEBUG(DEB_LEV_FUNCTION_NAME, "In %s, Error Component %x Already Allocated\n", __func__, (int)openmaxStandComp->pComponentPrivate);
+    free(omx_audio_mixer_component_Private->ports);
+    omx_audio_mixer_component_Private->ports=NULL;
   }
+  omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts = 0;
+}
 
-  omx_audio_mixer_component_Private = openmaxStandComp->pComponentPrivate;
-  omx_audio_mixer_component_Private->ports = NULL;
-
-  /** Calling base filter constructor */
-  err = omx_base_filter_Constructor(openmaxStandComp, cComponentName);
+/** Creates nInputPorts input ports followed by the output port, replacing
+  * the ports created before
+  */
+static OMX_ERRORTYPE omx_audio_mixer_component_CreatePorts(OMX_COMPONENTTYPE *openmaxStandComp, OMX_U32 nInputPorts) {
+  omx_audio_mixer_component_PrivateType* omx_audio_mixer_component_Private = openmaxStandComp->pComponentPrivate;
+  omx_audio_mixer_component_PortType *pPort;
+  OMX_U32 i, nPorts = nInputPorts + 1;
 
-  /*Assuming 2 input and 1 output portd*/
-  omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nStartPortNumber = 0;
-  omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts = MAX_PORTS;
+  omx_audio_mixer_component_DestroyPorts(omx_audio_mixer_component_Private);
+  omx_audio_mixer_component_Private->nReadyMask = 0;
+  omx_audio_mixer_component_Private->ePcmFormat = OMX_PCM_FORMAT_S16;
 
   /** Allocate Ports and call port constructor. */
-  if (omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts && !omx_audio_mixer_component_Private->ports) {
-    omx_audio_mixer_component_Private->ports = calloc(omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts, sizeof(omx_base_PortType *));
-    if (!omx_audio_mixer_component_Private->ports) {
+  omx_audio_mixer_component_Private->ports = calloc(nPorts, sizeof(omx_base_PortType *));
+  if (!omx_audio_mixer_component_Private->ports) {
+    return OMX_ErrorInsufficientResources;
+  }
+  omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts = nPorts;
+  for (i=0; i < nPorts; i++) {
+    omx_audio_mixer_component_Private->ports[i] = calloc(1, sizeof(omx_audio_mixer_component_PortType));
+    if (!omx_audio_mixer_component_Private->ports[i]) {
       return OMX_ErrorInsufficientResources;
     }
-    for (i=0; i < omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts; i++) {
-      omx_audio_mixer_component_Private->ports[i] = calloc(1, sizeof(omx_audio_mixer_component_PortType));
-      if (!omx_audio_mixer_component_Private->ports[i]) {
-        return OMX_ErrorInsufficientResources;
-      }
-    }
   }
 
   /* construct all input ports */
-  for(i=0;i<omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts-1;i++) {
+  for(i=0;i<nPorts-1;i++) {
     base_audio_port_Constructor(openmaxStandComp, &omx_audio_mixer_component_Private->ports[i], i, OMX_TRUE);
+    omx_audio_mixer_component_Private->ports[i]->Port_SendBufferFunction = omx_audio_mixer_port_SendBufferFunction;
   }
 
   /* construct one output port */
-  base_audio_port_Constructor(openmaxStandComp, &omx_audio_mixer_component_Private->ports[omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts-1], omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts-1, OMX_FALSE);
+  base_audio_port_Constructor(openmaxStandComp, &omx_audio_mixer_component_Private->ports[nPorts-1], nPorts-1, OMX_FALSE);
 
   /** Domain specific section for the ports. */
-  for(i=0;i<omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts;i++) {
+  for(i=0;i<nPorts;i++) {
     pPort = (omx_audio_mixer_component_PortType *) omx_audio_mixer_component_Private->ports[i];
 
     pPort->sPortParam.nBufferSize = DEFAULT_OUT_BUFFER_SIZE;
@@ -120,6 +134,43 @@ OMX_ERRORTYPE omx_audio_mixer_component_Constructor(OMX_COMPONENTTYPE *openmaxSt
     pPort->sVolume.sVolume.nValue = (OMX_S32)GAIN_VALUE;
     pPort->sVolume.sVolume.nMin = 0;   /**< minimum for value (i.e. nValue >= nMin) */
     pPort->sVolume.sVolume.nMax = (OMX_S32)GAIN_VALUE;
+
+    /* Ports created again after OMX_GetHandle have missed SetCallbacks */
+    if (omx_audio_mixer_component_Private->callbacks) {
+      if (i < nPorts-1) {
+        pPort->BufferProcessedCallback = omx_audio_mixer_component_Private->callbacks->EmptyBufferDone;
+      } else {
+        pPort->BufferProcessedCallback = omx_audio_mixer_component_Private->callbacks->FillBufferDone;
+      }
+    }
+  }
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE omx_audio_mixer_component_Constructor(OMX_COMPONENTTYPE *openmaxStandComp, OMX_STRING cComponentName) {
+  OMX_ERRORTYPE err = OMX_ErrorNone;
+  omx_audio_mixer_component_PrivateType* omx_audio_mixer_component_Private;
+
+  if (!openmaxStandComp->pComponentPrivate) {
+    DEBUG(DEB_LEV_FUNCTION_NAME, "In %s, allocating component\n",__func__);
+    openmaxStandComp->pComponentPrivate = calloc(1, sizeof(omx_audio_mixer_component_PrivateType));
+    if(openmaxStandComp->pComponentPrivate == NULL) {
+      return OMX_ErrorInsufficientResources;
+    }
+  } else {
+    DEBUG(DEB_LEV_FUNCTION_NAME, "In %s, Error Component %p Already Allocated\n", __func__, openmaxStandComp->pComponentPrivate);
+  }
+
+  omx_audio_mixer_component_Private = openmaxStandComp->pComponentPrivate;
+  omx_audio_mixer_component_Private->ports = NULL;
+
+  /** Calling base filter constructor */
+  err = omx_base_filter_Constructor(openmaxStandComp, cComponentName);
+
+  /*DEFAULT_INPUT_PORTS input ports and 1 output port, until the client sets OMX_IndexVendorMixerInputs*/
+  omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nStartPortNumber = 0;
+  if (omx_audio_mixer_component_CreatePorts(openmaxStandComp, DEFAULT_INPUT_PORTS) != OMX_ErrorNone) {
+    return OMX_ErrorInsufficientResources;
   }
 
   omx_audio_mixer_component_Private->destructor = omx_audio_mixer_component_Destructor;
@@ -127,8 +178,11 @@ OMX_ERRORTYPE omx_audio_mixer_component_Constructor(OMX_COMPONENTTYPE *openmaxSt
   openmaxStandComp->GetParameter = omx_audio_mixer_component_GetParameter;
   openmaxStandComp->GetConfig = omx_audio_mixer_component_GetConfig;
   openmaxStandComp->SetConfig = omx_audio_mixer_component_SetConfig;
+  openmaxStandComp->GetExtensionIndex = omx_audio_mixer_component_GetExtensionIndex;
   omx_audio_mixer_component_Private->BufferMgmtCallback = omx_audio_mixer_component_BufferMgmtCallback;
   omx_audio_mixer_component_Private->BufferMgmtFunction = omx_audio_mixer_BufferMgmtFunction;
+  /* The own loop blocks, it cannot run on the shared executor */
+  omx_audio_mixer_component_Private->BufferMgmtStep = NULL;
 
   noAudioMixerCompInstance++;
   if(noAudioMixerCompInstance > MAX_COMPONENT_AUDIO_MIXER) {
@@ -144,17 +198,9 @@ OMX_ERRORTYPE omx_audio_mixer_component_Constructor(OMX_COMPONENTTYPE *openmaxSt
 OMX_ERRORTYPE omx_audio_mixer_component_Destructor(OMX_COMPONENTTYPE *openmaxStandComp) {
 
   omx_audio_mixer_component_PrivateType* omx_audio_mixer_component_Private = openmaxStandComp->pComponentPrivate;
-  OMX_U32 i;
 
   /* frees port/s */
-  if (omx_audio_mixer_component_Private->ports) {
-    for (i=0; i < omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts; i++) {
-      if(omx_audio_mixer_component_Private->ports[i])
-        omx_audio_mixer_component_Private->ports[i]->PortDestructor(omx_audio_mixer_component_Private->ports[i]);
-    }
-    free(omx_audio_mixer_component_Private->ports);
-    omx_audio_mixer_component_Private->ports=NULL;
-  }
+  omx_audio_mixer_component_DestroyPorts(omx_audio_mixer_component_Private);
 
   DEBUG(DEB_LEV_FUNCTION_NAME, "Destructor of audiodecoder component is called\n");
   omx_base_filter_Destructor(openmaxStandComp);
@@ -166,10 +212,25 @@ OMX_ERRORTYPE omx_audio_mixer_component_Destructor(OMX_COMPONENTTYPE *openmaxSta
 /** This function is used to process the input buffer and provide one output buffer
   */
 void omx_audio_mixer_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandComp, OMX_BUFFERHEADERTYPE* pInBuffer, OMX_BUFFERHEADERTYPE* pOutBuffer) {
-  OMX_S32 denominator=0;
-  OMX_U32 i,sampleCount = pInBuffer->nFilledLen / 2; // signed 16 bit samples assumed
+  omx_audio_mixer_component_MixBuffers(openmaxStandComp, &pInBuffer, 1, pOutBuffer);
+}
+
+/** Each port is weighted by its volume over the sum of the volumes of the
+  * enabled input ports. The weights are computed once per output buffer and
+  * the samples of all the inputs are accumulated, then rounded and saturated
+  * once in the sample format of the ports
+  */
+void omx_audio_mixer_component_MixBuffers(OMX_COMPONENTTYPE *openmaxStandComp, OMX_BUFFERHEADERTYPE** pInBuffers, OMX_U32 nInBuffers, OMX_BUFFERHEADERTYPE* pOutBuffer) {
   omx_audio_mixer_component_PrivateType* omx_audio_mixer_component_Private = openmaxStandComp->pComponentPrivate;
   omx_audio_mixer_component_PortType* pPort;
+  /* One buffer per input port and the data already in the output */
+  const void* ppIn[MAX_INPUT_PORTS + 1];
+  OMX_U32 nSamples[MAX_INPUT_PORTS + 1];
+  OMX_S32 nWeights[MAX_INPUT_PORTS + 1];
+  OMX_U32 nSampleSize = omx_pcm_sample_size(omx_audio_mixer_component_Private->ePcmFormat);
+  OMX_U32 nMaxSamples = pOutBuffer->nAllocLen / nSampleSize;
+  OMX_S32 denominator = 0;
+  OMX_U32 i, nInputs = 0;
 
   for(i=0;i<omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts-1;i++) {
     pPort = (omx_audio_mixer_component_PortType*)omx_audio_mixer_component_Private->ports[i];
@@ -178,25 +239,33 @@ void omx_audio_mixer_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStan
     }
   }
 
-  pPort = (omx_audio_mixer_component_PortType*)omx_audio_mixer_component_Private->ports[pInBuffer->nInputPortIndex];
-
-  /*Copy the first buffer with appropriate gain*/
-  if(pOutBuffer->nFilledLen == 0) {
-    memset(pOutBuffer->pBuffer,0,pInBuffer->nFilledLen);
+  /* Data already mixed into the output buffer is kept as it is */
+  if(pOutBuffer->nFilledLen != 0) {
+    ppIn[nInputs] = pOutBuffer->pBuffer;
+    nSamples[nInputs] = pOutBuffer->nFilledLen / nSampleSize;
+    nWeights[nInputs] = OMX_PCM_UNITY_GAIN;
+    nInputs++;
+  }
 
-    for (i = 0; i < sampleCount; i++) {
-      ((OMX_S16*) pOutBuffer->pBuffer)[i] = (OMX_S16)
-              ((((OMX_S16*) pInBuffer->pBuffer)[i] * pPort->sVolume.sVolume.nValue ) / denominator);
+  for (i = 0; i < nInBuffers; i++) {
+    pPort = (omx_audio_mixer_component_PortType*)omx_audio_mixer_component_Private->ports[pInBuffers[i]->nInputPortIndex];
+    ppIn[nInputs] = pInBuffers[i]->pBuffer;
+    nSamples[nInputs] = pInBuffers[i]->nFilledLen / nSampleSize;
+    if (nSamples[nInputs] > nMaxSamples) {
+      DEBUG(DEB_LEV_ERR, "In %s input buffer of port %i larger than the output buffer\n", __func__, (int)pInBuffers[i]->nInputPortIndex);
+      nSamples[nInputs] = nMaxSamples;
     }
-  } else { // For the second buffer add with the first buffer with gain
-    for (i = 0; i < sampleCount; i++) {
-      ((OMX_S16*) pOutBuffer->pBuffer)[i] += (OMX_S16)
-                ((((OMX_S16*) pInBuffer->pBuffer)[i] * pPort->sVolume.sVolume.nValue ) / denominator);
+    /* Rounded down, so that the weights add up to unity at most */
+    if (denominator > 0) {
+      nWeights[nInputs] = (pPort->sVolume.sVolume.nValue * OMX_PCM_UNITY_GAIN) / denominator;
+    } else {
+      nWeights[nInputs] = 0;
     }
+    nInputs++;
+    pInBuffers[i]->nFilledLen = 0;
   }
 
-  pOutBuffer->nFilledLen = pInBuffer->nFilledLen;
-  pInBuffer->nFilledLen=0;
+  pOutBuffer->nFilledLen = omx_pcm_mix(omx_audio_mixer_component_Private->ePcmFormat, pOutBuffer->pBuffer, ppIn, nSamples, nWeights, nInputs) * nSampleSize;
 }
 
 /** setting configurations */
@@ -219,7 +288,7 @@ OMX_ERRORTYPE omx_audio_mixer_component_SetConfig(
         break;
       }
 
-      if (pVolume->nPortIndex <= omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts) {
+      if (pVolume->nPortIndex < omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts) {
         pPort= (omx_audio_mixer_component_PortType *)omx_audio_mixer_component_Private->ports[pVolume->nPortIndex];
         DEBUG(DEB_LEV_SIMPLE_SEQ, "Port %i Gain=%d\n",(int)pVolume->nPortIndex,(int)pVolume->sVolume.nValue);
         memcpy(&pPort->sVolume, pVolume, sizeof(OMX_AUDIO_CONFIG_VOLUMETYPE));
@@ -246,7 +315,7 @@ OMX_ERRORTYPE omx_audio_mixer_component_GetConfig(
   switch (nIndex) {
     case OMX_IndexConfigAudioVolume :
       pVolume = (OMX_AUDIO_CONFIG_VOLUMETYPE*) pComponentConfigStructure;
-      if (pVolume->nPortIndex <= omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts) {
+      if (pVolume->nPortIndex < omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts) {
         pPort= (omx_audio_mixer_component_PortType *)omx_audio_mixer_component_Private->ports[pVolume->nPortIndex];
         memcpy(pVolume,&pPort->sVolume,sizeof(OMX_AUDIO_CONFIG_VOLUMETYPE));
       } else {
@@ -266,8 +335,11 @@ OMX_ERRORTYPE omx_audio_mixer_component_SetParameter(
 
   OMX_ERRORTYPE                   err = OMX_ErrorNone;
   OMX_AUDIO_PARAM_PORTFORMATTYPE  *pAudioPortFormat;
+  OMX_AUDIO_PARAM_PCMMODETYPE     *pAudioPcmMode;
   OMX_PARAM_COMPONENTROLETYPE     *pComponentRole;
+  OMX_PARAM_U32TYPE               *pInputs;
   OMX_U32                         portIndex;
+  omx_pcm_format_t                ePcmFormat;
   omx_audio_mixer_component_PortType *port;
 
   /* Check which structure we are being fed and make control its header */
@@ -278,7 +350,7 @@ OMX_ERRORTYPE omx_audio_mixer_component_SetParameter(
   }
 
   DEBUG(DEB_LEV_SIMPLE_SEQ, "   Setting parameter %i\n", nParamIndex);
-  switch(nParamIndex) {
+  switch((OMX_U32)nParamIndex) {
     case OMX_IndexParamAudioPortFormat:
       pAudioPortFormat = (OMX_AUDIO_PARAM_PORTFORMATTYPE*)ComponentParameterStructure;
       portIndex = pAudioPortFormat->nPortIndex;
@@ -287,13 +359,36 @@ OMX_ERRORTYPE omx_audio_mixer_component_SetParameter(
         DEBUG(DEB_LEV_ERR, "In %s Parameter Check Error=%x\n",__func__,err);
         break;
       }
-      if (portIndex <= omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts) {
+      if (portIndex < omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts) {
         port= (omx_audio_mixer_component_PortType *)omx_audio_mixer_component_Private->ports[portIndex];
         memcpy(&port->sAudioParam, pAudioPortFormat, sizeof(OMX_AUDIO_PARAM_PORTFORMATTYPE));
       } else {
         err = OMX_ErrorBadPortIndex;
       }
       break;
+    case OMX_IndexParamAudioPcm:
+      pAudioPcmMode = (OMX_AUDIO_PARAM_PCMMODETYPE*)ComponentParameterStructure;
+      err = omx_base_component_ParameterSanityCheck(hComponent, pAudioPcmMode->nPortIndex, pAudioPcmMode, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+      /* The streams are mixed without conversion, so the mode applies to all the ports and none may be running */
+      for (portIndex = 0; err == OMX_ErrorNone && portIndex < omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts; portIndex++) {
+        err = omx_base_component_ParameterSanityCheck(hComponent, portIndex, pAudioPcmMode, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+      }
+      if(err!=OMX_ErrorNone) {
+        DEBUG(DEB_LEV_ERR, "In %s Parameter Check Error=%x\n",__func__,err);
+        break;
+      }
+      err = omx_pcm_format_from_mode(pAudioPcmMode, &ePcmFormat);
+      if(err!=OMX_ErrorNone) {
+        DEBUG(DEB_LEV_ERR, "In %s PCM mode of %i bits and %i channels not supported\n",__func__,(int)pAudioPcmMode->nBitPerSample,(int)pAudioPcmMode->nChannels);
+        break;
+      }
+      for (portIndex = 0; portIndex < omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts; portIndex++) {
+        port = (omx_audio_mixer_component_PortType *)omx_audio_mixer_component_Private->ports[portIndex];
+        memcpy(&port->pAudioPcmMode, pAudioPcmMode, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+        port->pAudioPcmMode.nPortIndex = portIndex;
+      }
+      omx_audio_mixer_component_Private->ePcmFormat = ePcmFormat;
+      break;
     case OMX_IndexParamStandardComponentRole:
       pComponentRole = (OMX_PARAM_COMPONENTROLETYPE*)ComponentParameterStructure;
 
@@ -310,6 +405,29 @@ OMX_ERRORTYPE omx_audio_mixer_component_SetParameter(
         return OMX_ErrorBadParameter;
       }
       break;
+    case OMX_IndexVendorMixerInputs:
+      pInputs = (OMX_PARAM_U32TYPE*)ComponentParameterStructure;
+      if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_PARAM_U32TYPE))) != OMX_ErrorNone) {
+        break;
+      }
+      /* The ports are created again, so none of them may have buffers or a tunnel */
+      if (omx_audio_mixer_component_Private->state != OMX_StateLoaded) {
+        return OMX_ErrorIncorrectStateOperation;
+      }
+      for (portIndex = 0; portIndex < omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts; portIndex++) {
+        if (omx_audio_mixer_component_Private->ports[portIndex]->hTunneledComponent != NULL ||
+            PORT_IS_POPULATED(omx_audio_mixer_component_Private->ports[portIndex])) {
+          DEBUG(DEB_LEV_ERR, "In %s port %i is in use\n", __func__, (int)portIndex);
+          return OMX_ErrorIncorrectStateOperation;
+        }
+      }
+      if (pInputs->nU32 < 1 || pInputs->nU32 > MAX_INPUT_PORTS) {
+        return OMX_ErrorBadParameter;
+      }
+      if (pInputs->nU32 != omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts - 1) {
+        err = omx_audio_mixer_component_CreatePorts(openmaxStandComp, pInputs->nU32);
+      }
+      break;
     default:
       err = omx_base_component_SetParameter(hComponent, nParamIndex, ComponentParameterStructure);
   }
@@ -324,6 +442,7 @@ OMX_ERRORTYPE omx_audio_mixer_component_GetParameter(
   OMX_AUDIO_PARAM_PORTFORMATTYPE  *pAudioPortFormat;
   OMX_AUDIO_PARAM_PCMMODETYPE     *pAudioPcmMode;
   OMX_PARAM_COMPONENTROLETYPE     *pComponentRole;
+  OMX_PARAM_U32TYPE               *pInputs;
   OMX_ERRORTYPE                   err = OMX_ErrorNone;
   omx_audio_mixer_component_PortType    *port;
   OMX_COMPONENTTYPE                     *openmaxStandComp = (OMX_COMPONENTTYPE *)hComponent;
@@ -333,7 +452,7 @@ OMX_ERRORTYPE omx_audio_mixer_component_GetParameter(
   }
   DEBUG(DEB_LEV_SIMPLE_SEQ, "   Getting parameter %i\n", nParamIndex);
   /* Check which structure we are being fed and fill its header */
-  switch(nParamIndex) {
+  switch((OMX_U32)nParamIndex) {
     case OMX_IndexParamAudioInit:
       if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_PORT_PARAM_TYPE))) != OMX_ErrorNone) {
         break;
@@ -345,7 +464,7 @@ OMX_ERRORTYPE omx_audio_mixer_component_GetParameter(
       if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_AUDIO_PARAM_PORTFORMATTYPE))) != OMX_ErrorNone) {
         break;
       }
-      if (pAudioPortFormat->nPortIndex <= omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts) {
+      if (pAudioPortFormat->nPortIndex < omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts) {
         port= (omx_audio_mixer_component_PortType *)omx_audio_mixer_component_Private->ports[pAudioPortFormat->nPortIndex];
         memcpy(pAudioPortFormat, &port->sAudioParam, sizeof(OMX_AUDIO_PARAM_PORTFORMATTYPE));
       } else {
@@ -358,7 +477,7 @@ OMX_ERRORTYPE omx_audio_mixer_component_GetParameter(
         break;
       }
 
-      if (pAudioPcmMode->nPortIndex <= omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts) {
+      if (pAudioPcmMode->nPortIndex < omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts) {
         port= (omx_audio_mixer_component_PortType *)omx_audio_mixer_component_Private->ports[pAudioPcmMode->nPortIndex];
         memcpy(pAudioPcmMode, &port->pAudioPcmMode, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
       } else {
@@ -372,12 +491,35 @@ OMX_ERRORTYPE omx_audio_mixer_component_GetParameter(
       }
       strcpy( (char*) pComponentRole->cRole, MIXER_COMP_ROLE);
       break;
+    case OMX_IndexVendorMixerInputs:
+      pInputs = (OMX_PARAM_U32TYPE*)ComponentParameterStructure;
+      if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_PARAM_U32TYPE))) != OMX_ErrorNone) {
+        break;
+      }
+      pInputs->nU32 = omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts - 1;
+      break;
     default:
       err = omx_base_component_GetParameter(hComponent, nParamIndex, ComponentParameterStructure);
   }
   return err;
 }
 
+/** Returns the index of the vendor parameter setting the number of input ports */
+OMX_ERRORTYPE omx_audio_mixer_component_GetExtensionIndex(
+  OMX_IN  OMX_HANDLETYPE hComponent,
+  OMX_IN  OMX_STRING cParameterName,
+  OMX_OUT OMX_INDEXTYPE* pIndexType) {
+
+  DEBUG(DEB_LEV_FUNCTION_NAME,"In  %s \n",__func__);
+
+  if(strcmp(cParameterName,AUDIO_MIXER_INPUTS_NAME) == 0) {
+    *pIndexType = OMX_IndexVendorMixerInputs;
+  } else {
+    return omx_base_component_GetExtensionIndex(hComponent, cParameterName, pIndexType);
+  }
+  return OMX_ErrorNone;
+}
+
 int checkAnyPortBeingFlushed(omx_audio_mixer_component_PrivateType* omx_audio_mixer_component_Private) {
   omx_base_PortType *pPort;
   int ret = OMX_FALSE,i;
@@ -410,186 +552,241 @@ void* omx_audio_mixer_BufferMgmtFunction (void* param) {
   omx_audio_mixer_component_PrivateType* omx_audio_mixer_component_Private = (omx_audio_mixer_component_PrivateType*)openmaxStandComp->pComponentPrivate;
 
   omx_base_PortType *pPort[MAX_PORTS];
-  tsem_t* pSem[MAX_PORTS];
-  queue_t* pQueue[MAX_PORTS];
   OMX_BUFFERHEADERTYPE* pBuffer[MAX_PORTS];
-  OMX_BOOL isBufferNeeded[MAX_PORTS];
+  OMX_BUFFERHEADERTYPE* pMixBuffer[MAX_INPUT_PORTS];
   OMX_COMPONENTTYPE* target_component;
-  OMX_U32 nOutputPortIndex,i;
+  OMX_U32 nOutputPortIndex,i,nMixBuffers;
+  /* One bit per input port: the ports that may have a buffer queued, the
+   * ports holding a buffer, the ports whose buffer the mix waits for and
+   * the supplier ports, which get buffers without notice */
+  OMX_U64 nAllInputs,nPending,nHeld,nActive,nPoll,nReady,nMask,nBit;
+  OMX_STATETYPE eState,eLastState;
+  OMX_BOOL bProgress;
+  unsigned int nStateGen;
+  OMX_U64 nPerfTime;
 
-  for(i=0;i<omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts;i++){
+  nOutputPortIndex = omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts - 1;
+  nAllInputs = ~(OMX_U64)0 >> (MAX_INPUT_PORTS - nOutputPortIndex);
+  nPoll = 0;
+  for(i=0;i<=nOutputPortIndex;i++){
     pPort[i] = omx_audio_mixer_component_Private->ports[i];
-    pSem[i] = pPort[i]->pBufferSem;
-    pQueue[i] = pPort[i]->pBufferQueue;
     pBuffer[i] = NULL;
-    isBufferNeeded[i] = OMX_TRUE;
+    if(i < nOutputPortIndex && PORT_IS_BUFFER_SUPPLIER(pPort[i])) {
+      nPoll |= (OMX_U64)1 << i;
+    }
   }
-
-  nOutputPortIndex = omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts - 1;
-
+  nPending = nAllInputs;
+  nHeld = 0;
+  nActive = 0;
+  eLastState = OMX_StateInvalid;
 
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
   while(omx_audio_mixer_component_Private->state == OMX_StateIdle || omx_audio_mixer_component_Private->state == OMX_StateExecuting ||  omx_audio_mixer_component_Private->state == OMX_StatePause ||
     omx_audio_mixer_component_Private->transientState == OMX_TransStateLoadedToIdle) {
 
     /*Wait till the ports are being flushed*/
-    while( checkAnyPortBeingFlushed(omx_audio_mixer_component_Private) ) {
-
-      DEBUG(DEB_LEV_FULL_SEQ, "In %s 1 signalling flush all cond iF=%d,oF=%d iSemVal=%d,oSemval=%d\n",
-        __func__,isBufferNeeded[0],isBufferNeeded[nOutputPortIndex],pSem[0]->semval,pSem[nOutputPortIndex]->semval);
-
-      for(i=0;i<omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts;i++){
-        if(isBufferNeeded[i]==OMX_FALSE && PORT_IS_BEING_FLUSHED(pPort[i])) {
-          pPort[i]->ReturnBufferFunction(pPort[i],pBuffer[i]);
-          pBuffer[i]=NULL;
-          isBufferNeeded[i]=OMX_TRUE;
-          DEBUG(DEB_LEV_FULL_SEQ, "Ports are flushing,so returning buffer %i\n",(int)i);
+    if(checkAnyPortBeingFlushed(omx_audio_mixer_component_Private)) {
+      while( checkAnyPortBeingFlushed(omx_audio_mixer_component_Private) ) {
+        DEBUG(DEB_LEV_FULL_SEQ, "In %s signalling flush all cond held=%llx\n", __func__, (unsigned long long)nHeld);
+
+        for(i=0;i<=nOutputPortIndex;i++){
+          if(pBuffer[i]!=NULL && PORT_IS_BEING_FLUSHED(pPort[i])) {
+            pPort[i]->ReturnBufferFunction(pPort[i],pBuffer[i]);
+            pBuffer[i]=NULL;
+            if(i < nOutputPortIndex) {
+              nHeld &= ~((OMX_U64)1 << i);
+            }
+            DEBUG(DEB_LEV_FULL_SEQ, "Ports are flushing,so returning buffer %i\n",(int)i);
+          }
         }
-      }
-
-      DEBUG(DEB_LEV_FULL_SEQ, "In %s 2 signalling flush all cond iF=%d,oF=%d iSemVal=%d,oSemval=%d\n",
-        __func__,isBufferNeeded[0],isBufferNeeded[nOutputPortIndex],pSem[0]->semval,pSem[nOutputPortIndex]->semval);
 
-      tsem_up(omx_audio_mixer_component_Private->flush_all_condition);
-      tsem_down(omx_audio_mixer_component_Private->flush_condition);
+        tsem_up(omx_audio_mixer_component_Private->flush_all_condition);
+        tsem_down(omx_audio_mixer_component_Private->flush_condition);
+      }
+      /*The flush emptied the queues without going through the ready mask*/
+      nPending = nAllInputs;
     }
 
-    if(omx_audio_mixer_component_Private->state == OMX_StateLoaded || omx_audio_mixer_component_Private->state == OMX_StateInvalid) {
+    eState = omx_audio_mixer_component_Private->state;
+    if(eState == OMX_StateLoaded || eState == OMX_StateInvalid) {
       DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s Buffer Management Thread is exiting\n",__func__);
       break;
     }
 
-    /*No buffer to process. So wait here*/
-    for(i=0;i<omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts;i++){
-      if((isBufferNeeded[i]==OMX_TRUE && pSem[i]->semval==0) &&
-        (omx_audio_mixer_component_Private->state != OMX_StateLoaded && omx_audio_mixer_component_Private->state != OMX_StateInvalid) &&
-        PORT_IS_ENABLED(pPort[i]) && !PORT_IS_BEING_FLUSHED(pPort[i])) {
-        //Signalled from EmptyThisBuffer or FillThisBuffer or some thing else
-        DEBUG(DEB_LEV_FULL_SEQ, "Waiting for next input/output buffer\n");
-        tsem_down(omx_audio_mixer_component_Private->bMgmtSem);
-
-      }
-      /*Don't wait for buffers, if any port is flushing*/
-      if(checkAnyPortBeingFlushed(omx_audio_mixer_component_Private)) {
-        break;
-      }
-      if(omx_audio_mixer_component_Private->state == OMX_StateLoaded || omx_audio_mixer_component_Private->state == OMX_StateInvalid) {
-        DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s Buffer Management Thread is exiting\n",__func__);
-        break;
+    if(eState != eLastState) {
+      /*Supplier buffers are released on state changes without notice.
+       *Leaving or entering Idle, all the enabled inputs take part in the mix again*/
+      nPending = nAllInputs;
+      if(eState == OMX_StateIdle || eLastState == OMX_StateIdle || eLastState == OMX_StateInvalid) {
+        nActive = 0;
+        for(i=0;i<nOutputPortIndex;i++){
+          if(PORT_IS_ENABLED(pPort[i])) {
+            nActive |= (OMX_U64)1 << i;
+          }
+        }
       }
+      eLastState = eState;
     }
 
-    for(i=0;i<omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts;i++){
-      DEBUG(DEB_LEV_SIMPLE_SEQ, "Waiting for buffer %i semval=%d \n",(int)i,pSem[i]->semval);
-      if(pSem[i]->semval>0 && isBufferNeeded[i]==OMX_TRUE && PORT_IS_ENABLED(pPort[i])) {
-        tsem_down(pSem[i]);
-        if(pQueue[i]->nelem>0){
-          isBufferNeeded[i]=OMX_FALSE;
-          pBuffer[i] = dequeue(pQueue[i]);
-          if(pBuffer[i] == NULL){
-            DEBUG(DEB_LEV_ERR, "Had NULL input buffer!!\n");
-            break;
-          }
+    /*Take a buffer from the inputs marked ready that do not hold one yet*/
+    nReady = __atomic_exchange_n(&omx_audio_mixer_component_Private->nReadyMask, 0, __ATOMIC_ACQUIRE);
+    nPending |= nReady | nPoll;
+    nMask = nPending & ~nHeld;
+    while(nMask) {
+      i = __builtin_ctzll(nMask);
+      nBit = (OMX_U64)1 << i;
+      nMask &= nMask - 1;
+      if(!PORT_IS_ENABLED(pPort[i]) || pPort[i]->pBufferSem->semval == 0) {
+        /*Set again by omx_audio_mixer_port_SendBufferFunction. A bit seen before
+         *its buffer is queued is armed again for the wake up that follows*/
+        nPending &= ~nBit;
+        if(nReady & nBit) {
+          __atomic_fetch_or(&omx_audio_mixer_component_Private->nReadyMask, nBit, __ATOMIC_RELAXED);
         }
+        continue;
       }
+      tsem_down(pPort[i]->pBufferSem);
+      pBuffer[i] = dequeue(pPort[i]->pBufferQueue);
+      if(pBuffer[i] == NULL){
+        DEBUG(DEB_LEV_ERR, "Had NULL input buffer!!\n");
+        continue;
+      }
+      /*A port enabled at runtime joins the mix with its first buffer*/
+      nHeld |= nBit;
+      nActive |= nBit;
     }
 
-    if(isBufferNeeded[nOutputPortIndex]==OMX_FALSE) {
-
-      if(omx_audio_mixer_component_Private->pMark.hMarkTargetComponent != NULL){
-        pBuffer[nOutputPortIndex]->hMarkTargetComponent = omx_audio_mixer_component_Private->pMark.hMarkTargetComponent;
-        pBuffer[nOutputPortIndex]->pMarkData            = omx_audio_mixer_component_Private->pMark.pMarkData;
-        omx_audio_mixer_component_Private->pMark.hMarkTargetComponent = NULL;
-        omx_audio_mixer_component_Private->pMark.pMarkData            = NULL;
-      }
-      for(i=0;i<omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts-1;i++){
-        if(isBufferNeeded[i]==OMX_FALSE && PORT_IS_ENABLED(pPort[i])) {
-
-          if(isBufferNeeded[i]==OMX_FALSE) {
-            target_component=(OMX_COMPONENTTYPE*)pBuffer[i]->hMarkTargetComponent;
-            if(target_component==(OMX_COMPONENTTYPE *)openmaxStandComp) {
-              /*Clear the mark and generate an event*/
-              (*(omx_audio_mixer_component_Private->callbacks->EventHandler))
-                (openmaxStandComp,
-                omx_audio_mixer_component_Private->callbackData,
-                OMX_EventMark, /* The command was completed */
-                1, /* The commands was a OMX_CommandStateSet */
-                0, /* The state has been changed in message->messageParam2 */
-                pBuffer[i]->pMarkData);
-            } else if(pBuffer[i]->hMarkTargetComponent!=NULL){
-              /*If this is not the target component then pass the mark*/
-              pBuffer[nOutputPortIndex]->hMarkTargetComponent  = pBuffer[i]->hMarkTargetComponent;
-              pBuffer[nOutputPortIndex]->pMarkData = pBuffer[i]->pMarkData;
-              pBuffer[i]->pMarkData=NULL;
-            }
-            pBuffer[nOutputPortIndex]->nTimeStamp = pBuffer[i]->nTimeStamp;
-          }
+    if(pBuffer[nOutputPortIndex] == NULL && PORT_IS_ENABLED(pPort[nOutputPortIndex]) &&
+       pPort[nOutputPortIndex]->pBufferSem->semval > 0) {
+      tsem_down(pPort[nOutputPortIndex]->pBufferSem);
+      pBuffer[nOutputPortIndex] = dequeue(pPort[nOutputPortIndex]->pBufferQueue);
+    }
 
-          if(pBuffer[i]->nFlags==OMX_BUFFERFLAG_EOS && pBuffer[i]->nFilledLen==0) {
-            DEBUG(DEB_LEV_FULL_SEQ, "Detected EOS flags in input buffer filled len=%d\n", (int)pBuffer[i]->nFilledLen);
-            pBuffer[nOutputPortIndex]->nFlags = pBuffer[i]->nFlags;
-            pBuffer[i]->nFlags=0;
-            (*(omx_audio_mixer_component_Private->callbacks->EventHandler))
-              (openmaxStandComp,
-              omx_audio_mixer_component_Private->callbackData,
-              OMX_EventBufferFlag, /* The command was completed */
-              nOutputPortIndex, /* The commands was a OMX_CommandStateSet */
-              pBuffer[nOutputPortIndex]->nFlags, /* The state has been changed in message->messageParam2 */
-              NULL);
-          }
+    /*Inputs disabled or being disabled no longer hold back the mix of the others*/
+    nMask = nActive & ~nHeld;
+    while(nMask) {
+      i = __builtin_ctzll(nMask);
+      nMask &= nMask - 1;
+      if(!PORT_IS_ENABLED(pPort[i]) || PORT_IS_BEING_DISABLED(pPort[i])) {
+        nActive &= ~((OMX_U64)1 << i);
+      }
+    }
 
-          //TBD: Tobe verified
-          if(omx_audio_mixer_component_Private->state == OMX_StateExecuting)  {
-            if (omx_audio_mixer_component_Private->BufferMgmtCallback && pBuffer[i]->nFilledLen != 0) {
-              (*(omx_audio_mixer_component_Private->BufferMgmtCallback))(openmaxStandComp, pBuffer[i], pBuffer[nOutputPortIndex]);
-            } else {
-              /*It no buffer management call back the explicitly consume input buffer*/
-              pBuffer[i]->nFilledLen = 0;
-            }
-          } else {
-            DEBUG(DEB_LEV_ERR, "In %s Received Buffer in non-Executing State(%x)\n", __func__, (int)omx_audio_mixer_component_Private->state);
-            if(OMX_TransStateExecutingToIdle == omx_audio_mixer_component_Private->transientState) {
-              pBuffer[i]->nFilledLen = 0;
-            }
-          }
+    /*No buffer to process. So wait here*/
+    if(pBuffer[nOutputPortIndex] == NULL || nHeld == 0 || (nActive & ~nHeld) != 0) {
+      //Signalled from EmptyThisBuffer or FillThisBuffer or some thing else
+      DEBUG(DEB_LEV_FULL_SEQ, "Waiting for next input/output buffer\n");
+      nPerfTime = omx_base_component_PerfTime();
+      tsem_down(omx_audio_mixer_component_Private->bMgmtSem);
+      PERF_COUNTER_ADD(omx_audio_mixer_component_Private->sPerfCounters.nMgmtWaitTime, omx_base_component_PerfTime() - nPerfTime);
+      continue;
+    }
 
-          /*Input Buffer has been completely consumed. So, get new input buffer*/
-          if(pBuffer[i]->nFilledLen==0) {
-            isBufferNeeded[i] = OMX_TRUE;
-          }
-        }
+    nStateGen = tsem_get_gen(omx_audio_mixer_component_Private->bStateSem);
+    if(omx_audio_mixer_component_Private->state==OMX_StatePause &&
+      !(checkAnyPortBeingFlushed(omx_audio_mixer_component_Private))) {
+      /*Waiting at paused state*/
+      tsem_wait_gen(omx_audio_mixer_component_Private->bStateSem, nStateGen);
+      continue;
+    }
+
+    if(omx_audio_mixer_component_Private->pMark.hMarkTargetComponent != NULL){
+      pBuffer[nOutputPortIndex]->hMarkTargetComponent = omx_audio_mixer_component_Private->pMark.hMarkTargetComponent;
+      pBuffer[nOutputPortIndex]->pMarkData            = omx_audio_mixer_component_Private->pMark.pMarkData;
+      omx_audio_mixer_component_Private->pMark.hMarkTargetComponent = NULL;
+      omx_audio_mixer_component_Private->pMark.pMarkData            = NULL;
+    }
+    nMixBuffers = 0;
+    nMask = nHeld;
+    while(nMask) {
+      i = __builtin_ctzll(nMask);
+      nMask &= nMask - 1;
+
+      target_component=(OMX_COMPONENTTYPE*)pBuffer[i]->hMarkTargetComponent;
+      if(target_component==(OMX_COMPONENTTYPE *)openmaxStandComp) {
+        /*Clear the mark and generate an event*/
+        (*(omx_audio_mixer_component_Private->callbacks->EventHandler))
+          (openmaxStandComp,
+          omx_audio_mixer_component_Private->callbackData,
+          OMX_EventMark, /* The command was completed */
+          1, /* The commands was a OMX_CommandStateSet */
+          0, /* The state has been changed in message->messageParam2 */
+          pBuffer[i]->pMarkData);
+      } else if(pBuffer[i]->hMarkTargetComponent!=NULL){
+        /*If this is not the target component then pass the mark*/
+        pBuffer[nOutputPortIndex]->hMarkTargetComponent  = pBuffer[i]->hMarkTargetComponent;
+        pBuffer[nOutputPortIndex]->pMarkData = pBuffer[i]->pMarkData;
+        pBuffer[i]->pMarkData=NULL;
       }
+      pBuffer[nOutputPortIndex]->nTimeStamp = pBuffer[i]->nTimeStamp;
 
-      if(omx_audio_mixer_component_Private->state==OMX_StatePause &&
-        !(checkAnyPortBeingFlushed(omx_audio_mixer_component_Private))) {
-        /*Waiting at paused state*/
-        tsem_wait(omx_audio_mixer_component_Private->bStateSem);
+      /*The stream has ended, the mix does not wait for it until it restarts*/
+      if(pBuffer[i]->nFlags & OMX_BUFFERFLAG_EOS) {
+        nActive &= ~((OMX_U64)1 << i);
+      }
+      if(pBuffer[i]->nFlags==OMX_BUFFERFLAG_EOS && pBuffer[i]->nFilledLen==0) {
+        DEBUG(DEB_LEV_FULL_SEQ, "Detected EOS flags in input buffer filled len=%d\n", (int)pBuffer[i]->nFilledLen);
+        pBuffer[nOutputPortIndex]->nFlags = pBuffer[i]->nFlags;
+        pBuffer[i]->nFlags=0;
+        (*(omx_audio_mixer_component_Private->callbacks->EventHandler))
+          (openmaxStandComp,
+          omx_audio_mixer_component_Private->callbackData,
+          OMX_EventBufferFlag, /* The command was completed */
+          nOutputPortIndex, /* The commands was a OMX_CommandStateSet */
+          pBuffer[nOutputPortIndex]->nFlags, /* The state has been changed in message->messageParam2 */
+          NULL);
       }
 
-      /*If EOS and Input buffer Filled Len Zero then Return output buffer immediately*/
-      if(pBuffer[nOutputPortIndex]->nFilledLen!=0 || pBuffer[nOutputPortIndex]->nFlags==OMX_BUFFERFLAG_EOS){
-        DEBUG(DEB_LEV_SIMPLE_SEQ, "Returning output buffer \n");
-        pPort[nOutputPortIndex]->ReturnBufferFunction(pPort[nOutputPortIndex],pBuffer[nOutputPortIndex]);
-        pBuffer[nOutputPortIndex]=NULL;
-        isBufferNeeded[nOutputPortIndex]=OMX_TRUE;
+      //TBD: Tobe verified
+      if(omx_audio_mixer_component_Private->state == OMX_StateExecuting)  {
+        if (pBuffer[i]->nFilledLen != 0) {
+          /*Mixed below with the buffers of the other ports*/
+          pMixBuffer[nMixBuffers++] = pBuffer[i];
+        }
+      } else {
+        DEBUG(DEB_LEV_ERR, "In %s Received Buffer in non-Executing State(%x)\n", __func__, (int)omx_audio_mixer_component_Private->state);
+        if(OMX_TransStateExecutingToIdle == omx_audio_mixer_component_Private->transientState) {
+          pBuffer[i]->nFilledLen = 0;
+        }
       }
     }
 
-    DEBUG(DEB_LEV_FULL_SEQ, "Input buffer arrived\n");
+    /*All the input buffers available are mixed at once into the output buffer*/
+    if(nMixBuffers > 0) {
+      nPerfTime = omx_base_component_PerfTime();
+      omx_audio_mixer_component_MixBuffers(openmaxStandComp, pMixBuffer, nMixBuffers, pBuffer[nOutputPortIndex]);
+      PERF_COUNTER_ADD(omx_audio_mixer_component_Private->sPerfCounters.nCallbackTime, omx_base_component_PerfTime() - nPerfTime);
+      PERF_COUNTER_ADD(omx_audio_mixer_component_Private->sPerfCounters.nCallbacks, 1);
+    }
 
-    if(omx_audio_mixer_component_Private->state==OMX_StatePause &&
-      !(checkAnyPortBeingFlushed(omx_audio_mixer_component_Private))) {
-      /*Waiting at paused state*/
-      tsem_wait(omx_audio_mixer_component_Private->bStateSem);
+    bProgress = OMX_FALSE;
+    /*If EOS and Input buffer Filled Len Zero then Return output buffer immediately*/
+    if(pBuffer[nOutputPortIndex]->nFilledLen!=0 || pBuffer[nOutputPortIndex]->nFlags==OMX_BUFFERFLAG_EOS){
+      DEBUG(DEB_LEV_SIMPLE_SEQ, "Returning output buffer \n");
+      pPort[nOutputPortIndex]->ReturnBufferFunction(pPort[nOutputPortIndex],pBuffer[nOutputPortIndex]);
+      pBuffer[nOutputPortIndex]=NULL;
+      bProgress = OMX_TRUE;
     }
 
     /*Input Buffer has been completely consumed. So, return input buffer*/
-    for(i=0;i<omx_audio_mixer_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts-1;i++){
-      if(isBufferNeeded[i] == OMX_TRUE && pBuffer[i]!=NULL && PORT_IS_ENABLED(pPort[i])) {
+    nMask = nHeld;
+    while(nMask) {
+      i = __builtin_ctzll(nMask);
+      nMask &= nMask - 1;
+      if(pBuffer[i]->nFilledLen==0) {
         pPort[i]->ReturnBufferFunction(pPort[i],pBuffer[i]);
         pBuffer[i]=NULL;
+        nHeld &= ~((OMX_U64)1 << i);
+        bProgress = OMX_TRUE;
       }
     }
+
+    /*Buffers received out of Executing are kept until something changes*/
+    if(!bProgress) {
+      nPerfTime = omx_base_component_PerfTime();
+      tsem_down(omx_audio_mixer_component_Private->bMgmtSem);
+      PERF_COUNTER_ADD(omx_audio_mixer_component_Private->sPerfCounters.nMgmtWaitTime, omx_base_component_PerfTime() - nPerfTime);
+    }
   }
   DEBUG(DEB_LEV_SIMPLE_SEQ,"Exiting Buffer Management Thread\n");
   return NULL;
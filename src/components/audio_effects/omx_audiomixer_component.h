@@ -38,9 +38,18 @@
 #include <pthread.h>
 #include <omx_base_filter.h>
 #include <omx_base_audio_port.h>
+#include <omx_pcm_kernels.h>
 
-#define MAX_PORTS   5 // Maximum number of ports supported by the mixer. 4 input and 1 output
-#define MAX_CHANNEL 6 // Maximum number of channels supported in a single stream 5.1
+#define MAX_INPUT_PORTS     64 // Maximum number of input ports, one bit each in the ready mask. The mix kernels take one stream more, the data already in the output
+#define DEFAULT_INPUT_PORTS 4  // Number of input ports until OMX_IndexVendorMixerInputs is set
+#define MAX_PORTS   (MAX_INPUT_PORTS + 1) // Maximum number of ports supported by the mixer. The inputs and 1 output
+#define MAX_CHANNEL OMX_PCM_MAX_CHANNELS // Maximum number of channels supported in a single stream 7.1
+
+/** The extension name of OMX_IndexVendorMixerInputs. Its nU32 is the number
+  * of input ports, from 1 to MAX_INPUT_PORTS. The output port follows them.
+  * Setting it creates all the ports again with their default parameters
+  */
+#define AUDIO_MIXER_INPUTS_NAME "OMX.st.index.param.audiomixer.inputs"
 
 /** Audio Mixer port structure.
   */
@@ -61,7 +70,10 @@ ENDCLASS(omx_audio_mixer_component_PortType)
 */
 DERIVEDCLASS(omx_audio_mixer_component_PrivateType, omx_base_filter_PrivateType)
 #define omx_audio_mixer_component_PrivateType_FIELDS omx_base_filter_PrivateType_FIELDS \
-  /** This class is empty for the time being */
+  /** @param nReadyMask bit i is set when input port i receives a buffer, and cleared by the buffer management thread */ \
+  OMX_U64 nReadyMask; \
+  /** @param ePcmFormat sample format of the PCM mode, the same on all the ports */ \
+  omx_pcm_format_t ePcmFormat;
 ENDCLASS(omx_audio_mixer_component_PrivateType)
 
 /* Component private entry points declaration */
@@ -73,6 +85,16 @@ void omx_audio_mixer_component_BufferMgmtCallback(
   OMX_BUFFERHEADERTYPE* inputbuffer,
   OMX_BUFFERHEADERTYPE* outputbuffer);
 
+/** Mixes the input buffers, weighted by the volumes of their ports, into
+  * the output buffer in a single pass. If the output buffer is not empty its
+  * content is mixed in at unity gain
+  */
+void omx_audio_mixer_component_MixBuffers(
+  OMX_COMPONENTTYPE *openmaxStandComp,
+  OMX_BUFFERHEADERTYPE** inputbuffers,
+  OMX_U32 nInputBuffers,
+  OMX_BUFFERHEADERTYPE* outputbuffer);
+
 OMX_ERRORTYPE omx_audio_mixer_component_GetParameter(
   OMX_IN  OMX_HANDLETYPE hComponent,
   OMX_IN  OMX_INDEXTYPE nParamIndex,
@@ -93,10 +115,17 @@ OMX_ERRORTYPE omx_audio_mixer_component_SetConfig(
   OMX_IN  OMX_INDEXTYPE nIndex,
   OMX_IN  OMX_PTR pComponentConfigStructure);
 
+OMX_ERRORTYPE omx_audio_mixer_component_GetExtensionIndex(
+  OMX_IN  OMX_HANDLETYPE hComponent,
+  OMX_IN  OMX_STRING cParameterName,
+  OMX_OUT OMX_INDEXTYPE* pIndexType);
+
 /** This is the central function for component processing, overridden for audio mixer. It
   * is executed in a separate thread, is synchronized with
   * semaphores at each port, those are released each time a new buffer
-  * is available on the given port.
+  * is available on the given port. Only the input ports marked in
+  * nReadyMask are looked at, and an output buffer is produced as soon as
+  * every input taking part in the mix holds a buffer.
   */
 void* omx_audio_mixer_BufferMgmtFunction (void* param);
 
@@ -0,0 +1,989 @@
+/**
+  @file src/components/audio_effects/omx_pcm_kernels.c
+
+  PCM processing kernels shared by the audio effect components.
+
+  Every kernel has a C version and, on x86, SSE2 and AVX2 versions computing
+  exactly the same results. The 16 bit samples are processed in 32 bit
+  fixed point, the 24 and 32 bit ones in double precision, where the
+  products and the sums of up to OMX_PCM_MAX_MIX_INPUTS streams are exact,
+  and the float ones in single precision. The version is chosen once from the CPU
+  features, unless OMX_BELLAGIO_SIMD=0 forces the C version.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <omx_comp_debug_levels.h>
+#include "omx_pcm_kernels.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define PCM_X86
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/** Rounding added before the Q15 products are shifted back */
+#define Q15_ROUND (1 << 14)
+
+/** Scale of the Q15 gains as floating point factors, a power of two so
+ * that the scaling is exact
+ */
+#define Q15_SCALE (1.0 / 32768.0)
+
+/** Adding then subtracting 1.5 * 2^52 rounds a double of magnitude below
+ * 2^51 to the nearest integer, ties to even, without the SSE4.1 rounding
+ * instructions
+ */
+#define ROUND_MAGIC 6755399441055744.0
+
+/** Largest values of the 24 and 32 bit samples */
+#define S24_MAX 8388607.0
+#define S32_MAX 2147483647.0
+
+/** The packed 24 bit samples are widened to 32 bits by blocks of this
+ * many samples, on the stack
+ */
+#define S24_BLOCK 128
+
+/** The 16 bit samples are scaled in C by blocks of this many samples */
+#define S16_BLOCK 64
+
+/** Kernel applying a constant gain, the hot path of the volume component */
+typedef void (*gain_s16_func)(OMX_S16* pOut, const OMX_S16* pIn, OMX_U32 nSamples, OMX_S32 nGain);
+
+/** Kernel mixing the first nSamples samples of all the inputs, which are at
+ * least that long
+ */
+typedef void (*mix_s16_func)(OMX_S16* pOut, const OMX_S16* const* ppIn, const int* pWeights, OMX_U32 nInputs, OMX_U32 nSamples);
+
+/** Kernels of the 24 and 32 bit samples, held in 32 bits, scaling them by
+ * a factor then rounding and saturating them to [-dMax - 1, dMax]
+ */
+typedef void (*gain_s32_func)(int* pOut, const int* pIn, OMX_U32 nSamples, double dGain, double dMax);
+typedef void (*mix_s32_func)(int* pOut, const int* const* ppIn, const double* pWeights, OMX_U32 nInputs, OMX_U32 nSamples, double dMax);
+
+/** Kernels of the float samples */
+typedef void (*gain_f32_func)(float* pOut, const float* pIn, OMX_U32 nSamples, float fGain);
+typedef void (*mix_f32_func)(float* pOut, const float* const* ppIn, const float* pWeights, OMX_U32 nInputs, OMX_U32 nSamples);
+
+static pthread_once_t initOnce = PTHREAD_ONCE_INIT;
+static omx_pcm_simd_t simdLevel = OMX_PCM_SIMD_NONE;
+static gain_s16_func gain_s16 = NULL;
+static mix_s16_func mix_s16 = NULL;
+static gain_s32_func gain_s32 = NULL;
+static mix_s32_func mix_s32 = NULL;
+static gain_f32_func gain_f32 = NULL;
+static mix_f32_func mix_f32 = NULL;
+
+/* OMX_S32 may be a long: the computations are done on int, 32 bits on all
+ * the supported platforms, so that the compiler can vectorize them
+ */
+static inline OMX_S16 saturate_s16(int value) {
+  if (value > 32767) {
+    return 32767;
+  }
+  if (value < -32768) {
+    return -32768;
+  }
+  return (OMX_S16)value;
+}
+
+static inline OMX_S16 gain_sample_s16(OMX_S16 sample, int nGain) {
+  return saturate_s16((sample * nGain + Q15_ROUND) >> 15);
+}
+
+/* GCC only vectorizes at -O2 the loops of a constant trip count that need
+ * no runtime alias check: the samples are scaled by blocks copied on the
+ * stack, which also lets the output be the input. The gain is split in two
+ * 16 bit halves as in the SSE2 kernel, so that the products are 16 by 16
+ * bit multiplies rather than the 32 bit ones SSE2 lacks. Between 0 and
+ * unity the rounded products always fit in 16 bits, no saturation needed
+ */
+static void gain_s16_c(OMX_S16* pOut, const OMX_S16* pIn, OMX_U32 nSamples, OMX_S32 nGain) {
+  OMX_S16 block[S16_BLOCK];
+  OMX_S16 nLow = (OMX_S16)(nGain >> 1);
+  OMX_S16 nHigh = (OMX_S16)(nGain - (nGain >> 1));
+  OMX_U32 i = 0, j;
+
+  if (nGain >= 0 && nGain <= OMX_PCM_UNITY_GAIN) {
+    for (; i + S16_BLOCK <= nSamples; i += S16_BLOCK) {
+      memcpy(block, pIn + i, sizeof(block));
+      for (j = 0; j < S16_BLOCK; j++) {
+        block[j] = (OMX_S16)((block[j] * nLow + block[j] * nHigh + Q15_ROUND) >> 15);
+      }
+      memcpy(pOut + i, block, sizeof(block));
+    }
+  }
+  for (; i < nSamples; i++) {
+    pOut[i] = gain_sample_s16(pIn[i], (int)nGain);
+  }
+}
+
+static void mix_s16_c(OMX_S16* pOut, const OMX_S16* const* ppIn, const int* pWeights, OMX_U32 nInputs, OMX_U32 nSamples) {
+  OMX_U32 i, p;
+  int acc;
+
+  for (i = 0; i < nSamples; i++) {
+    acc = Q15_ROUND;
+    for (p = 0; p < nInputs; p++) {
+      acc += ppIn[p][i] * pWeights[p];
+    }
+    pOut[i] = saturate_s16(acc >> 15);
+  }
+}
+
+/* The comparisons are written as the minpd and maxpd of the SIMD kernels,
+ * which return their second operand when the first one is not smaller or
+ * larger
+ */
+static inline int round_s32(double value, double dMax) {
+  value = value < dMax ? value : dMax;
+  value = value > -dMax - 1.0 ? value : -dMax - 1.0;
+  return (int)((value + ROUND_MAGIC) - ROUND_MAGIC);
+}
+
+static void gain_s32_c(int* pOut, const int* pIn, OMX_U32 nSamples, double dGain, double dMax) {
+  OMX_U32 i;
+
+  for (i = 0; i < nSamples; i++) {
+    pOut[i] = round_s32(pIn[i] * dGain, dMax);
+  }
+}
+
+static void mix_s32_c(int* pOut, const int* const* ppIn, const double* pWeights, OMX_U32 nInputs, OMX_U32 nSamples, double dMax) {
+  OMX_U32 i, p;
+  double acc;
+
+  for (i = 0; i < nSamples; i++) {
+    acc = 0.0;
+    for (p = 0; p < nInputs; p++) {
+      acc += ppIn[p][i] * pWeights[p];
+    }
+    pOut[i] = round_s32(acc, dMax);
+  }
+}
+
+static void gain_f32_c(float* pOut, const float* pIn, OMX_U32 nSamples, float fGain) {
+  OMX_U32 i;
+
+  for (i = 0; i < nSamples; i++) {
+    pOut[i] = pIn[i] * fGain;
+  }
+}
+
+static void mix_f32_c(float* pOut, const float* const* ppIn, const float* pWeights, OMX_U32 nInputs, OMX_U32 nSamples) {
+  OMX_U32 i, p;
+  float acc;
+
+  for (i = 0; i < nSamples; i++) {
+    acc = 0.0f;
+    for (p = 0; p < nInputs; p++) {
+      acc += ppIn[p][i] * pWeights[p];
+    }
+    pOut[i] = acc;
+  }
+}
+
+#ifdef PCM_X86
+
+/* The gain, up to 32768, does not fit in a 16 bit lane: it is split in two
+ * halves that pmaddwd multiplies by the same sample and adds in 32 bits.
+ * The products are then rounded and shifted as in C, and packed back to 16
+ * bits with signed saturation
+ */
+static inline OMX_S32 gain_pair(OMX_S32 nGain) {
+  OMX_S32 nLow = nGain >> 1;
+
+  return nLow | ((nGain - nLow) << 16);
+}
+
+TARGET_SSE2 static void gain_s16_sse2(OMX_S16* pOut, const OMX_S16* pIn, OMX_U32 nSamples, OMX_S32 nGain) {
+  __m128i gain = _mm_set1_epi32(gain_pair(nGain));
+  __m128i round = _mm_set1_epi32(Q15_ROUND);
+  __m128i x, lo, hi;
+  OMX_U32 i;
+
+  for (i = 0; i + 8 <= nSamples; i += 8) {
+    x = _mm_loadu_si128((const __m128i*)(pIn + i));
+    lo = _mm_madd_epi16(_mm_unpacklo_epi16(x, x), gain);
+    hi = _mm_madd_epi16(_mm_unpackhi_epi16(x, x), gain);
+    lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 15);
+    hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 15);
+    _mm_storeu_si128((__m128i*)(pOut + i), _mm_packs_epi32(lo, hi));
+  }
+  gain_s16_c(pOut + i, pIn + i, nSamples - i, nGain);
+}
+
+/* The accumulators stay in registers while all the inputs are added, so
+ * that the output is written once
+ */
+TARGET_SSE2 static void mix_s16_sse2(OMX_S16* pOut, const OMX_S16* const* ppIn, const int* pWeights, OMX_U32 nInputs, OMX_U32 nSamples) {
+  OMX_S32 pairs[OMX_PCM_MAX_MIX_INPUTS];
+  __m128i round = _mm_set1_epi32(Q15_ROUND);
+  __m128i x, weight, lo, hi;
+  OMX_U32 i, p;
+
+  for (p = 0; p < nInputs; p++) {
+    pairs[p] = gain_pair(pWeights[p]);
+  }
+  for (i = 0; i + 8 <= nSamples; i += 8) {
+    lo = hi = round;
+    for (p = 0; p < nInputs; p++) {
+      x = _mm_loadu_si128((const __m128i*)(ppIn[p] + i));
+      weight = _mm_set1_epi32(pairs[p]);
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(x, x), weight));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(x, x), weight));
+    }
+    lo = _mm_srai_epi32(lo, 15);
+    hi = _mm_srai_epi32(hi, 15);
+    _mm_storeu_si128((__m128i*)(pOut + i), _mm_packs_epi32(lo, hi));
+  }
+  if (i < nSamples) {
+    const OMX_S16* ppTail[OMX_PCM_MAX_MIX_INPUTS];
+
+    for (p = 0; p < nInputs; p++) {
+      ppTail[p] = ppIn[p] + i;
+    }
+    mix_s16_c(pOut + i, ppTail, pWeights, nInputs, nSamples - i);
+  }
+}
+
+/* The unpacks and the pack work on each 128 bit half, so the samples come
+ * back in their order
+ */
+TARGET_AVX2 static void gain_s16_avx2(OMX_S16* pOut, const OMX_S16* pIn, OMX_U32 nSamples, OMX_S32 nGain) {
+  __m256i gain = _mm256_set1_epi32(gain_pair(nGain));
+  __m256i round = _mm256_set1_epi32(Q15_ROUND);
+  __m256i x, lo, hi;
+  OMX_U32 i;
+
+  for (i = 0; i + 16 <= nSamples; i += 16) {
+    x = _mm256_loadu_si256((const __m256i*)(pIn + i));
+    lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(x, x), gain);
+    hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(x, x), gain);
+    lo = _mm256_srai_epi32(_mm256_add_epi32(lo, round), 15);
+    hi = _mm256_srai_epi32(_mm256_add_epi32(hi, round), 15);
+    _mm256_storeu_si256((__m256i*)(pOut + i), _mm256_packs_epi32(lo, hi));
+  }
+  gain_s16_sse2(pOut + i, pIn + i, nSamples - i, nGain);
+}
+
+TARGET_AVX2 static void mix_s16_avx2(OMX_S16* pOut, const OMX_S16* const* ppIn, const int* pWeights, OMX_U32 nInputs, OMX_U32 nSamples) {
+  OMX_S32 pairs[OMX_PCM_MAX_MIX_INPUTS];
+  __m256i round = _mm256_set1_epi32(Q15_ROUND);
+  __m256i x, weight, lo, hi;
+  OMX_U32 i, p;
+
+  for (p = 0; p < nInputs; p++) {
+    pairs[p] = gain_pair(pWeights[p]);
+  }
+  for (i = 0; i + 16 <= nSamples; i += 16) {
+    lo = hi = round;
+    for (p = 0; p < nInputs; p++) {
+      x = _mm256_loadu_si256((const __m256i*)(ppIn[p] + i));
+      weight = _mm256_set1_epi32(pairs[p]);
+      lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(x, x), weight));
+      hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(x, x), weight));
+    }
+    lo = _mm256_srai_epi32(lo, 15);
+    hi = _mm256_srai_epi32(hi, 15);
+    _mm256_storeu_si256((__m256i*)(pOut + i), _mm256_packs_epi32(lo, hi));
+  }
+  if (i < nSamples) {
+    const OMX_S16* ppTail[OMX_PCM_MAX_MIX_INPUTS];
+
+    for (p = 0; p < nInputs; p++) {
+      ppTail[p] = ppIn[p] + i;
+    }
+    mix_s16_sse2(pOut + i, ppTail, pWeights, nInputs, nSamples - i);
+  }
+}
+
+/* Two samples per register in double precision: the low half of the
+ * samples goes to one register and the high half to another
+ */
+TARGET_SSE2 static inline __m128i round_s32_sse2(__m128d lo, __m128d hi, __m128d max, __m128d min, __m128d magic) {
+  lo = _mm_max_pd(_mm_min_pd(lo, max), min);
+  hi = _mm_max_pd(_mm_min_pd(hi, max), min);
+  lo = _mm_sub_pd(_mm_add_pd(lo, magic), magic);
+  hi = _mm_sub_pd(_mm_add_pd(hi, magic), magic);
+  return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+TARGET_SSE2 static void gain_s32_sse2(int* pOut, const int* pIn, OMX_U32 nSamples, double dGain, double dMax) {
+  __m128d gain = _mm_set1_pd(dGain);
+  __m128d max = _mm_set1_pd(dMax);
+  __m128d min = _mm_set1_pd(-dMax - 1.0);
+  __m128d magic = _mm_set1_pd(ROUND_MAGIC);
+  __m128d lo, hi;
+  __m128i x;
+  OMX_U32 i;
+
+  for (i = 0; i + 4 <= nSamples; i += 4) {
+    x = _mm_loadu_si128((const __m128i*)(pIn + i));
+    lo = _mm_mul_pd(_mm_cvtepi32_pd(x), gain);
+    hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2))), gain);
+    _mm_storeu_si128((__m128i*)(pOut + i), round_s32_sse2(lo, hi, max, min, magic));
+  }
+  gain_s32_c(pOut + i, pIn + i, nSamples - i, dGain, dMax);
+}
+
+TARGET_SSE2 static void mix_s32_sse2(int* pOut, const int* const* ppIn, const double* pWeights, OMX_U32 nInputs, OMX_U32 nSamples, double dMax) {
+  __m128d max = _mm_set1_pd(dMax);
+  __m128d min = _mm_set1_pd(-dMax - 1.0);
+  __m128d magic = _mm_set1_pd(ROUND_MAGIC);
+  __m128d weight, lo, hi;
+  __m128i x;
+  OMX_U32 i, p;
+
+  for (i = 0; i + 4 <= nSamples; i += 4) {
+    lo = hi = _mm_setzero_pd();
+    for (p = 0; p < nInputs; p++) {
+      x = _mm_loadu_si128((const __m128i*)(ppIn[p] + i));
+      weight = _mm_set1_pd(pWeights[p]);
+      lo = _mm_add_pd(lo, _mm_mul_pd(_mm_cvtepi32_pd(x), weight));
+      hi = _mm_add_pd(hi, _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2))), weight));
+    }
+    _mm_storeu_si128((__m128i*)(pOut + i), round_s32_sse2(lo, hi, max, min, magic));
+  }
+  if (i < nSamples) {
+    const int* ppTail[OMX_PCM_MAX_MIX_INPUTS];
+
+    for (p = 0; p < nInputs; p++) {
+      ppTail[p] = ppIn[p] + i;
+    }
+    mix_s32_c(pOut + i, ppTail, pWeights, nInputs, nSamples - i, dMax);
+  }
+}
+
+TARGET_SSE2 static void gain_f32_sse2(float* pOut, const float* pIn, OMX_U32 nSamples, float fGain) {
+  __m128 gain = _mm_set1_ps(fGain);
+  OMX_U32 i;
+
+  for (i = 0; i + 4 <= nSamples; i += 4) {
+    _mm_storeu_ps(pOut + i, _mm_mul_ps(_mm_loadu_ps(pIn + i), gain));
+  }
+  gain_f32_c(pOut + i, pIn + i, nSamples - i, fGain);
+}
+
+TARGET_SSE2 static void mix_f32_sse2(float* pOut, const float* const* ppIn, const float* pWeights, OMX_U32 nInputs, OMX_U32 nSamples) {
+  __m128 acc;
+  OMX_U32 i, p;
+
+  for (i = 0; i + 4 <= nSamples; i += 4) {
+    acc = _mm_setzero_ps();
+    for (p = 0; p < nInputs; p++) {
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(ppIn[p] + i), _mm_set1_ps(pWeights[p])));
+    }
+    _mm_storeu_ps(pOut + i, acc);
+  }
+  if (i < nSamples) {
+    const float* ppTail[OMX_PCM_MAX_MIX_INPUTS];
+
+    for (p = 0; p < nInputs; p++) {
+      ppTail[p] = ppIn[p] + i;
+    }
+    mix_f32_c(pOut + i, ppTail, pWeights, nInputs, nSamples - i);
+  }
+}
+
+/* Four samples per register in double precision. FMA is not enabled, so
+ * the products are rounded before the additions as in C
+ */
+TARGET_AVX2 static inline __m128i round_s32_avx2(__m256d value, __m256d max, __m256d min, __m256d magic) {
+  value = _mm256_max_pd(_mm256_min_pd(value, max), min);
+  value = _mm256_sub_pd(_mm256_add_pd(value, magic), magic);
+  return _mm256_cvttpd_epi32(value);
+}
+
+TARGET_AVX2 static void gain_s32_avx2(int* pOut, const int* pIn, OMX_U32 nSamples, double dGain, double dMax) {
+  __m256d gain = _mm256_set1_pd(dGain);
+  __m256d max = _mm256_set1_pd(dMax);
+  __m256d min = _mm256_set1_pd(-dMax - 1.0);
+  __m256d magic = _mm256_set1_pd(ROUND_MAGIC);
+  __m256d lo, hi;
+  OMX_U32 i;
+
+  for (i = 0; i + 8 <= nSamples; i += 8) {
+    lo = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(pIn + i))), gain);
+    hi = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(pIn + i + 4))), gain);
+    _mm_storeu_si128((__m128i*)(pOut + i), round_s32_avx2(lo, max, min, magic));
+    _mm_storeu_si128((__m128i*)(pOut + i + 4), round_s32_avx2(hi, max, min, magic));
+  }
+  gain_s32_sse2(pOut + i, pIn + i, nSamples - i, dGain, dMax);
+}
+
+TARGET_AVX2 static void mix_s32_avx2(int* pOut, const int* const* ppIn, const double* pWeights, OMX_U32 nInputs, OMX_U32 nSamples, double dMax) {
+  __m256d max = _mm256_set1_pd(dMax);
+  __m256d min = _mm256_set1_pd(-dMax - 1.0);
+  __m256d magic = _mm256_set1_pd(ROUND_MAGIC);
+  __m256d weight, lo, hi;
+  OMX_U32 i, p;
+
+  for (i = 0; i + 8 <= nSamples; i += 8) {
+    lo = hi = _mm256_setzero_pd();
+    for (p = 0; p < nInputs; p++) {
+      weight = _mm256_set1_pd(pWeights[p]);
+      lo = _mm256_add_pd(lo, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(ppIn[p] + i))), weight));
+      hi = _mm256_add_pd(hi, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(ppIn[p] + i + 4))), weight));
+    }
+    _mm_storeu_si128((__m128i*)(pOut + i), round_s32_avx2(lo, max, min, magic));
+    _mm_storeu_si128((__m128i*)(pOut + i + 4), round_s32_avx2(hi, max, min, magic));
+  }
+  if (i < nSamples) {
+    const int* ppTail[OMX_PCM_MAX_MIX_INPUTS];
+
+    for (p = 0; p < nInputs; p++) {
+      ppTail[p] = ppIn[p] + i;
+    }
+    mix_s32_sse2(pOut + i, ppTail, pWeights, nInputs, nSamples - i, dMax);
+  }
+}
+
+TARGET_AVX2 static void gain_f32_avx2(float* pOut, const float* pIn, OMX_U32 nSamples, float fGain) {
+  __m256 gain = _mm256_set1_ps(fGain);
+  OMX_U32 i;
+
+  for (i = 0; i + 8 <= nSamples; i += 8) {
+    _mm256_storeu_ps(pOut + i, _mm256_mul_ps(_mm256_loadu_ps(pIn + i), gain));
+  }
+  gain_f32_sse2(pOut + i, pIn + i, nSamples - i, fGain);
+}
+
+TARGET_AVX2 static void mix_f32_avx2(float* pOut, const float* const* ppIn, const float* pWeights, OMX_U32 nInputs, OMX_U32 nSamples) {
+  __m256 acc;
+  OMX_U32 i, p;
+
+  for (i = 0; i + 8 <= nSamples; i += 8) {
+    acc = _mm256_setzero_ps();
+    for (p = 0; p < nInputs; p++) {
+      acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(ppIn[p] + i), _mm256_set1_ps(pWeights[p])));
+    }
+    _mm256_storeu_ps(pOut + i, acc);
+  }
+  if (i < nSamples) {
+    const float* ppTail[OMX_PCM_MAX_MIX_INPUTS];
+
+    for (p = 0; p < nInputs; p++) {
+      ppTail[p] = ppIn[p] + i;
+    }
+    mix_f32_sse2(pOut + i, ppTail, pWeights, nInputs, nSamples - i);
+  }
+}
+
+#endif
+
+static omx_pcm_simd_t cpu_simd_level(void) {
+#ifdef PCM_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return OMX_PCM_SIMD_AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return OMX_PCM_SIMD_SSE2;
+  }
+#endif
+  return OMX_PCM_SIMD_NONE;
+}
+
+static void set_simd_level(omx_pcm_simd_t level) {
+  simdLevel = level;
+  switch (level) {
+#ifdef PCM_X86
+  case OMX_PCM_SIMD_AVX2:
+    gain_s16 = gain_s16_avx2;
+    mix_s16 = mix_s16_avx2;
+    gain_s32 = gain_s32_avx2;
+    mix_s32 = mix_s32_avx2;
+    gain_f32 = gain_f32_avx2;
+    mix_f32 = mix_f32_avx2;
+    break;
+  case OMX_PCM_SIMD_SSE2:
+    gain_s16 = gain_s16_sse2;
+    mix_s16 = mix_s16_sse2;
+    gain_s32 = gain_s32_sse2;
+    mix_s32 = mix_s32_sse2;
+    gain_f32 = gain_f32_sse2;
+    mix_f32 = mix_f32_sse2;
+    break;
+#endif
+  default:
+    simdLevel = OMX_PCM_SIMD_NONE;
+    gain_s16 = gain_s16_c;
+    mix_s16 = mix_s16_c;
+    gain_s32 = gain_s32_c;
+    mix_s32 = mix_s32_c;
+    gain_f32 = gain_f32_c;
+    mix_f32 = mix_f32_c;
+  }
+}
+
+static void init_kernels(void) {
+  char* value = getenv(OMX_PCM_SIMD_ENV);
+
+  if (value && !strcmp(value, "0")) {
+    set_simd_level(OMX_PCM_SIMD_NONE);
+  } else {
+    set_simd_level(cpu_simd_level());
+  }
+  DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s PCM kernels use SIMD level %i\n", __func__, (int)simdLevel);
+}
+
+omx_pcm_simd_t omx_pcm_simd_level(void) {
+  pthread_once(&initOnce, init_kernels);
+  return simdLevel;
+}
+
+omx_pcm_simd_t omx_pcm_simd_select(omx_pcm_simd_t level) {
+  omx_pcm_simd_t cpuLevel = cpu_simd_level();
+
+  pthread_once(&initOnce, init_kernels);
+  set_simd_level(level < cpuLevel ? level : cpuLevel);
+  return simdLevel;
+}
+
+OMX_S32 omx_pcm_gain_from_percent(OMX_S32 nPercent) {
+  if (nPercent <= 0) {
+    return 0;
+  }
+  if (nPercent >= 100) {
+    return OMX_PCM_UNITY_GAIN;
+  }
+  return (nPercent * OMX_PCM_UNITY_GAIN + 50) / 100;
+}
+
+void omx_pcm_gain_s16(OMX_S16* pOut, const OMX_S16* pIn, OMX_U32 nSamples, OMX_U32 nChannels, OMX_S32 nStartGain, OMX_S32 nEndGain) {
+  omx_pcm_gain(OMX_PCM_FORMAT_S16, pOut, pIn, nSamples, nChannels, nStartGain, nEndGain);
+}
+
+OMX_U32 omx_pcm_mix_s16(OMX_S16* pOut, const OMX_S16* const* ppIn, const OMX_U32* pSamples, const OMX_S32* pWeights, OMX_U32 nInputs) {
+  int weights[OMX_PCM_MAX_MIX_INPUTS];
+  OMX_U32 nCommon, nLongest, i, p;
+  int acc;
+
+  pthread_once(&initOnce, init_kernels);
+  if (nInputs == 0) {
+    return 0;
+  }
+  if (nInputs > OMX_PCM_MAX_MIX_INPUTS) {
+    nInputs = OMX_PCM_MAX_MIX_INPUTS;
+  }
+  nCommon = nLongest = pSamples[0];
+  for (p = 0; p < nInputs; p++) {
+    weights[p] = (int)pWeights[p];
+    if (pSamples[p] < nCommon) {
+      nCommon = pSamples[p];
+    }
+    if (pSamples[p] > nLongest) {
+      nLongest = pSamples[p];
+    }
+  }
+
+  mix_s16(pOut, ppIn, weights, nInputs, nCommon);
+
+  /* Streams of different lengths only happen at the end of a stream */
+  for (i = nCommon; i < nLongest; i++) {
+    acc = Q15_ROUND;
+    for (p = 0; p < nInputs; p++) {
+      if (i < pSamples[p]) {
+        acc += ppIn[p][i] * weights[p];
+      }
+    }
+    pOut[i] = saturate_s16(acc >> 15);
+  }
+  return nLongest;
+}
+
+OMX_ERRORTYPE omx_pcm_format_from_mode(const OMX_AUDIO_PARAM_PCMMODETYPE* pMode, omx_pcm_format_t* pFormat) {
+  if (pMode->nChannels < 1 || pMode->nChannels > OMX_PCM_MAX_CHANNELS ||
+      (!pMode->bInterleaved && pMode->nChannels > 1) || pMode->ePCMMode != OMX_AUDIO_PCMModeLinear) {
+    return OMX_ErrorBadParameter;
+  }
+  if (pMode->eNumData == OMX_NumericalDataVendorFloat && pMode->nBitPerSample == 32) {
+    *pFormat = OMX_PCM_FORMAT_F32;
+    return OMX_ErrorNone;
+  }
+  if (pMode->eNumData != OMX_NumericalDataSigned) {
+    return OMX_ErrorBadParameter;
+  }
+  switch (pMode->nBitPerSample) {
+  case 16:
+    *pFormat = OMX_PCM_FORMAT_S16;
+    break;
+  case 24:
+    *pFormat = OMX_PCM_FORMAT_S24;
+    break;
+  case 32:
+    *pFormat = OMX_PCM_FORMAT_S32;
+    break;
+  default:
+    return OMX_ErrorBadParameter;
+  }
+  return OMX_ErrorNone;
+}
+
+OMX_U32 omx_pcm_sample_size(omx_pcm_format_t eFormat) {
+  switch (eFormat) {
+  case OMX_PCM_FORMAT_S24:
+    return 3;
+  case OMX_PCM_FORMAT_S32:
+  case OMX_PCM_FORMAT_F32:
+    return 4;
+  default:
+    return 2;
+  }
+}
+
+static inline int load_s24(const OMX_U8* pIn) {
+  return (int)(((unsigned int)pIn[0] << 8) | ((unsigned int)pIn[1] << 16) | ((unsigned int)pIn[2] << 24)) >> 8;
+}
+
+static inline void store_s24(OMX_U8* pOut, int value) {
+  pOut[0] = (OMX_U8)value;
+  pOut[1] = (OMX_U8)(value >> 8);
+  pOut[2] = (OMX_U8)(value >> 16);
+}
+
+/** Widens nSamples packed samples and clears the rest of the block, so
+ * that a shorter stream counts as silence
+ */
+static void unpack_s24(int* pOut, const OMX_U8* pIn, OMX_U32 nSamples) {
+  OMX_U32 i;
+
+  for (i = 0; i < nSamples; i++) {
+    pOut[i] = load_s24(pIn + 3 * i);
+  }
+  for (; i < S24_BLOCK; i++) {
+    pOut[i] = 0;
+  }
+}
+
+static void pack_s24(OMX_U8* pOut, const int* pIn, OMX_U32 nSamples) {
+  OMX_U32 i;
+
+  for (i = 0; i < nSamples; i++) {
+    store_s24(pOut + 3 * i, pIn[i]);
+  }
+}
+
+/** Steps the gain of a ramp frame by frame. The gain of a frame is the
+ * start gain plus the change times the frames done over all the frames,
+ * rounded towards zero as the division would; it is tracked as a quotient
+ * and a remainder so that the frames take no division
+ */
+typedef struct ramp_step_t {
+  int nGain;
+  int nSign;
+  OMX_U32 nQuotient;
+  OMX_U32 nRemainder;
+  OMX_U32 nFrames;
+  OMX_U32 nCarry;
+} ramp_step_t;
+
+static void ramp_start(ramp_step_t* pStep, OMX_S32 nStartGain, OMX_S32 nEndGain, OMX_U32 nFrames) {
+  OMX_U32 nChange = (OMX_U32)(nEndGain > nStartGain ? nEndGain - nStartGain : nStartGain - nEndGain);
+
+  pStep->nGain = (int)nStartGain;
+  pStep->nSign = nEndGain > nStartGain ? 1 : -1;
+  pStep->nQuotient = nChange / nFrames;
+  pStep->nRemainder = nChange % nFrames;
+  pStep->nFrames = nFrames;
+  pStep->nCarry = 0;
+}
+
+/* The carry is taken without a branch, it follows no pattern the branch
+ * predictor could learn
+ */
+static inline int ramp_next(ramp_step_t* pStep) {
+  OMX_U32 nCarry = pStep->nCarry + pStep->nRemainder;
+  OMX_U32 nOver = nCarry >= pStep->nFrames;
+
+  pStep->nCarry = nCarry - (pStep->nFrames & (0 - nOver));
+  pStep->nGain += pStep->nSign * (int)(pStep->nQuotient + nOver);
+  return pStep->nGain;
+}
+
+/** Ramps the gain of 16 bit samples between 0 and unity. A block holds
+ * whole frames. The gain of each sample is computed on its own from the
+ * number of its frame, so that the loops vectorize: the change times that
+ * number plus a half, over the number of frames, stays further from the
+ * integers than the rounding errors of the doubles, and truncates to the
+ * quotient of the integer division. The end of the last block is not
+ * stored
+ */
+static void ramp_s16(OMX_S16* pOut, const OMX_S16* pIn, OMX_U32 nSamples, OMX_U32 nChannels, OMX_S32 nStartGain, OMX_S32 nEndGain, OMX_U32 nFrames) {
+  OMX_S16 block[S16_BLOCK];
+  OMX_S16 lows[S16_BLOCK];
+  OMX_S16 highs[S16_BLOCK];
+  int gains[S16_BLOCK];
+  double frames[S16_BLOCK];
+  OMX_U32 nBlockSamples = S16_BLOCK / nChannels * nChannels;
+  double dBlockFrames = (double)(S16_BLOCK / nChannels);
+  double dChange = (double)(nEndGain > nStartGain ? nEndGain - nStartGain : nStartGain - nEndGain);
+  double dInverse = 1.0 / (double)nFrames;
+  int nStart = (int)nStartGain;
+  int nSign = nEndGain > nStartGain ? 1 : -1;
+  OMX_U32 i, j, n;
+
+  memset(block, 0, sizeof(block));
+  for (j = 0; j < S16_BLOCK; j++) {
+    frames[j] = (double)(j / nChannels + 1) - dBlockFrames;
+  }
+  for (i = 0; i < nSamples; i += n) {
+    n = nSamples - i < nBlockSamples ? nSamples - i : nBlockSamples;
+    for (j = 0; j < S16_BLOCK; j++) {
+      frames[j] += dBlockFrames;
+    }
+    for (j = 0; j < S16_BLOCK; j++) {
+      gains[j] = (int)((frames[j] * dChange + 0.5) * dInverse);
+    }
+    for (j = 0; j < S16_BLOCK; j++) {
+      gains[j] = nStart + nSign * gains[j];
+      lows[j] = (OMX_S16)(gains[j] >> 1);
+      highs[j] = (OMX_S16)(gains[j] - (gains[j] >> 1));
+    }
+    if (n == S16_BLOCK) {
+      memcpy(block, pIn + i, sizeof(block));
+    } else {
+      memcpy(block, pIn + i, n * sizeof(OMX_S16));
+    }
+    for (j = 0; j < S16_BLOCK; j++) {
+      block[j] = (OMX_S16)((block[j] * lows[j] + block[j] * highs[j] + Q15_ROUND) >> 15);
+    }
+    if (n == S16_BLOCK) {
+      memcpy(pOut + i, block, sizeof(block));
+    } else {
+      memcpy(pOut + i, block, n * sizeof(OMX_S16));
+    }
+  }
+}
+
+/** Ramps the gain of samples of any format, see omx_pcm_gain_s16 */
+static void ramp(omx_pcm_format_t eFormat, OMX_PTR pOut, const void* pIn, OMX_U32 nSamples, OMX_U32 nChannels, OMX_S32 nStartGain, OMX_S32 nEndGain) {
+  ramp_step_t step;
+  OMX_U32 nFrames, i, n, c;
+  int nGain;
+
+  if (nChannels == 0) {
+    nChannels = 1;
+  }
+  nFrames = (nSamples + nChannels - 1) / nChannels;
+  if (nFrames == 0) {
+    return;
+  }
+  if (eFormat == OMX_PCM_FORMAT_S16 && nChannels <= OMX_PCM_MAX_CHANNELS &&
+      nStartGain >= 0 && nStartGain <= OMX_PCM_UNITY_GAIN && nEndGain >= 0 && nEndGain <= OMX_PCM_UNITY_GAIN) {
+    ramp_s16(pOut, pIn, nSamples, nChannels, nStartGain, nEndGain, nFrames);
+    return;
+  }
+  ramp_start(&step, nStartGain, nEndGain, nFrames);
+  for (i = 0; i < nSamples; i += n) {
+    nGain = ramp_next(&step);
+    n = nSamples - i < nChannels ? nSamples - i : nChannels;
+    switch (eFormat) {
+    case OMX_PCM_FORMAT_S24:
+      for (c = 0; c < n; c++) {
+        store_s24((OMX_U8*)pOut + 3 * (i + c), round_s32(load_s24((const OMX_U8*)pIn + 3 * (i + c)) * (nGain * Q15_SCALE), S24_MAX));
+      }
+      break;
+    case OMX_PCM_FORMAT_S32:
+      for (c = 0; c < n; c++) {
+        ((int*)pOut)[i + c] = round_s32(((const int*)pIn)[i + c] * (nGain * Q15_SCALE), S32_MAX);
+      }
+      break;
+    case OMX_PCM_FORMAT_F32:
+      for (c = 0; c < n; c++) {
+        ((float*)pOut)[i + c] = ((const float*)pIn)[i + c] * (float)(nGain * Q15_SCALE);
+      }
+      break;
+    default:
+      for (c = 0; c < n; c++) {
+        ((OMX_S16*)pOut)[i + c] = gain_sample_s16(((const OMX_S16*)pIn)[i + c], nGain);
+      }
+    }
+  }
+}
+
+void omx_pcm_gain(omx_pcm_format_t eFormat, OMX_PTR pOut, const void* pIn, OMX_U32 nSamples, OMX_U32 nChannels, OMX_S32 nStartGain, OMX_S32 nEndGain) {
+  int block[S24_BLOCK];
+  OMX_U32 i, n;
+
+  pthread_once(&initOnce, init_kernels);
+  if (nStartGain != nEndGain) {
+    ramp(eFormat, pOut, pIn, nSamples, nChannels, nStartGain, nEndGain);
+    return;
+  }
+  switch (eFormat) {
+  case OMX_PCM_FORMAT_S24:
+    for (i = 0; i < nSamples; i += n) {
+      n = nSamples - i < S24_BLOCK ? nSamples - i : S24_BLOCK;
+      unpack_s24(block, (const OMX_U8*)pIn + 3 * i, n);
+      gain_s32(block, block, n, nEndGain * Q15_SCALE, S24_MAX);
+      pack_s24((OMX_U8*)pOut + 3 * i, block, n);
+    }
+    break;
+  case OMX_PCM_FORMAT_S32:
+    gain_s32(pOut, pIn, nSamples, nEndGain * Q15_SCALE, S32_MAX);
+    break;
+  case OMX_PCM_FORMAT_F32:
+    gain_f32(pOut, pIn, nSamples, (float)(nEndGain * Q15_SCALE));
+    break;
+  default:
+    gain_s16(pOut, pIn, nSamples, nEndGain);
+  }
+}
+
+/** Mixes the packed 24 bit streams block by block, up to the longest one */
+static void mix_s24(OMX_U8* pOut, const OMX_U8* const* ppIn, const OMX_U32* pSamples, const double* pWeights, OMX_U32 nInputs, OMX_U32 nLongest) {
+  int blocks[OMX_PCM_MAX_MIX_INPUTS][S24_BLOCK];
+  const int* ppBlocks[OMX_PCM_MAX_MIX_INPUTS];
+  OMX_U32 i, n, p;
+
+  for (p = 0; p < nInputs; p++) {
+    ppBlocks[p] = blocks[p];
+  }
+  for (i = 0; i < nLongest; i += n) {
+    n = nLongest - i < S24_BLOCK ? nLongest - i : S24_BLOCK;
+    for (p = 0; p < nInputs; p++) {
+      unpack_s24(blocks[p], ppIn[p] + 3 * i, pSamples[p] <= i ? 0 : (pSamples[p] - i < n ? pSamples[p] - i : n));
+    }
+    mix_s32(blocks[0], ppBlocks, pWeights, nInputs, n, S24_MAX);
+    pack_s24(pOut + 3 * i, blocks[0], n);
+  }
+}
+
+OMX_U32 omx_pcm_mix(omx_pcm_format_t eFormat, OMX_PTR pOut, const void* const* ppIn, const OMX_U32* pSamples, const OMX_S32* pWeights, OMX_U32 nInputs) {
+  double weights[OMX_PCM_MAX_MIX_INPUTS];
+  float fWeights[OMX_PCM_MAX_MIX_INPUTS];
+  OMX_U32 nCommon, nLongest, i, p;
+  double acc;
+  float fAcc;
+
+  if (eFormat == OMX_PCM_FORMAT_S16) {
+    return omx_pcm_mix_s16(pOut, (const OMX_S16* const*)ppIn, pSamples, pWeights, nInputs);
+  }
+  pthread_once(&initOnce, init_kernels);
+  if (nInputs == 0) {
+    return 0;
+  }
+  if (nInputs > OMX_PCM_MAX_MIX_INPUTS) {
+    nInputs = OMX_PCM_MAX_MIX_INPUTS;
+  }
+  nCommon = nLongest = pSamples[0];
+  for (p = 0; p < nInputs; p++) {
+    weights[p] = pWeights[p] * Q15_SCALE;
+    fWeights[p] = (float)weights[p];
+    if (pSamples[p] < nCommon) {
+      nCommon = pSamples[p];
+    }
+    if (pSamples[p] > nLongest) {
+      nLongest = pSamples[p];
+    }
+  }
+
+  switch (eFormat) {
+  case OMX_PCM_FORMAT_S24:
+    mix_s24(pOut, (const OMX_U8* const*)ppIn, pSamples, weights, nInputs, nLongest);
+    break;
+  case OMX_PCM_FORMAT_S32:
+    mix_s32(pOut, (const int* const*)ppIn, weights, nInputs, nCommon, S32_MAX);
+    for (i = nCommon; i < nLongest; i++) {
+      acc = 0.0;
+      for (p = 0; p < nInputs; p++) {
+        if (i < pSamples[p]) {
+          acc += ((const int*)ppIn[p])[i] * weights[p];
+        }
+      }
+      ((int*)pOut)[i] = round_s32(acc, S32_MAX);
+    }
+    break;
+  default:
+    mix_f32(pOut, (const float* const*)ppIn, fWeights, nInputs, nCommon);
+    for (i = nCommon; i < nLongest; i++) {
+      fAcc = 0.0f;
+      for (p = 0; p < nInputs; p++) {
+        if (i < pSamples[p]) {
+          fAcc += ((const float*)ppIn[p])[i] * fWeights[p];
+        }
+      }
+      ((float*)pOut)[i] = fAcc;
+    }
+  }
+  return nLongest;
+}
+
+/* The conversions only run around the heavier float processing of the
+ * resampler, the plain C versions are enough for them
+ */
+void omx_pcm_to_float(omx_pcm_format_t eFormat, float* pOut, const void* pIn, OMX_U32 nSamples) {
+  OMX_U32 i;
+
+  switch (eFormat) {
+  case OMX_PCM_FORMAT_S16:
+    for (i = 0; i < nSamples; i++) {
+      pOut[i] = ((const OMX_S16*)pIn)[i] * (float)Q15_SCALE;
+    }
+    break;
+  case OMX_PCM_FORMAT_S24:
+    for (i = 0; i < nSamples; i++) {
+      pOut[i] = (float)(load_s24((const OMX_U8*)pIn + 3 * i) * (1.0 / 8388608.0));
+    }
+    break;
+  case OMX_PCM_FORMAT_S32:
+    for (i = 0; i < nSamples; i++) {
+      pOut[i] = (float)(((const int*)pIn)[i] * (1.0 / 2147483648.0));
+    }
+    break;
+  default:
+    memcpy(pOut, pIn, nSamples * sizeof(float));
+  }
+}
+
+void omx_pcm_from_float(omx_pcm_format_t eFormat, OMX_PTR pOut, const float* pIn, OMX_U32 nSamples) {
+  OMX_U32 i;
+
+  switch (eFormat) {
+  case OMX_PCM_FORMAT_S16:
+    for (i = 0; i < nSamples; i++) {
+      ((OMX_S16*)pOut)[i] = (OMX_S16)round_s32(pIn[i] * 32768.0, 32767.0);
+    }
+    break;
+  case OMX_PCM_FORMAT_S24:
+    for (i = 0; i < nSamples; i++) {
+      store_s24((OMX_U8*)pOut + 3 * i, round_s32(pIn[i] * 8388608.0, S24_MAX));
+    }
+    break;
+  case OMX_PCM_FORMAT_S32:
+    for (i = 0; i < nSamples; i++) {
+      ((int*)pOut)[i] = round_s32(pIn[i] * 2147483648.0, S32_MAX);
+    }
+    break;
+  default:
+    memcpy(pOut, pIn, nSamples * sizeof(float));
+  }
+}
@@ -0,0 +1,145 @@
+/**
+  @file src/components/audio_effects/omx_pcm_kernels.h
+
+  PCM processing kernels shared by the audio effect components, with SIMD
+  versions selected at run time.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#ifndef __OMX_PCM_KERNELS_H__
+#define __OMX_PCM_KERNELS_H__
+
+#include <OMX_Types.h>
+#include <OMX_Core.h>
+#include <OMX_Audio.h>
+
+/** Environment variable read the first time a kernel is used. 0 selects
+ * the C kernels, e.g. to compare the results
+ */
+#define OMX_PCM_SIMD_ENV "OMX_BELLAGIO_SIMD"
+
+/** Gains are Q15 fixed point values from 0, silence, to
+ * OMX_PCM_UNITY_GAIN, which leaves the samples unchanged
+ */
+#define OMX_PCM_UNITY_GAIN 32768
+
+/** Largest number of streams omx_pcm_mix_s16 mixes at once: the 64 inputs
+ * of the mixer and the data already in its output buffer
+ */
+#define OMX_PCM_MAX_MIX_INPUTS 65
+
+/** Largest number of interleaved channels of the PCM modes accepted */
+#define OMX_PCM_MAX_CHANNELS 8
+
+/** eNumData of the PCM modes with 32 bit float samples, which OpenMAX IL
+ * does not define. The samples are nominally between -1.0 and 1.0 but are
+ * never clipped
+ */
+#define OMX_NumericalDataVendorFloat ((OMX_NUMERICALDATATYPE)0x7F000001)
+
+/** Interleaved sample formats, in the host byte order */
+typedef enum omx_pcm_format_t {
+  OMX_PCM_FORMAT_S16 = 0, /**< signed 16 bit */
+  OMX_PCM_FORMAT_S24,     /**< signed 24 bit packed in 3 bytes, little endian */
+  OMX_PCM_FORMAT_S32,     /**< signed 32 bit */
+  OMX_PCM_FORMAT_F32      /**< 32 bit float, see OMX_NumericalDataVendorFloat */
+} omx_pcm_format_t;
+
+/** Instruction sets the kernels can use, in increasing order */
+typedef enum omx_pcm_simd_t {
+  OMX_PCM_SIMD_NONE = 0,
+  OMX_PCM_SIMD_SSE2,
+  OMX_PCM_SIMD_AVX2
+} omx_pcm_simd_t;
+
+/** @return the instruction set used by the kernels */
+omx_pcm_simd_t omx_pcm_simd_level(void);
+
+/** Restricts the kernels to an instruction set, for the tests and the
+ * benchmarks. Must not be called while a kernel is running
+ *
+ * @return the instruction set actually used, which is lower than the
+ * requested one if the CPU does not support it
+ */
+omx_pcm_simd_t omx_pcm_simd_select(omx_pcm_simd_t level);
+
+/** @return the Q15 gain of a linear volume, clamped between 0 and 100 */
+OMX_S32 omx_pcm_gain_from_percent(OMX_S32 nPercent);
+
+/** Multiplies interleaved signed 16 bit samples by a Q15 gain, rounding
+ * to the nearest and saturating. If the start and end gains differ the
+ * gain ramps linearly from one to the other across the frames, the last
+ * frame getting the end gain. The output may be the input
+ *
+ * @param nSamples number of samples, all the channels included
+ * @param nChannels number of interleaved channels sharing the same gain
+ */
+void omx_pcm_gain_s16(OMX_S16* pOut, const OMX_S16* pIn, OMX_U32 nSamples, OMX_U32 nChannels, OMX_S32 nStartGain, OMX_S32 nEndGain);
+
+/** Mixes signed 16 bit streams in one pass: each output sample is the sum
+ * of the input samples multiplied by their Q15 weights, accumulated in 32
+ * bits, then rounded to the nearest and saturated once. A stream shorter
+ * than the others counts as silence after its end. The output may be one
+ * of the inputs
+ *
+ * @param ppIn the input streams
+ * @param pSamples number of samples of each input stream
+ * @param pWeights Q15 weight of each input stream, up to
+ * OMX_PCM_UNITY_GAIN. Their sum must not exceed 2 * OMX_PCM_UNITY_GAIN so
+ * that the sums fit in 32 bits
+ * @param nInputs number of input streams, up to OMX_PCM_MAX_MIX_INPUTS
+ * @return the number of samples written, the length of the longest input
+ */
+OMX_U32 omx_pcm_mix_s16(OMX_S16* pOut, const OMX_S16* const* ppIn, const OMX_U32* pSamples, const OMX_S32* pWeights, OMX_U32 nInputs);
+
+/** Gets the sample format of a linear interleaved PCM mode of 1 to
+ * OMX_PCM_MAX_CHANNELS channels
+ *
+ * @return OMX_ErrorBadParameter if the kernels do not handle the mode
+ */
+OMX_ERRORTYPE omx_pcm_format_from_mode(const OMX_AUDIO_PARAM_PCMMODETYPE* pMode, omx_pcm_format_t* pFormat);
+
+/** @return the size in bytes of one sample of a format */
+OMX_U32 omx_pcm_sample_size(omx_pcm_format_t eFormat);
+
+/** Same as omx_pcm_gain_s16 on samples of any format. The integer samples
+ * are rounded to the nearest, ties to even above 16 bits, and saturated;
+ * the float samples are only multiplied
+ */
+void omx_pcm_gain(omx_pcm_format_t eFormat, OMX_PTR pOut, const void* pIn, OMX_U32 nSamples, OMX_U32 nChannels, OMX_S32 nStartGain, OMX_S32 nEndGain);
+
+/** Same as omx_pcm_mix_s16 on streams of any format, rounding and
+ * saturating as omx_pcm_gain. The float sums are not clipped
+ */
+OMX_U32 omx_pcm_mix(omx_pcm_format_t eFormat, OMX_PTR pOut, const void* const* ppIn, const OMX_U32* pSamples, const OMX_S32* pWeights, OMX_U32 nInputs);
+
+/** Converts samples of any format to floats between -1.0 and 1.0 */
+void omx_pcm_to_float(omx_pcm_format_t eFormat, float* pOut, const void* pIn, OMX_U32 nSamples);
+
+/** Converts floats back to samples of any format, rounding to the nearest,
+ * ties to even, and saturating the integer samples
+ */
+void omx_pcm_from_float(omx_pcm_format_t eFormat, OMX_PTR pOut, const float* pIn, OMX_U32 nSamples);
+
+#endif
@@ -0,0 +1,381 @@
+/**
+  @file src/components/audio_effects/omx_pcm_resampler.c
+
+  Polyphase windowed-sinc sample rate converter.
+
+  The ratio of the rates is reduced to nPhases / nStep. Each output frame
+  falls between two input frames at one of nPhases fractional positions,
+  and is the dot product of the nTaps input frames around it with the
+  filter of that phase: a sinc cut off below the lower Nyquist frequency,
+  shaped by a Kaiser window and normalized to unity DC gain. The filters
+  are computed once in double precision and stored as floats.
+
+  The history of each channel is kept apart, so that the dot products run
+  on contiguous samples with the SSE2 or AVX2 version chosen as the PCM
+  kernels are. The SIMD versions add the products in another order than C,
+  so they only agree within the float rounding.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <omx_comp_debug_levels.h>
+#include "omx_pcm_kernels.h"
+#include "omx_pcm_resampler.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define PCM_X86
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/** Input frames appended to the history at once, beyond the filter length */
+#define HISTORY_BLOCK 1024
+
+/** Number of taps of the filters are multiples of this, the AVX2 width */
+#define TAPS_ALIGN 8
+
+/** Filter length, Kaiser window shape and cut off frequency, relative to
+ * the lower Nyquist frequency, of each quality tier
+ */
+static const struct {
+  OMX_U32 nTaps;
+  double dBeta;
+  double dCutoff;
+} qualities[OMX_PCM_RESAMPLER_QUALITIES] = {
+  { 16, 6.0, 0.80 },
+  { 32, 8.0, 0.88 },
+  { 64, 10.0, 0.92 }
+};
+
+typedef float (*dot_func)(const float* pSamples, const float* pCoeffs, OMX_U32 nTaps);
+
+struct omx_pcm_resampler_t {
+  OMX_U32 nChannels;
+  OMX_U32 nTaps;
+  OMX_U32 nPhases;      /**< output frames per nStep input frames */
+  OMX_U32 nStep;
+  float* pCoeffs;       /**< nPhases filters of nTaps coefficients */
+  float* pHistory;      /**< nCapacity frames of each channel, one channel after the other */
+  OMX_U32 nCapacity;
+  OMX_U32 nFrames;      /**< frames in the history */
+  OMX_U32 nPosition;    /**< first history frame of the next output */
+  OMX_U32 nPhase;       /**< filter of the next output */
+  OMX_BOOL bDrained;
+};
+
+static float dot_c(const float* pSamples, const float* pCoeffs, OMX_U32 nTaps) {
+  float sum = 0.0f;
+  OMX_U32 i;
+
+  for (i = 0; i < nTaps; i++) {
+    sum += pSamples[i] * pCoeffs[i];
+  }
+  return sum;
+}
+
+#ifdef PCM_X86
+
+/* Two accumulators hide the latency of the additions */
+TARGET_SSE2 static float dot_sse2(const float* pSamples, const float* pCoeffs, OMX_U32 nTaps) {
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  OMX_U32 i;
+
+  for (i = 0; i < nTaps; i += 8) {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(pSamples + i), _mm_loadu_ps(pCoeffs + i)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(pSamples + i + 4), _mm_loadu_ps(pCoeffs + i + 4)));
+  }
+  acc0 = _mm_add_ps(acc0, acc1);
+  acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+  acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+  return _mm_cvtss_f32(acc0);
+}
+
+TARGET_AVX2 static float dot_avx2(const float* pSamples, const float* pCoeffs, OMX_U32 nTaps) {
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  __m128 sum;
+  OMX_U32 i = 0;
+
+  for (; i + 16 <= nTaps; i += 16) {
+    acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(pSamples + i), _mm256_loadu_ps(pCoeffs + i)));
+    acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(pSamples + i + 8), _mm256_loadu_ps(pCoeffs + i + 8)));
+  }
+  if (i < nTaps) {
+    acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(pSamples + i), _mm256_loadu_ps(pCoeffs + i)));
+  }
+  acc0 = _mm256_add_ps(acc0, acc1);
+  sum = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  return _mm_cvtss_f32(sum);
+}
+
+#endif
+
+static dot_func select_dot(void) {
+  switch (omx_pcm_simd_level()) {
+#ifdef PCM_X86
+  case OMX_PCM_SIMD_AVX2:
+    return dot_avx2;
+  case OMX_PCM_SIMD_SSE2:
+    return dot_sse2;
+#endif
+  default:
+    return dot_c;
+  }
+}
+
+static OMX_U32 gcd(OMX_U32 a, OMX_U32 b) {
+  OMX_U32 t;
+
+  while (b != 0) {
+    t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+/** Modified Bessel function of the first kind and order 0, for the Kaiser window */
+static double bessel_i0(double x) {
+  double sum = 1.0, term = 1.0;
+  int k;
+
+  for (k = 1; k < 50 && term > sum * 1e-12; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+/** Fills the filter of each phase. The output of phase p lies p / nPhases
+ * after the history frame nTaps / 2 - 1 of its window
+ */
+static void design_filters(omx_pcm_resampler_t* pResampler, double dBeta, double dCutoff) {
+  OMX_U32 nHalf = pResampler->nTaps / 2;
+  double dNorm = bessel_i0(dBeta);
+  double dSum, x, r, h;
+  float* pFilter;
+  OMX_U32 p, j;
+
+  for (p = 0; p < pResampler->nPhases; p++) {
+    pFilter = pResampler->pCoeffs + p * pResampler->nTaps;
+    dSum = 0.0;
+    for (j = 0; j < pResampler->nTaps; j++) {
+      x = (double)j - (double)(nHalf - 1) - (double)p / pResampler->nPhases;
+      r = x / nHalf;
+      if (r <= -1.0 || r >= 1.0) {
+        h = 0.0;
+      } else {
+        h = x == 0.0 ? dCutoff : sin(M_PI * dCutoff * x) / (M_PI * x);
+        h *= bessel_i0(dBeta * sqrt(1.0 - r * r)) / dNorm;
+      }
+      pFilter[j] = (float)h;
+      dSum += h;
+    }
+    for (j = 0; j < pResampler->nTaps; j++) {
+      pFilter[j] = (float)(pFilter[j] / dSum);
+    }
+  }
+}
+
+omx_pcm_resampler_t* omx_pcm_resampler_create(OMX_U32 nInputRate, OMX_U32 nOutputRate, OMX_U32 nChannels, omx_pcm_resampler_quality_t eQuality) {
+  omx_pcm_resampler_t* pResampler;
+  double dCutoff;
+  OMX_U32 nDivisor, nTaps;
+
+  if (nInputRate == 0 || nOutputRate == 0 || nChannels == 0 || eQuality >= OMX_PCM_RESAMPLER_QUALITIES) {
+    return NULL;
+  }
+  nDivisor = gcd(nInputRate, nOutputRate);
+  if (nOutputRate / nDivisor > OMX_PCM_RESAMPLER_MAX_PHASES) {
+    DEBUG(DEB_LEV_ERR, "In %s %i Hz to %i Hz needs %i phases\n", __func__, (int)nInputRate, (int)nOutputRate, (int)(nOutputRate / nDivisor));
+    return NULL;
+  }
+
+  pResampler = calloc(1, sizeof(omx_pcm_resampler_t));
+  if (!pResampler) {
+    return NULL;
+  }
+  pResampler->nChannels = nChannels;
+  pResampler->nPhases = nOutputRate / nDivisor;
+  pResampler->nStep = nInputRate / nDivisor;
+
+  /* Downsampling moves the cut off below the input Nyquist frequency, the
+   * filters get longer by the same ratio to keep their transition band
+   */
+  nTaps = qualities[eQuality].nTaps;
+  dCutoff = qualities[eQuality].dCutoff;
+  if (nInputRate > nOutputRate) {
+    nTaps = (OMX_U32)ceil((double)nTaps * nInputRate / nOutputRate);
+    dCutoff = dCutoff * nOutputRate / nInputRate;
+  }
+  pResampler->nTaps = (nTaps + TAPS_ALIGN - 1) / TAPS_ALIGN * TAPS_ALIGN;
+  pResampler->nCapacity = pResampler->nTaps + HISTORY_BLOCK;
+
+  pResampler->pCoeffs = malloc(pResampler->nPhases * pResampler->nTaps * sizeof(float));
+  pResampler->pHistory = malloc(nChannels * pResampler->nCapacity * sizeof(float));
+  if (!pResampler->pCoeffs || !pResampler->pHistory) {
+    omx_pcm_resampler_destroy(pResampler);
+    return NULL;
+  }
+  design_filters(pResampler, qualities[eQuality].dBeta, dCutoff);
+  omx_pcm_resampler_reset(pResampler);
+  DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s %i Hz to %i Hz with %i phases of %i taps\n", __func__,
+        (int)nInputRate, (int)nOutputRate, (int)pResampler->nPhases, (int)pResampler->nTaps);
+  return pResampler;
+}
+
+void omx_pcm_resampler_destroy(omx_pcm_resampler_t* pResampler) {
+  if (pResampler) {
+    free(pResampler->pCoeffs);
+    free(pResampler->pHistory);
+    free(pResampler);
+  }
+}
+
+/* The first output is the first input frame: it starts the history,
+ * after the silence before the stream
+ */
+void omx_pcm_resampler_reset(omx_pcm_resampler_t* pResampler) {
+  memset(pResampler->pHistory, 0, pResampler->nChannels * pResampler->nCapacity * sizeof(float));
+  pResampler->nFrames = pResampler->nTaps / 2 - 1;
+  pResampler->nPosition = 0;
+  pResampler->nPhase = 0;
+  pResampler->bDrained = OMX_FALSE;
+}
+
+/** Writes the outputs whose window is in the history, up to nOutputFrames */
+static OMX_U32 produce(omx_pcm_resampler_t* pResampler, float* pOutput, OMX_U32 nOutputFrames) {
+  dot_func dot = select_dot();
+  const float* pFilter;
+  OMX_U32 nDone = 0, c;
+
+  while (nDone < nOutputFrames && pResampler->nPosition + pResampler->nTaps <= pResampler->nFrames) {
+    pFilter = pResampler->pCoeffs + pResampler->nPhase * pResampler->nTaps;
+    for (c = 0; c < pResampler->nChannels; c++) {
+      *pOutput++ = dot(pResampler->pHistory + c * pResampler->nCapacity + pResampler->nPosition, pFilter, pResampler->nTaps);
+    }
+    nDone++;
+    pResampler->nPhase += pResampler->nStep;
+    pResampler->nPosition += pResampler->nPhase / pResampler->nPhases;
+    pResampler->nPhase %= pResampler->nPhases;
+  }
+  return nDone;
+}
+
+/** Drops the history frames no output needs any more */
+static void compact(omx_pcm_resampler_t* pResampler) {
+  OMX_U32 nDrop = pResampler->nPosition < pResampler->nFrames ? pResampler->nPosition : pResampler->nFrames;
+  float* pChannel;
+  OMX_U32 c;
+
+  if (nDrop == 0) {
+    return;
+  }
+  for (c = 0; c < pResampler->nChannels; c++) {
+    pChannel = pResampler->pHistory + c * pResampler->nCapacity;
+    memmove(pChannel, pChannel + nDrop, (pResampler->nFrames - nDrop) * sizeof(float));
+  }
+  pResampler->nFrames -= nDrop;
+  pResampler->nPosition -= nDrop;
+}
+
+/** Appends interleaved frames to the history, as many as fit
+ *
+ * @return the number of frames appended
+ */
+static OMX_U32 feed(omx_pcm_resampler_t* pResampler, const float* pInput, OMX_U32 nInputFrames) {
+  OMX_U32 nChannels = pResampler->nChannels;
+  OMX_U32 n, i, c;
+  float* pChannel;
+
+  if (pResampler->nFrames == pResampler->nCapacity) {
+    compact(pResampler);
+  }
+  n = pResampler->nCapacity - pResampler->nFrames;
+  if (n > nInputFrames) {
+    n = nInputFrames;
+  }
+  for (c = 0; c < nChannels; c++) {
+    pChannel = pResampler->pHistory + c * pResampler->nCapacity + pResampler->nFrames;
+    for (i = 0; i < n; i++) {
+      pChannel[i] = pInput[i * nChannels + c];
+    }
+  }
+  pResampler->nFrames += n;
+  return n;
+}
+
+OMX_U32 omx_pcm_resampler_process(omx_pcm_resampler_t* pResampler, const float* pInput, OMX_U32* pInputFrames, float* pOutput, OMX_U32 nOutputFrames) {
+  OMX_U32 nUsed = 0, nDone = 0;
+
+  for (;;) {
+    nDone += produce(pResampler, pOutput + nDone * pResampler->nChannels, nOutputFrames - nDone);
+    if (nDone == nOutputFrames || nUsed == *pInputFrames || pResampler->bDrained) {
+      break;
+    }
+    nUsed += feed(pResampler, pInput + nUsed * pResampler->nChannels, *pInputFrames - nUsed);
+  }
+  *pInputFrames = nUsed;
+  return nDone;
+}
+
+OMX_U32 omx_pcm_resampler_drain_length(omx_pcm_resampler_t* pResampler, OMX_U32 nInputFrames) {
+  OMX_U32 nFrames = pResampler->nFrames + nInputFrames + (pResampler->bDrained ? 0 : pResampler->nTaps / 2);
+  OMX_U32 nPosition = pResampler->nPosition;
+  OMX_U32 nPhase = pResampler->nPhase;
+  OMX_U32 nCount = 0;
+
+  while (nPosition + pResampler->nTaps <= nFrames) {
+    nCount++;
+    nPhase += pResampler->nStep;
+    nPosition += nPhase / pResampler->nPhases;
+    nPhase %= pResampler->nPhases;
+  }
+  return nCount;
+}
+
+/* Half a filter of silence after the last input frame lets the outputs up
+ * to it out. It is appended once the history is exhausted, so that it fits
+ */
+OMX_U32 omx_pcm_resampler_drain(omx_pcm_resampler_t* pResampler, float* pOutput, OMX_U32 nOutputFrames) {
+  OMX_U32 nDone, c;
+
+  nDone = produce(pResampler, pOutput, nOutputFrames);
+  if (!pResampler->bDrained && nDone < nOutputFrames) {
+    compact(pResampler);
+    for (c = 0; c < pResampler->nChannels; c++) {
+      memset(pResampler->pHistory + c * pResampler->nCapacity + pResampler->nFrames, 0, pResampler->nTaps / 2 * sizeof(float));
+    }
+    pResampler->nFrames += pResampler->nTaps / 2;
+    pResampler->bDrained = OMX_TRUE;
+  }
+  return nDone + produce(pResampler, pOutput + nDone * pResampler->nChannels, nOutputFrames - nDone);
+}
@@ -0,0 +1,88 @@
+/**
+  @file src/components/audio_effects/omx_pcm_resampler.h
+
+  Polyphase windowed-sinc sample rate converter of interleaved float PCM,
+  with SIMD filters selected as the PCM kernels are.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#ifndef __OMX_PCM_RESAMPLER_H__
+#define __OMX_PCM_RESAMPLER_H__
+
+#include <OMX_Types.h>
+
+/** Largest number of filter phases, the output rate divided by the
+ * greatest common divisor of the rates. All the usual rates between 8 and
+ * 192 kHz need less
+ */
+#define OMX_PCM_RESAMPLER_MAX_PHASES 1024
+
+/** Quality tiers, trading the CPU load for the stop band attenuation and
+ * the width of the pass band
+ */
+typedef enum omx_pcm_resampler_quality_t {
+  OMX_PCM_RESAMPLER_FAST = 0, /**< 16 taps */
+  OMX_PCM_RESAMPLER_MEDIUM,   /**< 32 taps */
+  OMX_PCM_RESAMPLER_BEST,     /**< 64 taps */
+  OMX_PCM_RESAMPLER_QUALITIES
+} omx_pcm_resampler_quality_t;
+
+typedef struct omx_pcm_resampler_t omx_pcm_resampler_t;
+
+/** Creates a resampler. Downsampling widens the filters by the rate ratio
+ * so that the quality does not drop
+ *
+ * @return NULL if the rates need more than OMX_PCM_RESAMPLER_MAX_PHASES
+ * phases or the memory is exhausted
+ */
+omx_pcm_resampler_t* omx_pcm_resampler_create(OMX_U32 nInputRate, OMX_U32 nOutputRate, OMX_U32 nChannels, omx_pcm_resampler_quality_t eQuality);
+
+void omx_pcm_resampler_destroy(omx_pcm_resampler_t* pResampler);
+
+/** Forgets the past samples, to start a new stream */
+void omx_pcm_resampler_reset(omx_pcm_resampler_t* pResampler);
+
+/** Resamples interleaved frames until the input is consumed or the output
+ * is full. The output lags the input by half the filter length
+ *
+ * @param pInputFrames the number of input frames, set to the number consumed
+ * @return the number of frames written
+ */
+OMX_U32 omx_pcm_resampler_process(omx_pcm_resampler_t* pResampler, const float* pInput, OMX_U32* pInputFrames, float* pOutput, OMX_U32 nOutputFrames);
+
+/** @return the number of frames that omx_pcm_resampler_drain would write
+ * after nInputFrames more input frames are processed, whatever the size of
+ * the output
+ */
+OMX_U32 omx_pcm_resampler_drain_length(omx_pcm_resampler_t* pResampler, OMX_U32 nInputFrames);
+
+/** Ends the stream with silence to write the frames still held back by
+ * the filters, up to nOutputFrames of them. The resampler must be reset
+ * before the next stream
+ *
+ * @return the number of frames written
+ */
+OMX_U32 omx_pcm_resampler_drain(omx_pcm_resampler_t* pResampler, float* pOutput, OMX_U32 nOutputFrames);
+
+#endif
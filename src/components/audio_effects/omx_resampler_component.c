@@ -0,0 +1,450 @@
+/**
+  @file src/components/audio_effects/omx_resampler_component.c
+
+  OpenMAX sample rate converter component. This component implements a filter
+  that converts an audio PCM stream from the sampling rate of its input port to
+  the one of its output port, with the polyphase resampler of the PCM kernels.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#include <omxcore.h>
+#include <omx_base_audio_port.h>
+#include <omx_resampler_component.h>
+#include <OMX_Audio.h>
+
+/* Max allowable resampler component instance */
+#define MAX_COMPONENT_RESAMPLER 4
+
+/* Sampling rate of both ports until the client sets them */
+#define DEFAULT_SAMPLING_RATE 44100
+
+/* Frames converted to float at once, on the stack */
+#define BLOCK_FRAMES 256
+
+/** Maximum Number of Resampler Component Instance*/
+static OMX_U32 noResamplerCompInstance = 0;
+
+#define RESAMPLER_COMP_ROLE "audio.resampler"
+
+
+OMX_ERRORTYPE omx_resampler_component_Constructor(OMX_COMPONENTTYPE *openmaxStandComp, OMX_STRING cComponentName) {
+  OMX_ERRORTYPE err = OMX_ErrorNone;
+  omx_resampler_component_PrivateType* omx_resampler_component_Private;
+  OMX_U32 i;
+
+  if (!openmaxStandComp->pComponentPrivate) {
+    DEBUG(DEB_LEV_FUNCTION_NAME, "In %s, allocating component\n",__func__);
+    openmaxStandComp->pComponentPrivate = calloc(1, sizeof(omx_resampler_component_PrivateType));
+    if(openmaxStandComp->pComponentPrivate == NULL) {
+      return OMX_ErrorInsufficientResources;
+    }
+  } else {
+    DEBUG(DEB_LEV_FUNCTION_NAME, "In %s, Error Component %p Already Allocated\n", __func__, openmaxStandComp->pComponentPrivate);
+  }
+
+  omx_resampler_component_Private = openmaxStandComp->pComponentPrivate;
+  omx_resampler_component_Private->ports = NULL;
+
+  /** Calling base filter constructor */
+  err = omx_base_filter_Constructor(openmaxStandComp, cComponentName);
+
+  omx_resampler_component_Private->sPortTypesParam[OMX_PortDomainAudio].nStartPortNumber = 0;
+  omx_resampler_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts = 2;
+
+  /** Allocate Ports and call port constructor. */
+  if (omx_resampler_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts && !omx_resampler_component_Private->ports) {
+    omx_resampler_component_Private->ports = calloc(omx_resampler_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts, sizeof(omx_base_PortType *));
+    if (!omx_resampler_component_Private->ports) {
+      return OMX_ErrorInsufficientResources;
+    }
+    for (i=0; i < omx_resampler_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts; i++) {
+      omx_resampler_component_Private->ports[i] = calloc(1, sizeof(omx_base_audio_PortType));
+      if (!omx_resampler_component_Private->ports[i]) {
+        return OMX_ErrorInsufficientResources;
+      }
+    }
+  }
+
+  base_audio_port_Constructor(openmaxStandComp, &omx_resampler_component_Private->ports[0], 0, OMX_TRUE);
+  base_audio_port_Constructor(openmaxStandComp, &omx_resampler_component_Private->ports[1], 1, OMX_FALSE);
+
+  /** Domain specific section for the ports. */
+  omx_resampler_component_Private->ports[OMX_BASE_FILTER_INPUTPORT_INDEX]->sPortParam.nBufferSize = DEFAULT_OUT_BUFFER_SIZE;
+  omx_resampler_component_Private->ports[OMX_BASE_FILTER_OUTPUTPORT_INDEX]->sPortParam.nBufferSize = DEFAULT_OUT_BUFFER_SIZE;
+
+  for (i = 0; i < 2; i++) {
+    setHeader(&omx_resampler_component_Private->sPcmModeParam[i], sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+    omx_resampler_component_Private->sPcmModeParam[i].nPortIndex = i;
+    omx_resampler_component_Private->sPcmModeParam[i].nChannels = 2;
+    omx_resampler_component_Private->sPcmModeParam[i].eNumData = OMX_NumericalDataSigned;
+    omx_resampler_component_Private->sPcmModeParam[i].eEndian = OMX_EndianLittle;
+    omx_resampler_component_Private->sPcmModeParam[i].bInterleaved = OMX_TRUE;
+    omx_resampler_component_Private->sPcmModeParam[i].nBitPerSample = 16;
+    omx_resampler_component_Private->sPcmModeParam[i].nSamplingRate = DEFAULT_SAMPLING_RATE;
+    omx_resampler_component_Private->sPcmModeParam[i].ePCMMode = OMX_AUDIO_PCMModeLinear;
+  }
+  omx_resampler_component_Private->ePcmFormat = OMX_PCM_FORMAT_S16;
+  omx_resampler_component_Private->eQuality = OMX_PCM_RESAMPLER_MEDIUM;
+  omx_resampler_component_Private->pResampler = NULL;
+
+  omx_resampler_component_Private->destructor = omx_resampler_component_Destructor;
+  omx_resampler_component_Private->messageHandler = omx_resampler_component_MessageHandler;
+  openmaxStandComp->SetParameter = omx_resampler_component_SetParameter;
+  openmaxStandComp->GetParameter = omx_resampler_component_GetParameter;
+  openmaxStandComp->GetExtensionIndex = omx_resampler_component_GetExtensionIndex;
+  omx_resampler_component_Private->BufferMgmtCallback = omx_resampler_component_BufferMgmtCallback;
+  /** The frames the filters hold are drained at EOS, even when the EOS buffer is empty */
+  omx_resampler_component_Private->bDrainOnEOS = OMX_TRUE;
+
+  noResamplerCompInstance++;
+  if(noResamplerCompInstance > MAX_COMPONENT_RESAMPLER) {
+    return OMX_ErrorInsufficientResources;
+  }
+
+  return err;
+}
+
+
+/** The destructor
+  */
+OMX_ERRORTYPE omx_resampler_component_Destructor(OMX_COMPONENTTYPE *openmaxStandComp) {
+
+  omx_resampler_component_PrivateType* omx_resampler_component_Private = openmaxStandComp->pComponentPrivate;
+  OMX_U32 i;
+
+  if (omx_resampler_component_Private->pResampler) {
+    omx_pcm_resampler_destroy(omx_resampler_component_Private->pResampler);
+    omx_resampler_component_Private->pResampler = NULL;
+  }
+
+  /* frees port/s */
+  if (omx_resampler_component_Private->ports) {
+    for (i=0; i < omx_resampler_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts; i++) {
+      if(omx_resampler_component_Private->ports[i])
+        omx_resampler_component_Private->ports[i]->PortDestructor(omx_resampler_component_Private->ports[i]);
+    }
+    free(omx_resampler_component_Private->ports);
+    omx_resampler_component_Private->ports=NULL;
+  }
+
+  DEBUG(DEB_LEV_FUNCTION_NAME, "Destructor of resampler component is called\n");
+  omx_base_filter_Destructor(openmaxStandComp);
+  noResamplerCompInstance--;
+
+  return OMX_ErrorNone;
+}
+
+/** Creates the resampler of the rates of the ports when the stream starts.
+  * The quality and the rates cannot change while it runs
+  */
+OMX_ERRORTYPE omx_resampler_component_MessageHandler(OMX_COMPONENTTYPE* openmaxStandComp, internalRequestMessageType *message) {
+  omx_resampler_component_PrivateType* omx_resampler_component_Private = openmaxStandComp->pComponentPrivate;
+  OMX_U32 nInputRate = omx_resampler_component_Private->sPcmModeParam[OMX_BASE_FILTER_INPUTPORT_INDEX].nSamplingRate;
+  OMX_U32 nOutputRate = omx_resampler_component_Private->sPcmModeParam[OMX_BASE_FILTER_OUTPUTPORT_INDEX].nSamplingRate;
+
+  DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s\n", __func__);
+
+  if (message->messageType == OMX_CommandStateSet) {
+    if ((message->messageParam == OMX_StateExecuting) && (omx_resampler_component_Private->state == OMX_StateIdle)) {
+      if (omx_resampler_component_Private->pResampler) {
+        omx_pcm_resampler_destroy(omx_resampler_component_Private->pResampler);
+        omx_resampler_component_Private->pResampler = NULL;
+      }
+      if (nInputRate != nOutputRate) {
+        omx_resampler_component_Private->pResampler = omx_pcm_resampler_create(nInputRate, nOutputRate,
+          omx_resampler_component_Private->sPcmModeParam[OMX_BASE_FILTER_INPUTPORT_INDEX].nChannels, omx_resampler_component_Private->eQuality);
+        if (!omx_resampler_component_Private->pResampler) {
+          DEBUG(DEB_LEV_ERR, "In %s cannot convert %i Hz to %i Hz\n", __func__, (int)nInputRate, (int)nOutputRate);
+          return OMX_ErrorUnsupportedSetting;
+        }
+      }
+    } else if ((message->messageParam == OMX_StateLoaded) && (omx_resampler_component_Private->state == OMX_StateIdle)) {
+      if (omx_resampler_component_Private->pResampler) {
+        omx_pcm_resampler_destroy(omx_resampler_component_Private->pResampler);
+        omx_resampler_component_Private->pResampler = NULL;
+      }
+    }
+  }
+  return omx_base_component_MessageHandler(openmaxStandComp, message);
+}
+
+/** This function converts the input buffer into the output buffer, as far as
+  * the output buffer takes it. The input buffer keeps the frames left, and
+  * comes back with the next output buffer.
+  * The last frame of a buffer flagged EOS is held back until the output buffer
+  * also takes the frames the filters still hold, so that they leave with the EOS.
+  * An empty buffer flagged EOS only drains the filters
+  */
+void omx_resampler_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandComp, OMX_BUFFERHEADERTYPE* pInputBuffer, OMX_BUFFERHEADERTYPE* pOutputBuffer) {
+  omx_resampler_component_PrivateType* omx_resampler_component_Private = openmaxStandComp->pComponentPrivate;
+  omx_pcm_resampler_t* pResampler = omx_resampler_component_Private->pResampler;
+  omx_pcm_format_t ePcmFormat = omx_resampler_component_Private->ePcmFormat;
+  OMX_U32 nChannels = omx_resampler_component_Private->sPcmModeParam[OMX_BASE_FILTER_INPUTPORT_INDEX].nChannels;
+  OMX_U32 nFrameSize = omx_pcm_sample_size(ePcmFormat) * nChannels;
+  OMX_U32 nInputFrames = pInputBuffer->nFilledLen / nFrameSize;
+  OMX_U32 nOutputFrames = pOutputBuffer->nAllocLen / nFrameSize;
+  OMX_U32 nHeld = (pInputBuffer->nFlags & OMX_BUFFERFLAG_EOS) && nInputFrames > 0 ? 1 : 0;
+  OMX_U8* pInput = pInputBuffer->pBuffer + pInputBuffer->nOffset;
+  OMX_U8* pOutput = pOutputBuffer->pBuffer;
+  OMX_U32 nUsed = 0, nDone = 0, nFrames, nWritten;
+  float inBlock[BLOCK_FRAMES * OMX_PCM_MAX_CHANNELS];
+  float outBlock[BLOCK_FRAMES * OMX_PCM_MAX_CHANNELS];
+
+  if (!pResampler) {
+    nUsed = nInputFrames < nOutputFrames ? nInputFrames : nOutputFrames;
+    memcpy(pOutput, pInput, nUsed * nFrameSize);
+    nDone = nUsed;
+  } else {
+    while (nUsed + nHeld < nInputFrames && nDone < nOutputFrames) {
+      nFrames = nInputFrames - nHeld - nUsed < BLOCK_FRAMES ? nInputFrames - nHeld - nUsed : BLOCK_FRAMES;
+      omx_pcm_to_float(ePcmFormat, inBlock, pInput + nUsed * nFrameSize, nFrames * nChannels);
+      nWritten = omx_pcm_resampler_process(pResampler, inBlock, &nFrames, outBlock,
+                                           nOutputFrames - nDone < BLOCK_FRAMES ? nOutputFrames - nDone : BLOCK_FRAMES);
+      omx_pcm_from_float(ePcmFormat, pOutput + nDone * nFrameSize, outBlock, nWritten * nChannels);
+      nUsed += nFrames;
+      nDone += nWritten;
+    }
+
+    /* The stream ends here if the output buffer takes all its end, or takes
+     * as much of it as it can when it is empty
+     */
+    if ((pInputBuffer->nFlags & OMX_BUFFERFLAG_EOS) && nUsed + nHeld == nInputFrames &&
+        (nDone == 0 || omx_pcm_resampler_drain_length(pResampler, nHeld) <= nOutputFrames - nDone)) {
+      while (nHeld && nDone < nOutputFrames) {
+        nFrames = nHeld;
+        omx_pcm_to_float(ePcmFormat, inBlock, pInput + nUsed * nFrameSize, nFrames * nChannels);
+        nWritten = omx_pcm_resampler_process(pResampler, inBlock, &nFrames, outBlock,
+                                             nOutputFrames - nDone < BLOCK_FRAMES ? nOutputFrames - nDone : BLOCK_FRAMES);
+        omx_pcm_from_float(ePcmFormat, pOutput + nDone * nFrameSize, outBlock, nWritten * nChannels);
+        nUsed += nFrames;
+        nHeld -= nFrames;
+        nDone += nWritten;
+      }
+      do {
+        nFrames = nOutputFrames - nDone < BLOCK_FRAMES ? nOutputFrames - nDone : BLOCK_FRAMES;
+        nWritten = omx_pcm_resampler_drain(pResampler, outBlock, nFrames);
+        omx_pcm_from_float(ePcmFormat, pOutput + nDone * nFrameSize, outBlock, nWritten * nChannels);
+        nDone += nWritten;
+      } while (nWritten == nFrames && nFrames > 0);
+      omx_pcm_resampler_reset(pResampler);
+      nUsed = nInputFrames;
+    }
+  }
+
+  pOutputBuffer->nFilledLen = nDone * nFrameSize;
+  if (nUsed == nInputFrames) {
+    /* A trailing partial frame is dropped */
+    pInputBuffer->nFilledLen = 0;
+    pInputBuffer->nOffset = 0;
+  } else {
+    pInputBuffer->nOffset += nUsed * nFrameSize;
+    pInputBuffer->nFilledLen -= nUsed * nFrameSize;
+  }
+}
+
+OMX_ERRORTYPE omx_resampler_component_SetParameter(
+  OMX_IN  OMX_HANDLETYPE hComponent,
+  OMX_IN  OMX_INDEXTYPE nParamIndex,
+  OMX_IN  OMX_PTR ComponentParameterStructure) {
+
+  OMX_ERRORTYPE err = OMX_ErrorNone;
+  OMX_AUDIO_PARAM_PORTFORMATTYPE *pAudioPortFormat;
+  OMX_AUDIO_PARAM_PCMMODETYPE *pAudioPcmMode;
+  OMX_PARAM_COMPONENTROLETYPE *pComponentRole;
+  OMX_PARAM_U32TYPE *pQuality;
+  omx_pcm_format_t ePcmFormat;
+  OMX_U32 portIndex, nOtherRate;
+  omx_base_audio_PortType *port;
+
+  /* Check which structure we are being fed and make control its header */
+  OMX_COMPONENTTYPE *openmaxStandComp = (OMX_COMPONENTTYPE *)hComponent;
+  omx_resampler_component_PrivateType* omx_resampler_component_Private = openmaxStandComp->pComponentPrivate;
+  if (ComponentParameterStructure == NULL) {
+    return OMX_ErrorBadParameter;
+  }
+
+  DEBUG(DEB_LEV_SIMPLE_SEQ, "   Setting parameter %i\n", nParamIndex);
+  switch((OMX_U32)nParamIndex) {
+    case OMX_IndexParamAudioPortFormat:
+      pAudioPortFormat = (OMX_AUDIO_PARAM_PORTFORMATTYPE*)ComponentParameterStructure;
+      portIndex = pAudioPortFormat->nPortIndex;
+      err = omx_base_component_ParameterSanityCheck(hComponent, portIndex, pAudioPortFormat, sizeof(OMX_AUDIO_PARAM_PORTFORMATTYPE));
+      if(err!=OMX_ErrorNone) {
+        DEBUG(DEB_LEV_ERR, "In %s Parameter Check Error=%x\n",__func__,err);
+        break;
+      }
+      if (portIndex <= 1) {
+        port= (omx_base_audio_PortType *)omx_resampler_component_Private->ports[portIndex];
+        memcpy(&port->sAudioParam, pAudioPortFormat, sizeof(OMX_AUDIO_PARAM_PORTFORMATTYPE));
+      } else {
+        err = OMX_ErrorBadPortIndex;
+      }
+      break;
+    case OMX_IndexParamAudioPcm:
+      pAudioPcmMode = (OMX_AUDIO_PARAM_PCMMODETYPE*)ComponentParameterStructure;
+      portIndex = pAudioPcmMode->nPortIndex;
+      /* The sample format applies to both ports, neither may be running */
+      err = omx_base_component_ParameterSanityCheck(hComponent, portIndex, pAudioPcmMode, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+      if(err == OMX_ErrorNone) {
+        err = omx_base_component_ParameterSanityCheck(hComponent, 1 - portIndex, pAudioPcmMode, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+      }
+      if(err!=OMX_ErrorNone) {
+        DEBUG(DEB_LEV_ERR, "In %s Parameter Check Error=%x\n",__func__,err);
+        break;
+      }
+      err = omx_pcm_format_from_mode(pAudioPcmMode, &ePcmFormat);
+      if(err!=OMX_ErrorNone) {
+        DEBUG(DEB_LEV_ERR, "In %s PCM mode of %i bits and %i channels not supported\n",__func__,(int)pAudioPcmMode->nBitPerSample,(int)pAudioPcmMode->nChannels);
+        break;
+      }
+      if (pAudioPcmMode->nSamplingRate == 0) {
+        return OMX_ErrorBadParameter;
+      }
+      /* The port gets its own sampling rate, the other one keeps its rate */
+      nOtherRate = omx_resampler_component_Private->sPcmModeParam[1 - portIndex].nSamplingRate;
+      memcpy(&omx_resampler_component_Private->sPcmModeParam[portIndex], pAudioPcmMode, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+      memcpy(&omx_resampler_component_Private->sPcmModeParam[1 - portIndex], pAudioPcmMode, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+      omx_resampler_component_Private->sPcmModeParam[1 - portIndex].nPortIndex = 1 - portIndex;
+      omx_resampler_component_Private->sPcmModeParam[1 - portIndex].nSamplingRate = nOtherRate;
+      omx_resampler_component_Private->ePcmFormat = ePcmFormat;
+      break;
+    case OMX_IndexParamStandardComponentRole:
+      pComponentRole = (OMX_PARAM_COMPONENTROLETYPE*)ComponentParameterStructure;
+
+      if (omx_resampler_component_Private->state != OMX_StateLoaded && omx_resampler_component_Private->state != OMX_StateWaitForResources) {
+        DEBUG(DEB_LEV_ERR, "In %s Incorrect State=%x lineno=%d\n",__func__,omx_resampler_component_Private->state,__LINE__);
+        return OMX_ErrorIncorrectStateOperation;
+      }
+
+      if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_PARAM_COMPONENTROLETYPE))) != OMX_ErrorNone) {
+        break;
+      }
+
+      if (strcmp( (char*) pComponentRole->cRole, RESAMPLER_COMP_ROLE)) {
+        return OMX_ErrorBadParameter;
+      }
+      break;
+    case OMX_IndexVendorResamplerQuality:
+      pQuality = (OMX_PARAM_U32TYPE*)ComponentParameterStructure;
+      if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_PARAM_U32TYPE))) != OMX_ErrorNone) {
+        break;
+      }
+      /* The resampler is created with the quality when the stream starts */
+      if (omx_resampler_component_Private->state != OMX_StateLoaded && omx_resampler_component_Private->state != OMX_StateIdle) {
+        return OMX_ErrorIncorrectStateOperation;
+      }
+      if (pQuality->nU32 >= OMX_PCM_RESAMPLER_QUALITIES) {
+        return OMX_ErrorBadParameter;
+      }
+      omx_resampler_component_Private->eQuality = pQuality->nU32;
+      break;
+    default:
+      err = omx_base_component_SetParameter(hComponent, nParamIndex, ComponentParameterStructure);
+  }
+  return err;
+}
+
+OMX_ERRORTYPE omx_resampler_component_GetParameter(
+  OMX_IN  OMX_HANDLETYPE hComponent,
+  OMX_IN  OMX_INDEXTYPE nParamIndex,
+  OMX_INOUT OMX_PTR ComponentParameterStructure) {
+
+  OMX_AUDIO_PARAM_PORTFORMATTYPE *pAudioPortFormat;
+  OMX_AUDIO_PARAM_PCMMODETYPE *pAudioPcmMode;
+  OMX_PARAM_COMPONENTROLETYPE *pComponentRole;
+  OMX_PARAM_U32TYPE *pQuality;
+  OMX_ERRORTYPE err = OMX_ErrorNone;
+  omx_base_audio_PortType *port;
+  OMX_COMPONENTTYPE *openmaxStandComp = (OMX_COMPONENTTYPE *)hComponent;
+  omx_resampler_component_PrivateType* omx_resampler_component_Private = openmaxStandComp->pComponentPrivate;
+  if (ComponentParameterStructure == NULL) {
+    return OMX_ErrorBadParameter;
+  }
+  DEBUG(DEB_LEV_SIMPLE_SEQ, "   Getting parameter %i\n", nParamIndex);
+  /* Check which structure we are being fed and fill its header */
+  switch((OMX_U32)nParamIndex) {
+    case OMX_IndexParamAudioInit:
+      if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_PORT_PARAM_TYPE))) != OMX_ErrorNone) {
+        break;
+      }
+      memcpy(ComponentParameterStructure, &omx_resampler_component_Private->sPortTypesParam[OMX_PortDomainAudio], sizeof(OMX_PORT_PARAM_TYPE));
+      break;
+    case OMX_IndexParamAudioPortFormat:
+      pAudioPortFormat = (OMX_AUDIO_PARAM_PORTFORMATTYPE*)ComponentParameterStructure;
+      if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_AUDIO_PARAM_PORTFORMATTYPE))) != OMX_ErrorNone) {
+        break;
+      }
+      if (pAudioPortFormat->nPortIndex <= 1) {
+        port= (omx_base_audio_PortType *)omx_resampler_component_Private->ports[pAudioPortFormat->nPortIndex];
+        memcpy(pAudioPortFormat, &port->sAudioParam, sizeof(OMX_AUDIO_PARAM_PORTFORMATTYPE));
+      } else {
+        err = OMX_ErrorBadPortIndex;
+      }
+    break;
+    case OMX_IndexParamAudioPcm:
+      pAudioPcmMode = (OMX_AUDIO_PARAM_PCMMODETYPE*)ComponentParameterStructure;
+      if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE))) != OMX_ErrorNone) {
+        break;
+      }
+
+      if (pAudioPcmMode->nPortIndex > 1) {
+        return OMX_ErrorBadPortIndex;
+      }
+      memcpy(pAudioPcmMode, &omx_resampler_component_Private->sPcmModeParam[pAudioPcmMode->nPortIndex], sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+      break;
+    case OMX_IndexParamStandardComponentRole:
+      pComponentRole = (OMX_PARAM_COMPONENTROLETYPE*)ComponentParameterStructure;
+      if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_PARAM_COMPONENTROLETYPE))) != OMX_ErrorNone) {
+        break;
+      }
+      strcpy( (char*) pComponentRole->cRole, RESAMPLER_COMP_ROLE);
+      break;
+    case OMX_IndexVendorResamplerQuality:
+      pQuality = (OMX_PARAM_U32TYPE*)ComponentParameterStructure;
+      if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_PARAM_U32TYPE))) != OMX_ErrorNone) {
+        break;
+      }
+      pQuality->nU32 = omx_resampler_component_Private->eQuality;
+      break;
+    default:
+      err = omx_base_component_GetParameter(hComponent, nParamIndex, ComponentParameterStructure);
+  }
+  return err;
+}
+
+/** Returns the index of the vendor parameter setting the quality tier */
+OMX_ERRORTYPE omx_resampler_component_GetExtensionIndex(
+  OMX_IN  OMX_HANDLETYPE hComponent,
+  OMX_IN  OMX_STRING cParameterName,
+  OMX_OUT OMX_INDEXTYPE* pIndexType) {
+
+  DEBUG(DEB_LEV_FUNCTION_NAME,"In  %s \n",__func__);
+
+  if(strcmp(cParameterName,RESAMPLER_QUALITY_NAME) == 0) {
+    *pIndexType = OMX_IndexVendorResamplerQuality;
+  } else {
+    return omx_base_component_GetExtensionIndex(hComponent, cParameterName, pIndexType);
+  }
+  return OMX_ErrorNone;
+}
@@ -0,0 +1,91 @@
+/**
+  @file src/components/audio_effects/omx_resampler_component.h
+
+  OpenMAX sample rate converter component. This component implements a filter
+  that converts an audio PCM stream from the sampling rate of its input port to
+  the one of its output port.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#ifndef _OMX_RESAMPLER_COMPONENT_H_
+#define _OMX_RESAMPLER_COMPONENT_H_
+
+#include <OMX_Types.h>
+#include <OMX_Component.h>
+#include <OMX_Core.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <omx_base_filter.h>
+#include <omx_pcm_kernels.h>
+#include <omx_pcm_resampler.h>
+
+/** The extension name of OMX_IndexVendorResamplerQuality. Its nU32 is an
+  * omx_pcm_resampler_quality_t, OMX_PCM_RESAMPLER_MEDIUM by default. It is
+  * set in the Loaded or Idle state and used from the next Executing state
+  */
+#define RESAMPLER_QUALITY_NAME "OMX.st.index.param.resampler.quality"
+
+/** Twoport component private structure.
+* see the define above
+*/
+DERIVEDCLASS(omx_resampler_component_PrivateType, omx_base_filter_PrivateType)
+#define omx_resampler_component_PrivateType_FIELDS omx_base_filter_PrivateType_FIELDS \
+  /** @param sPcmModeParam PCM mode of each port. They differ by the sampling rate only */ \
+  OMX_AUDIO_PARAM_PCMMODETYPE sPcmModeParam[2]; \
+  /** @param ePcmFormat sample format of both ports */ \
+  omx_pcm_format_t ePcmFormat; \
+  /** @param eQuality quality tier of the next resampler */ \
+  omx_pcm_resampler_quality_t eQuality; \
+  /** @param pResampler converter of the stream, NULL when both rates are the same */ \
+  omx_pcm_resampler_t* pResampler;
+ENDCLASS(omx_resampler_component_PrivateType)
+
+/* Component private entry points declaration */
+OMX_ERRORTYPE omx_resampler_component_Constructor(OMX_COMPONENTTYPE *openmaxStandComp,OMX_STRING cComponentName);
+OMX_ERRORTYPE omx_resampler_component_Destructor(OMX_COMPONENTTYPE *openmaxStandComp);
+
+OMX_ERRORTYPE omx_resampler_component_MessageHandler(OMX_COMPONENTTYPE*,internalRequestMessageType*);
+
+void omx_resampler_component_BufferMgmtCallback(
+  OMX_COMPONENTTYPE *openmaxStandComp,
+  OMX_BUFFERHEADERTYPE* inputbuffer,
+  OMX_BUFFERHEADERTYPE* outputbuffer);
+
+OMX_ERRORTYPE omx_resampler_component_GetParameter(
+  OMX_IN  OMX_HANDLETYPE hComponent,
+  OMX_IN  OMX_INDEXTYPE nParamIndex,
+  OMX_INOUT OMX_PTR ComponentParameterStructure);
+
+OMX_ERRORTYPE omx_resampler_component_SetParameter(
+  OMX_IN  OMX_HANDLETYPE hComponent,
+  OMX_IN  OMX_INDEXTYPE nParamIndex,
+  OMX_IN  OMX_PTR ComponentParameterStructure);
+
+OMX_ERRORTYPE omx_resampler_component_GetExtensionIndex(
+  OMX_IN  OMX_HANDLETYPE hComponent,
+  OMX_IN  OMX_STRING cParameterName,
+  OMX_OUT OMX_INDEXTYPE* pIndexType);
+
+#endif
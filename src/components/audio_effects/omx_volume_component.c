@@ -30,6 +30,7 @@
 #include <omxcore.h>
 #include <omx_base_audio_port.h>
 #include <omx_volume_component.h>
+#include <omx_pcm_kernels.h>
 #include<OMX_Audio.h>
 
 /* gain value */
@@ -89,13 +90,28 @@ OMX_ERRORTYPE omx_volume_component_Constructor(OMX_COMPONENTTYPE *openmaxStandCo
   omx_volume_component_Private->ports[OMX_BASE_FILTER_INPUTPORT_INDEX]->sPortParam.nBufferSize = DEFAULT_OUT_BUFFER_SIZE;
   omx_volume_component_Private->ports[OMX_BASE_FILTER_OUTPUTPORT_INDEX]->sPortParam.nBufferSize = DEFAULT_OUT_BUFFER_SIZE;
 
+  setHeader(&omx_volume_component_Private->sPcmModeParam, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+  omx_volume_component_Private->sPcmModeParam.nChannels = 2;
+  omx_volume_component_Private->sPcmModeParam.eNumData = OMX_NumericalDataSigned;
+  omx_volume_component_Private->sPcmModeParam.eEndian = OMX_EndianBig;
+  omx_volume_component_Private->sPcmModeParam.bInterleaved = OMX_TRUE;
+  omx_volume_component_Private->sPcmModeParam.nBitPerSample = 16;
+  omx_volume_component_Private->sPcmModeParam.nSamplingRate = 0;
+  omx_volume_component_Private->sPcmModeParam.ePCMMode = OMX_AUDIO_PCMModeLinear;
+  omx_volume_component_Private->ePcmFormat = OMX_PCM_FORMAT_S16;
+
   omx_volume_component_Private->gain = GAIN_VALUE; //100.0f; // default gain
+  omx_volume_component_Private->nGain = OMX_PCM_UNITY_GAIN;
+  omx_volume_component_Private->nTargetGain = OMX_PCM_UNITY_GAIN;
   omx_volume_component_Private->destructor = omx_volume_component_Destructor;
   openmaxStandComp->SetParameter = omx_volume_component_SetParameter;
   openmaxStandComp->GetParameter = omx_volume_component_GetParameter;
   openmaxStandComp->GetConfig = omx_volume_component_GetConfig;
   openmaxStandComp->SetConfig = omx_volume_component_SetConfig;
   omx_volume_component_Private->BufferMgmtCallback = omx_volume_component_BufferMgmtCallback;
+  omx_volume_component_Private->BufferMgmtBatchCallback = omx_volume_component_BufferMgmtBatchCallback;
+  /* Each sample is read before being written, so the gain can be applied in place */
+  omx_volume_component_Private->bInPlaceProcessing = OMX_TRUE;
 
   noVolumeCompInstance++;
   if(noVolumeCompInstance > MAX_COMPONENT_VOLUME) {
@@ -130,25 +146,54 @@ OMX_ERRORTYPE omx_volume_component_Destructor(OMX_COMPONENTTYPE *openmaxStandCom
   return OMX_ErrorNone;
 }
 
-/** This function is used to process the input buffer and provide one output buffer
+/** This function is used to process the input buffer and provide one output buffer.
+  * The samples are in the format of the PCM mode of the ports.
+  * After a volume change the gain ramps linearly across the buffer to the new value
   */
 void omx_volume_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandComp, OMX_BUFFERHEADERTYPE* pInputBuffer, OMX_BUFFERHEADERTYPE* pOutputBuffer) {
-  int i;
-  int sampleCount = pInputBuffer->nFilledLen / 2; // signed 16 bit samples assumed
   omx_volume_component_PrivateType* omx_volume_component_Private = openmaxStandComp->pComponentPrivate;
-
-  if(omx_volume_component_Private->gain != GAIN_VALUE) {
-    for (i = 0; i < sampleCount; i++) {
-      ((OMX_S16*) pOutputBuffer->pBuffer)[i] = (OMX_S16)
-              (((OMX_S16*) pInputBuffer->pBuffer)[i] * (omx_volume_component_Private->gain / 100.0f));
-    }
-  } else {
+  OMX_U32 sampleCount = pInputBuffer->nFilledLen / omx_pcm_sample_size(omx_volume_component_Private->ePcmFormat);
+  OMX_S32 nStartGain = omx_volume_component_Private->nGain;
+  OMX_S32 nEndGain = omx_volume_component_Private->nTargetGain;
+
+  if(nStartGain != OMX_PCM_UNITY_GAIN || nEndGain != OMX_PCM_UNITY_GAIN) {
+    omx_pcm_gain(omx_volume_component_Private->ePcmFormat, pOutputBuffer->pBuffer, pInputBuffer->pBuffer,
+                 sampleCount, omx_volume_component_Private->sPcmModeParam.nChannels, nStartGain, nEndGain);
+    omx_volume_component_Private->nGain = nEndGain;
+  } else if(pOutputBuffer->pBuffer != pInputBuffer->pBuffer) {
     memcpy(pOutputBuffer->pBuffer,pInputBuffer->pBuffer,pInputBuffer->nFilledLen);
   }
   pOutputBuffer->nFilledLen = pInputBuffer->nFilledLen;
   pInputBuffer->nFilledLen=0;
 }
 
+/** This function processes the input buffers queued at once, each into one output buffer.
+  * The format and the gain are read once for the whole batch: a gain change ramps over
+  * the first buffer, and the others are scaled by the new gain or just copied.
+  */
+void omx_volume_component_BufferMgmtBatchCallback(OMX_COMPONENTTYPE *openmaxStandComp, OMX_BUFFERHEADERTYPE** pInputBuffers, OMX_U32 nInputBuffers, OMX_BUFFERHEADERTYPE** pOutputBuffers, OMX_U32 nOutputBuffers) {
+  omx_volume_component_PrivateType* omx_volume_component_Private = openmaxStandComp->pComponentPrivate;
+  omx_pcm_format_t ePcmFormat = omx_volume_component_Private->ePcmFormat;
+  OMX_U32 nSampleSize = omx_pcm_sample_size(ePcmFormat);
+  OMX_U32 nChannels = omx_volume_component_Private->sPcmModeParam.nChannels;
+  OMX_S32 nStartGain = omx_volume_component_Private->nGain;
+  OMX_S32 nEndGain = omx_volume_component_Private->nTargetGain;
+  OMX_U32 i;
+
+  for (i = 0; i < nInputBuffers && i < nOutputBuffers; i++) {
+    if(nStartGain != OMX_PCM_UNITY_GAIN || nEndGain != OMX_PCM_UNITY_GAIN) {
+      omx_pcm_gain(ePcmFormat, pOutputBuffers[i]->pBuffer, pInputBuffers[i]->pBuffer,
+                   pInputBuffers[i]->nFilledLen / nSampleSize, nChannels, nStartGain, nEndGain);
+      nStartGain = nEndGain;
+    } else if(pOutputBuffers[i]->pBuffer != pInputBuffers[i]->pBuffer) {
+      memcpy(pOutputBuffers[i]->pBuffer, pInputBuffers[i]->pBuffer, pInputBuffers[i]->nFilledLen);
+    }
+    pOutputBuffers[i]->nFilledLen = pInputBuffers[i]->nFilledLen;
+    pInputBuffers[i]->nFilledLen = 0;
+  }
+  omx_volume_component_Private->nGain = nStartGain;
+}
+
 /** setting configurations */
 OMX_ERRORTYPE omx_volume_component_SetConfig(
   OMX_IN  OMX_HANDLETYPE hComponent,
@@ -168,6 +213,11 @@ OMX_ERRORTYPE omx_volume_component_SetConfig(
         break;
       }
       omx_volume_component_Private->gain = pVolume->sVolume.nValue;
+      omx_volume_component_Private->nTargetGain = omx_pcm_gain_from_percent(pVolume->sVolume.nValue);
+      /* No ramp is needed before the stream starts */
+      if (omx_volume_component_Private->state != OMX_StateExecuting && omx_volume_component_Private->state != OMX_StatePause) {
+        omx_volume_component_Private->nGain = omx_volume_component_Private->nTargetGain;
+      }
       err = OMX_ErrorNone;
       break;
     default: // delegate to superclass
@@ -209,7 +259,9 @@ OMX_ERRORTYPE omx_volume_component_SetParameter(
 
   OMX_ERRORTYPE err = OMX_ErrorNone;
   OMX_AUDIO_PARAM_PORTFORMATTYPE *pAudioPortFormat;
+  OMX_AUDIO_PARAM_PCMMODETYPE *pAudioPcmMode;
   OMX_PARAM_COMPONENTROLETYPE *pComponentRole;
+  omx_pcm_format_t ePcmFormat;
   OMX_U32 portIndex;
   omx_base_audio_PortType *port;
 
@@ -237,6 +289,26 @@ OMX_ERRORTYPE omx_volume_component_SetParameter(
         err = OMX_ErrorBadPortIndex;
       }
       break;
+    case OMX_IndexParamAudioPcm:
+      pAudioPcmMode = (OMX_AUDIO_PARAM_PCMMODETYPE*)ComponentParameterStructure;
+      portIndex = pAudioPcmMode->nPortIndex;
+      /* The mode applies to both ports, neither may be running */
+      err = omx_base_component_ParameterSanityCheck(hComponent, portIndex, pAudioPcmMode, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+      if(err == OMX_ErrorNone) {
+        err = omx_base_component_ParameterSanityCheck(hComponent, 1 - portIndex, pAudioPcmMode, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+      }
+      if(err!=OMX_ErrorNone) {
+        DEBUG(DEB_LEV_ERR, "In %s Parameter Check Error=%x\n",__func__,err);
+        break;
+      }
+      err = omx_pcm_format_from_mode(pAudioPcmMode, &ePcmFormat);
+      if(err!=OMX_ErrorNone) {
+        DEBUG(DEB_LEV_ERR, "In %s PCM mode of %i bits and %i channels not supported\n",__func__,(int)pAudioPcmMode->nBitPerSample,(int)pAudioPcmMode->nChannels);
+        break;
+      }
+      memcpy(&omx_volume_component_Private->sPcmModeParam, pAudioPcmMode, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+      omx_volume_component_Private->ePcmFormat = ePcmFormat;
+      break;
     case OMX_IndexParamStandardComponentRole:
       pComponentRole = (OMX_PARAM_COMPONENTROLETYPE*)ComponentParameterStructure;
 
@@ -269,6 +341,7 @@ OMX_ERRORTYPE omx_volume_component_GetParameter(
   OMX_PARAM_COMPONENTROLETYPE *pComponentRole;
   OMX_ERRORTYPE err = OMX_ErrorNone;
   omx_base_audio_PortType *port;
+  OMX_U32 portIndex;
   OMX_COMPONENTTYPE *openmaxStandComp = (OMX_COMPONENTTYPE *)hComponent;
   omx_volume_component_PrivateType* omx_volume_component_Private = openmaxStandComp->pComponentPrivate;
   if (ComponentParameterStructure == NULL) {
@@ -304,13 +377,9 @@ OMX_ERRORTYPE omx_volume_component_GetParameter(
       if (pAudioPcmMode->nPortIndex > 1) {
         return OMX_ErrorBadPortIndex;
       }
-      pAudioPcmMode->nChannels = 2;
-      pAudioPcmMode->eNumData = OMX_NumericalDataSigned;
-      pAudioPcmMode->eEndian = OMX_EndianBig;
-      pAudioPcmMode->bInterleaved = OMX_TRUE;
-      pAudioPcmMode->nBitPerSample = 16;
-      pAudioPcmMode->nSamplingRate = 0;
-      pAudioPcmMode->ePCMMode = OMX_AUDIO_PCMModeLinear;
+      portIndex = pAudioPcmMode->nPortIndex;
+      memcpy(pAudioPcmMode, &omx_volume_component_Private->sPcmModeParam, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+      pAudioPcmMode->nPortIndex = portIndex;
       break;
     case OMX_IndexParamStandardComponentRole:
       pComponentRole = (OMX_PARAM_COMPONENTROLETYPE*)ComponentParameterStructure;
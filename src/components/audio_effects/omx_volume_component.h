@@ -37,6 +37,7 @@
 #include <string.h>
 #include <pthread.h>
 #include <omx_base_filter.h>
+#include <omx_pcm_kernels.h>
 
 /** Twoport component private structure.
 * see the define above
@@ -44,7 +45,15 @@
 DERIVEDCLASS(omx_volume_component_PrivateType, omx_base_filter_PrivateType)
 #define omx_volume_component_PrivateType_FIELDS omx_base_filter_PrivateType_FIELDS \
   /** @param gain the volume gain value */ \
-  float gain;
+  float gain; \
+  /** @param nGain Q15 gain applied to the end of the last buffer */ \
+  OMX_S32 nGain; \
+  /** @param nTargetGain Q15 gain set by the client, the next buffer ramps from nGain to it */ \
+  OMX_S32 nTargetGain; \
+  /** @param sPcmModeParam PCM mode of both ports, the samples being processed in place */ \
+  OMX_AUDIO_PARAM_PCMMODETYPE sPcmModeParam; \
+  /** @param ePcmFormat sample format of sPcmModeParam */ \
+  omx_pcm_format_t ePcmFormat;
 ENDCLASS(omx_volume_component_PrivateType)
 
 /* Component private entry points declaration */
@@ -56,6 +65,13 @@ void omx_volume_component_BufferMgmtCallback(
   OMX_BUFFERHEADERTYPE* inputbuffer,
   OMX_BUFFERHEADERTYPE* outputbuffer);
 
+void omx_volume_component_BufferMgmtBatchCallback(
+  OMX_COMPONENTTYPE *openmaxStandComp,
+  OMX_BUFFERHEADERTYPE** inputbuffers,
+  OMX_U32 nInputBuffers,
+  OMX_BUFFERHEADERTYPE** outputbuffers,
+  OMX_U32 nOutputBuffers);
+
 OMX_ERRORTYPE omx_volume_component_GetParameter(
   OMX_IN  OMX_HANDLETYPE hComponent,
   OMX_IN  OMX_INDEXTYPE nParamIndex,
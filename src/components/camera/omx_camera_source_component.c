@@ -1208,6 +1208,7 @@ static void* omx_camera_source_component_BufferMgmtFunction (void* param) {
   OMX_BUFFERHEADERTYPE* pPreviewBuffer=NULL;
   OMX_BUFFERHEADERTYPE* pCaptureBuffer=NULL;
   OMX_BUFFERHEADERTYPE* pThumbnailBuffer=NULL;
+  unsigned int nStateGen;
 
 
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s for camera component\n",__func__);
@@ -1268,11 +1269,12 @@ static void* omx_camera_source_component_BufferMgmtFunction (void* param) {
     omx_camera_source_component_Private->bCapturing = omx_camera_source_component_Private->bCapturingNext;
     pthread_mutex_unlock(&omx_camera_source_component_Private->setconfig_mutex);
 
+    nStateGen = tsem_get_gen(omx_camera_source_component_Private->bStateSem);
     if(omx_camera_source_component_Private->state==OMX_StatePause &&
         !(PORT_IS_BEING_FLUSHED(pPreviewPort) || PORT_IS_BEING_FLUSHED(pCapturePort) || PORT_IS_BEING_FLUSHED(pThumbnailPort))) {
       /*Waiting at paused state*/
       DEBUG(DEB_LEV_FULL_SEQ, "In %s: wait at State %d\n", __func__, omx_camera_source_component_Private->state);
-      tsem_wait(omx_camera_source_component_Private->bStateSem);
+      tsem_wait_gen(omx_camera_source_component_Private->bStateSem, nStateGen);
     }
 
     pthread_mutex_lock(&omx_camera_source_component_Private->idle_state_mutex);
@@ -352,7 +352,7 @@ OMX_ERRORTYPE omx_clocksrc_component_GetConfig(
      memcpy(pRefClock,&omx_clocksrc_component_Private->sRefClock, sizeof(OMX_TIME_CONFIG_ACTIVEREFCLOCKTYPE));
      break;
   default:
-    return OMX_ErrorBadParameter;
+    return omx_base_component_GetConfig(hComponent, nIndex, pComponentConfigStructure);
     break;
   }
   return OMX_ErrorNone;
@@ -639,6 +639,7 @@ void* omx_clocksrc_BufferMgmtFunction (void* param) {
   OMX_BUFFERHEADERTYPE*               pOutputBuffer[MAX_CLOCK_PORTS];
   OMX_BOOL                            isOutputBufferNeeded[MAX_CLOCK_PORTS],bPortsBeingFlushed = OMX_FALSE;
   int                                 i,j,outBufExchanged[MAX_CLOCK_PORTS];
+  OMX_U64                             nPerfTime;
 
   for(i=0;i<omx_clocksrc_component_Private->sPortTypesParam[OMX_PortDomainOther].nPorts;i++) {
     pOutPort[i]             = (omx_base_clock_PortType *)omx_clocksrc_component_Private->ports[i];
@@ -695,7 +696,7 @@ void* omx_clocksrc_BufferMgmtFunction (void* param) {
 
           if(pOutputSem[i]->semval>0 && isOutputBufferNeeded[i]==OMX_TRUE ) {
             tsem_down(pOutputSem[i]);
-            if(pOutputQueue[i]->nelem>0){
+            if(getquenelem(pOutputQueue[i])>0){
               outBufExchanged[i]++;
               isOutputBufferNeeded[i]=OMX_FALSE;
               pOutputBuffer[i] = dequeue(pOutputQueue[i]);
@@ -741,7 +742,9 @@ void* omx_clocksrc_BufferMgmtFunction (void* param) {
           && PORT_IS_ENABLED(pOutPort[i])) {
           //Signalled from EmptyThisBuffer or FillThisBuffer or some where else
           DEBUG(DEB_LEV_FULL_SEQ, "Waiting for next output buffer %i\n",i);
+          nPerfTime = omx_base_component_PerfTime();
           tsem_down(omx_clocksrc_component_Private->bMgmtSem);
+          PERF_COUNTER_ADD(omx_clocksrc_component_Private->sPerfCounters.nMgmtWaitTime, omx_base_component_PerfTime() - nPerfTime);
         }
         if(omx_clocksrc_component_Private->state == OMX_StateLoaded  || 
            omx_clocksrc_component_Private->state == OMX_StateInvalid ||
@@ -753,7 +756,7 @@ void* omx_clocksrc_BufferMgmtFunction (void* param) {
         
         if(pOutputSem[i]->semval>0 && isOutputBufferNeeded[i]==OMX_TRUE ) {
           tsem_down(pOutputSem[i]);
-          if(pOutputQueue[i]->nelem>0){
+          if(getquenelem(pOutputQueue[i])>0){
             outBufExchanged[i]++;
             isOutputBufferNeeded[i]=OMX_FALSE;
             pOutputBuffer[i] = dequeue(pOutputQueue[i]);
@@ -780,7 +783,10 @@ void* omx_clocksrc_BufferMgmtFunction (void* param) {
         /*Process Output buffer of Port i */
         if(isOutputBufferNeeded[i]==OMX_FALSE) {
           if (omx_clocksrc_component_Private->BufferMgmtCallback) {
+            nPerfTime = omx_base_component_PerfTime();
             (*(omx_clocksrc_component_Private->BufferMgmtCallback))(openmaxStandComp, pOutputBuffer[i]);
+            PERF_COUNTER_ADD(omx_clocksrc_component_Private->sPerfCounters.nCallbackTime, omx_base_component_PerfTime() - nPerfTime);
+            PERF_COUNTER_ADD(omx_clocksrc_component_Private->sPerfCounters.nCallbacks, 1);
           } else {
             /*If no buffer management call back then don't produce any output buffer*/
             pOutputBuffer[i]->nFilledLen = 0;
@@ -817,17 +823,14 @@ OMX_ERRORTYPE clocksrc_port_FlushProcessingBuffers(omx_base_PortType *openmaxSta
 
   pthread_mutex_lock(&omx_clocksrc_component_Private->flush_mutex);
   openmaxStandPort->bIsPortFlushed=OMX_TRUE;
-  /*Signal the buffer management thread of port flush,if it is waiting for buffers*/
-  if(omx_clocksrc_component_Private->bMgmtSem->semval==0) {
-    tsem_up(omx_clocksrc_component_Private->bMgmtSem);
-  }
+  /* Always wake the buffer management thread: it may have seen the port not flushed
+   * yet and be about to wait. The count left over is reset once the flush is done */
+  tsem_up(omx_clocksrc_component_Private->bMgmtSem);
   tsem_up(omx_clocksrc_component_Private->clockEventSem);
   tsem_up(omx_clocksrc_component_Private->clockEventCompleteSem);
 
-  if(omx_clocksrc_component_Private->state==OMX_StatePause ) {
-    /*Waiting at paused state*/
-    tsem_signal(omx_clocksrc_component_Private->bStateSem);
-  }
+  /* Wake it up if it waits at paused state */
+  tsem_signal(omx_clocksrc_component_Private->bStateSem);
   DEBUG(DEB_LEV_FULL_SEQ, "In %s waiting for flush all condition port index =%d\n", __func__,(int)openmaxStandPort->sPortParam.nPortIndex);
   /* Wait until flush is completed */
   pthread_mutex_unlock(&omx_clocksrc_component_Private->flush_mutex);
@@ -840,7 +843,7 @@ OMX_ERRORTYPE clocksrc_port_FlushProcessingBuffers(omx_base_PortType *openmaxSta
   while (openmaxStandPort->pBufferSem->semval > 0) {
     DEBUG(DEB_LEV_FULL_SEQ, "In %s TFlag=%x Flusing Port=%d,Semval=%d Qelem=%d\n", 
     __func__,(int)openmaxStandPort->nTunnelFlags,(int)openmaxStandPort->sPortParam.nPortIndex,
-    (int)openmaxStandPort->pBufferSem->semval,(int)openmaxStandPort->pBufferQueue->nelem);
+    (int)openmaxStandPort->pBufferSem->semval,(int)getquenelem(openmaxStandPort->pBufferQueue));
 
     tsem_down(openmaxStandPort->pBufferSem);
     pBuffer = dequeue(openmaxStandPort->pBufferQueue);
@@ -853,7 +856,9 @@ OMX_ERRORTYPE clocksrc_port_FlushProcessingBuffers(omx_base_PortType *openmaxSta
         ((OMX_COMPONENTTYPE*)(openmaxStandPort->hTunneledComponent))->EmptyThisBuffer(openmaxStandPort->hTunneledComponent, pBuffer);
       }
     } else if (PORT_IS_TUNNELED_N_BUFFER_SUPPLIER(openmaxStandPort)) {
-      queue(openmaxStandPort->pBufferQueue,pBuffer);
+      if (queue(openmaxStandPort->pBufferQueue,pBuffer) != 0) {
+        DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+      }
     } else {
       (*(openmaxStandPort->BufferProcessedCallback))(
         openmaxStandPort->standCompContainer,
@@ -863,9 +868,9 @@ OMX_ERRORTYPE clocksrc_port_FlushProcessingBuffers(omx_base_PortType *openmaxSta
   }
   /*Port is tunneled and supplier and didn't received all it's buffer then wait for the buffers*/
   if (PORT_IS_TUNNELED_N_BUFFER_SUPPLIER(openmaxStandPort)) {
-    while(openmaxStandPort->pBufferQueue->nelem!= openmaxStandPort->nNumAssignedBuffers){
+    while(getquenelem(openmaxStandPort->pBufferQueue)!= openmaxStandPort->nNumAssignedBuffers){
       tsem_down(openmaxStandPort->pBufferSem);
-      DEBUG(DEB_LEV_PARAMS, "In %s Got a buffer qelem=%d\n",__func__,openmaxStandPort->pBufferQueue->nelem);
+      DEBUG(DEB_LEV_PARAMS, "In %s Got a buffer qelem=%d\n",__func__,getquenelem(openmaxStandPort->pBufferQueue));
     }
     tsem_reset(openmaxStandPort->pBufferSem);
   }
@@ -881,7 +886,7 @@ OMX_ERRORTYPE clocksrc_port_FlushProcessingBuffers(omx_base_PortType *openmaxSta
 
   DEBUG(DEB_LEV_PARAMS, "In %s TFlag=%x Qelem=%d BSem=%d bMgmtsem=%d component=%s\n", __func__,
     (int)openmaxStandPort->nTunnelFlags,
-    (int)openmaxStandPort->pBufferQueue->nelem,
+    (int)getquenelem(openmaxStandPort->pBufferQueue),
     (int)openmaxStandPort->pBufferSem->semval,
     (int)omx_clocksrc_component_Private->bMgmtSem->semval,
     omx_clocksrc_component_Private->name);
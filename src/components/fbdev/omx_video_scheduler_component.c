@@ -123,6 +123,7 @@ OMX_ERRORTYPE omx_video_scheduler_component_Constructor(OMX_COMPONENTTYPE *openm
 
   omx_video_scheduler_component_Private->destructor         = omx_video_scheduler_component_Destructor;
   omx_video_scheduler_component_Private->BufferMgmtCallback = omx_video_scheduler_component_BufferMgmtCallback;
+  omx_video_scheduler_component_Private->bInPlaceProcessing = OMX_TRUE;
 
   inPort->Port_SendBufferFunction =  omx_video_scheduler_component_port_SendBufferFunction;
   inPort->FlushProcessingBuffers  = omx_video_scheduler_component_port_FlushProcessingBuffers;
@@ -241,13 +242,19 @@ OMX_ERRORTYPE omx_video_scheduler_component_port_SendBufferFunction(omx_base_Por
   /* And notify the buffer management thread we have a fresh new buffer to manage */
   if(!PORT_IS_BEING_FLUSHED(openmaxStandPort) && !(PORT_IS_BEING_DISABLED(openmaxStandPort) && PORT_IS_TUNNELED_N_BUFFER_SUPPLIER(openmaxStandPort)) 
       && omx_base_component_Private->transientState != OMX_TransStateExecutingToIdle){
-      queue(openmaxStandPort->pBufferQueue, pBuffer);
+      if (queue(openmaxStandPort->pBufferQueue, pBuffer) != 0) {
+        DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+        return OMX_ErrorInsufficientResources;
+      }
       tsem_up(openmaxStandPort->pBufferSem);
       DEBUG(DEB_LEV_FULL_SEQ, "In %s Signalling bMgmtSem Port Index=%d\n",__func__, (int)portIndex);
       tsem_up(omx_base_component_Private->bMgmtSem);
   }else if(PORT_IS_BUFFER_SUPPLIER(openmaxStandPort)){
       DEBUG(DEB_LEV_FULL_SEQ, "In %s: Comp %s received io:%d buffer\n", __func__,omx_base_component_Private->name,(int)openmaxStandPort->sPortParam.nPortIndex);
-      queue(openmaxStandPort->pBufferQueue, pBuffer);   
+      if (queue(openmaxStandPort->pBufferQueue, pBuffer) != 0) {
+        DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+        return OMX_ErrorInsufficientResources;
+      }
       tsem_up(openmaxStandPort->pBufferSem);
   } else { // If port being flushed and not tunneled then return error
     DEBUG(DEB_LEV_FULL_SEQ, "In %s \n", __func__);
@@ -291,7 +298,7 @@ OMX_BOOL omx_video_scheduler_component_ClockPortHandleFunction(
     tsem_down(pClockPort->pBufferSem); /* wait for state change notification */
 
     /* update the clock state and clock scale info into the fbdev private data */
-    if(pClockPort->pBufferQueue->nelem > 0) {
+    if(getquenelem(pClockPort->pBufferQueue) > 0) {
       clockBuffer=dequeue(pClockPort->pBufferQueue);
       pMediaTime  = (OMX_TIME_MEDIATIMETYPE*)clockBuffer->pBuffer;
       omx_video_scheduler_component_Private->eState      = pMediaTime->eState;
@@ -310,7 +317,7 @@ OMX_BOOL omx_video_scheduler_component_ClockPortHandleFunction(
   /* check for any scale change information from the clock component */
   if(pClockPort->pBufferSem->semval>0) {
     tsem_down(pClockPort->pBufferSem);
-    if(pClockPort->pBufferQueue->nelem > 0) {
+    if(getquenelem(pClockPort->pBufferQueue) > 0) {
       clockBuffer = dequeue(pClockPort->pBufferQueue);
       pMediaTime  = (OMX_TIME_MEDIATIMETYPE*)clockBuffer->pBuffer;
       if(pMediaTime->eUpdateType==OMX_TIME_UpdateScaleChanged) {
@@ -368,7 +375,7 @@ OMX_BOOL omx_video_scheduler_component_ClockPortHandleFunction(
       if(!PORT_IS_BEING_FLUSHED(pInputPort) && !PORT_IS_BEING_FLUSHED(pClockPort) &&
           omx_video_scheduler_component_Private->transientState != OMX_TransStateExecutingToIdle) {
         tsem_down(pClockPort->pBufferSem); /* wait for the request fullfillment */
-        if(pClockPort->pBufferQueue->nelem > 0) {
+        if(getquenelem(pClockPort->pBufferQueue) > 0) {
           clockBuffer = dequeue(pClockPort->pBufferQueue);
           pMediaTime  = (OMX_TIME_MEDIATIMETYPE*)clockBuffer->pBuffer;
           if(pMediaTime->eUpdateType==OMX_TIME_UpdateScaleChanged) {
@@ -422,15 +429,12 @@ OMX_ERRORTYPE  omx_video_scheduler_component_port_FlushProcessingBuffers(omx_bas
   if(openmaxStandPort->sPortParam.eDomain!=OMX_PortDomainOther) { /* clock buffers not used in the clients buffer managment function */
     pthread_mutex_lock(&omx_base_component_Private->flush_mutex);
     openmaxStandPort->bIsPortFlushed=OMX_TRUE;
-    /*Signal the buffer management thread of port flush,if it is waiting for buffers*/
-    if(omx_base_component_Private->bMgmtSem->semval==0) {
-      tsem_up(omx_base_component_Private->bMgmtSem);
-    }
+    /* Always wake the buffer management thread: it may have seen the port not flushed
+     * yet and be about to wait. The count left over is reset once the flush is done */
+    tsem_up(omx_base_component_Private->bMgmtSem);
 
-    if(omx_base_component_Private->state==OMX_StatePause ) {
-      /*Waiting at paused state*/
-      tsem_signal(omx_base_component_Private->bStateSem);
-    }
+    /* Wake it up if it waits at paused state */
+    tsem_signal(omx_base_component_Private->bStateSem);
     DEBUG(DEB_LEV_FULL_SEQ, "In %s waiting for flush all condition port index =%d\n", __func__,(int)openmaxStandPort->sPortParam.nPortIndex);
     /* Wait until flush is completed */
     pthread_mutex_unlock(&omx_base_component_Private->flush_mutex);
@@ -449,7 +453,7 @@ OMX_ERRORTYPE  omx_video_scheduler_component_port_FlushProcessingBuffers(omx_bas
   while (openmaxStandPort->pBufferSem->semval > 0) {
     DEBUG(DEB_LEV_FULL_SEQ, "In %s TFlag=%x Flusing Port=%d,Semval=%d Qelem=%d\n", 
     __func__,(int)openmaxStandPort->nTunnelFlags,(int)openmaxStandPort->sPortParam.nPortIndex,
-    (int)openmaxStandPort->pBufferSem->semval,(int)openmaxStandPort->pBufferQueue->nelem);
+    (int)openmaxStandPort->pBufferSem->semval,(int)getquenelem(openmaxStandPort->pBufferQueue));
 
     tsem_down(openmaxStandPort->pBufferSem);
     pBuffer = dequeue(openmaxStandPort->pBufferQueue);
@@ -462,7 +466,9 @@ OMX_ERRORTYPE  omx_video_scheduler_component_port_FlushProcessingBuffers(omx_bas
         ((OMX_COMPONENTTYPE*)(openmaxStandPort->hTunneledComponent))->EmptyThisBuffer(openmaxStandPort->hTunneledComponent, pBuffer);
       }
     } else if (PORT_IS_TUNNELED_N_BUFFER_SUPPLIER(openmaxStandPort)) {
-      queue(openmaxStandPort->pBufferQueue,pBuffer);
+      if (queue(openmaxStandPort->pBufferQueue,pBuffer) != 0) {
+        DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)openmaxStandPort->sPortParam.nPortIndex);
+      }
     } else {
       (*(openmaxStandPort->BufferProcessedCallback))(
         openmaxStandPort->standCompContainer,
@@ -472,9 +478,9 @@ OMX_ERRORTYPE  omx_video_scheduler_component_port_FlushProcessingBuffers(omx_bas
   }
   /*Port is tunneled and supplier and didn't received all it's buffer then wait for the buffers*/
   if (PORT_IS_TUNNELED_N_BUFFER_SUPPLIER(openmaxStandPort)) {
-    while(openmaxStandPort->pBufferQueue->nelem!= openmaxStandPort->nNumAssignedBuffers){
+    while(getquenelem(openmaxStandPort->pBufferQueue)!= openmaxStandPort->nNumAssignedBuffers){
       tsem_down(openmaxStandPort->pBufferSem);
-      DEBUG(DEB_LEV_PARAMS, "In %s Got a buffer qelem=%d\n",__func__,openmaxStandPort->pBufferQueue->nelem);
+      DEBUG(DEB_LEV_PARAMS, "In %s Got a buffer qelem=%d\n",__func__,getquenelem(openmaxStandPort->pBufferQueue));
     }
     tsem_reset(openmaxStandPort->pBufferSem);
   }
@@ -490,7 +496,7 @@ OMX_ERRORTYPE  omx_video_scheduler_component_port_FlushProcessingBuffers(omx_bas
 
   DEBUG(DEB_LEV_PARAMS, "In %s TFlag=%x Qelem=%d BSem=%d bMgmtsem=%d component=%s\n", __func__,
     (int)openmaxStandPort->nTunnelFlags,
-    (int)openmaxStandPort->pBufferQueue->nelem,
+    (int)getquenelem(openmaxStandPort->pBufferQueue),
     (int)openmaxStandPort->pBufferSem->semval,
     (int)omx_base_component_Private->bMgmtSem->semval,
     omx_base_component_Private->name);
@@ -510,8 +516,8 @@ void omx_video_scheduler_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmax
 
   if(pInputBuffer->pBuffer != pOutputBuffer->pBuffer){
     memcpy(pOutputBuffer->pBuffer,pInputBuffer->pBuffer,pInputBuffer->nFilledLen);
-    pOutputBuffer->nOffset = pInputBuffer->nOffset;
   }
+  pOutputBuffer->nOffset = pInputBuffer->nOffset;
   pOutputBuffer->nFilledLen = pInputBuffer->nFilledLen;
   pInputBuffer->nFilledLen=0;
 }
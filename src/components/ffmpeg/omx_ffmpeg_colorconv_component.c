@@ -328,6 +328,7 @@ OMX_ERRORTYPE omx_ffmpeg_colorconv_component_Constructor(OMX_COMPONENTTYPE *open
 
   omx_ffmpeg_colorconv_component_Private->in_buffer = NULL;
   omx_ffmpeg_colorconv_component_Private->conv_buffer = NULL;
+  omx_ffmpeg_colorconv_component_Private->imgConvertYuvCtx = NULL;
 
   omx_ffmpeg_colorconv_component_Private->messageHandler = omx_video_colorconv_MessageHandler;
   omx_ffmpeg_colorconv_component_Private->destructor = omx_ffmpeg_colorconv_component_Destructor;
@@ -345,6 +346,16 @@ OMX_ERRORTYPE omx_ffmpeg_colorconv_component_Constructor(OMX_COMPONENTTYPE *open
   return err;
 }
 
+/** Frees the swscale context, so that the next buffer builds one for the
+  * new port settings
+  */
+static void omx_ffmpeg_colorconv_component_FreeSwsContext(omx_ffmpeg_colorconv_component_PrivateType* omx_ffmpeg_colorconv_component_Private) {
+  if (omx_ffmpeg_colorconv_component_Private->imgConvertYuvCtx) {
+    sws_freeContext(omx_ffmpeg_colorconv_component_Private->imgConvertYuvCtx);
+    omx_ffmpeg_colorconv_component_Private->imgConvertYuvCtx = NULL;
+  }
+}
+
 /** The destructor
  */
 OMX_ERRORTYPE omx_ffmpeg_colorconv_component_Destructor(OMX_COMPONENTTYPE *openmaxStandComp) {
@@ -353,6 +364,8 @@ OMX_ERRORTYPE omx_ffmpeg_colorconv_component_Destructor(OMX_COMPONENTTYPE *openm
 
   DEBUG(DEB_LEV_FUNCTION_NAME, "Destructor of video color converter component is called\n");
 
+  omx_ffmpeg_colorconv_component_FreeSwsContext(omx_ffmpeg_colorconv_component_Private);
+
   /* frees port/s */
   if (omx_ffmpeg_colorconv_component_Private->ports) {
     for (i=0; i < omx_ffmpeg_colorconv_component_Private->sPortTypesParam[OMX_PortDomainVideo].nPorts; i++) {
@@ -441,6 +454,7 @@ OMX_ERRORTYPE omx_ffmpeg_colorconv_component_Deinit(OMX_COMPONENTTYPE *openmaxSt
     av_free(omx_ffmpeg_colorconv_component_Private->conv_frame);
     omx_ffmpeg_colorconv_component_Private->conv_frame = NULL;
   }
+  omx_ffmpeg_colorconv_component_FreeSwsContext(omx_ffmpeg_colorconv_component_Private);
 
   return err;
 }
@@ -717,6 +731,92 @@ void omx_img_copy(OMX_U8* src_ptr, OMX_S32 src_stride, OMX_U32 src_width, OMX_U3
 }
 
 
+/**  This function sets up the plane pointers and line sizes of a rectangle of an image,
+  *  so that swscale reads or writes the rectangle in place instead of through a copy
+  * @param ptr is the start of the image buffer
+  * @param stride is the stride of the image - only positive (top-to-bottom) strides are handled
+  * @param width is the image width
+  * @param height is the image height
+  * @param offset_x is the offset (in columns) to the left side of the rectangle
+  * @param offset_y is the offset (in rows) to the top of the rectangle
+  * @param rect_width is the rectangle width
+  * @param rect_height is the rectangle height
+  * @param flip walks the rows of the rectangle from the bottom up, with negative line sizes
+  * @param colorformat is the image color format
+  * @param data receives the plane pointers
+  * @param linesize receives the plane line sizes
+  * @return OMX_FALSE if the format, the stride or the rectangle needs the copy path
+  */
+static OMX_BOOL omx_img_planes(OMX_U8* ptr, OMX_S32 stride, OMX_U32 width, OMX_U32 height,
+                               OMX_S32 offset_x, OMX_S32 offset_y, OMX_U32 rect_width, OMX_U32 rect_height,
+                               OMX_BOOL flip, OMX_COLOR_FORMATTYPE colorformat, uint8_t* data[4], int linesize[4]) {
+
+  OMX_U32 chroma_shift_x;     //  log2 of the horizontal chroma subsampling of planar formats
+  OMX_U32 chroma_shift_y;     //  log2 of the vertical chroma subsampling of planar formats
+  OMX_U32 row;                //  First row walked by swscale
+
+  if (stride <= 0 || offset_x < 0 || offset_y < 0 || rect_width == 0 || rect_height == 0 ||
+      (OMX_U32) offset_x + rect_width > width || (OMX_U32) offset_y + rect_height > height) {
+    return OMX_FALSE;
+  }
+  row = flip ? (OMX_U32) offset_y + rect_height - 1 : (OMX_U32) offset_y;
+
+  data[1] = data[2] = data[3] = NULL;
+  linesize[1] = linesize[2] = linesize[3] = 0;
+
+  switch (colorformat) {
+    //  The plane layout is the one of omx_img_copy: the Y plane then the U and V planes, with packed rows
+    case OMX_COLOR_FormatYUV411Planar:
+    case OMX_COLOR_FormatYUV411PackedPlanar:
+      chroma_shift_x = 2;
+      chroma_shift_y = 0;
+      break;
+    case OMX_COLOR_FormatYUV420Planar:
+    case OMX_COLOR_FormatYUV420PackedPlanar:
+      chroma_shift_x = 1;
+      chroma_shift_y = 1;
+      break;
+    case OMX_COLOR_FormatYUV422Planar:
+    case OMX_COLOR_FormatYUV422PackedPlanar:
+      chroma_shift_x = 1;
+      chroma_shift_y = 0;
+      break;
+    case OMX_COLOR_FormatMonochrome:
+      //  Pixels are not byte aligned
+      return OMX_FALSE;
+    case OMX_COLOR_FormatCbYCrY:
+      //  A pair of pixels shares its chroma
+      if ((offset_x & 1) || (rect_width & 1)) {
+        return OMX_FALSE;
+      }
+      //  fall through
+    default:
+      if (find_ffmpeg_pxlfmt(colorformat) == PIX_FMT_NONE || stride < calcStride(width, colorformat)) {
+        return OMX_FALSE;
+      }
+      data[0] = ptr + row * (OMX_U32) stride + calcStride((OMX_U32) offset_x, colorformat);
+      linesize[0] = flip ? -stride : stride;
+      return OMX_TRUE;
+  }
+
+  //  The rectangle must not split the chroma samples
+  if (((OMX_U32) offset_x | rect_width) & ((1 << chroma_shift_x) - 1) ||
+      ((OMX_U32) offset_y | rect_height) & ((1 << chroma_shift_y) - 1)) {
+    return OMX_FALSE;
+  }
+
+  OMX_U32 chroma_width = width >> chroma_shift_x;
+  OMX_U8* U_ptr = ptr + width * height;
+  OMX_U8* V_ptr = U_ptr + chroma_width * (height >> chroma_shift_y);
+
+  data[0] = ptr + row * width + (OMX_U32) offset_x;
+  data[1] = U_ptr + (row >> chroma_shift_y) * chroma_width + ((OMX_U32) offset_x >> chroma_shift_x);
+  data[2] = V_ptr + (row >> chroma_shift_y) * chroma_width + ((OMX_U32) offset_x >> chroma_shift_x);
+  linesize[0] = flip ? -(int) width : (int) width;
+  linesize[1] = linesize[2] = flip ? -(int) chroma_width : (int) chroma_width;
+  return OMX_TRUE;
+}
+
 /** This function is used to process the input buffer and provide one output buffer
   */
 void omx_ffmpeg_colorconv_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandComp, OMX_BUFFERHEADERTYPE* pInputBuffer, OMX_BUFFERHEADERTYPE* pOutputBuffer) {
@@ -733,7 +833,6 @@ void omx_ffmpeg_colorconv_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openma
   OMX_S32 input_src_stride = inPort->sPortParam.format.video.nStride;    //  Negative means bottom-to-top (think Windows bmp)
   OMX_U32 input_src_width = inPort->sPortParam.format.video.nFrameWidth;
   OMX_U32 input_src_height = inPort->sPortParam.format.video.nSliceHeight;
-  struct SwsContext *imgConvertYuvCtx = NULL;
 
   /**  FIXME: Configuration values should be clamped to prevent memory trampling and potential segfaults.
     *  It might be best to store clamped AND unclamped values on a per-port basis so that OMX_GetConfig
@@ -774,6 +873,53 @@ void omx_ffmpeg_colorconv_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openma
   OMX_S32 output_dest_offset_x = outPort->omxConfigOutputPosition.nX;
   OMX_S32 output_dest_offset_y = outPort->omxConfigOutputPosition.nY;
 
+  /**  The output crop rectangle is taken from the input crop rectangle converted as it is, and the vertical
+    *  mirrors of both ports cancel each other out. When swscale can address both rectangles in place, it
+    *  reads the source rectangle straight from the input buffer and writes it at the output position,
+    *  instead of copying the crop into in_buffer and the converted image from conv_buffer
+    */
+  OMX_BOOL flip = ((inPort->omxConfigMirror.eMirror == OMX_MirrorVertical || inPort->omxConfigMirror.eMirror == OMX_MirrorBoth) !=
+                   (outPort->omxConfigMirror.eMirror == OMX_MirrorVertical || outPort->omxConfigMirror.eMirror == OMX_MirrorBoth)) ? OMX_TRUE : OMX_FALSE;
+  uint8_t* direct_src_data[4];
+  int direct_src_linesize[4];
+  uint8_t* direct_dest_data[4];
+  int direct_dest_linesize[4];
+
+  if (output_src_offset_x >= 0 && output_src_offset_y >= 0 &&
+      (OMX_U32) output_src_offset_x + output_cpy_width <= (OMX_U32) input_cpy_width &&
+      (OMX_U32) output_src_offset_y + output_cpy_height <= input_cpy_height &&
+      omx_img_planes(input_src_ptr, input_src_stride, input_src_width, input_src_height,
+                     input_src_offset_x + output_src_offset_x,
+                     flip ? input_src_offset_y + (OMX_S32) (input_cpy_height - output_cpy_height) - output_src_offset_y : input_src_offset_y + output_src_offset_y,
+                     output_cpy_width, output_cpy_height, flip, input_colorformat, direct_src_data, direct_src_linesize) &&
+      omx_img_planes(output_dest_ptr, output_dest_stride, output_dest_width, output_dest_height,
+                     output_dest_offset_x, output_dest_offset_y, output_cpy_width, output_cpy_height,
+                     OMX_FALSE, output_colorformat, direct_dest_data, direct_dest_linesize)) {
+
+    omx_ffmpeg_colorconv_component_Private->imgConvertYuvCtx = sws_getCachedContext(omx_ffmpeg_colorconv_component_Private->imgConvertYuvCtx,
+                                        output_cpy_width,
+                                        output_cpy_height,
+                                        inPort->ffmpeg_pxlfmt,
+                                        output_cpy_width,
+                                        output_cpy_height,
+                                        outPort->ffmpeg_pxlfmt, SWS_FAST_BILINEAR, NULL, NULL, NULL );
+    if (!omx_ffmpeg_colorconv_component_Private->imgConvertYuvCtx) {
+      DEBUG(DEB_LEV_ERR, "In %s cannot convert pixel format %d to %d\n", __func__, inPort->ffmpeg_pxlfmt, outPort->ffmpeg_pxlfmt);
+      pOutputBuffer->nFilledLen = 0;
+      return;
+    }
+
+    sws_scale(omx_ffmpeg_colorconv_component_Private->imgConvertYuvCtx, direct_src_data, direct_src_linesize, 0,
+              output_cpy_height, direct_dest_data, direct_dest_linesize);
+
+    pInputBuffer->nFilledLen = 0;
+    pOutputBuffer->nFilledLen = (OMX_U32) abs(output_dest_stride) * output_dest_height;
+
+    DEBUG(DEB_LEV_FULL_SEQ, "in %s One output buffer %x len=%d is full returning in color converter\n",
+            __func__, (int)pOutputBuffer->pBuffer, (int)pOutputBuffer->nFilledLen);
+    return;
+  }
+
   avpicture_fill((AVPicture*) omx_ffmpeg_colorconv_component_Private->in_frame, omx_ffmpeg_colorconv_component_Private->in_buffer, inPort->ffmpeg_pxlfmt, input_dest_width, input_dest_height);
   avpicture_fill((AVPicture*) omx_ffmpeg_colorconv_component_Private->conv_frame, omx_ffmpeg_colorconv_component_Private->conv_buffer, outPort->ffmpeg_pxlfmt, output_src_width, output_src_height);
 
@@ -784,19 +930,24 @@ void omx_ffmpeg_colorconv_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openma
 
   pInputBuffer->nFilledLen = 0;
 
-  //  Use swscale to convert the colors into conv_buffer
-  if ( !imgConvertYuvCtx ) {
-    imgConvertYuvCtx = sws_getContext(input_src_width,
-                                      input_src_height,
+  //  Use swscale to convert the colors into conv_buffer. The scaler filters are only computed again when the size or the formats change.
+  //  in_buffer holds the rows of the crop, not the padding rows of the slice
+  omx_ffmpeg_colorconv_component_Private->imgConvertYuvCtx = sws_getCachedContext(omx_ffmpeg_colorconv_component_Private->imgConvertYuvCtx,
+                                      input_src_width,
+                                      input_dest_height,
                                       inPort->ffmpeg_pxlfmt,
                                       input_dest_width,
                                       input_dest_height,
                                       outPort->ffmpeg_pxlfmt, SWS_FAST_BILINEAR, NULL, NULL, NULL );
+  if (!omx_ffmpeg_colorconv_component_Private->imgConvertYuvCtx) {
+    DEBUG(DEB_LEV_ERR, "In %s cannot convert pixel format %d to %d\n", __func__, inPort->ffmpeg_pxlfmt, outPort->ffmpeg_pxlfmt);
+    pOutputBuffer->nFilledLen = 0;
+    return;
   }
 
-  sws_scale(imgConvertYuvCtx, omx_ffmpeg_colorconv_component_Private->in_frame->data,
+  sws_scale(omx_ffmpeg_colorconv_component_Private->imgConvertYuvCtx, omx_ffmpeg_colorconv_component_Private->in_frame->data,
             omx_ffmpeg_colorconv_component_Private->in_frame->linesize, 0,
-            input_src_height,
+            input_dest_height,
             omx_ffmpeg_colorconv_component_Private->conv_frame->data,
             omx_ffmpeg_colorconv_component_Private->conv_frame->linesize );
 
@@ -1080,11 +1231,16 @@ OMX_ERRORTYPE omx_ffmpeg_colorconv_component_SetParameter(
       //  Figure out stride, slice height, min buffer size
       pPort->sPortParam.format.video.nStride = calcStride(pPort->sPortParam.format.video.nFrameWidth, pPort->sVideoParam.eColorFormat);
       pPort->sPortParam.format.video.nSliceHeight = pPort->sPortParam.format.video.nFrameHeight;  //  No support for slices yet
+      //  A slice height set above the frame height describes padding rows, such as the ones of a decoder
+      if (pPortDef->format.video.nSliceHeight > pPort->sPortParam.format.video.nFrameHeight) {
+        pPort->sPortParam.format.video.nSliceHeight = pPortDef->format.video.nSliceHeight;
+      }
       // Read-only field by spec
       pPort->sPortParam.nBufferSize = (OMX_U32) abs(pPort->sPortParam.format.video.nStride) * pPort->sPortParam.format.video.nSliceHeight;
       pPort->omxConfigCrop.nWidth = pPort->sPortParam.format.video.nFrameWidth;
       pPort->omxConfigCrop.nHeight = pPort->sPortParam.format.video.nFrameHeight;
       pPort->ffmpeg_pxlfmt = find_ffmpeg_pxlfmt(pPort->sVideoParam.eColorFormat);
+      omx_ffmpeg_colorconv_component_FreeSwsContext(omx_ffmpeg_colorconv_component_Private);
       break;
     case OMX_IndexParamVideoPortFormat:
       //  FIXME: How do we handle the nIndex member?
@@ -1110,10 +1266,13 @@ OMX_ERRORTYPE omx_ffmpeg_colorconv_component_SetParameter(
           * so return bad parameter error to user application */
         return OMX_ErrorBadParameter;
       }
-      //  Figure out stride, slice height, min buffer size
+      //  Figure out stride, slice height, min buffer size. The padding rows set with the port definition are kept
       pPort->sPortParam.format.video.nStride = calcStride(pPort->sPortParam.format.video.nFrameWidth, pPort->sVideoParam.eColorFormat);
-      pPort->sPortParam.format.video.nSliceHeight = pPort->sPortParam.format.video.nFrameHeight;  //  No support for slices yet
+      if (pPort->sPortParam.format.video.nSliceHeight < pPort->sPortParam.format.video.nFrameHeight) {
+        pPort->sPortParam.format.video.nSliceHeight = pPort->sPortParam.format.video.nFrameHeight;  //  No support for slices yet
+      }
       pPort->sPortParam.nBufferSize = (OMX_U32) abs(pPort->sPortParam.format.video.nStride) * pPort->sPortParam.format.video.nSliceHeight;
+      omx_ffmpeg_colorconv_component_FreeSwsContext(omx_ffmpeg_colorconv_component_Private);
       break;
     case OMX_IndexParamStandardComponentRole:
       pComponentRole = (OMX_PARAM_COMPONENTROLETYPE*)ComponentParameterStructure;
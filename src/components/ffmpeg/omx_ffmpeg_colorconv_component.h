@@ -95,7 +95,9 @@ DERIVEDCLASS(omx_ffmpeg_colorconv_component_PrivateType, omx_base_filter_Private
   /** @param in_alloc_size Allocated size of the input buffer */ \
   unsigned int in_alloc_size; \
   /** @param conv_alloc_size Allocated size of the conversion buffer */ \
-  unsigned int conv_alloc_size;
+  unsigned int conv_alloc_size; \
+  /** @param imgConvertYuvCtx swscale context of the conversion, kept across buffers of the same size and formats */ \
+  struct SwsContext *imgConvertYuvCtx;
 ENDCLASS(omx_ffmpeg_colorconv_component_PrivateType)
 
 /* Component private entry points declaration */
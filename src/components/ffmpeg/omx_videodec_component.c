@@ -31,6 +31,7 @@
 #include <omx_base_video_port.h>
 #include <omx_videodec_component.h>
 #include<OMX_Video.h>
+#include <unistd.h>
 
 /** Maximum Number of Video Component Instance*/
 #define MAX_COMPONENT_VIDEODEC 4
@@ -114,6 +115,10 @@ OMX_ERRORTYPE omx_videodec_component_Constructor(OMX_COMPONENTTYPE *openmaxStand
   outPort->sVideoParam.eColorFormat = OUTPUT_DECODED_COLOR_FMT;
   outPort->sVideoParam.xFramerate = 25;
 
+  /** Gives the output buffers back their payloads before freeing them */
+  outPort->Port_FreeTunnelBuffer = omx_videodec_component_FreeTunnelBuffer;
+  outPort->Port_FreeBuffer = omx_videodec_component_FreeBuffer;
+
   /** now it's time to know the video coding type of the component */
   if(!strcmp(cComponentName, VIDEO_DEC_MPEG4_NAME)) {
     omx_videodec_component_Private->video_coding_type = OMX_VIDEO_CodingMPEG4;
@@ -152,7 +157,18 @@ OMX_ERRORTYPE omx_videodec_component_Constructor(OMX_COMPONENTTYPE *openmaxStand
   omx_videodec_component_Private->avcodecReady = OMX_FALSE;
   omx_videodec_component_Private->extradata = NULL;
   omx_videodec_component_Private->extradata_size = 0;
+  omx_videodec_component_Private->imgConvertYuvCtx = NULL;
+  omx_videodec_component_Private->bZeroCopy = OMX_FALSE;
+  omx_videodec_component_Private->pFrames = NULL;
+  omx_videodec_component_Private->nFrames = 0;
+  omx_videodec_component_Private->nDecodeThreads = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+  if (omx_videodec_component_Private->nDecodeThreads > MAX_VIDEO_DEC_THREADS) {
+    omx_videodec_component_Private->nDecodeThreads = MAX_VIDEO_DEC_THREADS;
+  }
   omx_videodec_component_Private->BufferMgmtCallback = omx_videodec_component_BufferMgmtCallback;
+  omx_videodec_component_Private->BufferMgmtFlushCallback = omx_videodec_component_BufferMgmtFlushCallback;
+  /** The frames delayed by the decoding threads and the B-frames are drained at EOS */
+  omx_videodec_component_Private->bDrainOnEOS = OMX_TRUE;
 
   /** initializing the codec context etc that was done earlier by ffmpeglibinit function */
   omx_videodec_component_Private->messageHandler = omx_videodec_component_MessageHandler;
@@ -160,7 +176,8 @@ OMX_ERRORTYPE omx_videodec_component_Constructor(OMX_COMPONENTTYPE *openmaxStand
   openmaxStandComp->SetParameter = omx_videodec_component_SetParameter;
   openmaxStandComp->GetParameter = omx_videodec_component_GetParameter;
   openmaxStandComp->ComponentRoleEnum = omx_videodec_component_ComponentRoleEnum;
-  
+  openmaxStandComp->GetExtensionIndex = omx_videodec_component_GetExtensionIndex;
+
   noVideoDecInstance++;
 
   if(noVideoDecInstance > MAX_COMPONENT_VIDEODEC) {
@@ -170,6 +187,268 @@ OMX_ERRORTYPE omx_videodec_component_Constructor(OMX_COMPONENTTYPE *openmaxStand
 }
 
 
+/** Frees the swscale context, so that the next frame builds one for the
+  * new frame size or output pixel format
+  */
+static void omx_videodec_component_FreeSwsContext(omx_videodec_component_PrivateType* omx_videodec_component_Private) {
+  if (omx_videodec_component_Private->imgConvertYuvCtx) {
+    sws_freeContext(omx_videodec_component_Private->imgConvertYuvCtx);
+    omx_videodec_component_Private->imgConvertYuvCtx = NULL;
+  }
+}
+
+/** Returns the pool payload attached to an output buffer header, NULL if
+  * the header carries the payload it was allocated with
+  */
+static omx_videodec_frame_type* omx_videodec_component_FindFrame(omx_videodec_component_PrivateType* omx_videodec_component_Private, OMX_BUFFERHEADERTYPE* pHeader) {
+  OMX_U32 i;
+
+  for (i = 0; i < omx_videodec_component_Private->nFrames; i++) {
+    if (omx_videodec_component_Private->pFrames[i].pBuffer && omx_videodec_component_Private->pFrames[i].pHeader == pHeader) {
+      return &omx_videodec_component_Private->pFrames[i];
+    }
+  }
+  return NULL;
+}
+
+/** Returns a pool payload of at least nSize bytes that nothing uses,
+  * allocating one if there is none. The entries never move, the codec keeps
+  * pointers to them
+  *
+  * @return NULL if the pool is full or the memory is exhausted
+  */
+static omx_videodec_frame_type* omx_videodec_component_GetFreeFrame(omx_videodec_component_PrivateType* omx_videodec_component_Private, OMX_U32 nSize) {
+  omx_videodec_frame_type* pFrame = NULL;
+  OMX_U32 i;
+
+  for (i = 0; i < omx_videodec_component_Private->nFrames; i++) {
+    if (omx_videodec_component_Private->pFrames[i].pBuffer == NULL) {
+      if (pFrame == NULL) {
+        pFrame = &omx_videodec_component_Private->pFrames[i];
+      }
+    } else if (omx_videodec_component_Private->pFrames[i].nReferences == 0 && omx_videodec_component_Private->pFrames[i].pHeader == NULL &&
+               omx_videodec_component_Private->pFrames[i].nSize >= nSize) {
+      return &omx_videodec_component_Private->pFrames[i];
+    }
+  }
+  if (pFrame == NULL) {
+    if (omx_videodec_component_Private->nFrames == MAX_VIDEO_DEC_FRAMES) {
+      return NULL;
+    }
+    pFrame = &omx_videodec_component_Private->pFrames[omx_videodec_component_Private->nFrames++];
+  }
+  pFrame->pBuffer = av_malloc(nSize);
+  if (pFrame->pBuffer == NULL) {
+    return NULL;
+  }
+  pFrame->nSize = nSize;
+  pFrame->nReferences = 0;
+  pFrame->pHeader = NULL;
+  return pFrame;
+}
+
+/** Frees the pool payloads that neither the codec nor a header uses */
+static void omx_videodec_component_FreeUnusedFrames(omx_videodec_component_PrivateType* omx_videodec_component_Private) {
+  omx_videodec_frame_type* pFrame;
+  OMX_U32 i;
+
+  for (i = 0; i < omx_videodec_component_Private->nFrames; i++) {
+    pFrame = &omx_videodec_component_Private->pFrames[i];
+    if (pFrame->pBuffer && pFrame->nReferences == 0 && pFrame->pHeader == NULL) {
+      av_free(pFrame->pBuffer);
+      pFrame->pBuffer = NULL;
+    }
+  }
+}
+
+/** Attaches a pool payload to an output buffer header. The payload the
+  * header was allocated with is kept aside, a pool payload it carried goes
+  * back to the pool
+  *
+  * @return OMX_FALSE if no more payload can be kept aside
+  */
+static OMX_BOOL omx_videodec_component_AttachFrame(omx_videodec_component_PrivateType* omx_videodec_component_Private, OMX_BUFFERHEADERTYPE* pHeader, omx_videodec_frame_type* pFrame) {
+  omx_videodec_frame_type* pOld = omx_videodec_component_FindFrame(omx_videodec_component_Private, pHeader);
+  omx_videodec_payload_type* pPayload;
+
+  if (pOld) {
+    pOld->pHeader = NULL;
+  } else {
+    if (omx_videodec_component_Private->nPayloads == MAX_VIDEO_DEC_FRAMES) {
+      return OMX_FALSE;
+    }
+    pPayload = &omx_videodec_component_Private->pPayloads[omx_videodec_component_Private->nPayloads++];
+    pPayload->pHeader = pHeader;
+    pPayload->pBuffer = pHeader->pBuffer;
+  }
+  pFrame->pHeader = pHeader;
+  pHeader->pBuffer = pFrame->pBuffer;
+  return OMX_TRUE;
+}
+
+/** Gives an output buffer header back the payload it was allocated with,
+  * if it carries a pool payload. Only done while the header is with the
+  * component, never while a tunneled component may read it
+  */
+static void omx_videodec_component_RestorePayload(omx_videodec_component_PrivateType* omx_videodec_component_Private, OMX_BUFFERHEADERTYPE* pHeader) {
+  omx_videodec_frame_type* pFrame = omx_videodec_component_FindFrame(omx_videodec_component_Private, pHeader);
+  OMX_U32 i;
+
+  if (pFrame == NULL) {
+    return;
+  }
+  pFrame->pHeader = NULL;
+  for (i = 0; i < omx_videodec_component_Private->nPayloads; i++) {
+    if (omx_videodec_component_Private->pPayloads[i].pHeader == pHeader) {
+      pHeader->pBuffer = omx_videodec_component_Private->pPayloads[i].pBuffer;
+      omx_videodec_component_Private->pPayloads[i] = omx_videodec_component_Private->pPayloads[--omx_videodec_component_Private->nPayloads];
+      break;
+    }
+  }
+}
+
+/** Makes sure the payload of an output buffer header can be written. If the
+  * codec still uses the pool payload it carries, the header gets its own
+  * payload back, which the codec never uses
+  */
+static void omx_videodec_component_OwnOutputBuffer(omx_videodec_component_PrivateType* omx_videodec_component_Private, OMX_BUFFERHEADERTYPE* pHeader) {
+  omx_videodec_frame_type* pFrame = omx_videodec_component_FindFrame(omx_videodec_component_Private, pHeader);
+
+  if (pFrame && pFrame->nReferences > 0) {
+    omx_videodec_component_RestorePayload(omx_videodec_component_Private, pHeader);
+  }
+}
+
+/** Gives all the headers of the output port the payloads they were
+  * allocated with back. The buffers are all back in the port when it frees
+  * them
+  */
+static void omx_videodec_component_RestorePayloads(omx_base_PortType *openmaxStandPort) {
+  omx_videodec_component_PrivateType* omx_videodec_component_Private = openmaxStandPort->standCompContainer->pComponentPrivate;
+  OMX_U32 i;
+
+  if (omx_videodec_component_Private->pFrames && openmaxStandPort->pInternalBufferStorage) {
+    for (i = 0; i < openmaxStandPort->sPortParam.nBufferCountActual; i++) {
+      if (openmaxStandPort->pInternalBufferStorage[i]) {
+        omx_videodec_component_RestorePayload(omx_videodec_component_Private, openmaxStandPort->pInternalBufferStorage[i]);
+      }
+    }
+    omx_videodec_component_FreeUnusedFrames(omx_videodec_component_Private);
+  }
+}
+
+/** Frees the buffers of the output port when it supplies them to its tunnel */
+OMX_ERRORTYPE omx_videodec_component_FreeTunnelBuffer(omx_base_PortType *openmaxStandPort, OMX_U32 nPortIndex) {
+  omx_videodec_component_RestorePayloads(openmaxStandPort);
+  return base_port_FreeTunnelBuffer(openmaxStandPort, nPortIndex);
+}
+
+/** Frees a buffer of the output port when the client or the tunneled
+  * component supplies them. The headers are freed in any order, so none
+  * may keep a pool payload
+  */
+OMX_ERRORTYPE omx_videodec_component_FreeBuffer(omx_base_PortType *openmaxStandPort, OMX_U32 nPortIndex, OMX_BUFFERHEADERTYPE* pBuffer) {
+  if (nPortIndex == openmaxStandPort->sPortParam.nPortIndex) {
+    omx_videodec_component_RestorePayloads(openmaxStandPort);
+  }
+  return base_port_FreeBuffer(openmaxStandPort, nPortIndex, pBuffer);
+}
+
+/** Gives the layout of the YUV 4:2:0 pictures sent: with padding rows when
+  * the tunneled component takes the slice height the output port describes,
+  * else just as big as the picture
+  */
+static void omx_videodec_component_OutLayout(omx_videodec_component_PrivateType* omx_videodec_component_Private, OMX_U32* pStride, OMX_U32* pSliceHeight) {
+  *pStride = omx_videodec_component_Private->avCodecContext->width;
+  if (omx_videodec_component_Private->nOutSliceHeight) {
+    *pSliceHeight = omx_videodec_component_Private->nOutSliceHeight;
+  } else {
+    *pSliceHeight = omx_videodec_component_Private->avCodecContext->height;
+  }
+}
+
+/** Pads the pictures sent when the tunneled input port has taken the slice
+  * height of the output port. Checked whenever the output port is enabled,
+  * as the client sets the tunneled port up in between
+  */
+static void omx_videodec_component_UpdateOutLayout(omx_videodec_component_PrivateType* omx_videodec_component_Private) {
+  omx_base_video_PortType *outPort = (omx_base_video_PortType *)omx_videodec_component_Private->ports[OMX_BASE_FILTER_OUTPUTPORT_INDEX];
+  OMX_PARAM_PORTDEFINITIONTYPE sPortDef;
+
+  omx_videodec_component_Private->nOutSliceHeight = 0;
+  if (!omx_videodec_component_Private->bZeroCopy || !PORT_IS_TUNNELED(outPort) ||
+      outPort->sPortParam.format.video.nSliceHeight <= outPort->sPortParam.format.video.nFrameHeight) {
+    return;
+  }
+  setHeader(&sPortDef, sizeof(OMX_PARAM_PORTDEFINITIONTYPE));
+  sPortDef.nPortIndex = outPort->nTunneledPort;
+  if (OMX_GetParameter(outPort->hTunneledComponent, OMX_IndexParamPortDefinition, &sPortDef) == OMX_ErrorNone &&
+      sPortDef.format.video.nFrameWidth == outPort->sPortParam.format.video.nFrameWidth &&
+      sPortDef.format.video.nSliceHeight == outPort->sPortParam.format.video.nSliceHeight) {
+    omx_videodec_component_Private->nOutSliceHeight = outPort->sPortParam.format.video.nSliceHeight;
+  }
+  DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s pictures sent with slice height %d\n", __func__, (int)omx_videodec_component_Private->nOutSliceHeight);
+}
+
+/** Hands the codec a pool payload laid out as the output port sends the
+  * frames, so that the decoded picture can be sent without being copied.
+  * Falls back to the default buffers when the layouts differ
+  */
+static int omx_videodec_component_GetBuffer(AVCodecContext *avCodecContext, AVFrame *pic) {
+  omx_videodec_component_PrivateType* omx_videodec_component_Private = avCodecContext->opaque;
+  omx_videodec_frame_type* pFrame;
+  int nWidth = avCodecContext->width;
+  int nHeight = avCodecContext->height;
+  OMX_U32 nStride;
+  OMX_U32 nSliceHeight;
+  OMX_U32 nSize;
+
+  omx_videodec_component_OutLayout(omx_videodec_component_Private, &nStride, &nSliceHeight);
+  /* No edges: the layout must hold the dimensions aligned as the codec needs, and align the chroma rows too */
+  avcodec_align_dimensions(avCodecContext, &nWidth, &nHeight);
+  if (avCodecContext->pix_fmt != PIX_FMT_YUV420P || omx_videodec_component_Private->eOutFramePixFmt != PIX_FMT_YUV420P ||
+      nStride < (OMX_U32)nWidth || nSliceHeight < (OMX_U32)nHeight || (nStride & 31) || (nSliceHeight & 1)) {
+    return avcodec_default_get_buffer(avCodecContext, pic);
+  }
+  nSize = nStride * nSliceHeight * 3 / 2;
+  pFrame = omx_videodec_component_GetFreeFrame(omx_videodec_component_Private,
+                                               nSize > omx_videodec_component_Private->nFrameAllocLen ? nSize : omx_videodec_component_Private->nFrameAllocLen);
+  if (pFrame == NULL) {
+    return avcodec_default_get_buffer(avCodecContext, pic);
+  }
+  pFrame->nReferences++;
+  pFrame->nStride = nStride;
+  pFrame->nSliceHeight = nSliceHeight;
+
+  pic->type = FF_BUFFER_TYPE_USER;
+  pic->opaque = pFrame;
+  /* The payload holds no previous picture the codec could reuse */
+  pic->age = 256*256*256*64;
+  pic->data[0] = pic->base[0] = pFrame->pBuffer;
+  pic->data[1] = pic->base[1] = pFrame->pBuffer + nStride * nSliceHeight;
+  pic->data[2] = pic->base[2] = pFrame->pBuffer + nStride * nSliceHeight * 5 / 4;
+  pic->data[3] = pic->base[3] = NULL;
+  pic->linesize[0] = nStride;
+  pic->linesize[1] = pic->linesize[2] = nStride / 2;
+  pic->linesize[3] = 0;
+  return 0;
+}
+
+/** Takes back a picture the codec no longer needs */
+static void omx_videodec_component_ReleaseBuffer(AVCodecContext *avCodecContext, AVFrame *pic) {
+  omx_videodec_frame_type* pFrame = pic->opaque;
+  int i;
+
+  if (pic->type != FF_BUFFER_TYPE_USER) {
+    avcodec_default_release_buffer(avCodecContext, pic);
+    return;
+  }
+  pFrame->nReferences--;
+  for (i = 0; i < 4; i++) {
+    pic->data[i] = NULL;
+  }
+}
+
 /** The destructor of the video decoder component
   */
 OMX_ERRORTYPE omx_videodec_component_Destructor(OMX_COMPONENTTYPE *openmaxStandComp) {
@@ -181,6 +460,24 @@ OMX_ERRORTYPE omx_videodec_component_Destructor(OMX_COMPONENTTYPE *openmaxStandC
     omx_videodec_component_Private->extradata=NULL;
   }
 
+  omx_videodec_component_FreeSwsContext(omx_videodec_component_Private);
+
+  if (omx_videodec_component_Private->pFrames) {
+    for (i = 0; i < omx_videodec_component_Private->nFrames; i++) {
+      if (omx_videodec_component_Private->pFrames[i].pBuffer) {
+        av_free(omx_videodec_component_Private->pFrames[i].pBuffer);
+      }
+    }
+    free(omx_videodec_component_Private->pFrames);
+    omx_videodec_component_Private->pFrames = NULL;
+    omx_videodec_component_Private->nFrames = 0;
+  }
+  if (omx_videodec_component_Private->pPayloads) {
+    free(omx_videodec_component_Private->pPayloads);
+    omx_videodec_component_Private->pPayloads = NULL;
+    omx_videodec_component_Private->nPayloads = 0;
+  }
+
   if(omx_videodec_component_Private->avCodecSyncSem) {
     tsem_deinit(omx_videodec_component_Private->avCodecSyncSem);
     free(omx_videodec_component_Private->avCodecSyncSem);
@@ -212,6 +509,8 @@ OMX_ERRORTYPE omx_videodec_component_Destructor(OMX_COMPONENTTYPE *openmaxStandC
 OMX_ERRORTYPE omx_videodec_component_ffmpegLibInit(omx_videodec_component_PrivateType* omx_videodec_component_Private) {
 
   OMX_U32 target_codecID;
+  omx_base_PortType *outPort;
+  OMX_U32 i;
   avcodec_init();
   av_register_all();
 
@@ -238,6 +537,38 @@ OMX_ERRORTYPE omx_videodec_component_ffmpegLibInit(omx_videodec_component_Privat
 
   omx_videodec_component_Private->avCodecContext = avcodec_alloc_context();
 
+  /** Zero-copy decoding: the decoded pictures are sent in their own payloads, swapped into the output buffer headers.
+    * Only done when the output port is tunneled, as the tunneled component then always gives the headers back,
+    * whichever port supplies them. The payloads the headers were allocated with are never given to the codec.
+    * The pool outlives the codec, as headers sent downstream may still carry its payloads.
+    * Pictures the codec pads, such as 1088 rows for 1080p H.264, are sent padded when the tunneled port takes
+    * the slice height of the output port, and are copied otherwise
+    */
+  outPort = omx_videodec_component_Private->ports[OMX_BASE_FILTER_OUTPUTPORT_INDEX];
+  omx_videodec_component_Private->bZeroCopy = OMX_FALSE;
+  omx_videodec_component_Private->nOutSliceHeight = 0;
+  if (PORT_IS_TUNNELED(outPort) && omx_videodec_component_Private->eOutFramePixFmt == PIX_FMT_YUV420P) {
+    if (omx_videodec_component_Private->pFrames == NULL) {
+      omx_videodec_component_Private->pFrames = calloc(MAX_VIDEO_DEC_FRAMES, sizeof(omx_videodec_frame_type));
+    }
+    if (omx_videodec_component_Private->pPayloads == NULL) {
+      omx_videodec_component_Private->pPayloads = calloc(MAX_VIDEO_DEC_FRAMES, sizeof(omx_videodec_payload_type));
+    }
+    if (omx_videodec_component_Private->pFrames && omx_videodec_component_Private->pPayloads) {
+      omx_videodec_component_Private->bZeroCopy = OMX_TRUE;
+      omx_videodec_component_Private->nFrameAllocLen = outPort->sPortParam.nBufferSize;
+      for (i = 0; i < outPort->sPortParam.nBufferCountActual; i++) {
+        if (outPort->pInternalBufferStorage[i] && outPort->pInternalBufferStorage[i]->nAllocLen > omx_videodec_component_Private->nFrameAllocLen) {
+          omx_videodec_component_Private->nFrameAllocLen = outPort->pInternalBufferStorage[i]->nAllocLen;
+        }
+      }
+      omx_videodec_component_Private->avCodecContext->opaque = omx_videodec_component_Private;
+      omx_videodec_component_Private->avCodecContext->get_buffer = omx_videodec_component_GetBuffer;
+      omx_videodec_component_Private->avCodecContext->release_buffer = omx_videodec_component_ReleaseBuffer;
+      omx_videodec_component_Private->avCodecContext->flags |= CODEC_FLAG_EMU_EDGE;
+    }
+  }
+
   /** necessary flags for MPEG-4 or H.264 stream */
   omx_videodec_component_Private->avFrame = avcodec_alloc_frame();
   if(omx_videodec_component_Private->extradata_size >0) {
@@ -247,8 +578,27 @@ OMX_ERRORTYPE omx_videodec_component_ffmpegLibInit(omx_videodec_component_Privat
     omx_videodec_component_Private->avCodecContext->flags |= CODEC_FLAG_TRUNCATED;
   }
 
+  /** Frame threading delays the output by a frame per thread. libavcodec disables it for truncated streams, so
+   * the raw elementary streams, which come without extradata, only get slice threading: single slice H.264 is not faster
+   */
+  if (omx_videodec_component_Private->nDecodeThreads > 1) {
+#ifdef FF_THREAD_FRAME
+    omx_videodec_component_Private->avCodecContext->thread_count = omx_videodec_component_Private->nDecodeThreads;
+    omx_videodec_component_Private->avCodecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+#else
+    if (avcodec_thread_init(omx_videodec_component_Private->avCodecContext, omx_videodec_component_Private->nDecodeThreads) < 0) {
+      DEBUG(DEB_LEV_ERR, "Could not start %d decoding threads, decoding on one\n", (int)omx_videodec_component_Private->nDecodeThreads);
+    }
+#endif
+  }
+
   if (avcodec_open(omx_videodec_component_Private->avCodecContext, omx_videodec_component_Private->avCodec) < 0) {
     DEBUG(DEB_LEV_ERR, "Could not open codec\n");
+    av_free(omx_videodec_component_Private->avCodecContext);
+    omx_videodec_component_Private->avCodecContext = NULL;
+    av_free(omx_videodec_component_Private->avFrame);
+    omx_videodec_component_Private->avFrame = NULL;
+    omx_videodec_component_Private->bZeroCopy = OMX_FALSE;
     return OMX_ErrorInsufficientResources;
   }
   DEBUG(DEB_LEV_SIMPLE_SEQ, "done\n");
@@ -270,9 +620,18 @@ void omx_videodec_component_ffmpegLibDeInit(omx_videodec_component_PrivateType*
     //omx_videodec_component_Private->avCodecContext->extradata_size = 0;
   }
   av_free (omx_videodec_component_Private->avCodecContext);
+  omx_videodec_component_Private->avCodecContext = NULL;
+
+  /* The payloads sent downstream stay attached to their headers until the port frees them */
+  if (omx_videodec_component_Private->bZeroCopy) {
+    omx_videodec_component_FreeUnusedFrames(omx_videodec_component_Private);
+    omx_videodec_component_Private->bZeroCopy = OMX_FALSE;
+  }
 
   av_free(omx_videodec_component_Private->avFrame);
+  omx_videodec_component_Private->avFrame = NULL;
 
+  omx_videodec_component_FreeSwsContext(omx_videodec_component_Private);
 }
 
 /** internal function to set codec related parameters in the private type structure
@@ -380,25 +739,43 @@ OMX_ERRORTYPE omx_videodec_component_Deinit(OMX_COMPONENTTYPE *openmaxStandComp)
 }
 
 /** Executes all the required steps after an output buffer frame-size has changed.
+  * When the codec decodes in place and pads the pictures, the slice height
+  * of the output port describes the padding rows
 */
 static inline void UpdateFrameSize(OMX_COMPONENTTYPE *openmaxStandComp) {
   omx_videodec_component_PrivateType* omx_videodec_component_Private = openmaxStandComp->pComponentPrivate;
   omx_base_video_PortType *outPort = (omx_base_video_PortType *)omx_videodec_component_Private->ports[OMX_BASE_FILTER_OUTPUTPORT_INDEX];
   omx_base_video_PortType *inPort = (omx_base_video_PortType *)omx_videodec_component_Private->ports[OMX_BASE_FILTER_INPUTPORT_INDEX];
+  int nWidth = inPort->sPortParam.format.video.nFrameWidth;
+  int nHeight = inPort->sPortParam.format.video.nFrameHeight;
+  OMX_U32 nSliceHeight = inPort->sPortParam.format.video.nFrameHeight;
   outPort->sPortParam.format.video.nFrameWidth = inPort->sPortParam.format.video.nFrameWidth;
   outPort->sPortParam.format.video.nFrameHeight = inPort->sPortParam.format.video.nFrameHeight;
   switch(outPort->sVideoParam.eColorFormat) {
     case OMX_COLOR_FormatYUV420Planar:
+      /* Only padding rows are described, the tunneled components lay the planes out with the frame width */
+      if (omx_videodec_component_Private->bZeroCopy && omx_videodec_component_Private->avcodecReady) {
+        avcodec_align_dimensions(omx_videodec_component_Private->avCodecContext, &nWidth, &nHeight);
+        if ((OMX_U32)nWidth == outPort->sPortParam.format.video.nFrameWidth && !(nWidth & 31)) {
+          nSliceHeight = (nHeight + 1) & ~1;
+        }
+      }
+      outPort->sPortParam.format.video.nStride = outPort->sPortParam.format.video.nFrameWidth;
+      outPort->sPortParam.format.video.nSliceHeight = nSliceHeight;
       if(outPort->sPortParam.format.video.nFrameWidth && outPort->sPortParam.format.video.nFrameHeight) {
-        outPort->sPortParam.nBufferSize = outPort->sPortParam.format.video.nFrameWidth * outPort->sPortParam.format.video.nFrameHeight * 3/2;
+        outPort->sPortParam.nBufferSize = outPort->sPortParam.format.video.nFrameWidth * nSliceHeight * 3/2;
       }
       break;
     default:
+      outPort->sPortParam.format.video.nStride = 0;
+      outPort->sPortParam.format.video.nSliceHeight = 0;
       if(outPort->sPortParam.format.video.nFrameWidth && outPort->sPortParam.format.video.nFrameHeight) {
         outPort->sPortParam.nBufferSize = outPort->sPortParam.format.video.nFrameWidth * outPort->sPortParam.format.video.nFrameHeight * 3;
       }
       break;
   }
+  /* The tunneled port takes the new layout when the output port is enabled again */
+  omx_videodec_component_Private->nOutSliceHeight = 0;
 }
 
 /** This function is used to process the input buffer and provide one output buffer
@@ -410,10 +787,12 @@ void omx_videodec_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandCo
 
   OMX_S32 nOutputFilled = 0;
   OMX_U8* outputCurrBuffer;
+  omx_videodec_frame_type* pFrame;
   int nLen = 0;
   int internalOutputFilled=0;
   int nSize;
-  struct SwsContext *imgConvertYuvCtx = NULL;
+  OMX_U32 nStride;
+  OMX_U32 nSliceHeight;
   OMX_ERRORTYPE err;
 
   if(omx_videodec_component_Private->isFirstBuffer == OMX_TRUE) {
@@ -448,6 +827,13 @@ void omx_videodec_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandCo
     }
   }
 
+  if (!omx_videodec_component_Private->avcodecReady) {
+    /* The codec could not be opened: the input is dropped */
+    pInputBuffer->nFilledLen = 0;
+    pOutputBuffer->nFilledLen = 0;
+    return;
+  }
+
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
   /** Fill up the current input buffer when a new buffer has arrived */
   if(omx_videodec_component_Private->isNewBuffer) {
@@ -457,7 +843,6 @@ void omx_videodec_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandCo
     DEBUG(DEB_LEV_FULL_SEQ, "New Buffer FilledLen = %d\n", (int)pInputBuffer->nFilledLen);
   }
 
-  outputCurrBuffer = pOutputBuffer->pBuffer;
   pOutputBuffer->nFilledLen = 0;
   pOutputBuffer->nOffset = 0;
 
@@ -492,6 +877,7 @@ void omx_videodec_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandCo
         }
 
         UpdateFrameSize (openmaxStandComp);
+        omx_videodec_component_FreeSwsContext(omx_videodec_component_Private);
 
         /** Send Port Settings changed call back */
         (*(omx_videodec_component_Private->callbacks->EventHandler))
@@ -514,44 +900,83 @@ void omx_videodec_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandCo
         omx_videodec_component_Private->isNewBuffer = 1;
       }
 
-      nSize = avpicture_get_size (omx_videodec_component_Private->eOutFramePixFmt,
-                                  omx_videodec_component_Private->avCodecContext->width,
-                                  omx_videodec_component_Private->avCodecContext->height);
+      /* Padded pictures are only sent in YUV 4:2:0, the layout the codec decodes in place */
+      if (omx_videodec_component_Private->bZeroCopy) {
+        omx_videodec_component_OutLayout(omx_videodec_component_Private, &nStride, &nSliceHeight);
+      } else {
+        nStride = omx_videodec_component_Private->avCodecContext->width;
+        nSliceHeight = omx_videodec_component_Private->avCodecContext->height;
+      }
+      nSize = avpicture_get_size (omx_videodec_component_Private->eOutFramePixFmt, nStride, nSliceHeight);
 
       if(pOutputBuffer->nAllocLen < nSize) {
         DEBUG(DEB_LEV_ERR, "Ouch!!!! Output buffer Alloc Len %d less than Frame Size %d\n",(int)pOutputBuffer->nAllocLen,nSize);
         return;
       }
 
-      avpicture_fill (&pic, (unsigned char*)(outputCurrBuffer),
-                      omx_videodec_component_Private->eOutFramePixFmt,
-                      omx_videodec_component_Private->avCodecContext->width,
-                      omx_videodec_component_Private->avCodecContext->height);
-
-      if ( !imgConvertYuvCtx ) {
-        imgConvertYuvCtx = sws_getContext( omx_videodec_component_Private->avCodecContext->width,
-                                              omx_videodec_component_Private->avCodecContext->height,
-                                              omx_videodec_component_Private->avCodecContext->pix_fmt,
-                                              omx_videodec_component_Private->avCodecContext->width,
-                                              omx_videodec_component_Private->avCodecContext->height,
-                                              omx_videodec_component_Private->eOutFramePixFmt, SWS_FAST_BILINEAR, NULL, NULL, NULL );
-      }
+      pFrame = omx_videodec_component_Private->avFrame->opaque;
+      if (omx_videodec_component_Private->bZeroCopy && omx_videodec_component_Private->avFrame->type == FF_BUFFER_TYPE_USER &&
+          pFrame->pHeader == NULL && pFrame->nSize >= pOutputBuffer->nAllocLen &&
+          pFrame->nStride == nStride && pFrame->nSliceHeight == nSliceHeight &&
+          omx_videodec_component_AttachFrame(omx_videodec_component_Private, pOutputBuffer, pFrame)) {
+        /* The picture leaves in the payload it was decoded into */
+        DEBUG(DEB_LEV_FULL_SEQ, "nSize=%d sent without copy\n", nSize);
+      } else {
+        /* The codec may still hold the picture last sent in this buffer */
+        if (omx_videodec_component_Private->bZeroCopy) {
+          omx_videodec_component_OwnOutputBuffer(omx_videodec_component_Private, pOutputBuffer);
+        }
+        outputCurrBuffer = pOutputBuffer->pBuffer;
+
+        /* Only the picture is written, the padding rows are left as they are */
+        avpicture_fill (&pic, (unsigned char*)(outputCurrBuffer),
+                        omx_videodec_component_Private->eOutFramePixFmt, nStride, nSliceHeight);
+
+        /* The scaler filters are only computed again when the size or the formats change */
+        omx_videodec_component_Private->imgConvertYuvCtx = sws_getCachedContext(omx_videodec_component_Private->imgConvertYuvCtx,
+                                                omx_videodec_component_Private->avCodecContext->width,
+                                                omx_videodec_component_Private->avCodecContext->height,
+                                                omx_videodec_component_Private->avCodecContext->pix_fmt,
+                                                omx_videodec_component_Private->avCodecContext->width,
+                                                omx_videodec_component_Private->avCodecContext->height,
+                                                omx_videodec_component_Private->eOutFramePixFmt, SWS_FAST_BILINEAR, NULL, NULL, NULL );
+        if (!omx_videodec_component_Private->imgConvertYuvCtx) {
+          DEBUG(DEB_LEV_ERR, "In %s cannot convert pixel format %d to %d\n", __func__,
+                omx_videodec_component_Private->avCodecContext->pix_fmt, omx_videodec_component_Private->eOutFramePixFmt);
+          /* The input is consumed but no picture can be output: the client must know */
+          (*(omx_videodec_component_Private->callbacks->EventHandler))
+            (openmaxStandComp,
+             omx_videodec_component_Private->callbackData,
+             OMX_EventError, /* The picture could not be converted */
+             OMX_ErrorInsufficientResources, /* No scaler context */
+             OMX_BASE_FILTER_OUTPUTPORT_INDEX, /* This is the output port index */
+             NULL);
+          return;
+        }
 
-      sws_scale(imgConvertYuvCtx, omx_videodec_component_Private->avFrame->data,
-                omx_videodec_component_Private->avFrame->linesize, 0,
-                omx_videodec_component_Private->avCodecContext->height, pic.data, pic.linesize );
+        sws_scale(omx_videodec_component_Private->imgConvertYuvCtx, omx_videodec_component_Private->avFrame->data,
+                  omx_videodec_component_Private->avFrame->linesize, 0,
+                  omx_videodec_component_Private->avCodecContext->height, pic.data, pic.linesize );
 
-      if (imgConvertYuvCtx ) {
-        sws_freeContext(imgConvertYuvCtx);
+        DEBUG(DEB_LEV_FULL_SEQ, "nSize=%d,frame linesize=%d,height=%d,pic linesize=%d PixFmt=%d\n",nSize,
+          omx_videodec_component_Private->avFrame->linesize[0],
+          omx_videodec_component_Private->avCodecContext->height,
+          pic.linesize[0],omx_videodec_component_Private->eOutFramePixFmt);
       }
 
-      DEBUG(DEB_LEV_FULL_SEQ, "nSize=%d,frame linesize=%d,height=%d,pic linesize=%d PixFmt=%d\n",nSize,
-        omx_videodec_component_Private->avFrame->linesize[0],
-        omx_videodec_component_Private->avCodecContext->height,
-        pic.linesize[0],omx_videodec_component_Private->eOutFramePixFmt);
-
       pOutputBuffer->nFilledLen += nSize;
 
+    } else if (nLen > 0 && (OMX_U32)nLen < omx_videodec_component_Private->inputCurrLength) {
+      /** A frame went to the decoding threads without giving one back yet, decode the rest of the buffer */
+      omx_videodec_component_Private->inputCurrBuffer += nLen;
+      omx_videodec_component_Private->inputCurrLength -= nLen;
+      pInputBuffer->nFilledLen -= nLen;
+      continue;
+    } else if (omx_videodec_component_Private->inputCurrLength > 0 && (pInputBuffer->nFlags & OMX_BUFFERFLAG_EOS)) {
+      /** The data of the EOS buffer is decoded, go on with empty input to drain the delayed frames */
+      omx_videodec_component_Private->inputCurrLength = 0;
+      pInputBuffer->nFilledLen = 0;
+      continue;
     } else {
       /**  This condition becomes true when the input buffer has completely be consumed.
         * In this case is immediately switched because there is no real buffer consumption
@@ -562,6 +987,10 @@ void omx_videodec_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandCo
         */
       omx_videodec_component_Private->isNewBuffer = 1;
       pOutputBuffer->nFilledLen = 0;
+      if (pInputBuffer->nFlags & OMX_BUFFERFLAG_EOS) {
+        /** Drained: the base filter sends the EOS with this empty buffer, and the next stream starts afresh */
+        avcodec_flush_buffers(omx_videodec_component_Private->avCodecContext);
+      }
     }
 
     nOutputFilled = 1;
@@ -570,6 +999,20 @@ void omx_videodec_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandCo
             (int)pOutputBuffer->pBuffer, (int)pOutputBuffer->nFilledLen);
 }
 
+/** Drops the frames held by the decoder when the ports are flushed, along
+  * with what is left of the input buffer, which the flush returned
+  */
+void omx_videodec_component_BufferMgmtFlushCallback(OMX_COMPONENTTYPE *openmaxStandComp) {
+  omx_videodec_component_PrivateType* omx_videodec_component_Private = openmaxStandComp->pComponentPrivate;
+
+  if (omx_videodec_component_Private->avcodecReady) {
+    avcodec_flush_buffers(omx_videodec_component_Private->avCodecContext);
+  }
+  omx_videodec_component_Private->inputCurrBuffer = NULL;
+  omx_videodec_component_Private->inputCurrLength = 0;
+  omx_videodec_component_Private->isNewBuffer = 1;
+}
+
 OMX_ERRORTYPE omx_videodec_component_SetParameter(
 OMX_IN  OMX_HANDLETYPE hComponent,
 OMX_IN  OMX_INDEXTYPE nParamIndex,
@@ -594,6 +1037,7 @@ OMX_IN  OMX_PTR ComponentParameterStructure) {
         if(eError == OMX_ErrorNone) {
           OMX_PARAM_PORTDEFINITIONTYPE *pPortDef = (OMX_PARAM_PORTDEFINITIONTYPE*)ComponentParameterStructure;
           UpdateFrameSize (openmaxStandComp);
+          omx_videodec_component_FreeSwsContext(omx_videodec_component_Private);
           portIndex = pPortDef->nPortIndex;
           port = (omx_base_video_PortType *)omx_videodec_component_Private->ports[portIndex];
           port->sVideoParam.eColorFormat = port->sPortParam.format.video.eColorFormat;
@@ -644,6 +1088,7 @@ OMX_IN  OMX_PTR ComponentParameterStructure) {
                 break;
             }
             UpdateFrameSize (openmaxStandComp);
+            omx_videodec_component_FreeSwsContext(omx_videodec_component_Private);
           }
         } else {
           return OMX_ErrorBadPortIndex;
@@ -703,6 +1148,23 @@ OMX_IN  OMX_PTR ComponentParameterStructure) {
         }
         break;
       }
+    case OMX_IndexVendorDecodeThreads:
+      {
+        OMX_PARAM_U32TYPE *pThreads;
+        pThreads = ComponentParameterStructure;
+        if ((eError = checkHeader(ComponentParameterStructure, sizeof(OMX_PARAM_U32TYPE))) != OMX_ErrorNone) {
+          break;
+        }
+        /* The threads are started when the codec is opened, on the first buffer */
+        if (omx_videodec_component_Private->state != OMX_StateLoaded && omx_videodec_component_Private->state != OMX_StateIdle) {
+          return OMX_ErrorIncorrectStateOperation;
+        }
+        if (pThreads->nU32 > MAX_VIDEO_DEC_THREADS) {
+          return OMX_ErrorBadParameter;
+        }
+        omx_videodec_component_Private->nDecodeThreads = pThreads->nU32;
+        break;
+      }
     default: /*Call the base component function*/
       return omx_base_component_SetParameter(hComponent, nParamIndex, ComponentParameterStructure);
   }
@@ -788,6 +1250,16 @@ OMX_ERRORTYPE omx_videodec_component_GetParameter(
         }
         break;
       }
+    case OMX_IndexVendorDecodeThreads:
+      {
+        OMX_PARAM_U32TYPE *pThreads;
+        pThreads = ComponentParameterStructure;
+        if ((eError = checkHeader(ComponentParameterStructure, sizeof(OMX_PARAM_U32TYPE))) != OMX_ErrorNone) {
+          break;
+        }
+        pThreads->nU32 = omx_videodec_component_Private->nDecodeThreads;
+        break;
+      }
     default: /*Call the base component function*/
       return omx_base_component_GetParameter(hComponent, nParamIndex, ComponentParameterStructure);
   }
@@ -819,6 +1291,11 @@ OMX_ERRORTYPE omx_videodec_component_MessageHandler(OMX_COMPONENTTYPE* openmaxSt
       }
     }
   }
+  /* The client sets the tunneled port up before enabling the output port again */
+  if (message->messageType == OMX_CommandPortEnable &&
+      (message->messageParam == OMX_BASE_FILTER_OUTPUTPORT_INDEX || message->messageParam == OMX_ALL)) {
+    omx_videodec_component_UpdateOutLayout(omx_videodec_component_Private);
+  }
   // Execute the base message handling
   err =  omx_base_component_MessageHandler(openmaxStandComp,message);
 
@@ -847,4 +1324,18 @@ OMX_ERRORTYPE omx_videodec_component_ComponentRoleEnum(
   return OMX_ErrorNone;
 }
 
+/** Returns the index of the vendor parameter setting the number of decoding threads */
+OMX_ERRORTYPE omx_videodec_component_GetExtensionIndex(
+  OMX_IN  OMX_HANDLETYPE hComponent,
+  OMX_IN  OMX_STRING cParameterName,
+  OMX_OUT OMX_INDEXTYPE* pIndexType) {
+
+  DEBUG(DEB_LEV_FUNCTION_NAME,"In  %s \n",__func__);
 
+  if(strcmp(cParameterName,VIDEO_DEC_THREADS_NAME) == 0) {
+    *pIndexType = OMX_IndexVendorDecodeThreads;
+  } else {
+    return omx_base_component_GetExtensionIndex(hComponent, cParameterName, pIndexType);
+  }
+  return OMX_ErrorNone;
+}
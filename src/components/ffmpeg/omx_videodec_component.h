@@ -63,6 +63,48 @@
 #define VIDEO_DEC_MPEG4_ROLE "video_decoder.mpeg4"
 #define VIDEO_DEC_H264_ROLE "video_decoder.avc"
 
+/** The extension name of OMX_IndexVendorDecodeThreads. Its nU32 is the
+ * number of libavcodec decoding threads, the number of online processors by
+ * default. 0 or 1 decodes on the buffer management thread
+ */
+#define VIDEO_DEC_THREADS_NAME "OMX.st.index.param.videodec.threads"
+/** Largest number of decoding threads */
+#define MAX_VIDEO_DEC_THREADS 16
+
+/** Largest number of frame payloads tracked by the zero-copy decoding */
+#define MAX_VIDEO_DEC_FRAMES 64
+
+/** A frame payload of the zero-copy decoding, allocated by the decoder.
+ * The codec decodes into the payloads of the pool, and a decoded picture
+ * is sent by attaching its payload to the output buffer header in place of
+ * the one it had
+ */
+typedef struct omx_videodec_frame_type {
+  /** @param pBuffer the payload, laid out as the YUV 4:2:0 planar output */
+  OMX_U8* pBuffer;
+  /** @param nSize size of the payload in bytes */
+  OMX_U32 nSize;
+  /** @param nStride luma stride of the picture decoded in the payload */
+  OMX_U32 nStride;
+  /** @param nSliceHeight luma rows of the picture decoded in the payload, the chroma planes follow them */
+  OMX_U32 nSliceHeight;
+  /** @param nReferences number of pictures of the codec using the payload */
+  OMX_U32 nReferences;
+  /** @param pHeader the header the payload is attached to, NULL when in the pool */
+  OMX_BUFFERHEADERTYPE* pHeader;
+} omx_videodec_frame_type;
+
+/** The payload an output buffer header was allocated with, kept aside while
+ * the header carries a frame of the pool. It is never given to the codec,
+ * and goes back to its header before the port frees the buffers
+ */
+typedef struct omx_videodec_payload_type {
+  /** @param pHeader the header carrying a frame of the pool */
+  OMX_BUFFERHEADERTYPE* pHeader;
+  /** @param pBuffer the payload the header was allocated with */
+  OMX_U8* pBuffer;
+} omx_videodec_payload_type;
+
 /** Video Decoder component private structure.
   */
 DERIVEDCLASS(omx_videodec_component_PrivateType, omx_base_filter_PrivateType)
@@ -95,10 +137,28 @@ DERIVEDCLASS(omx_videodec_component_PrivateType, omx_base_filter_PrivateType)
   OMX_U32 video_coding_type;   \
   /** @param eOutFramePixFmt Field that indicate output frame pixel format */ \
   enum PixelFormat eOutFramePixFmt; \
+  /** @param imgConvertYuvCtx swscale context converting the decoded frames, kept across frames of the same size and formats */ \
+  struct SwsContext *imgConvertYuvCtx; \
   /** @param extradata pointer to extradata*/ \
   OMX_U8* extradata; \
   /** @param extradata_size extradata size*/ \
-  OMX_U32 extradata_size;
+  OMX_U32 extradata_size; \
+  /** @param nDecodeThreads number of libavcodec decoding threads, used when the codec is opened */ \
+  OMX_U32 nDecodeThreads; \
+  /** @param bZeroCopy the codec decodes into the frame pool, as the output port is tunneled */ \
+  OMX_BOOL bZeroCopy; \
+  /** @param pFrames the frame pool of the zero-copy decoding */ \
+  omx_videodec_frame_type* pFrames; \
+  /** @param nFrames number of entries used in pFrames */ \
+  OMX_U32 nFrames; \
+  /** @param pPayloads the original payloads of the headers carrying a frame of the pool */ \
+  omx_videodec_payload_type* pPayloads; \
+  /** @param nPayloads number of entries in pPayloads */ \
+  OMX_U32 nPayloads; \
+  /** @param nFrameAllocLen size of the payloads allocated by the decoder, as big as the output buffers */ \
+  OMX_U32 nFrameAllocLen; \
+  /** @param nOutSliceHeight luma rows of the padded pictures sent, 0 when they are sent unpadded */ \
+  OMX_U32 nOutSliceHeight;
 ENDCLASS(omx_videodec_component_PrivateType)
 
 /* Component private entry points declaration */
@@ -113,6 +173,17 @@ void omx_videodec_component_BufferMgmtCallback(
   OMX_BUFFERHEADERTYPE* inputbuffer,
   OMX_BUFFERHEADERTYPE* outputbuffer);
 
+void omx_videodec_component_BufferMgmtFlushCallback(OMX_COMPONENTTYPE *openmaxStandComp);
+
+OMX_ERRORTYPE omx_videodec_component_FreeTunnelBuffer(
+  omx_base_PortType *openmaxStandPort,
+  OMX_U32 nPortIndex);
+
+OMX_ERRORTYPE omx_videodec_component_FreeBuffer(
+  omx_base_PortType *openmaxStandPort,
+  OMX_U32 nPortIndex,
+  OMX_BUFFERHEADERTYPE* pBuffer);
+
 OMX_ERRORTYPE omx_videodec_component_GetParameter(
   OMX_IN  OMX_HANDLETYPE hComponent,
   OMX_IN  OMX_INDEXTYPE nParamIndex,
@@ -31,6 +31,7 @@
 #include <omx_base_video_port.h>
 #include <omx_videoenc_component.h>
 #include<OMX_Video.h>
+#include <unistd.h>
 
 /** Maximum Number of Video Component Instance*/
 #define MAX_COMPONENT_VIDEOENC 4
@@ -143,7 +144,14 @@ OMX_ERRORTYPE omx_videoenc_component_Constructor(OMX_COMPONENTTYPE *openmaxStand
   omx_videoenc_component_Private->avCodec = NULL;
   omx_videoenc_component_Private->avCodecContext= NULL;
   omx_videoenc_component_Private->avcodecReady = OMX_FALSE;
+  omx_videoenc_component_Private->nEncodeThreads = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+  if (omx_videoenc_component_Private->nEncodeThreads > MAX_VIDEO_ENC_THREADS) {
+    omx_videoenc_component_Private->nEncodeThreads = MAX_VIDEO_ENC_THREADS;
+  }
   omx_videoenc_component_Private->BufferMgmtCallback = omx_videoenc_component_BufferMgmtCallback;
+  omx_videoenc_component_Private->BufferMgmtFlushCallback = omx_videoenc_component_BufferMgmtFlushCallback;
+  /** The frames delayed by the encoding threads and the B-frames are drained at EOS */
+  omx_videoenc_component_Private->bDrainOnEOS = OMX_TRUE;
 
   /** initializing the coenc context etc that was done earlier by ffmpeglibinit function */
   omx_videoenc_component_Private->messageHandler = omx_videoenc_component_MessageHandler;
@@ -151,6 +159,7 @@ OMX_ERRORTYPE omx_videoenc_component_Constructor(OMX_COMPONENTTYPE *openmaxStand
   openmaxStandComp->SetParameter = omx_videoenc_component_SetParameter;
   openmaxStandComp->GetParameter = omx_videoenc_component_GetParameter;
   openmaxStandComp->ComponentRoleEnum = omx_videoenc_component_ComponentRoleEnum;
+  openmaxStandComp->GetExtensionIndex = omx_videoenc_component_GetExtensionIndex;
 
   noVideoEncInstance++;
 
@@ -197,6 +206,7 @@ OMX_ERRORTYPE omx_videoenc_component_ffmpegLibInit(omx_videoenc_component_Privat
 
   omx_base_video_PortType *inPort = (omx_base_video_PortType *)omx_videoenc_component_Private->ports[OMX_BASE_FILTER_INPUTPORT_INDEX];
   OMX_U32 target_coencID;
+  OMX_U32 nThreads;
   avcodec_init();
   av_register_all();
 
@@ -261,10 +271,36 @@ OMX_ERRORTYPE omx_videoenc_component_ffmpegLibInit(omx_videoenc_component_Privat
     break;
   }
 #endif
+
+  /** Newer libavcodec encode whole frames in parallel, delaying the output by a frame per thread.
+    * Older ones split each picture in slices, one per thread and at most one per macroblock row
+    */
+  nThreads = omx_videoenc_component_Private->nEncodeThreads;
+  if (nThreads > 1) {
+#ifdef FF_THREAD_FRAME
+    omx_videoenc_component_Private->avCodecContext->thread_count = nThreads;
+    omx_videoenc_component_Private->avCodecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+#else
+    if (nThreads > (inPort->sPortParam.format.video.nFrameHeight + 15) / 16) {
+      nThreads = (inPort->sPortParam.format.video.nFrameHeight + 15) / 16;
+    }
+    if (nThreads > 1 && avcodec_thread_init(omx_videoenc_component_Private->avCodecContext, nThreads) < 0) {
+      DEBUG(DEB_LEV_ERR, "Could not start %d encoding threads, encoding on one\n", (int)nThreads);
+    }
+#endif
+  }
+
   if (avcodec_open(omx_videoenc_component_Private->avCodecContext, omx_videoenc_component_Private->avCodec) < 0) {
     DEBUG(DEB_LEV_ERR, "Could not open encoder\n");
+    av_free(omx_videoenc_component_Private->avCodecContext);
+    omx_videoenc_component_Private->avCodecContext = NULL;
+    av_free(omx_videoenc_component_Private->picture);
+    omx_videoenc_component_Private->picture = NULL;
     return OMX_ErrorInsufficientResources;
   }
+  omx_videoenc_component_Private->nNextPts = 0;
+  omx_videoenc_component_Private->nDelayedFrames = 0;
+  omx_videoenc_component_Private->bNoPtsLogged = OMX_FALSE;
   tsem_up(omx_videoenc_component_Private->avCodecSyncSem);
   DEBUG(DEB_LEV_SIMPLE_SEQ, "done\n");
 
@@ -284,8 +320,10 @@ void omx_videoenc_component_ffmpegLibDeInit(omx_videoenc_component_PrivateType*
     omx_videoenc_component_Private->avCodecContext->extradata = NULL;
   }
   av_free (omx_videoenc_component_Private->avCodecContext);
+  omx_videoenc_component_Private->avCodecContext = NULL;
 
   av_free(omx_videoenc_component_Private->picture);
+  omx_videoenc_component_Private->picture = NULL;
 
 }
 
@@ -366,65 +404,126 @@ static inline void UpdateFrameSize(OMX_COMPONENTTYPE *openmaxStandComp) {
   }
 }
 
-/** This function is used to process the input buffer and provide one output buffer
+/** This function is used to process the input buffer and provide one output buffer.
+  * The encoder copies the picture, so the input buffer is always consumed. The
+  * packet written may belong to an earlier picture when B-frames or encoding
+  * threads delay the output, it gets the timestamp of that picture
   */
 void omx_videoenc_component_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandComp, OMX_BUFFERHEADERTYPE* pInputBuffer, OMX_BUFFERHEADERTYPE* pOutputBuffer) {
 
   omx_videoenc_component_PrivateType* omx_videoenc_component_Private = openmaxStandComp->pComponentPrivate;
   omx_base_video_PortType *inPort = (omx_base_video_PortType *)omx_videoenc_component_Private->ports[OMX_BASE_FILTER_INPUTPORT_INDEX];
-
-  OMX_S32 nOutputFilled = 0;
-  OMX_U8* outputCurrBuffer;
+  AVFrame* codedFrame;
+  OMX_S64 nPts;
   OMX_S32 nLen = 0;
   int size;
 
   size= inPort->sPortParam.format.video.nFrameWidth*inPort->sPortParam.format.video.nFrameHeight;
 
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
-  /** Fill up the current input buffer when a new buffer has arrived */
-  if(omx_videoenc_component_Private->isNewBuffer) {
-    omx_videoenc_component_Private->isNewBuffer = 0;
-    DEBUG(DEB_LEV_FULL_SEQ, "New Buffer FilledLen = %d\n", (int)pInputBuffer->nFilledLen);
-
-    omx_videoenc_component_Private->picture->data[0] = pInputBuffer->pBuffer;
-    omx_videoenc_component_Private->picture->data[1] = omx_videoenc_component_Private->picture->data[0] + size;
-    omx_videoenc_component_Private->picture->data[2] = omx_videoenc_component_Private->picture->data[1] + size / 4;
-    omx_videoenc_component_Private->picture->linesize[0] = inPort->sPortParam.format.video.nFrameWidth;
-    omx_videoenc_component_Private->picture->linesize[1] = inPort->sPortParam.format.video.nFrameWidth / 2;
-    omx_videoenc_component_Private->picture->linesize[2] = inPort->sPortParam.format.video.nFrameWidth / 2;
-  }
-
-  outputCurrBuffer = pOutputBuffer->pBuffer;
   pOutputBuffer->nFilledLen = 0;
   pOutputBuffer->nOffset = 0;
+  pOutputBuffer->nFlags &= ~OMX_BUFFERFLAG_SYNCFRAME;
 
-  while (!nOutputFilled) {
-    if (omx_videoenc_component_Private->isFirstBuffer) {
-      tsem_down(omx_videoenc_component_Private->avCodecSyncSem);
-      omx_videoenc_component_Private->isFirstBuffer = 0;
+  if (!omx_videoenc_component_Private->avcodecReady) {
+    pInputBuffer->nFilledLen = 0;
+    return;
+  }
+  if (omx_videoenc_component_Private->isFirstBuffer) {
+    tsem_down(omx_videoenc_component_Private->avCodecSyncSem);
+    omx_videoenc_component_Private->isFirstBuffer = 0;
+  }
+
+  if (pInputBuffer->nFilledLen > 0) {
+    /** Fill up the current input buffer when a new buffer has arrived */
+    if(omx_videoenc_component_Private->isNewBuffer) {
+      omx_videoenc_component_Private->isNewBuffer = 0;
+      DEBUG(DEB_LEV_FULL_SEQ, "New Buffer FilledLen = %d\n", (int)pInputBuffer->nFilledLen);
+
+      omx_videoenc_component_Private->picture->data[0] = pInputBuffer->pBuffer;
+      omx_videoenc_component_Private->picture->data[1] = omx_videoenc_component_Private->picture->data[0] + size;
+      omx_videoenc_component_Private->picture->data[2] = omx_videoenc_component_Private->picture->data[1] + size / 4;
+      omx_videoenc_component_Private->picture->linesize[0] = inPort->sPortParam.format.video.nFrameWidth;
+      omx_videoenc_component_Private->picture->linesize[1] = inPort->sPortParam.format.video.nFrameWidth / 2;
+      omx_videoenc_component_Private->picture->linesize[2] = inPort->sPortParam.format.video.nFrameWidth / 2;
     }
+    /* The pts finds the timestamp of the picture back when its packet comes out */
+    omx_videoenc_component_Private->picture->pts = omx_videoenc_component_Private->nNextPts;
+    omx_videoenc_component_Private->sTimeStamps[omx_videoenc_component_Private->nNextPts % MAX_VIDEO_ENC_DELAY] = pInputBuffer->nTimeStamp;
     omx_videoenc_component_Private->avCodecContext->frame_number++;
 
     nLen = avcodec_encode_video(omx_videoenc_component_Private->avCodecContext,
-                                outputCurrBuffer,
+                                pOutputBuffer->pBuffer,
                                 pOutputBuffer->nAllocLen,
                                 omx_videoenc_component_Private->picture);
 
-    if (nLen < 0) {
-      DEBUG(DEB_LEV_ERR, "A general error or simply frame not encoded?\n");
+    pInputBuffer->nFilledLen = 0;
+    omx_videoenc_component_Private->isNewBuffer = 1;
+    if (nLen >= 0) {
+      omx_videoenc_component_Private->nNextPts++;
+      omx_videoenc_component_Private->nDelayedFrames++;
     }
+  }
 
-    pInputBuffer->nFilledLen = 0;
-      omx_videoenc_component_Private->isNewBuffer = 1;
-    if ( nLen >= 0) {
-      pOutputBuffer->nFilledLen = nLen;
+  /** At EOS the held back pictures come out one per call, the EOS flag goes with the first empty buffer */
+  if (nLen == 0 && (pInputBuffer->nFlags & OMX_BUFFERFLAG_EOS) && omx_videoenc_component_Private->nDelayedFrames > 0) {
+    nLen = avcodec_encode_video(omx_videoenc_component_Private->avCodecContext,
+                                pOutputBuffer->pBuffer,
+                                pOutputBuffer->nAllocLen,
+                                NULL);
+    if (nLen == 0) {
+      omx_videoenc_component_Private->nDelayedFrames = 0;
+    }
+  }
+
+  if (nLen < 0) {
+    DEBUG(DEB_LEV_ERR, "A general error or simply frame not encoded?\n");
+  } else if (nLen > 0) {
+    /* Without a pts from the encoder the packets are taken in input order,
+     * which is not their order when B-frames are reordered */
+    codedFrame = omx_videoenc_component_Private->avCodecContext->coded_frame;
+    if (codedFrame && codedFrame->pts != AV_NOPTS_VALUE) {
+      nPts = codedFrame->pts;
+    } else {
+      nPts = omx_videoenc_component_Private->nNextPts - omx_videoenc_component_Private->nDelayedFrames;
+      if (omx_videoenc_component_Private->avCodecContext->max_b_frames > 0 && !omx_videoenc_component_Private->bNoPtsLogged) {
+        DEBUG(DEB_LEV_ERR, "In %s the encoder gives no pts, the timestamps of the B-frames may not match their pictures\n", __func__);
+        omx_videoenc_component_Private->bNoPtsLogged = OMX_TRUE;
+      }
+    }
+    pOutputBuffer->nTimeStamp = omx_videoenc_component_Private->sTimeStamps[nPts % MAX_VIDEO_ENC_DELAY];
+    if (codedFrame && codedFrame->key_frame) {
+      pOutputBuffer->nFlags |= OMX_BUFFERFLAG_SYNCFRAME;
     }
-    nOutputFilled = 1;
+    if (omx_videoenc_component_Private->nDelayedFrames > 0) {
+      omx_videoenc_component_Private->nDelayedFrames--;
+    }
+    pOutputBuffer->nFilledLen = nLen;
   }
   DEBUG(DEB_LEV_FULL_SEQ, "One output buffer %x nLen=%d is full returning in video encoder\n",
             (int)pOutputBuffer->pBuffer, (int)pOutputBuffer->nFilledLen);
 }
 
+/** Drops the pictures held by the encoder when the ports are flushed. A
+  * libavcodec encoder is only reset by opening it again
+  */
+void omx_videoenc_component_BufferMgmtFlushCallback(OMX_COMPONENTTYPE *openmaxStandComp) {
+  omx_videoenc_component_PrivateType* omx_videoenc_component_Private = openmaxStandComp->pComponentPrivate;
+
+  omx_videoenc_component_Private->isNewBuffer = 1;
+  if (!omx_videoenc_component_Private->avcodecReady || omx_videoenc_component_Private->nDelayedFrames == 0) {
+    return;
+  }
+  omx_videoenc_component_ffmpegLibDeInit(omx_videoenc_component_Private);
+  /* Opening the encoder puts the semaphore up again for the next buffer */
+  omx_videoenc_component_Private->isFirstBuffer = 1;
+  /* A failed open has already freed the new context and picture */
+  if (omx_videoenc_component_ffmpegLibInit(omx_videoenc_component_Private) != OMX_ErrorNone) {
+    DEBUG(DEB_LEV_ERR, "In %s Could not open the encoder again\n", __func__);
+    omx_videoenc_component_Private->avcodecReady = OMX_FALSE;
+  }
+}
+
 OMX_ERRORTYPE omx_videoenc_component_SetParameter(
 OMX_IN  OMX_HANDLETYPE hComponent,
 OMX_IN  OMX_INDEXTYPE nParamIndex,
@@ -537,6 +636,23 @@ OMX_IN  OMX_PTR ComponentParameterStructure) {
         }
         break;
       }
+    case OMX_IndexVendorEncodeThreads:
+      {
+        OMX_PARAM_U32TYPE *pThreads;
+        pThreads = ComponentParameterStructure;
+        if ((eError = checkHeader(ComponentParameterStructure, sizeof(OMX_PARAM_U32TYPE))) != OMX_ErrorNone) {
+          break;
+        }
+        /* The threads are started when the encoder is opened, going to Idle */
+        if (omx_videoenc_component_Private->state != OMX_StateLoaded) {
+          return OMX_ErrorIncorrectStateOperation;
+        }
+        if (pThreads->nU32 > MAX_VIDEO_ENC_THREADS) {
+          return OMX_ErrorBadParameter;
+        }
+        omx_videoenc_component_Private->nEncodeThreads = pThreads->nU32;
+        break;
+      }
     default: /*Call the base component function*/
       return omx_base_component_SetParameter(hComponent, nParamIndex, ComponentParameterStructure);
   }
@@ -607,6 +723,16 @@ OMX_ERRORTYPE omx_videoenc_component_GetParameter(
         }
         break;
       }
+    case OMX_IndexVendorEncodeThreads:
+      {
+        OMX_PARAM_U32TYPE *pThreads;
+        pThreads = ComponentParameterStructure;
+        if ((eError = checkHeader(ComponentParameterStructure, sizeof(OMX_PARAM_U32TYPE))) != OMX_ErrorNone) {
+          break;
+        }
+        pThreads->nU32 = omx_videoenc_component_Private->nEncodeThreads;
+        break;
+      }
     default: /*Call the base component function*/
       return omx_base_component_GetParameter(hComponent, nParamIndex, ComponentParameterStructure);
   }
@@ -658,3 +784,19 @@ OMX_ERRORTYPE omx_videoenc_component_ComponentRoleEnum(
   }
   return OMX_ErrorNone;
 }
+
+/** Returns the index of the vendor parameter setting the number of encoding threads */
+OMX_ERRORTYPE omx_videoenc_component_GetExtensionIndex(
+  OMX_IN  OMX_HANDLETYPE hComponent,
+  OMX_IN  OMX_STRING cParameterName,
+  OMX_OUT OMX_INDEXTYPE* pIndexType) {
+
+  DEBUG(DEB_LEV_FUNCTION_NAME,"In  %s \n",__func__);
+
+  if(strcmp(cParameterName,VIDEO_ENC_THREADS_NAME) == 0) {
+    *pIndexType = OMX_IndexVendorEncodeThreads;
+  } else {
+    return omx_base_component_GetExtensionIndex(hComponent, cParameterName, pIndexType);
+  }
+  return OMX_ErrorNone;
+}
@@ -60,6 +60,19 @@
 #define VIDEO_ENC_MPEG4_NAME "OMX.st.video_encoder.mpeg4"
 #define VIDEO_ENC_MPEG4_ROLE "video_encoder.mpeg4"
 
+/** The extension name of OMX_IndexVendorEncodeThreads. Its nU32 is the
+ * number of libavcodec encoding threads, the number of online processors by
+ * default. 0 or 1 encodes on the buffer management thread
+ */
+#define VIDEO_ENC_THREADS_NAME "OMX.st.index.param.videoenc.threads"
+/** Largest number of encoding threads */
+#define MAX_VIDEO_ENC_THREADS 16
+/** Number of input timestamps remembered while their frames are in the
+ * encoder. Covers the largest B-frame delay of libavcodec, 16, plus a frame
+ * per encoding thread
+ */
+#define MAX_VIDEO_ENC_DELAY 64
+
 /** Video Encoder component private structure.
   */
 DERIVEDCLASS(omx_videoenc_component_PrivateType, omx_base_filter_PrivateType)
@@ -84,7 +97,17 @@ DERIVEDCLASS(omx_videoenc_component_PrivateType, omx_base_filter_PrivateType)
   /** @param video_encoding_type Field that indicate the supported video format of video encoder */ \
   OMX_U32 video_encoding_type;   \
   /** @param eOutFramePixFmt Field that indicate output frame pixel format */ \
-  enum PixelFormat eOutFramePixFmt;
+  enum PixelFormat eOutFramePixFmt; \
+  /** @param nEncodeThreads number of libavcodec encoding threads, used when the encoder is opened */ \
+  OMX_U32 nEncodeThreads; \
+  /** @param nNextPts pts of the next picture given to the encoder, its frame count */ \
+  OMX_S64 nNextPts; \
+  /** @param nDelayedFrames pictures given to the encoder whose packet is not out yet */ \
+  OMX_U32 nDelayedFrames; \
+  /** @param bNoPtsLogged set once the missing pts of a B-frame encoder has been reported */ \
+  OMX_BOOL bNoPtsLogged; \
+  /** @param sTimeStamps input timestamps of the last pictures, indexed by pts modulo MAX_VIDEO_ENC_DELAY */ \
+  OMX_TICKS sTimeStamps[MAX_VIDEO_ENC_DELAY];
 ENDCLASS(omx_videoenc_component_PrivateType)
 
 /* Component private entry points enclaration */
@@ -99,6 +122,8 @@ void omx_videoenc_component_BufferMgmtCallback(
   OMX_BUFFERHEADERTYPE* inputbuffer,
   OMX_BUFFERHEADERTYPE* outputbuffer);
 
+void omx_videoenc_component_BufferMgmtFlushCallback(OMX_COMPONENTTYPE *openmaxStandComp);
+
 OMX_ERRORTYPE omx_videoenc_component_GetParameter(
   OMX_IN  OMX_HANDLETYPE hComponent,
   OMX_IN  OMX_INDEXTYPE nParamIndex,
@@ -114,6 +139,11 @@ OMX_ERRORTYPE omx_videoenc_component_ComponentRoleEnum(
   OMX_OUT OMX_U8 *cRole,
   OMX_IN OMX_U32 nIndex);
 
+OMX_ERRORTYPE omx_videoenc_component_GetExtensionIndex(
+  OMX_IN  OMX_HANDLETYPE hComponent,
+  OMX_IN  OMX_STRING cParameterName,
+  OMX_OUT OMX_INDEXTYPE* pIndexType);
+
 void SetInternalVideoEncParameters(OMX_COMPONENTTYPE *openmaxStandComp);
 
 
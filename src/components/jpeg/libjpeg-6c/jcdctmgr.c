@@ -15,6 +15,7 @@
 #include "jinclude.h"
 #include "jpeglib.h"
 #include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"
 
 
 /* Private subobject for this module */
@@ -320,7 +321,10 @@ start_pass_fdctmgr (j_compress_ptr cinfo)
       switch (cinfo->dct_method) {
 #ifdef DCT_ISLOW_SUPPORTED
       case JDCT_ISLOW:
-	fdct->do_dct[ci] = jpeg_fdct_islow;
+	if (jsimd_can_fdct_islow())
+	  fdct->do_dct[ci] = jsimd_fdct_islow;
+	else
+	  fdct->do_dct[ci] = jpeg_fdct_islow;
 	method = JDCT_ISLOW;
 	break;
 #endif
@@ -0,0 +1,982 @@
+/*
+ * jsimd.c
+ *
+ * This file is part of the Independent JPEG Group's software.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains SSE2 versions of the islow forward and inverse DCT,
+ * of the RGB <=> YCbCr color conversions and of the fancy 2:1 upsampling.
+ * The routines are selected at run time by the module initialization code
+ * of jcdctmgr.c, jddctmgr.c, jccolor.c, jdcolor.c and jdsample.c when the
+ * matching jsimd_can_xxx() routine returns TRUE.
+ *
+ * Every routine computes exactly what the C version computes, so that the
+ * compressed data and the decompressed images do not depend on the machine.
+ * The C code works on INT32 (long) values while SSE2 lanes are 32 bits
+ * wide; the sums are done modulo 2^32, which gives the exact results as
+ * long as the final value of each sum fits in 32 bits.  This is always the
+ * case for the FDCT and for the color and upsampling routines; the IDCT
+ * checks its intermediate values and hands the rare blocks that could
+ * exceed this range (only found in corrupt or unusual data) over to the
+ * C routine.
+ *
+ * Constants larger than 16 bits are not needed: the products are computed
+ * from 16x16-bit partial products, which also avoids the SSE4.1 32-bit
+ * multiply.
+ */
+
+#define JPEG_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"
+
+#if BITS_IN_JSAMPLE == 8 && DCTSIZE == 8 && RGB_RED == 0 && \
+    RGB_GREEN == 1 && RGB_BLUE == 2 && RGB_PIXELSIZE == 3 && \
+    defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define SSE2_SUPPORTED
+#endif
+
+#ifdef SSE2_SUPPORTED
+#include <cpuid.h>
+#include <emmintrin.h>
+#endif
+
+
+/*
+ * Run-time selection.
+ */
+
+#define JSIMD_SSE2	0x01
+
+LOCAL(int)
+jsimd_support (void)
+{
+  static int cpu_support = -1;
+
+  if (cpu_support < 0) {
+    int support = 0;
+#ifdef SSE2_SUPPORTED
+    unsigned int eax, ebx, ecx, edx;
+
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (edx & bit_SSE2))
+      support |= JSIMD_SSE2;
+#endif
+    cpu_support = support;
+  }
+
+  /* The environment variable JPEGSIMD=0 selects the C routines, e.g. to
+   * compare the results.  It is read each time a module is initialized.
+   * If your system doesn't support getenv(), define NO_GETENV to disable
+   * this feature.
+   */
+#ifndef NO_GETENV
+  { char * simdenv;
+
+    if ((simdenv = getenv("JPEGSIMD")) != NULL &&
+	simdenv[0] == '0' && simdenv[1] == '\0')
+      return 0;
+  }
+#endif
+
+  return cpu_support;
+}
+
+
+GLOBAL(int)
+jsimd_can_idct_islow (void)
+{
+  if (SIZEOF(ISLOW_MULT_TYPE) != 4 || SIZEOF(JCOEF) != 2)
+    return FALSE;
+  return (jsimd_support() & JSIMD_SSE2) ? TRUE : FALSE;
+}
+
+GLOBAL(int)
+jsimd_can_fdct_islow (void)
+{
+  if (SIZEOF(DCTELEM) != 4)
+    return FALSE;
+  return (jsimd_support() & JSIMD_SSE2) ? TRUE : FALSE;
+}
+
+GLOBAL(int)
+jsimd_can_ycc_rgb (void)
+{
+  return (jsimd_support() & JSIMD_SSE2) ? TRUE : FALSE;
+}
+
+GLOBAL(int)
+jsimd_can_rgb_ycc (void)
+{
+  return (jsimd_support() & JSIMD_SSE2) ? TRUE : FALSE;
+}
+
+GLOBAL(int)
+jsimd_can_h2v1_fancy_upsample (void)
+{
+  return (jsimd_support() & JSIMD_SSE2) ? TRUE : FALSE;
+}
+
+GLOBAL(int)
+jsimd_can_h2v2_fancy_upsample (void)
+{
+  return (jsimd_support() & JSIMD_SSE2) ? TRUE : FALSE;
+}
+
+
+#ifdef SSE2_SUPPORTED
+
+/* The SSE2 routines are compiled for SSE2 whatever the compiler flags are;
+ * they are only called once the CPU has been checked.
+ */
+
+#define SSE2		__attribute__((target("sse2")))
+#define SSE2_LOCAL	static INLINE SSE2
+
+
+/* Low 32 bits of the products of the 32-bit lanes of x by c, 0 <= c < 2^16:
+ * x * c == (xl + xh * 2^16) * c == xl * c + ((xh * c) << 16)  (mod 2^32)
+ */
+
+SSE2_LOCAL __m128i
+mul_const (__m128i x, int c)
+{
+  __m128i c16 = _mm_set1_epi16((short) c);
+
+  return _mm_add_epi32(_mm_mullo_epi16(x, c16),
+		       _mm_slli_epi32(_mm_mulhi_epu16(x, c16), 16));
+}
+
+/* Same with a different multiplier 0 <= c < 2^16 in each lane */
+
+SSE2_LOCAL __m128i
+mul_var (__m128i x, __m128i c)
+{
+  __m128i c16 = _mm_or_si128(c, _mm_slli_epi32(c, 16));
+
+  return _mm_add_epi32(_mm_mullo_epi16(x, c16),
+		       _mm_slli_epi32(_mm_mulhi_epu16(x, c16), 16));
+}
+
+SSE2_LOCAL __m128i
+blend (__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+SSE2_LOCAL void
+transpose_4x4 (__m128i * a, __m128i * b, __m128i * c, __m128i * d)
+{
+  __m128i t0 = _mm_unpacklo_epi32(*a, *b);
+  __m128i t1 = _mm_unpacklo_epi32(*c, *d);
+  __m128i t2 = _mm_unpackhi_epi32(*a, *b);
+  __m128i t3 = _mm_unpackhi_epi32(*c, *d);
+
+  *a = _mm_unpacklo_epi64(t0, t1);
+  *b = _mm_unpackhi_epi64(t0, t1);
+  *c = _mm_unpacklo_epi64(t2, t3);
+  *d = _mm_unpackhi_epi64(t2, t3);
+}
+
+SSE2_LOCAL void
+transpose_8x8_epi16 (__m128i * v)
+{
+  __m128i a0, a1, a2, a3, a4, a5, a6, a7;
+  __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+  a0 = _mm_unpacklo_epi16(v[0], v[1]);
+  a1 = _mm_unpackhi_epi16(v[0], v[1]);
+  a2 = _mm_unpacklo_epi16(v[2], v[3]);
+  a3 = _mm_unpackhi_epi16(v[2], v[3]);
+  a4 = _mm_unpacklo_epi16(v[4], v[5]);
+  a5 = _mm_unpackhi_epi16(v[4], v[5]);
+  a6 = _mm_unpacklo_epi16(v[6], v[7]);
+  a7 = _mm_unpackhi_epi16(v[6], v[7]);
+
+  b0 = _mm_unpacklo_epi32(a0, a2);
+  b1 = _mm_unpackhi_epi32(a0, a2);
+  b2 = _mm_unpacklo_epi32(a1, a3);
+  b3 = _mm_unpackhi_epi32(a1, a3);
+  b4 = _mm_unpacklo_epi32(a4, a6);
+  b5 = _mm_unpackhi_epi32(a4, a6);
+  b6 = _mm_unpacklo_epi32(a5, a7);
+  b7 = _mm_unpackhi_epi32(a5, a7);
+
+  v[0] = _mm_unpacklo_epi64(b0, b4);
+  v[1] = _mm_unpackhi_epi64(b0, b4);
+  v[2] = _mm_unpacklo_epi64(b1, b5);
+  v[3] = _mm_unpackhi_epi64(b1, b5);
+  v[4] = _mm_unpacklo_epi64(b2, b6);
+  v[5] = _mm_unpackhi_epi64(b2, b6);
+  v[6] = _mm_unpacklo_epi64(b3, b7);
+  v[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+
+/*
+ * The islow DCTs, see jfdctint.c and jidctint.c.  Four columns (or rows)
+ * are processed at once, with the same operations as the C code.
+ */
+
+#define CONST_BITS  13
+#define PASS1_BITS  2
+
+#define FIX_0_298631336  2446
+#define FIX_0_390180644  3196
+#define FIX_0_541196100  4433
+#define FIX_0_765366865  6270
+#define FIX_0_899976223  7373
+#define FIX_1_175875602  9633
+#define FIX_1_501321110  12299
+#define FIX_1_847759065  15137
+#define FIX_1_961570560  16069
+#define FIX_2_053119869  16819
+#define FIX_2_562915447  20995
+#define FIX_3_072711026  25172
+
+/* Each output of a 1-D IDCT is a sum of the 8 inputs scaled by at most
+ * 178219 in total (before descaling), so inputs up to IDCT_MAX_INPUT in
+ * magnitude keep every output, rounding included, within 32 bits.  Valid
+ * 8-bit data stays far below this limit.
+ */
+
+#define IDCT_MAX_INPUT  12000
+
+
+SSE2_LOCAL void
+idct_1d (const __m128i * in, __m128i * out, int shift)
+{
+  __m128i tmp0, tmp1, tmp2, tmp3;
+  __m128i tmp10, tmp11, tmp12, tmp13;
+  __m128i z1, z2, z3, z4, z5;
+  __m128i round = _mm_set1_epi32(1 << (shift-1));
+
+  /* Even part */
+
+  z1 = mul_const(_mm_add_epi32(in[2], in[6]), FIX_0_541196100);
+  tmp2 = _mm_sub_epi32(z1, mul_const(in[6], FIX_1_847759065));
+  tmp3 = _mm_add_epi32(z1, mul_const(in[2], FIX_0_765366865));
+
+  tmp0 = _mm_slli_epi32(_mm_add_epi32(in[0], in[4]), CONST_BITS);
+  tmp1 = _mm_slli_epi32(_mm_sub_epi32(in[0], in[4]), CONST_BITS);
+
+  tmp10 = _mm_add_epi32(tmp0, tmp3);
+  tmp13 = _mm_sub_epi32(tmp0, tmp3);
+  tmp11 = _mm_add_epi32(tmp1, tmp2);
+  tmp12 = _mm_sub_epi32(tmp1, tmp2);
+
+  /* Odd part; the negative constants are applied by subtracting */
+
+  z1 = _mm_add_epi32(in[7], in[1]);
+  z2 = _mm_add_epi32(in[5], in[3]);
+  z3 = _mm_add_epi32(in[7], in[3]);
+  z4 = _mm_add_epi32(in[5], in[1]);
+  z5 = mul_const(_mm_add_epi32(z3, z4), FIX_1_175875602);
+
+  tmp0 = mul_const(in[7], FIX_0_298631336);
+  tmp1 = mul_const(in[5], FIX_2_053119869);
+  tmp2 = mul_const(in[3], FIX_3_072711026);
+  tmp3 = mul_const(in[1], FIX_1_501321110);
+  z1 = mul_const(z1, FIX_0_899976223);
+  z2 = mul_const(z2, FIX_2_562915447);
+  z3 = _mm_sub_epi32(z5, mul_const(z3, FIX_1_961570560));
+  z4 = _mm_sub_epi32(z5, mul_const(z4, FIX_0_390180644));
+
+  tmp0 = _mm_add_epi32(_mm_sub_epi32(tmp0, z1), z3);
+  tmp1 = _mm_add_epi32(_mm_sub_epi32(tmp1, z2), z4);
+  tmp2 = _mm_add_epi32(_mm_sub_epi32(tmp2, z2), z3);
+  tmp3 = _mm_add_epi32(_mm_sub_epi32(tmp3, z1), z4);
+
+  /* Final output stage */
+
+  tmp10 = _mm_add_epi32(tmp10, round);
+  tmp11 = _mm_add_epi32(tmp11, round);
+  tmp12 = _mm_add_epi32(tmp12, round);
+  tmp13 = _mm_add_epi32(tmp13, round);
+  out[0] = _mm_srai_epi32(_mm_add_epi32(tmp10, tmp3), shift);
+  out[7] = _mm_srai_epi32(_mm_sub_epi32(tmp10, tmp3), shift);
+  out[1] = _mm_srai_epi32(_mm_add_epi32(tmp11, tmp2), shift);
+  out[6] = _mm_srai_epi32(_mm_sub_epi32(tmp11, tmp2), shift);
+  out[2] = _mm_srai_epi32(_mm_add_epi32(tmp12, tmp1), shift);
+  out[5] = _mm_srai_epi32(_mm_sub_epi32(tmp12, tmp1), shift);
+  out[3] = _mm_srai_epi32(_mm_add_epi32(tmp13, tmp0), shift);
+  out[4] = _mm_srai_epi32(_mm_sub_epi32(tmp13, tmp0), shift);
+}
+
+/* Mask of the lanes of x out of -IDCT_MAX_INPUT..IDCT_MAX_INPUT */
+
+SSE2_LOCAL __m128i
+idct_out_of_range (__m128i x)
+{
+  return _mm_or_si128(_mm_cmpgt_epi32(x, _mm_set1_epi32(IDCT_MAX_INPUT)),
+		      _mm_cmplt_epi32(x, _mm_set1_epi32(-IDCT_MAX_INPUT)));
+}
+
+/* range_limit[x & RANGE_MASK] for the post-IDCT table of jdmaster.c:
+ * x is taken as a 10-bit signed value, offset by CENTERJSAMPLE and clamped
+ * (the clamping is done when packing to bytes).
+ */
+
+SSE2_LOCAL __m128i
+idct_range_limit (__m128i x)
+{
+  return _mm_add_epi32(_mm_srai_epi32(_mm_slli_epi32(x, 22), 22),
+		       _mm_set1_epi32(CENTERJSAMPLE));
+}
+
+
+GLOBAL(void) SSE2
+jsimd_idct_islow (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		  JCOEFPTR coef_block,
+		  JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  ISLOW_MULT_TYPE * quantptr = (ISLOW_MULT_TYPE *) compptr->dct_table;
+  JSAMPLE *range_limit = IDCT_range_limit(cinfo);
+  __m128i zero = _mm_setzero_si128();
+  __m128i coef[DCTSIZE], in[DCTSIZE], out[DCTSIZE];
+  __m128i workspace[2][DCTSIZE];	/* [row group][column] after pass 1 */
+  __m128i ac, mask, dc, bad;
+  int ctr, half;
+  SHIFT_TEMPS
+
+  for (ctr = 0; ctr < DCTSIZE; ctr++)
+    coef[ctr] = _mm_loadu_si128((__m128i *) (coef_block + ctr * DCTSIZE));
+
+  /* Blocks with only a DC coefficient are flat, as in the C code */
+
+  ac = _mm_srli_si128(coef[0], 2);
+  for (ctr = 1; ctr < DCTSIZE; ctr++)
+    ac = _mm_or_si128(ac, coef[ctr]);
+  if (_mm_movemask_epi8(_mm_cmpeq_epi16(ac, zero)) == 0xFFFF) {
+    int dcval = ((ISLOW_MULT_TYPE) coef_block[0] * quantptr[0]) << PASS1_BITS;
+    JSAMPLE outval = range_limit[(int) DESCALE((INT32) dcval, PASS1_BITS+3)
+				 & RANGE_MASK];
+    __m128i outvec = _mm_set1_epi8((char) outval);
+
+    for (ctr = 0; ctr < DCTSIZE; ctr++)
+      _mm_storel_epi64((__m128i *) (output_buf[ctr] + output_col), outvec);
+    return;
+  }
+
+  /* Pass 1: process columns, four at a time.  The columns whose AC terms
+   * are all zero take the DC value, as in the C shortcut.
+   */
+
+  bad = zero;
+  for (half = 0; half < 2; half++) {
+    ac = zero;
+    for (ctr = 0; ctr < DCTSIZE; ctr++) {
+      __m128i c = half ? _mm_unpackhi_epi16(coef[ctr], coef[ctr])
+		       : _mm_unpacklo_epi16(coef[ctr], coef[ctr]);
+
+      c = _mm_srai_epi32(c, 16);
+      if (ctr > 0)
+	ac = _mm_or_si128(ac, c);
+      in[ctr] = mul_var(c, _mm_loadu_si128((__m128i *)
+					   (quantptr + ctr * DCTSIZE + half * 4)));
+      bad = _mm_or_si128(bad, idct_out_of_range(in[ctr]));
+    }
+    idct_1d(in, out, CONST_BITS-PASS1_BITS);
+
+    mask = _mm_cmpeq_epi32(ac, zero);
+    dc = _mm_slli_epi32(in[0], PASS1_BITS);
+    for (ctr = 0; ctr < DCTSIZE; ctr++)
+      out[ctr] = blend(mask, dc, out[ctr]);
+
+    /* Transpose to rows */
+    transpose_4x4(&out[0], &out[1], &out[2], &out[3]);
+    transpose_4x4(&out[4], &out[5], &out[6], &out[7]);
+    for (ctr = 0; ctr < 4; ctr++) {
+      workspace[0][half * 4 + ctr] = out[ctr];
+      workspace[1][half * 4 + ctr] = out[4 + ctr];
+      bad = _mm_or_si128(bad, idct_out_of_range(out[ctr]));
+      bad = _mm_or_si128(bad, idct_out_of_range(out[4 + ctr]));
+    }
+  }
+
+  if (_mm_movemask_epi8(bad) != 0) {
+    jpeg_idct_islow(cinfo, compptr, coef_block, output_buf, output_col);
+    return;
+  }
+
+  /* Pass 2: process rows, four at a time.  The rows whose AC terms are all
+   * zero take the DC value, as in the C shortcut.
+   */
+
+  for (half = 0; half < 2; half++) {
+    __m128i * wsptr = workspace[half];
+
+    ac = zero;
+    for (ctr = 1; ctr < DCTSIZE; ctr++)
+      ac = _mm_or_si128(ac, wsptr[ctr]);
+    idct_1d(wsptr, out, CONST_BITS+PASS1_BITS+3);
+
+    mask = _mm_cmpeq_epi32(ac, zero);
+    dc = _mm_srai_epi32(_mm_add_epi32(wsptr[0],
+				      _mm_set1_epi32(1 << (PASS1_BITS+2))),
+			PASS1_BITS+3);
+    for (ctr = 0; ctr < DCTSIZE; ctr++) {
+      out[ctr] = idct_range_limit(blend(mask, dc, out[ctr]));
+      if (half)
+	in[ctr] = _mm_packs_epi32(in[ctr], out[ctr]);
+      else
+	in[ctr] = out[ctr];
+    }
+  }
+
+  /* Back to rows of samples */
+
+  transpose_8x8_epi16(in);
+  for (ctr = 0; ctr < DCTSIZE; ctr += 2) {
+    __m128i rows = _mm_packus_epi16(in[ctr], in[ctr+1]);
+
+    _mm_storel_epi64((__m128i *) (output_buf[ctr] + output_col), rows);
+    _mm_storel_epi64((__m128i *) (output_buf[ctr+1] + output_col),
+		     _mm_srli_si128(rows, 8));
+  }
+}
+
+
+SSE2_LOCAL void
+fdct_1d (const __m128i * in, __m128i * out, int pass1)
+{
+  __m128i tmp0, tmp1, tmp2, tmp3;
+  __m128i tmp10, tmp11, tmp12, tmp13;
+  __m128i z1;
+  int shift = pass1 ? CONST_BITS-PASS1_BITS : CONST_BITS+PASS1_BITS;
+  __m128i round = _mm_set1_epi32(1 << (shift-1));
+
+  /* Even part */
+
+  tmp0 = _mm_add_epi32(in[0], in[7]);
+  tmp1 = _mm_add_epi32(in[1], in[6]);
+  tmp2 = _mm_add_epi32(in[2], in[5]);
+  tmp3 = _mm_add_epi32(in[3], in[4]);
+
+  tmp10 = _mm_add_epi32(tmp0, tmp3);
+  tmp12 = _mm_sub_epi32(tmp0, tmp3);
+  tmp11 = _mm_add_epi32(tmp1, tmp2);
+  tmp13 = _mm_sub_epi32(tmp1, tmp2);
+
+  tmp0 = _mm_sub_epi32(in[0], in[7]);
+  tmp1 = _mm_sub_epi32(in[1], in[6]);
+  tmp2 = _mm_sub_epi32(in[2], in[5]);
+  tmp3 = _mm_sub_epi32(in[3], in[4]);
+
+  if (pass1) {
+    /* Apply unsigned->signed conversion */
+    out[0] = _mm_slli_epi32(_mm_sub_epi32(_mm_add_epi32(tmp10, tmp11),
+					  _mm_set1_epi32(8 * CENTERJSAMPLE)),
+			    PASS1_BITS);
+    out[4] = _mm_slli_epi32(_mm_sub_epi32(tmp10, tmp11), PASS1_BITS);
+  } else {
+    __m128i round1 = _mm_set1_epi32(1 << (PASS1_BITS-1));
+
+    out[0] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(tmp10, tmp11), round1),
+			    PASS1_BITS);
+    out[4] = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(tmp10, tmp11), round1),
+			    PASS1_BITS);
+  }
+
+  z1 = _mm_add_epi32(mul_const(_mm_add_epi32(tmp12, tmp13), FIX_0_541196100),
+		     round);
+  out[2] = _mm_srai_epi32(_mm_add_epi32(z1,
+					mul_const(tmp12, FIX_0_765366865)),
+			  shift);
+  out[6] = _mm_srai_epi32(_mm_sub_epi32(z1,
+					mul_const(tmp13, FIX_1_847759065)),
+			  shift);
+
+  /* Odd part; the negative constants are applied by subtracting */
+
+  tmp10 = _mm_add_epi32(tmp0, tmp3);
+  tmp11 = _mm_add_epi32(tmp1, tmp2);
+  tmp12 = _mm_add_epi32(tmp0, tmp2);
+  tmp13 = _mm_add_epi32(tmp1, tmp3);
+  z1 = _mm_add_epi32(mul_const(_mm_add_epi32(tmp12, tmp13), FIX_1_175875602),
+		     round);
+
+  tmp0  = mul_const(tmp0, FIX_1_501321110);
+  tmp1  = mul_const(tmp1, FIX_3_072711026);
+  tmp2  = mul_const(tmp2, FIX_2_053119869);
+  tmp3  = mul_const(tmp3, FIX_0_298631336);
+  tmp10 = mul_const(tmp10, FIX_0_899976223);
+  tmp11 = mul_const(tmp11, FIX_2_562915447);
+  tmp12 = _mm_sub_epi32(z1, mul_const(tmp12, FIX_0_390180644));
+  tmp13 = _mm_sub_epi32(z1, mul_const(tmp13, FIX_1_961570560));
+
+  out[1] = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(tmp0, tmp10), tmp12),
+			  shift);
+  out[3] = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(tmp1, tmp11), tmp13),
+			  shift);
+  out[5] = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(tmp2, tmp11), tmp12),
+			  shift);
+  out[7] = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(tmp3, tmp10), tmp13),
+			  shift);
+}
+
+
+GLOBAL(void) SSE2
+jsimd_fdct_islow (DCTELEM * data, JSAMPARRAY sample_data, JDIMENSION start_col)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i samples[DCTSIZE], in[DCTSIZE];
+  __m128i workspace[2][DCTSIZE];	/* [row group][coefficient] after pass 1 */
+  int ctr, half;
+
+  for (ctr = 0; ctr < DCTSIZE; ctr++)
+    samples[ctr] = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)
+				       (sample_data[ctr] + start_col)), zero);
+
+  /* Pass 1: process rows, four at a time */
+
+  transpose_8x8_epi16(samples);
+  for (half = 0; half < 2; half++) {
+    for (ctr = 0; ctr < DCTSIZE; ctr++)
+      in[ctr] = half ? _mm_unpackhi_epi16(samples[ctr], zero)
+		     : _mm_unpacklo_epi16(samples[ctr], zero);
+    fdct_1d(in, workspace[half], TRUE);
+  }
+
+  /* Pass 2: process columns, four at a time */
+
+  for (half = 0; half < 2; half++) {
+    for (ctr = 0; ctr < 4; ctr++) {
+      in[ctr] = workspace[0][half * 4 + ctr];
+      in[4 + ctr] = workspace[1][half * 4 + ctr];
+    }
+    transpose_4x4(&in[0], &in[1], &in[2], &in[3]);
+    transpose_4x4(&in[4], &in[5], &in[6], &in[7]);
+    fdct_1d(in, in, FALSE);
+    for (ctr = 0; ctr < DCTSIZE; ctr++)
+      _mm_storeu_si128((__m128i *) (data + ctr * DCTSIZE + half * 4), in[ctr]);
+  }
+}
+
+
+/*
+ * Color conversions, see jccolor.c and jdcolor.c.  The C code looks up
+ * tables of the products; here the products are computed, with the same
+ * constants and rounding.  Sixteen pixels are converted at once; the last
+ * ones of a row go through a small buffer.
+ */
+
+#define SCALEBITS	16
+#define CBCR_OFFSET	((INT32) CENTERJSAMPLE << SCALEBITS)
+#define ONE_HALF	((INT32) 1 << (SCALEBITS-1))
+#define FIX16(x)	((INT32) ((x) * (1L<<SCALEBITS) + 0.5))
+
+/* Products by constants up to 2^17 */
+
+SSE2_LOCAL __m128i
+mul_const17 (__m128i x, INT32 c)
+{
+  if (c >= 65536)
+    return _mm_add_epi32(mul_const(x, (int) (c - 65536)), _mm_slli_epi32(x, 16));
+  return mul_const(x, (int) c);
+}
+
+/* Cb or Cr values 0..15 (or 4..7 with high) of v, less CENTERJSAMPLE */
+
+SSE2_LOCAL void
+ycc_rgb_chroma (__m128i v, __m128i * x)
+{
+  __m128i center = _mm_set1_epi16(CENTERJSAMPLE);
+  __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(v, _mm_setzero_si128()), center);
+  __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(v, _mm_setzero_si128()), center);
+
+  x[0] = _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16);
+  x[1] = _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16);
+  x[2] = _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16);
+  x[3] = _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16);
+}
+
+/* Packs four vectors of 32-bit values, adds them to y and clamps them */
+
+SSE2_LOCAL __m128i
+ycc_rgb_add (__m128i y, const __m128i * v)
+{
+  __m128i zero = _mm_setzero_si128();
+
+  return _mm_packus_epi16(
+	_mm_add_epi16(_mm_unpacklo_epi8(y, zero), _mm_packs_epi32(v[0], v[1])),
+	_mm_add_epi16(_mm_unpackhi_epi8(y, zero), _mm_packs_epi32(v[2], v[3])));
+}
+
+/* Stores four pixels held in the low 24 bits of the 32-bit lanes of p */
+
+SSE2_LOCAL void
+store_rgb4 (JSAMPROW outptr, __m128i p, boolean last)
+{
+  __m128i even = _mm_set_epi32(0, -1, 0, -1);
+  __m128i w;
+  int tail;
+
+  /* Two pixels in six bytes in each 64-bit half, then 12 bytes in a row */
+  w = _mm_or_si128(_mm_and_si128(p, even),
+		   _mm_srli_epi64(_mm_andnot_si128(even, p), 8));
+  w = _mm_or_si128(_mm_move_epi64(w), _mm_slli_si128(_mm_srli_si128(w, 8), 6));
+  if (! last) {
+    /* The four extra bytes are overwritten by the next pixels */
+    _mm_storeu_si128((__m128i *) outptr, w);
+  } else {
+    _mm_storel_epi64((__m128i *) outptr, w);
+    tail = _mm_cvtsi128_si32(_mm_srli_si128(w, 8));
+    MEMCOPY(outptr + 8, &tail, 4);
+  }
+}
+
+SSE2_LOCAL void
+ycc_rgb_16 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2, JSAMPROW outptr)
+{
+  __m128i y = _mm_loadu_si128((__m128i *) inptr0);
+  __m128i cb[4], cr[4], red[4], green[4], blue[4];
+  __m128i one_half = _mm_set1_epi32(ONE_HALF);
+  __m128i r, g, b, rg, bz;
+  __m128i zero = _mm_setzero_si128();
+  int i;
+
+  ycc_rgb_chroma(_mm_loadu_si128((__m128i *) inptr1), cb);
+  ycc_rgb_chroma(_mm_loadu_si128((__m128i *) inptr2), cr);
+  for (i = 0; i < 4; i++) {
+    red[i] = _mm_srai_epi32(_mm_add_epi32(mul_const17(cr[i], FIX16(1.40200)),
+					  one_half), SCALEBITS);
+    blue[i] = _mm_srai_epi32(_mm_add_epi32(mul_const17(cb[i], FIX16(1.77200)),
+					   one_half), SCALEBITS);
+    green[i] = _mm_srai_epi32(_mm_sub_epi32(
+			_mm_sub_epi32(one_half,
+				      mul_const17(cb[i], FIX16(0.34414))),
+			mul_const17(cr[i], FIX16(0.71414))), SCALEBITS);
+  }
+  r = ycc_rgb_add(y, red);
+  g = ycc_rgb_add(y, green);
+  b = ycc_rgb_add(y, blue);
+
+  rg = _mm_unpacklo_epi8(r, g);
+  bz = _mm_unpacklo_epi8(b, zero);
+  store_rgb4(outptr, _mm_unpacklo_epi16(rg, bz), FALSE);
+  store_rgb4(outptr + 12, _mm_unpackhi_epi16(rg, bz), FALSE);
+  rg = _mm_unpackhi_epi8(r, g);
+  bz = _mm_unpackhi_epi8(b, zero);
+  store_rgb4(outptr + 24, _mm_unpacklo_epi16(rg, bz), FALSE);
+  store_rgb4(outptr + 36, _mm_unpackhi_epi16(rg, bz), TRUE);
+}
+
+
+GLOBAL(void) SSE2
+jsimd_ycc_rgb_convert (j_decompress_ptr cinfo,
+		       JSAMPIMAGE input_buf, JDIMENSION input_row,
+		       JSAMPARRAY output_buf, int num_rows)
+{
+  JSAMPROW inptr0, inptr1, inptr2, outptr;
+  JDIMENSION col, num_cols = cinfo->output_width;
+  JSAMPLE tmp_in[3][16], tmp_out[16 * RGB_PIXELSIZE];
+
+  while (--num_rows >= 0) {
+    inptr0 = input_buf[0][input_row];
+    inptr1 = input_buf[1][input_row];
+    inptr2 = input_buf[2][input_row];
+    input_row++;
+    outptr = *output_buf++;
+    for (col = 0; col + 16 <= num_cols; col += 16)
+      ycc_rgb_16(inptr0 + col, inptr1 + col, inptr2 + col,
+		 outptr + col * RGB_PIXELSIZE);
+    if (col < num_cols) {
+      MEMZERO(tmp_in, SIZEOF(tmp_in));
+      MEMCOPY(tmp_in[0], inptr0 + col, num_cols - col);
+      MEMCOPY(tmp_in[1], inptr1 + col, num_cols - col);
+      MEMCOPY(tmp_in[2], inptr2 + col, num_cols - col);
+      ycc_rgb_16(tmp_in[0], tmp_in[1], tmp_in[2], tmp_out);
+      MEMCOPY(outptr + col * RGB_PIXELSIZE, tmp_out,
+	      (num_cols - col) * RGB_PIXELSIZE);
+    }
+  }
+}
+
+
+/* Y, Cb and Cr of four pixels; inptr must allow reading 16 bytes */
+
+SSE2_LOCAL void
+rgb_ycc_4 (JSAMPROW inptr, __m128i * y, __m128i * cb, __m128i * cr)
+{
+  __m128i v = _mm_loadu_si128((__m128i *) inptr);
+  __m128i mask24 = _mm_set_epi32(0, 0xFFFFFF, 0, 0xFFFFFF);
+  __m128i mask8 = _mm_set1_epi32(0xFF);
+  __m128i r, g, b, p;
+
+  /* One pixel in the low 24 bits of each 32-bit lane */
+  v = _mm_unpacklo_epi64(v, _mm_srli_si128(v, 6));
+  p = _mm_or_si128(_mm_and_si128(v, mask24),
+		   _mm_and_si128(_mm_slli_epi64(v, 8), _mm_slli_epi64(mask24, 32)));
+  r = _mm_and_si128(p, mask8);
+  g = _mm_and_si128(_mm_srli_epi32(p, 8), mask8);
+  b = _mm_srli_epi32(p, 16);
+
+  /* The results are never negative, see jccolor.c */
+  *y = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(
+	mul_const17(r, FIX16(0.29900)), mul_const17(g, FIX16(0.58700))),
+	_mm_add_epi32(mul_const17(b, FIX16(0.11400)),
+		      _mm_set1_epi32(ONE_HALF))), SCALEBITS);
+  *cb = _mm_srli_epi32(_mm_sub_epi32(_mm_sub_epi32(
+	_mm_add_epi32(mul_const17(b, FIX16(0.50000)),
+		      _mm_set1_epi32(CBCR_OFFSET + ONE_HALF-1)),
+	mul_const17(r, FIX16(0.16874))), mul_const17(g, FIX16(0.33126))),
+	SCALEBITS);
+  *cr = _mm_srli_epi32(_mm_sub_epi32(_mm_sub_epi32(
+	_mm_add_epi32(mul_const17(r, FIX16(0.50000)),
+		      _mm_set1_epi32(CBCR_OFFSET + ONE_HALF-1)),
+	mul_const17(g, FIX16(0.41869))), mul_const17(b, FIX16(0.08131))),
+	SCALEBITS);
+}
+
+/* Converts 16 pixels; inptr must allow reading 52 bytes */
+
+SSE2_LOCAL void
+rgb_ycc_16 (JSAMPROW inptr, JSAMPROW outptr0, JSAMPROW outptr1,
+	    JSAMPROW outptr2)
+{
+  __m128i y[4], cb[4], cr[4];
+  int i;
+
+  for (i = 0; i < 4; i++)
+    rgb_ycc_4(inptr + i * 4 * RGB_PIXELSIZE, &y[i], &cb[i], &cr[i]);
+  _mm_storeu_si128((__m128i *) outptr0,
+		   _mm_packus_epi16(_mm_packs_epi32(y[0], y[1]),
+				    _mm_packs_epi32(y[2], y[3])));
+  _mm_storeu_si128((__m128i *) outptr1,
+		   _mm_packus_epi16(_mm_packs_epi32(cb[0], cb[1]),
+				    _mm_packs_epi32(cb[2], cb[3])));
+  _mm_storeu_si128((__m128i *) outptr2,
+		   _mm_packus_epi16(_mm_packs_epi32(cr[0], cr[1]),
+				    _mm_packs_epi32(cr[2], cr[3])));
+}
+
+
+GLOBAL(void) SSE2
+jsimd_rgb_ycc_convert (j_compress_ptr cinfo,
+		       JSAMPARRAY input_buf, JSAMPIMAGE output_buf,
+		       JDIMENSION output_row, int num_rows)
+{
+  JSAMPROW inptr, outptr0, outptr1, outptr2;
+  JDIMENSION col, num_cols = cinfo->image_width;
+  JSAMPLE tmp_in[16 * RGB_PIXELSIZE + 4], tmp_out[3][16];
+
+  while (--num_rows >= 0) {
+    inptr = *input_buf++;
+    outptr0 = output_buf[0][output_row];
+    outptr1 = output_buf[1][output_row];
+    outptr2 = output_buf[2][output_row];
+    output_row++;
+    /* Each group of 16 pixels is read past by four bytes, so the last
+     * pixels go through the buffer even for a multiple of 16 pixels
+     */
+    for (col = 0; col + 18 <= num_cols; col += 16)
+      rgb_ycc_16(inptr + col * RGB_PIXELSIZE,
+		 outptr0 + col, outptr1 + col, outptr2 + col);
+    while (col < num_cols) {
+      JDIMENSION count = num_cols - col < 16 ? num_cols - col : 16;
+
+      MEMZERO(tmp_in, SIZEOF(tmp_in));
+      MEMCOPY(tmp_in, inptr + col * RGB_PIXELSIZE, count * RGB_PIXELSIZE);
+      rgb_ycc_16(tmp_in, tmp_out[0], tmp_out[1], tmp_out[2]);
+      MEMCOPY(outptr0 + col, tmp_out[0], count);
+      MEMCOPY(outptr1 + col, tmp_out[1], count);
+      MEMCOPY(outptr2 + col, tmp_out[2], count);
+      col += count;
+    }
+  }
+}
+
+
+/*
+ * Fancy upsampling, see jdsample.c.  The inner columns are processed 16 at
+ * a time, the first and last ones as in the C code.
+ */
+
+GLOBAL(void) SSE2
+jsimd_h2v1_fancy_upsample (j_decompress_ptr cinfo,
+			   jpeg_component_info * compptr,
+			   JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+  JSAMPARRAY output_data = *output_data_ptr;
+  JSAMPROW inptr, outptr;
+  JDIMENSION col, width = compptr->downsampled_width;
+  __m128i zero = _mm_setzero_si128();
+  __m128i one = _mm_set1_epi16(1), two = _mm_set1_epi16(2);
+  int invalue, outrow;
+
+  for (outrow = 0; outrow < cinfo->max_v_samp_factor; outrow++) {
+    inptr = input_data[outrow];
+    outptr = output_data[outrow];
+    /* Special case for first column */
+    invalue = GETJSAMPLE(inptr[0]);
+    outptr[0] = (JSAMPLE) invalue;
+    outptr[1] = (JSAMPLE) ((invalue * 3 + GETJSAMPLE(inptr[1]) + 2) >> 2);
+
+    /* General case: 3/4 * nearer pixel + 1/4 * further pixel */
+    for (col = 1; col + 17 <= width; col += 16) {
+      __m128i cur = _mm_loadu_si128((__m128i *) (inptr + col));
+      __m128i prev = _mm_loadu_si128((__m128i *) (inptr + col - 1));
+      __m128i next = _mm_loadu_si128((__m128i *) (inptr + col + 1));
+      __m128i c, even, odd;
+
+      c = _mm_unpacklo_epi8(cur, zero);
+      c = _mm_add_epi16(_mm_add_epi16(c, c), c);
+      even = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(c, one),
+				_mm_unpacklo_epi8(prev, zero)), 2);
+      odd = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(c, two),
+				_mm_unpacklo_epi8(next, zero)), 2);
+      _mm_storeu_si128((__m128i *) (outptr + col * 2),
+		       _mm_or_si128(even, _mm_slli_epi16(odd, 8)));
+
+      c = _mm_unpackhi_epi8(cur, zero);
+      c = _mm_add_epi16(_mm_add_epi16(c, c), c);
+      even = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(c, one),
+				_mm_unpackhi_epi8(prev, zero)), 2);
+      odd = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(c, two),
+				_mm_unpackhi_epi8(next, zero)), 2);
+      _mm_storeu_si128((__m128i *) (outptr + col * 2 + 16),
+		       _mm_or_si128(even, _mm_slli_epi16(odd, 8)));
+    }
+    for (; col < width - 1; col++) {
+      invalue = GETJSAMPLE(inptr[col]) * 3;
+      outptr[col * 2] = (JSAMPLE) ((invalue + GETJSAMPLE(inptr[col-1]) + 1) >> 2);
+      outptr[col * 2 + 1] = (JSAMPLE) ((invalue + GETJSAMPLE(inptr[col+1]) + 2) >> 2);
+    }
+
+    /* Special case for last column */
+    invalue = GETJSAMPLE(inptr[col]);
+    outptr[col * 2] = (JSAMPLE) ((invalue * 3 + GETJSAMPLE(inptr[col-1]) + 1) >> 2);
+    outptr[col * 2 + 1] = (JSAMPLE) invalue;
+  }
+}
+
+
+/* Column sums 3 * nearer + further of 16 columns, as two vectors */
+
+SSE2_LOCAL void
+h2v2_colsum (JSAMPROW inptr0, JSAMPROW inptr1, __m128i * sum)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i v0 = _mm_loadu_si128((__m128i *) inptr0);
+  __m128i v1 = _mm_loadu_si128((__m128i *) inptr1);
+  __m128i lo = _mm_unpacklo_epi8(v0, zero);
+  __m128i hi = _mm_unpackhi_epi8(v0, zero);
+
+  sum[0] = _mm_add_epi16(_mm_add_epi16(_mm_add_epi16(lo, lo), lo),
+			 _mm_unpacklo_epi8(v1, zero));
+  sum[1] = _mm_add_epi16(_mm_add_epi16(_mm_add_epi16(hi, hi), hi),
+			 _mm_unpackhi_epi8(v1, zero));
+}
+
+GLOBAL(void) SSE2
+jsimd_h2v2_fancy_upsample (j_decompress_ptr cinfo,
+			   jpeg_component_info * compptr,
+			   JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+  JSAMPARRAY output_data = *output_data_ptr;
+  JSAMPROW inptr0, inptr1, outptr;
+  JDIMENSION col, width = compptr->downsampled_width;
+  __m128i seven = _mm_set1_epi16(7), eight = _mm_set1_epi16(8);
+  int thiscolsum, lastcolsum, nextcolsum;
+  int inrow, outrow, v, i;
+
+  inrow = outrow = 0;
+  while (outrow < cinfo->max_v_samp_factor) {
+    for (v = 0; v < 2; v++) {
+      /* inptr0 points to nearest input row, inptr1 points to next nearest */
+      inptr0 = input_data[inrow];
+      if (v == 0)		/* next nearest is row above */
+	inptr1 = input_data[inrow-1];
+      else			/* next nearest is row below */
+	inptr1 = input_data[inrow+1];
+      outptr = output_data[outrow++];
+
+      /* Special case for first column */
+      thiscolsum = GETJSAMPLE(inptr0[0]) * 3 + GETJSAMPLE(inptr1[0]);
+      nextcolsum = GETJSAMPLE(inptr0[1]) * 3 + GETJSAMPLE(inptr1[1]);
+      outptr[0] = (JSAMPLE) ((thiscolsum * 4 + 8) >> 4);
+      outptr[1] = (JSAMPLE) ((thiscolsum * 3 + nextcolsum + 7) >> 4);
+
+      /* General case: 3/4 * nearer pixel + 1/4 * further pixel in each */
+      /* dimension, thus 9/16, 3/16, 3/16, 1/16 overall */
+      for (col = 1; col + 17 <= width; col += 16) {
+	__m128i cur[2], prev[2], next[2], c, even, odd;
+
+	h2v2_colsum(inptr0 + col, inptr1 + col, cur);
+	h2v2_colsum(inptr0 + col - 1, inptr1 + col - 1, prev);
+	h2v2_colsum(inptr0 + col + 1, inptr1 + col + 1, next);
+	for (i = 0; i < 2; i++) {
+	  c = _mm_add_epi16(_mm_add_epi16(cur[i], cur[i]), cur[i]);
+	  even = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(c, eight),
+					      prev[i]), 4);
+	  odd = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(c, seven),
+					     next[i]), 4);
+	  _mm_storeu_si128((__m128i *) (outptr + col * 2 + i * 16),
+			   _mm_or_si128(even, _mm_slli_epi16(odd, 8)));
+	}
+      }
+      lastcolsum = GETJSAMPLE(inptr0[col-1]) * 3 + GETJSAMPLE(inptr1[col-1]);
+      thiscolsum = GETJSAMPLE(inptr0[col]) * 3 + GETJSAMPLE(inptr1[col]);
+      for (; col < width - 1; col++) {
+	nextcolsum = GETJSAMPLE(inptr0[col+1]) * 3 + GETJSAMPLE(inptr1[col+1]);
+	outptr[col * 2] = (JSAMPLE) ((thiscolsum * 3 + lastcolsum + 8) >> 4);
+	outptr[col * 2 + 1] = (JSAMPLE) ((thiscolsum * 3 + nextcolsum + 7) >> 4);
+	lastcolsum = thiscolsum; thiscolsum = nextcolsum;
+      }
+
+      /* Special case for last column */
+      outptr[col * 2] = (JSAMPLE) ((thiscolsum * 3 + lastcolsum + 8) >> 4);
+      outptr[col * 2 + 1] = (JSAMPLE) ((thiscolsum * 4 + 7) >> 4);
+    }
+    inrow++;
+  }
+}
+
+#else /* ! SSE2_SUPPORTED */
+
+/* Never selected: the jsimd_can_xxx() routines return FALSE */
+
+GLOBAL(void)
+jsimd_idct_islow (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		  JCOEFPTR coef_block,
+		  JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  jpeg_idct_islow(cinfo, compptr, coef_block, output_buf, output_col);
+}
+
+GLOBAL(void)
+jsimd_fdct_islow (DCTELEM * data, JSAMPARRAY sample_data, JDIMENSION start_col)
+{
+  jpeg_fdct_islow(data, sample_data, start_col);
+}
+
+GLOBAL(void)
+jsimd_ycc_rgb_convert (j_decompress_ptr cinfo,
+		       JSAMPIMAGE input_buf, JDIMENSION input_row,
+		       JSAMPARRAY output_buf, int num_rows)
+{
+}
+
+GLOBAL(void)
+jsimd_rgb_ycc_convert (j_compress_ptr cinfo,
+		       JSAMPARRAY input_buf, JSAMPIMAGE output_buf,
+		       JDIMENSION output_row, int num_rows)
+{
+}
+
+GLOBAL(void)
+jsimd_h2v1_fancy_upsample (j_decompress_ptr cinfo,
+			   jpeg_component_info * compptr,
+			   JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+}
+
+GLOBAL(void)
+jsimd_h2v2_fancy_upsample (j_decompress_ptr cinfo,
+			   jpeg_component_info * compptr,
+			   JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+}
+
+#endif /* SSE2_SUPPORTED */
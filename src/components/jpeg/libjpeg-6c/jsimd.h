@@ -0,0 +1,51 @@
+/*
+ * jsimd.h
+ *
+ * This file is part of the Independent JPEG Group's software.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains declarations for the SIMD versions of the most
+ * time-consuming routines: the islow forward and inverse DCT, the
+ * RGB <=> YCbCr color conversions and the fancy 2:1 upsampling.
+ * Each jsimd_can_xxx() routine tells whether the corresponding jsimd_xxx()
+ * routine may be used on this machine; it checks the CPU once at run time
+ * and can be overridden by setting the environment variable JPEGSIMD to 0.
+ * The SIMD routines produce exactly the same output as the C ones.
+ * The SIMD DCT routines are declared in jdct.h with the C ones.
+ */
+
+
+/* Short forms of external names for systems with brain-damaged linkers. */
+
+#ifdef NEED_SHORT_EXTERNAL_NAMES
+#define jsimd_can_idct_islow		jSCRislow
+#define jsimd_can_fdct_islow		jSCFislow
+#define jsimd_can_ycc_rgb		jSCyccrgb
+#define jsimd_can_rgb_ycc		jSCrgbycc
+#define jsimd_can_h2v1_fancy_upsample	jSCh2v1fu
+#define jsimd_can_h2v2_fancy_upsample	jSCh2v2fu
+#define jsimd_ycc_rgb_convert		jSyccrgb
+#define jsimd_rgb_ycc_convert		jSrgbycc
+#define jsimd_h2v1_fancy_upsample	jSh2v1fu
+#define jsimd_h2v2_fancy_upsample	jSh2v2fu
+#endif /* NEED_SHORT_EXTERNAL_NAMES */
+
+EXTERN(int) jsimd_can_idct_islow JPP((void));
+EXTERN(int) jsimd_can_fdct_islow JPP((void));
+EXTERN(int) jsimd_can_ycc_rgb JPP((void));
+EXTERN(int) jsimd_can_rgb_ycc JPP((void));
+EXTERN(int) jsimd_can_h2v1_fancy_upsample JPP((void));
+EXTERN(int) jsimd_can_h2v2_fancy_upsample JPP((void));
+
+EXTERN(void) jsimd_ycc_rgb_convert
+    JPP((j_decompress_ptr cinfo, JSAMPIMAGE input_buf, JDIMENSION input_row,
+	 JSAMPARRAY output_buf, int num_rows));
+EXTERN(void) jsimd_rgb_ycc_convert
+    JPP((j_compress_ptr cinfo, JSAMPARRAY input_buf, JSAMPIMAGE output_buf,
+	 JDIMENSION output_row, int num_rows));
+EXTERN(void) jsimd_h2v1_fancy_upsample
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr));
+EXTERN(void) jsimd_h2v2_fancy_upsample
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr));
@@ -31,6 +31,7 @@
 #include <omx_base_image_port.h>
 
 #include <ctype.h>    /* to declare isprint() */
+#include <setjmp.h>
 #include "omx_jpegdec_component.h"
 
 /** Maximum Number of Image Mad Decoder Component Instance*/
@@ -49,6 +50,7 @@ static const char * const cdjpeg_message_table[] = {
 
 
 extern void finish_output_bmp_buf (j_decompress_ptr cinfo, djpeg_dest_ptr dinfo,char *buf);
+extern void write_bmp_header_mem (j_decompress_ptr cinfo, JDIMENSION row_width, JDIMENSION height, char* buf);
 
 /*
  * This list defines the known output image formats
@@ -108,8 +110,8 @@ OMX_ERRORTYPE omx_jpegdec_component_Constructor(OMX_COMPONENTTYPE *openmaxStandC
       return OMX_ErrorInsufficientResources;
     }
   }  else {
-    DEBUG(DEB_LEV_FUNCTION_NAME, "In %s, Error Component %x Already Allocated\n", 
-              __func__, (int)openmaxStandComp->pComponentPrivate);
+    DEBUG(DEB_LEV_FUNCTION_NAME, "In %s, Error Component %p Already Allocated\n", 
+              __func__, openmaxStandComp->pComponentPrivate);
   }
   
   omx_jpegdec_component_Private = openmaxStandComp->pComponentPrivate;
@@ -181,18 +183,32 @@ OMX_ERRORTYPE omx_jpegdec_component_Constructor(OMX_COMPONENTTYPE *openmaxStandC
     tsem_init(omx_jpegdec_component_Private->jpegdecSyncSem1, 0);
   }
 
+  if(!omx_jpegdec_component_Private->decodeSem) {
+    omx_jpegdec_component_Private->decodeSem = calloc(1,sizeof(tsem_t));
+    if(omx_jpegdec_component_Private->decodeSem == NULL) {
+      return OMX_ErrorInsufficientResources;
+    }
+    tsem_init(omx_jpegdec_component_Private->decodeSem, 0);
+  }
+  pthread_mutex_init(&omx_jpegdec_component_Private->decodeMutex, NULL);
+
   /** general configuration irrespective of any image formats
     *  setting values of other fields of omx_jpegdec_component_Private structure  
     */ 
   omx_jpegdec_component_Private->jpegdecReady = OMX_FALSE;
   omx_jpegdec_component_Private->hMarkTargetComponent = NULL;
   omx_jpegdec_component_Private->nFlags = 0x0;
+  omx_jpegdec_component_Private->nDecodeThreads = 0;
+  omx_jpegdec_component_Private->nRunningThreads = 0;
   //omx_jpegdec_component_Private->BufferMgmtCallback = omx_jpegdec_component_BufferMgmtCallback;
   omx_jpegdec_component_Private->BufferMgmtFunction = omx_jpegdec_component_BufferMgmtFunction;
+  /* The own loop blocks, it cannot run on the shared executor */
+  omx_jpegdec_component_Private->BufferMgmtStep = NULL;
   omx_jpegdec_component_Private->messageHandler = omx_jpegdec_decoder_MessageHandler;
   omx_jpegdec_component_Private->destructor = omx_jpegdec_component_Destructor;
   openmaxStandComp->SetParameter = omx_jpegdec_component_SetParameter;
   openmaxStandComp->GetParameter = omx_jpegdec_component_GetParameter;
+  openmaxStandComp->GetExtensionIndex = omx_jpegdec_component_GetExtensionIndex;
 
   nojpegdecInstance++;
 
@@ -204,12 +220,42 @@ OMX_ERRORTYPE omx_jpegdec_component_Constructor(OMX_COMPONENTTYPE *openmaxStandC
   return err;
 }
 
+/** Stops the decoding threads. No band is left when the component is idle:
+ * each thread takes a wake up as the request to exit. The threads are taken
+ * under decodeMutex, so that the message handler and the destructor do not
+ * both join them
+ */
+static void omx_jpegdec_component_StopDecodeThreads(omx_jpegdec_component_PrivateType* omx_jpegdec_component_Private) {
+  pthread_t* decodeThreads;
+  OMX_U32 i, nThreads;
+
+  pthread_mutex_lock(&omx_jpegdec_component_Private->decodeMutex);
+  decodeThreads = omx_jpegdec_component_Private->decodeThreads;
+  nThreads = omx_jpegdec_component_Private->nRunningThreads;
+  omx_jpegdec_component_Private->decodeThreads = NULL;
+  omx_jpegdec_component_Private->nRunningThreads = 0;
+  pthread_mutex_unlock(&omx_jpegdec_component_Private->decodeMutex);
+
+  if (decodeThreads == NULL) {
+    return;
+  }
+  for (i = 0; i < nThreads; i++) {
+    tsem_up(omx_jpegdec_component_Private->decodeSem);
+  }
+  for (i = 0; i < nThreads; i++) {
+    pthread_join(decodeThreads[i], NULL);
+  }
+  free(decodeThreads);
+}
+
 /** The destructor */
 OMX_ERRORTYPE omx_jpegdec_component_Destructor(OMX_COMPONENTTYPE *openmaxStandComp) {
 
   omx_jpegdec_component_PrivateType* omx_jpegdec_component_Private = openmaxStandComp->pComponentPrivate;
   OMX_U32 i;
 
+  omx_jpegdec_component_StopDecodeThreads(omx_jpegdec_component_Private);
+
   if(omx_jpegdec_component_Private->jpegdecSyncSem) {
     tsem_deinit(omx_jpegdec_component_Private->jpegdecSyncSem);
     free(omx_jpegdec_component_Private->jpegdecSyncSem);
@@ -222,6 +268,13 @@ OMX_ERRORTYPE omx_jpegdec_component_Destructor(OMX_COMPONENTTYPE *openmaxStandCo
     omx_jpegdec_component_Private->jpegdecSyncSem1 = NULL;
   }
 
+  if(omx_jpegdec_component_Private->decodeSem) {
+    tsem_deinit(omx_jpegdec_component_Private->decodeSem);
+    free(omx_jpegdec_component_Private->decodeSem);
+    omx_jpegdec_component_Private->decodeSem = NULL;
+  }
+  pthread_mutex_destroy(&omx_jpegdec_component_Private->decodeMutex);
+
   /* frees port/s */
   if (omx_jpegdec_component_Private->ports) {
     for (i=0; i < omx_jpegdec_component_Private->sPortTypesParam[OMX_PortDomainImage].nPorts; i++) {
@@ -248,8 +301,28 @@ OMX_ERRORTYPE omx_jpegdec_component_Init(OMX_COMPONENTTYPE *openmaxStandComp)  {
   omx_jpegdec_component_PrivateType* omx_jpegdec_component_Private = openmaxStandComp->pComponentPrivate;
   OMX_ERRORTYPE err = OMX_ErrorNone;
 
+  OMX_U32 i;
+
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s \n",__func__);
 
+  if (omx_jpegdec_component_Private->nDecodeThreads > 0) {
+    /* Images are decoded by the decoding threads, each with its own decompression object */
+    omx_jpegdec_component_Private->decodeThreads = calloc(omx_jpegdec_component_Private->nDecodeThreads, sizeof(pthread_t));
+    if (omx_jpegdec_component_Private->decodeThreads == NULL) {
+      return OMX_ErrorInsufficientResources;
+    }
+    for (i = 0; i < omx_jpegdec_component_Private->nDecodeThreads; i++) {
+      if (pthread_create(&omx_jpegdec_component_Private->decodeThreads[i], NULL,
+                         omx_jpegdec_component_DecodeFunction, omx_jpegdec_component_Private) != 0) {
+        DEBUG(DEB_LEV_ERR, "In %s cannot start decoding thread %d\n", __func__, (int)i);
+        omx_jpegdec_component_StopDecodeThreads(omx_jpegdec_component_Private);
+        return OMX_ErrorInsufficientResources;
+      }
+      omx_jpegdec_component_Private->nRunningThreads = i + 1;
+    }
+    return err;
+  }
+
   /* Initialize the JPEG decompression object with default error handling. */
   omx_jpegdec_component_Private->cinfo.err = jpeg_std_error(&omx_jpegdec_component_Private->jerr);
   jpeg_create_decompress(&omx_jpegdec_component_Private->cinfo);
@@ -294,6 +367,7 @@ OMX_ERRORTYPE omx_jpegdec_component_SetParameter(
   OMX_ERRORTYPE err = OMX_ErrorNone;
   OMX_IMAGE_PARAM_PORTFORMATTYPE *pImagePortFormat;
   OMX_PARAM_COMPONENTROLETYPE * pComponentRole;
+  OMX_PARAM_U32TYPE *pThreads;
   OMX_U32 portIndex;
 
   /* Check which structure we are being fed and make control its header */
@@ -305,7 +379,7 @@ OMX_ERRORTYPE omx_jpegdec_component_SetParameter(
   }
 
   DEBUG(DEB_LEV_SIMPLE_SEQ, "   Setting parameter %i\n", nParamIndex);
-  switch(nParamIndex) {
+  switch((OMX_U32)nParamIndex) {
   case OMX_IndexParamImagePortFormat:
     pImagePortFormat = (OMX_IMAGE_PARAM_PORTFORMATTYPE*)ComponentParameterStructure;
     portIndex = pImagePortFormat->nPortIndex;
@@ -333,6 +407,21 @@ OMX_ERRORTYPE omx_jpegdec_component_SetParameter(
     //omx_jpegdec_component_SetInternalParameters(openmaxStandComp);
     break;
 
+  case OMX_IndexVendorDecodeThreads:
+    pThreads = (OMX_PARAM_U32TYPE*)ComponentParameterStructure;
+    if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_PARAM_U32TYPE))) != OMX_ErrorNone) {
+      break;
+    }
+    /* The threads are started on the transition to Idle */
+    if (omx_jpegdec_component_Private->state != OMX_StateLoaded) {
+      return OMX_ErrorIncorrectStateOperation;
+    }
+    if (pThreads->nU32 > MAX_DECODE_THREADS) {
+      return OMX_ErrorBadParameter;
+    }
+    omx_jpegdec_component_Private->nDecodeThreads = pThreads->nU32;
+    break;
+
   default: /*Call the base component function*/
     return omx_base_component_SetParameter(hComponent, nParamIndex, ComponentParameterStructure);
   }
@@ -348,6 +437,7 @@ OMX_ERRORTYPE omx_jpegdec_component_GetParameter(
 
   OMX_IMAGE_PARAM_PORTFORMATTYPE *pImagePortFormat;  
   OMX_PARAM_COMPONENTROLETYPE * pComponentRole;
+  OMX_PARAM_U32TYPE *pThreads;
   omx_base_image_PortType *port;
   OMX_ERRORTYPE err = OMX_ErrorNone;
 
@@ -358,7 +448,7 @@ OMX_ERRORTYPE omx_jpegdec_component_GetParameter(
   }
   DEBUG(DEB_LEV_SIMPLE_SEQ, "   Getting parameter %i\n", nParamIndex);
   /* Check which structure we are being fed and fill its header */
-  switch(nParamIndex) {
+  switch((OMX_U32)nParamIndex) {
   case OMX_IndexParamImageInit:
     if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_PORT_PARAM_TYPE))) != OMX_ErrorNone) { 
       break;
@@ -390,6 +480,13 @@ OMX_ERRORTYPE omx_jpegdec_component_GetParameter(
       strcpy( (char*) pComponentRole->cRole,"\0");;
     }
     break;
+  case OMX_IndexVendorDecodeThreads:
+    pThreads = (OMX_PARAM_U32TYPE*)ComponentParameterStructure;
+    if ((err = checkHeader(ComponentParameterStructure, sizeof(OMX_PARAM_U32TYPE))) != OMX_ErrorNone) {
+      break;
+    }
+    pThreads->nU32 = omx_jpegdec_component_Private->nDecodeThreads;
+    break;
   default: /*Call the base component function*/
     return omx_base_component_GetParameter(hComponent, nParamIndex, ComponentParameterStructure);
   }
@@ -397,6 +494,22 @@ OMX_ERRORTYPE omx_jpegdec_component_GetParameter(
   
 }
 
+/** Returns the index of the vendor parameter setting the number of decoding threads */
+OMX_ERRORTYPE omx_jpegdec_component_GetExtensionIndex(
+  OMX_IN  OMX_HANDLETYPE hComponent,
+  OMX_IN  OMX_STRING cParameterName,
+  OMX_OUT OMX_INDEXTYPE* pIndexType) {
+
+  DEBUG(DEB_LEV_FUNCTION_NAME,"In  %s \n",__func__);
+
+  if(strcmp(cParameterName,IMAGE_DEC_JPEG_THREADS_NAME) == 0) {
+    *pIndexType = OMX_IndexVendorDecodeThreads;
+  } else {
+    return omx_base_component_GetExtensionIndex(hComponent, cParameterName, pIndexType);
+  }
+  return OMX_ErrorNone;
+}
+
 /*
  * Marker processor for COM and interesting APPn markers.
  * This replaces the library's built-in processor, which just skips the marker.
@@ -580,6 +693,10 @@ void* omx_jpegdec_component_BufferMgmtFunction(void* param)
   static OMX_S32 first=1;
   JDIMENSION num_scanlines;
   OMX_S32 width, height;
+
+  if(omx_jpegdec_component_Private->nDecodeThreads > 0) {
+    return omx_jpegdec_component_PoolBufferMgmtFunction(param);
+  }
     
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
   while(omx_jpegdec_component_Private->state == OMX_StateIdle || omx_jpegdec_component_Private->state == OMX_StateExecuting ||  
@@ -638,12 +755,12 @@ void* omx_jpegdec_component_BufferMgmtFunction(void* param)
     /*When we have input buffer to process then get one output buffer*/
     if(pOutputSem->semval>0 && isOutputBufferNeeded==OMX_TRUE) {
       tsem_down(pOutputSem);
-      if(pOutputQueue->nelem>0){
+      if(getquenelem(pOutputQueue)>0){
         outBufExchanged++;
         isOutputBufferNeeded=OMX_FALSE;
         pOutputBuffer = dequeue(pOutputQueue);
         if(pOutputBuffer == NULL){
-          DEBUG(DEB_LEV_ERR, "Had NULL output buffer!! op is=%d,iq=%d\n",pOutputSem->semval,pOutputQueue->nelem);
+          DEBUG(DEB_LEV_ERR, "Had NULL output buffer!! op is=%d,iq=%d\n",pOutputSem->semval,getquenelem(pOutputQueue));
           break;
         }
       }
@@ -771,6 +888,704 @@ void* omx_jpegdec_component_BufferMgmtFunction(void* param)
 
 #endif
 
+/* Decoding threads
+ *
+ * The buffer management thread gathers each image from the input buffers,
+ * returns them at once and hands the image to the decoding threads with an
+ * output buffer. An image whose scan has restart markers on MCU row
+ * boundaries is split in bands of rows when some threads are idle. Each
+ * band is decoded as an image of its own, rebuilt from the headers and the
+ * restart intervals of its rows. It starts and ends one run of intervals
+ * beyond its rows, so that the upsampling of its edges sees the same
+ * neighbours as in the whole image. Output buffers are returned in the
+ * order of the images.
+ */
+
+/** Smallest number of runs of restart intervals decoded by a band */
+#define MIN_BAND_UNITS 4
+
+/** Size of the BMP header written before the rows */
+#define BMP_HEADER_SIZE 54
+
+#define IMAGE_IS_COMPLETE(pImage) ((pImage)->nFlags & (OMX_BUFFERFLAG_ENDOFFRAME | OMX_BUFFERFLAG_EOS))
+
+/** Error manager of the decoding threads: a corrupt image fails instead of exiting */
+typedef struct {
+  struct jpeg_error_mgr pub;
+  jmp_buf setjmp_buffer;
+} jpegdec_error_mgr;
+
+static void jpegdec_error_exit(j_common_ptr cinfo) {
+  jpegdec_error_mgr* err = (jpegdec_error_mgr*) cinfo->err;
+  char buffer[JMSG_LENGTH_MAX];
+
+  (*cinfo->err->format_message) (cinfo, buffer);
+  DEBUG(DEB_LEV_ERR, "In %s %s\n", __func__, buffer);
+  longjmp(err->setjmp_buffer, 1);
+}
+
+static void jpegdec_output_message(j_common_ptr cinfo) {
+  char buffer[JMSG_LENGTH_MAX];
+
+  (*cinfo->err->format_message) (cinfo, buffer);
+  DEBUG(DEB_LEV_PARAMS, "In %s %s\n", __func__, buffer);
+}
+
+/* Source manager reading an image from memory */
+
+static void mem_init_source(j_decompress_ptr cinfo) {
+}
+
+static boolean mem_fill_input_buffer(j_decompress_ptr cinfo) {
+  static const JOCTET eoi[2] = { 0xFF, JPEG_EOI };
+
+  /* Truncated image: insert a fake EOI marker */
+  WARNMS(cinfo, JWRN_JPEG_EOF);
+  cinfo->src->next_input_byte = eoi;
+  cinfo->src->bytes_in_buffer = 2;
+  return TRUE;
+}
+
+static void mem_skip_input_data(j_decompress_ptr cinfo, long num_bytes) {
+  if (num_bytes <= 0) {
+    return;
+  }
+  if ((size_t) num_bytes > cinfo->src->bytes_in_buffer) {
+    (void) mem_fill_input_buffer(cinfo);
+  } else {
+    cinfo->src->next_input_byte += num_bytes;
+    cinfo->src->bytes_in_buffer -= num_bytes;
+  }
+}
+
+static void mem_term_source(j_decompress_ptr cinfo) {
+}
+
+static void jpegdec_mem_src(j_decompress_ptr cinfo, const OMX_U8* pData, OMX_U32 nLen) {
+  if (cinfo->src == NULL) {
+    cinfo->src = (struct jpeg_source_mgr *)
+      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT, sizeof(struct jpeg_source_mgr));
+  }
+  cinfo->src->init_source = mem_init_source;
+  cinfo->src->fill_input_buffer = mem_fill_input_buffer;
+  cinfo->src->skip_input_data = mem_skip_input_data;
+  cinfo->src->resync_to_restart = jpeg_resync_to_restart;
+  cinfo->src->term_source = mem_term_source;
+  cinfo->src->next_input_byte = pData;
+  cinfo->src->bytes_in_buffer = nLen;
+}
+
+static OMX_U32 jpegdec_gcd(OMX_U32 a, OMX_U32 b) {
+  OMX_U32 t;
+
+  while (b != 0) {
+    t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+/** Finds the restart intervals of the scan of an image. It is split only when
+ * it is a single sequential Huffman scan with all the components
+ */
+static void jpegdec_FindIntervals(jpegdec_image_t* pImage, OMX_U32 nSof, OMX_U32 nComps, OMX_U32 nScanComps,
+                                  OMX_U32 nRestart, OMX_U32 hMax, OMX_U32 vMax) {
+  OMX_U8* p = pImage->pData;
+  OMX_U8* q;
+  OMX_U32 nMcuWidth, nMcuHeight, nMcusPerRow, nMcus, nRowIntervals, i, k;
+
+  pImage->nUnits = 0;
+  if ((nSof != 0xC0 && nSof != 0xC1) || nRestart == 0 || pImage->nHeight == 0 ||
+      nScanComps != nComps || (nComps != 1 && nComps != 3)) {
+    return;
+  }
+  if (nComps == 1) {
+    nMcuWidth = nMcuHeight = DCTSIZE;
+  } else {
+    nMcuWidth = hMax * DCTSIZE;
+    nMcuHeight = vMax * DCTSIZE;
+  }
+  nMcusPerRow = (pImage->nWidth + nMcuWidth - 1) / nMcuWidth;
+  nMcus = nMcusPerRow * ((pImage->nHeight + nMcuHeight - 1) / nMcuHeight);
+  pImage->nIntervals = (nMcus + nRestart - 1) / nRestart;
+  /* Runs of whole intervals covering whole MCU rows */
+  nRowIntervals = nMcusPerRow / jpegdec_gcd(nRestart, nMcusPerRow);
+  pImage->nUnitIntervals = nRowIntervals;
+  pImage->nUnitRows = nRowIntervals * nRestart / nMcusPerRow * nMcuHeight;
+  if (pImage->nIntervals <= nRowIntervals) {
+    return;
+  }
+
+  pImage->pSegments = malloc(2 * pImage->nIntervals * sizeof(OMX_U32));
+  if (pImage->pSegments == NULL) {
+    return;
+  }
+  k = 0;
+  pImage->pSegments[0] = pImage->nHeaderLen;
+  for (i = pImage->nHeaderLen; i + 1 < pImage->nLen; i++) {
+    q = memchr(p + i, 0xFF, pImage->nLen - 1 - i);
+    if (q == NULL) {
+      break;
+    }
+    i = q - p;
+    if (p[i + 1] == 0x00 || p[i + 1] == 0xFF) {
+      /* Stuffed byte or fill byte */
+      continue;
+    }
+    if (p[i + 1] >= JPEG_RST0 && p[i + 1] <= JPEG_RST0 + 7 && k + 1 < pImage->nIntervals) {
+      pImage->pSegments[2 * k + 1] = i;
+      k++;
+      pImage->pSegments[2 * k] = i + 2;
+      i++;
+      continue;
+    }
+    if (p[i + 1] == JPEG_EOI && k + 1 == pImage->nIntervals) {
+      pImage->pSegments[2 * k + 1] = i;
+      pImage->nUnits = (pImage->nIntervals + nRowIntervals - 1) / nRowIntervals;
+      return;
+    }
+    /* Any other marker: more scans, or intervals not matching the frame */
+    break;
+  }
+  DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s restart intervals not found, image not split\n", __func__);
+  free(pImage->pSegments);
+  pImage->pSegments = NULL;
+}
+
+/** Reads the frame header of an image
+ *
+ * @return OMX_ErrorStreamCorrupt if there is no frame header before the scan
+ */
+static OMX_ERRORTYPE jpegdec_ParseImage(jpegdec_image_t* pImage) {
+  OMX_U8* p = pImage->pData;
+  OMX_U32 i = 2, nLen, nMarker, c;
+  OMX_U32 nSof = 0, nComps = 0, nScanComps = 0, nRestart = 0, hMax = 1, vMax = 1;
+
+  if (pImage->nLen < 4 || p[0] != 0xFF || p[1] != 0xD8) {
+    return OMX_ErrorStreamCorrupt;
+  }
+  while (i + 4 <= pImage->nLen && p[i] == 0xFF) {
+    if (p[i + 1] == 0xFF) {
+      /* Fill byte */
+      i++;
+      continue;
+    }
+    nMarker = p[i + 1];
+    nLen = (p[i + 2] << 8) | p[i + 3];
+    if (i + 2 + nLen > pImage->nLen) {
+      break;
+    }
+    if (nMarker >= 0xC0 && nMarker <= 0xCF && nMarker != 0xC4 && nMarker != 0xC8 && nMarker != 0xCC && nLen >= 8) {
+      /* Start of frame */
+      nSof = nMarker;
+      pImage->nSofOffset = i;
+      pImage->nHeight = (p[i + 5] << 8) | p[i + 6];
+      pImage->nWidth = (p[i + 7] << 8) | p[i + 8];
+      nComps = p[i + 9];
+      for (c = 0; c < nComps && 10 + 3 * c + 2 < 2 + nLen; c++) {
+        hMax = (p[i + 11 + 3 * c] >> 4) > hMax ? (p[i + 11 + 3 * c] >> 4) : hMax;
+        vMax = (p[i + 11 + 3 * c] & 0x0F) > vMax ? (p[i + 11 + 3 * c] & 0x0F) : vMax;
+      }
+    } else if (nMarker == 0xDD && nLen >= 4) {
+      /* Define restart interval */
+      nRestart = (p[i + 4] << 8) | p[i + 5];
+    } else if (nMarker == 0xDA) {
+      /* Start of scan */
+      nScanComps = p[i + 4];
+      pImage->nHeaderLen = i + 2 + nLen;
+      break;
+    }
+    i += 2 + nLen;
+  }
+  if (nSof == 0 || pImage->nHeaderLen == 0) {
+    return OMX_ErrorStreamCorrupt;
+  }
+  pImage->nComponents = nComps == 3 ? 3 : 1;
+  jpegdec_FindIntervals(pImage, nSof, nComps, nScanComps, nRestart, hMax, vMax);
+  return OMX_ErrorNone;
+}
+
+/** Writes in pData the image of the rows of the units [nFirst, nLast) */
+static OMX_U32 jpegdec_BuildBand(jpegdec_image_t* pImage, OMX_U32 nFirst, OMX_U32 nLast, OMX_U8* pData) {
+  OMX_U32 nFirstInterval = nFirst * pImage->nUnitIntervals;
+  OMX_U32 nLastInterval = nLast * pImage->nUnitIntervals;
+  OMX_U32 nHeight = (nLast - nFirst) * pImage->nUnitRows;
+  OMX_U32 nLen, nSegmentLen, k;
+
+  if (nLastInterval > pImage->nIntervals) {
+    nLastInterval = pImage->nIntervals;
+  }
+  if (nHeight > pImage->nHeight - nFirst * pImage->nUnitRows) {
+    nHeight = pImage->nHeight - nFirst * pImage->nUnitRows;
+  }
+  memcpy(pData, pImage->pData, pImage->nHeaderLen);
+  pData[pImage->nSofOffset + 5] = nHeight >> 8;
+  pData[pImage->nSofOffset + 6] = nHeight & 0xFF;
+  nLen = pImage->nHeaderLen;
+  for (k = nFirstInterval; k < nLastInterval; k++) {
+    nSegmentLen = pImage->pSegments[2 * k + 1] - pImage->pSegments[2 * k];
+    memcpy(pData + nLen, pImage->pData + pImage->pSegments[2 * k], nSegmentLen);
+    nLen += nSegmentLen;
+    pData[nLen++] = 0xFF;
+    /* The restart markers of the band are numbered from 0 */
+    pData[nLen++] = k + 1 < nLastInterval ? JPEG_RST0 + ((k - nFirstInterval) & 7) : JPEG_EOI;
+  }
+  return nLen;
+}
+
+/** Decodes a band of an image and writes its rows in the output buffer
+ *
+ * @return OMX_FALSE if the band cannot be decoded
+ */
+static OMX_BOOL jpegdec_DecodeBand(j_decompress_ptr cinfo, jpegdec_error_mgr* jerr, jpegdec_band_t* pBand,
+                                   OMX_U8** ppScratch, OMX_U32* pnScratchLen) {
+  jpegdec_image_t* pImage = pBand->pImage;
+  OMX_U8* pOut = pImage->pOutputBuffer->pBuffer;
+  OMX_U32 nRowWidth = (pImage->nWidth * pImage->nComponents + 3) & ~3;
+  OMX_U8* pData = pImage->pData;
+  OMX_U32 nLen = pImage->nLen;
+  OMX_U32 nFirstRow = 0, nSkipRows = 0, nRows = pImage->nHeight;
+  OMX_U32 nFirst, nLast, nStart, nEnd, y, x;
+  JSAMPARRAY row;
+  JSAMPROW pIn;
+  OMX_U8* pRow;
+
+  if (pImage->nBands > 1) {
+    nFirst = pBand->nBand * pImage->nUnits / pImage->nBands;
+    nLast = (pBand->nBand + 1) * pImage->nUnits / pImage->nBands;
+    /* One more run of intervals above and below the rows of the band */
+    nStart = nFirst > 0 ? nFirst - 1 : 0;
+    nEnd = nLast < pImage->nUnits ? nLast + 1 : nLast;
+    if (*pnScratchLen < pImage->nLen + 2 * pImage->nIntervals) {
+      free(*ppScratch);
+      *pnScratchLen = pImage->nLen + 2 * pImage->nIntervals;
+      *ppScratch = malloc(*pnScratchLen);
+      if (*ppScratch == NULL) {
+        *pnScratchLen = 0;
+        return OMX_FALSE;
+      }
+    }
+    pData = *ppScratch;
+    nLen = jpegdec_BuildBand(pImage, nStart, nEnd, pData);
+    nFirstRow = nFirst * pImage->nUnitRows;
+    nSkipRows = (nFirst - nStart) * pImage->nUnitRows;
+    nRows = nLast * pImage->nUnitRows < pImage->nHeight ? nLast * pImage->nUnitRows - nFirstRow : pImage->nHeight - nFirstRow;
+  }
+
+  if (setjmp(jerr->setjmp_buffer)) {
+    jpeg_abort_decompress(cinfo);
+    return OMX_FALSE;
+  }
+  jpegdec_mem_src(cinfo, pData, nLen);
+  jpeg_read_header(cinfo, TRUE);
+  jpeg_start_decompress(cinfo);
+  if (cinfo->output_width != pImage->nWidth || cinfo->output_components != pImage->nComponents ||
+      (cinfo->out_color_space != JCS_RGB && cinfo->out_color_space != JCS_GRAYSCALE)) {
+    DEBUG(DEB_LEV_ERR, "In %s unsupported output %dx%d\n", __func__, (int)cinfo->output_width, cinfo->output_components);
+    jpeg_abort_decompress(cinfo);
+    return OMX_FALSE;
+  }
+  if (pBand->nBand == 0) {
+    write_bmp_header_mem(cinfo, nRowWidth, pImage->nHeight, (char *) pOut);
+  }
+  row = (*cinfo->mem->alloc_sarray) ((j_common_ptr) cinfo, JPOOL_IMAGE, nRowWidth, 1);
+
+  while (cinfo->output_scanline < nSkipRows + nRows) {
+    y = cinfo->output_scanline;
+    jpeg_read_scanlines(cinfo, row, 1);
+    if (y < nSkipRows) {
+      continue;
+    }
+    /* BMP rows are stored bottom up */
+    pRow = pOut + BMP_HEADER_SIZE + (pImage->nHeight - 1 - (nFirstRow + y - nSkipRows)) * nRowWidth;
+    pIn = row[0];
+    if (pImage->nComponents == 3) {
+      for (x = 0; x < pImage->nWidth; x++, pIn += 3, pRow += 3) {
+        pRow[0] = GETJSAMPLE(pIn[2]);
+        pRow[1] = GETJSAMPLE(pIn[1]);
+        pRow[2] = GETJSAMPLE(pIn[0]);
+      }
+    } else {
+      memcpy(pRow, pIn, pImage->nWidth);
+      pRow += pImage->nWidth;
+    }
+    for (x = pImage->nWidth * pImage->nComponents; x < nRowWidth; x++) {
+      *pRow++ = 0;
+    }
+  }
+  if (cinfo->output_scanline == cinfo->output_height) {
+    jpeg_finish_decompress(cinfo);
+  } else {
+    /* The rows below the band are not needed */
+    jpeg_abort_decompress(cinfo);
+  }
+  return OMX_TRUE;
+}
+
+/** Decoding thread: each thread has its own decompression object */
+void* omx_jpegdec_component_DecodeFunction(void* param) {
+  omx_jpegdec_component_PrivateType* omx_jpegdec_component_Private = param;
+  struct jpeg_decompress_struct cinfo;
+  jpegdec_error_mgr jerr;
+  jpegdec_band_t* pBand;
+  jpegdec_image_t* pImage;
+  OMX_U8* pScratch = NULL;
+  OMX_U32 nScratchLen = 0;
+  OMX_BOOL bDecoded, bDone;
+  OMX_U64 nPerfTime;
+
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = jpegdec_error_exit;
+  jerr.pub.output_message = jpegdec_output_message;
+  jpeg_create_decompress(&cinfo);
+
+  for (;;) {
+    tsem_down(omx_jpegdec_component_Private->decodeSem);
+    pthread_mutex_lock(&omx_jpegdec_component_Private->decodeMutex);
+    pBand = omx_jpegdec_component_Private->pBandHead;
+    if (pBand == NULL) {
+      /* Woken to exit */
+      pthread_mutex_unlock(&omx_jpegdec_component_Private->decodeMutex);
+      break;
+    }
+    omx_jpegdec_component_Private->pBandHead = pBand->next;
+    if (omx_jpegdec_component_Private->pBandHead == NULL) {
+      omx_jpegdec_component_Private->pBandTail = NULL;
+    }
+    pthread_mutex_unlock(&omx_jpegdec_component_Private->decodeMutex);
+
+    pImage = pBand->pImage;
+    nPerfTime = omx_base_component_PerfTime();
+    bDecoded = jpegdec_DecodeBand(&cinfo, &jerr, pBand, &pScratch, &nScratchLen);
+    PERF_COUNTER_ADD(omx_jpegdec_component_Private->sPerfCounters.nCallbackTime, omx_base_component_PerfTime() - nPerfTime);
+    PERF_COUNTER_ADD(omx_jpegdec_component_Private->sPerfCounters.nCallbacks, 1);
+
+    pthread_mutex_lock(&omx_jpegdec_component_Private->decodeMutex);
+    if (!bDecoded) {
+      pImage->bFailed = OMX_TRUE;
+    }
+    pImage->nPendingBands--;
+    bDone = pImage->nPendingBands == 0;
+    omx_jpegdec_component_Private->nActiveBands--;
+    pthread_mutex_unlock(&omx_jpegdec_component_Private->decodeMutex);
+    if (bDone) {
+      tsem_up(omx_jpegdec_component_Private->bMgmtSem);
+    }
+  }
+
+  jpeg_destroy_decompress(&cinfo);
+  free(pScratch);
+  return NULL;
+}
+
+static void jpegdec_FreeImage(jpegdec_image_t* pImage) {
+  free(pImage->pData);
+  free(pImage->pSegments);
+  free(pImage->pBands);
+  free(pImage);
+}
+
+/** Appends an input buffer to the image being received */
+static OMX_ERRORTYPE jpegdec_AppendInput(jpegdec_image_t* pImage, OMX_BUFFERHEADERTYPE* pInputBuffer) {
+  OMX_U8* pData;
+  OMX_U32 nAllocLen;
+
+  if (pImage->nLen == 0) {
+    pImage->nTimeStamp = pInputBuffer->nTimeStamp;
+  }
+  if (pImage->nLen + pInputBuffer->nFilledLen > pImage->nAllocLen) {
+    nAllocLen = pImage->nAllocLen ? pImage->nAllocLen : IN_BUFFER_SIZE;
+    while (nAllocLen < pImage->nLen + pInputBuffer->nFilledLen) {
+      nAllocLen *= 2;
+    }
+    pData = realloc(pImage->pData, nAllocLen);
+    if (pData == NULL) {
+      return OMX_ErrorInsufficientResources;
+    }
+    pImage->pData = pData;
+    pImage->nAllocLen = nAllocLen;
+  }
+  memcpy(pImage->pData + pImage->nLen, pInputBuffer->pBuffer + pInputBuffer->nOffset, pInputBuffer->nFilledLen);
+  pImage->nLen += pInputBuffer->nFilledLen;
+  pInputBuffer->nFilledLen = 0;
+  if (pInputBuffer->hMarkTargetComponent != NULL) {
+    pImage->hMarkTargetComponent = pInputBuffer->hMarkTargetComponent;
+    pImage->pMarkData = pInputBuffer->pMarkData;
+    pInputBuffer->hMarkTargetComponent = NULL;
+    pInputBuffer->pMarkData = NULL;
+  }
+  pImage->nFlags |= pInputBuffer->nFlags;
+  return OMX_ErrorNone;
+}
+
+/** Hands a complete image to the decoding threads */
+static void jpegdec_SubmitImage(OMX_COMPONENTTYPE* openmaxStandComp, jpegdec_image_t* pImage) {
+  omx_jpegdec_component_PrivateType* omx_jpegdec_component_Private = openmaxStandComp->pComponentPrivate;
+  omx_base_image_PortType *pOutPort = (omx_base_image_PortType *)omx_jpegdec_component_Private->ports[OMX_BASE_FILTER_OUTPUTPORT_INDEX];
+  OMX_U32 nSize, nIdle, i;
+
+  pImage->nBands = 0;
+  if (pImage->nLen > 0) {
+    if (jpegdec_ParseImage(pImage) != OMX_ErrorNone) {
+      DEBUG(DEB_LEV_ERR, "In %s no frame header in the image\n", __func__);
+      pImage->bFailed = OMX_TRUE;
+    } else {
+      nSize = BMP_HEADER_SIZE + ((pImage->nWidth * pImage->nComponents + 3) & ~3) * pImage->nHeight;
+      if((pOutPort->sPortParam.format.image.nFrameWidth != pImage->nWidth) ||
+         (pOutPort->sPortParam.format.image.nFrameHeight != pImage->nHeight)) {
+        pOutPort->sPortParam.format.image.nFrameWidth = pImage->nWidth;
+        pOutPort->sPortParam.format.image.nFrameHeight = pImage->nHeight;
+        pOutPort->sPortParam.nBufferSize = nSize;
+
+        /*Send Port Settings changed call back*/
+        (*(omx_jpegdec_component_Private->callbacks->EventHandler))
+          (openmaxStandComp,
+           omx_jpegdec_component_Private->callbackData,
+           OMX_EventPortSettingsChanged, /* The command was completed */
+           0,
+           1, /* This is the output port index */
+           NULL);
+      }
+      if (pImage->pOutputBuffer->nAllocLen < nSize) {
+        DEBUG(DEB_LEV_ERR, "Output Buffer AllocLen %d less than required ouput %d\n", (int)pImage->pOutputBuffer->nAllocLen, (int)nSize);
+        pImage->bFailed = OMX_TRUE;
+      } else {
+        pImage->pOutputBuffer->nOffset = 0;
+        pImage->pOutputBuffer->nFilledLen = nSize;
+        pImage->nBands = 1;
+      }
+    }
+  }
+
+  pthread_mutex_lock(&omx_jpegdec_component_Private->decodeMutex);
+  /* Split the image only to keep idle threads busy */
+  if (pImage->nBands == 1 && pImage->nUnits >= 2 * MIN_BAND_UNITS) {
+    nIdle = omx_jpegdec_component_Private->nDecodeThreads > omx_jpegdec_component_Private->nActiveBands ?
+            omx_jpegdec_component_Private->nDecodeThreads - omx_jpegdec_component_Private->nActiveBands : 0;
+    pImage->nBands = pImage->nUnits / MIN_BAND_UNITS < nIdle ? pImage->nUnits / MIN_BAND_UNITS : nIdle;
+    if (pImage->nBands < 1) {
+      pImage->nBands = 1;
+    }
+  }
+  if (pImage->nBands > 0) {
+    pImage->pBands = calloc(pImage->nBands, sizeof(jpegdec_band_t));
+    if (pImage->pBands == NULL) {
+      pImage->nBands = 0;
+      pImage->bFailed = OMX_TRUE;
+    }
+  }
+  for (i = 0; i < pImage->nBands; i++) {
+    pImage->pBands[i].pImage = pImage;
+    pImage->pBands[i].nBand = i;
+    if (omx_jpegdec_component_Private->pBandTail) {
+      omx_jpegdec_component_Private->pBandTail->next = &pImage->pBands[i];
+    } else {
+      omx_jpegdec_component_Private->pBandHead = &pImage->pBands[i];
+    }
+    omx_jpegdec_component_Private->pBandTail = &pImage->pBands[i];
+  }
+  pImage->nPendingBands = pImage->nBands;
+  omx_jpegdec_component_Private->nActiveBands += pImage->nBands;
+  pthread_mutex_unlock(&omx_jpegdec_component_Private->decodeMutex);
+
+  DEBUG(DEB_LEV_FULL_SEQ, "In %s image %dx%d in %d bands\n", __func__, (int)pImage->nWidth, (int)pImage->nHeight, (int)pImage->nBands);
+  if (omx_jpegdec_component_Private->pImageTail) {
+    omx_jpegdec_component_Private->pImageTail->next = pImage;
+  } else {
+    omx_jpegdec_component_Private->pImageHead = pImage;
+  }
+  omx_jpegdec_component_Private->pImageTail = pImage;
+  for (i = 0; i < pImage->nBands; i++) {
+    tsem_up(omx_jpegdec_component_Private->decodeSem);
+  }
+}
+
+/** Returns the output buffer of a decoded image */
+static void jpegdec_ReturnImage(OMX_COMPONENTTYPE* openmaxStandComp, jpegdec_image_t* pImage) {
+  omx_jpegdec_component_PrivateType* omx_jpegdec_component_Private = openmaxStandComp->pComponentPrivate;
+  omx_base_PortType *pOutPort = (omx_base_PortType *)omx_jpegdec_component_Private->ports[OMX_BASE_FILTER_OUTPUTPORT_INDEX];
+  OMX_BUFFERHEADERTYPE* pOutputBuffer = pImage->pOutputBuffer;
+
+  if (pImage->bFailed || pImage->nBands == 0) {
+    pOutputBuffer->nFilledLen = 0;
+  }
+  pOutputBuffer->nTimeStamp = pImage->nTimeStamp;
+  pOutputBuffer->nFlags = pImage->nFlags;
+
+  if(omx_jpegdec_component_Private->pMark.hMarkTargetComponent != NULL){
+    pOutputBuffer->hMarkTargetComponent = omx_jpegdec_component_Private->pMark.hMarkTargetComponent;
+    pOutputBuffer->pMarkData            = omx_jpegdec_component_Private->pMark.pMarkData;
+    omx_jpegdec_component_Private->pMark.hMarkTargetComponent = NULL;
+    omx_jpegdec_component_Private->pMark.pMarkData            = NULL;
+  }
+  if(pImage->hMarkTargetComponent == (OMX_HANDLETYPE)openmaxStandComp) {
+    /*Clear the mark and generate an event*/
+    (*(omx_jpegdec_component_Private->callbacks->EventHandler))
+      (openmaxStandComp,
+      omx_jpegdec_component_Private->callbackData,
+      OMX_EventMark, /* The command was completed */
+      1, /* The commands was a OMX_CommandStateSet */
+      0, /* The state has been changed in message->messageParam2 */
+      pImage->pMarkData);
+  } else if(pImage->hMarkTargetComponent != NULL) {
+    /*If this is not the target component then pass the mark*/
+    pOutputBuffer->hMarkTargetComponent = pImage->hMarkTargetComponent;
+    pOutputBuffer->pMarkData            = pImage->pMarkData;
+  }
+
+  if(pOutputBuffer->nFlags & OMX_BUFFERFLAG_EOS) {
+    DEBUG(DEB_LEV_FULL_SEQ, "Detected EOS flags in input buffer filled\n");
+    (*(omx_jpegdec_component_Private->callbacks->EventHandler))
+      (openmaxStandComp,
+      omx_jpegdec_component_Private->callbackData,
+      OMX_EventBufferFlag, /* The command was completed */
+      1, /* The commands was a OMX_CommandStateSet */
+      pOutputBuffer->nFlags, /* The state has been changed in message->messageParam2 */
+      NULL);
+  }
+  pOutPort->ReturnBufferFunction(pOutPort, pOutputBuffer);
+  jpegdec_FreeImage(pImage);
+}
+
+/** Returns in order the images decoded so far. When bAll is set waits for all the images
+ *
+ * @return OMX_TRUE if some output buffer has been returned
+ */
+static OMX_BOOL jpegdec_ReturnImages(OMX_COMPONENTTYPE* openmaxStandComp, OMX_BOOL bAll) {
+  omx_jpegdec_component_PrivateType* omx_jpegdec_component_Private = openmaxStandComp->pComponentPrivate;
+  jpegdec_image_t* pImage;
+  OMX_U32 nPendingBands;
+  OMX_BOOL bReturned = OMX_FALSE;
+
+  while ((pImage = omx_jpegdec_component_Private->pImageHead) != NULL) {
+    pthread_mutex_lock(&omx_jpegdec_component_Private->decodeMutex);
+    nPendingBands = pImage->nPendingBands;
+    pthread_mutex_unlock(&omx_jpegdec_component_Private->decodeMutex);
+    if (nPendingBands > 0) {
+      if (!bAll) {
+        break;
+      }
+      /* Signalled by the decoding thread of the last band */
+      tsem_down(omx_jpegdec_component_Private->bMgmtSem);
+      continue;
+    }
+    omx_jpegdec_component_Private->pImageHead = pImage->next;
+    if (omx_jpegdec_component_Private->pImageHead == NULL) {
+      omx_jpegdec_component_Private->pImageTail = NULL;
+    }
+    jpegdec_ReturnImage(openmaxStandComp, pImage);
+    bReturned = OMX_TRUE;
+  }
+  return bReturned;
+}
+
+/** Buffer management function of the decoding threads mode */
+void* omx_jpegdec_component_PoolBufferMgmtFunction(void* param) {
+  OMX_COMPONENTTYPE* openmaxStandComp = (OMX_COMPONENTTYPE*)param;
+  omx_jpegdec_component_PrivateType* omx_jpegdec_component_Private = openmaxStandComp->pComponentPrivate;
+  omx_base_PortType *pInPort=(omx_base_PortType *)omx_jpegdec_component_Private->ports[OMX_BASE_FILTER_INPUTPORT_INDEX];
+  omx_base_PortType *pOutPort=(omx_base_PortType *)omx_jpegdec_component_Private->ports[OMX_BASE_FILTER_OUTPUTPORT_INDEX];
+  tsem_t* pInputSem = pInPort->pBufferSem;
+  tsem_t* pOutputSem = pOutPort->pBufferSem;
+  queue_t* pInputQueue = pInPort->pBufferQueue;
+  queue_t* pOutputQueue = pOutPort->pBufferQueue;
+  OMX_BUFFERHEADERTYPE* pInputBuffer;
+  jpegdec_image_t* pImage;
+  OMX_BOOL bProgress;
+  unsigned int nStateGen;
+  OMX_U64 nPerfTime;
+
+  DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
+  while(omx_jpegdec_component_Private->state == OMX_StateIdle || omx_jpegdec_component_Private->state == OMX_StateExecuting ||
+        omx_jpegdec_component_Private->state == OMX_StatePause ||
+        omx_jpegdec_component_Private->transientState == OMX_TransStateLoadedToIdle) {
+
+    /*Wait till the ports are being flushed*/
+    pthread_mutex_lock(&omx_jpegdec_component_Private->flush_mutex);
+    while( PORT_IS_BEING_FLUSHED(pInPort) ||
+           PORT_IS_BEING_FLUSHED(pOutPort)) {
+      pthread_mutex_unlock(&omx_jpegdec_component_Private->flush_mutex);
+
+      /* The images being decoded hold output buffers: return them all */
+      jpegdec_ReturnImages(openmaxStandComp, OMX_TRUE);
+      if(PORT_IS_BEING_FLUSHED(pInPort) && omx_jpegdec_component_Private->pCurrentImage) {
+        DEBUG(DEB_LEV_FULL_SEQ, "Ports are flushing,so dropping the image being received\n");
+        jpegdec_FreeImage(omx_jpegdec_component_Private->pCurrentImage);
+        omx_jpegdec_component_Private->pCurrentImage = NULL;
+      }
+
+      tsem_up(omx_jpegdec_component_Private->flush_all_condition);
+      tsem_down(omx_jpegdec_component_Private->flush_condition);
+      pthread_mutex_lock(&omx_jpegdec_component_Private->flush_mutex);
+    }
+    pthread_mutex_unlock(&omx_jpegdec_component_Private->flush_mutex);
+
+    if(omx_jpegdec_component_Private->state == OMX_StateLoaded || omx_jpegdec_component_Private->state == OMX_StateInvalid) {
+      DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s Buffer Management Thread is exiting\n",__func__);
+      break;
+    }
+
+    bProgress = jpegdec_ReturnImages(openmaxStandComp, OMX_FALSE);
+
+    nStateGen = tsem_get_gen(omx_jpegdec_component_Private->bStateSem);
+    if(omx_jpegdec_component_Private->state==OMX_StatePause && !(PORT_IS_BEING_FLUSHED(pInPort) || PORT_IS_BEING_FLUSHED(pOutPort))) {
+      /*Waiting at paused state*/
+      tsem_wait_gen(omx_jpegdec_component_Private->bStateSem, nStateGen);
+      continue;
+    }
+
+    /* Receive the current image, the input buffers are returned at once */
+    pImage = omx_jpegdec_component_Private->pCurrentImage;
+    while(pInputSem->semval > 0 && !(pImage && IMAGE_IS_COMPLETE(pImage)) && !PORT_IS_BEING_FLUSHED(pInPort)) {
+      tsem_down(pInputSem);
+      pInputBuffer = dequeue(pInputQueue);
+      if(pInputBuffer == NULL){
+        DEBUG(DEB_LEV_ERR, "Had NULL input buffer!!\n");
+        break;
+      }
+      if(pImage == NULL) {
+        pImage = omx_jpegdec_component_Private->pCurrentImage = calloc(1, sizeof(jpegdec_image_t));
+      }
+      if(pImage == NULL || jpegdec_AppendInput(pImage, pInputBuffer) != OMX_ErrorNone) {
+        DEBUG(DEB_LEV_ERR, "In %s cannot store the input buffer, data dropped\n", __func__);
+        pInputBuffer->nFilledLen = 0;
+      }
+      pInPort->ReturnBufferFunction(pInPort, pInputBuffer);
+      bProgress = OMX_TRUE;
+    }
+
+    /* Decode it as soon as it has an output buffer */
+    if(pImage && IMAGE_IS_COMPLETE(pImage) && pOutputSem->semval > 0 && !PORT_IS_BEING_FLUSHED(pOutPort)) {
+      tsem_down(pOutputSem);
+      pImage->pOutputBuffer = dequeue(pOutputQueue);
+      if(pImage->pOutputBuffer == NULL){
+        DEBUG(DEB_LEV_ERR, "Had NULL output buffer!!\n");
+        break;
+      }
+      omx_jpegdec_component_Private->pCurrentImage = NULL;
+      jpegdec_SubmitImage(openmaxStandComp, pImage);
+      bProgress = OMX_TRUE;
+    }
+
+    if(!bProgress) {
+      DEBUG(DEB_LEV_FULL_SEQ, "Waiting for next input/output buffer or decoded image\n");
+      nPerfTime = omx_base_component_PerfTime();
+      tsem_down(omx_jpegdec_component_Private->bMgmtSem);
+      PERF_COUNTER_ADD(omx_jpegdec_component_Private->sPerfCounters.nMgmtWaitTime, omx_base_component_PerfTime() - nPerfTime);
+    }
+  }
+
+  /* Do not leave the decoding threads working on the buffers */
+  jpegdec_ReturnImages(openmaxStandComp, OMX_TRUE);
+  if(omx_jpegdec_component_Private->pCurrentImage) {
+    jpegdec_FreeImage(omx_jpegdec_component_Private->pCurrentImage);
+    omx_jpegdec_component_Private->pCurrentImage = NULL;
+  }
+  DEBUG(DEB_LEV_SIMPLE_SEQ,"Exiting Buffer Management Thread\n");
+  return NULL;
+}
+
 /*
  * Initialize source --- called by jpeg_read_header
  * before any data is actually read.
@@ -867,7 +1682,7 @@ Label1:
     DEBUG(DEB_LEV_FULL_SEQ, "Waiting for input buffer semval=%d count=%d\n",pInputSem->semval,count++);
     if(pInputSem->semval>0) {
       tsem_down(pInputSem);
-      if(pInputQueue->nelem>0){
+      if(getquenelem(pInputQueue)>0){
         //inBufExchanged++;
         //isInputBufferNeeded=OMX_FALSE;
         pInputBuffer = dequeue(pInputQueue);
@@ -1033,13 +1848,18 @@ OMX_ERRORTYPE omx_jpegdec_decoder_MessageHandler(OMX_COMPONENTTYPE* openmaxStand
         DEBUG(DEB_LEV_ERR, "In %s MAD Decoder Init Failed Error=%x\n",__func__,err); 
         return err;
       }
-    } 
+    }
   }
   /** Execute the base message handling */
   err = omx_base_component_MessageHandler(openmaxStandComp, message);
 
   if (message->messageType == OMX_CommandStateSet){
     if ((message->messageParam == OMX_StateLoaded) && (eCurrentState == OMX_StateIdle)) {
+      /* Only once in Loaded. If the component is freed as soon as the
+       * command completes, the destructor stops them instead */
+      if (err == OMX_ErrorNone) {
+        omx_jpegdec_component_StopDecodeThreads(omx_jpegdec_component_Private);
+      }
       err = omx_jpegdec_component_Deinit(openmaxStandComp);
       if(err!=OMX_ErrorNone) { 
         DEBUG(DEB_LEV_ERR, "In %s MAD Decoder Deinit Failed Error=%x\n",__func__,err); 
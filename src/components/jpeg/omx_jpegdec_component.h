@@ -66,6 +66,60 @@
 #define IMAGE_DEC_JPEG_NAME "OMX.st.image_decoder.jpeg"
 #define IMAGE_DEC_JPEG_ROLE "image_decoder.jpeg"
 
+/** The extension name of OMX_IndexVendorDecodeThreads. Its nU32 is the
+ * number of decoding threads, 0 (the default) decodes on the buffer
+ * management thread
+ */
+#define IMAGE_DEC_JPEG_THREADS_NAME "OMX.st.index.param.jpegdec.threads"
+/** Largest number of decoding threads */
+#define MAX_DECODE_THREADS 64
+
+/** A band of rows of an image, the unit of work of the decoding threads */
+typedef struct jpegdec_band_t {
+  struct jpegdec_image_t* pImage;
+  OMX_U32 nBand;
+  struct jpegdec_band_t* next;
+} jpegdec_band_t;
+
+/** An image decoded by the decoding threads.
+ * The image is the content of the input buffers up to the one flagged
+ * with OMX_BUFFERFLAG_ENDOFFRAME or OMX_BUFFERFLAG_EOS. When its scan has
+ * restart markers at MCU row boundaries it can be split in bands of rows,
+ * decoded by several threads at once
+ */
+typedef struct jpegdec_image_t {
+  OMX_U8* pData;
+  OMX_U32 nLen;
+  OMX_U32 nAllocLen;
+  OMX_BUFFERHEADERTYPE* pOutputBuffer;
+  OMX_U32 nFlags;
+  OMX_TICKS nTimeStamp;
+  OMX_HANDLETYPE hMarkTargetComponent;
+  OMX_PTR pMarkData;
+  /** Frame header: size of the image and number of output components */
+  OMX_U32 nWidth;
+  OMX_U32 nHeight;
+  OMX_U32 nComponents;
+  /** Offset of the SOF marker, whose height is patched in the bands */
+  OMX_U32 nSofOffset;
+  /** Length of the headers, up to the first entropy coded byte */
+  OMX_U32 nHeaderLen;
+  /** Start and end of the entropy coded segment of each restart interval */
+  OMX_U32* pSegments;
+  OMX_U32 nIntervals;
+  /** Smallest run of restart intervals ending on an MCU row boundary, and its height in rows.
+   * nUnits is 0 when the image cannot be split
+   */
+  OMX_U32 nUnitIntervals;
+  OMX_U32 nUnitRows;
+  OMX_U32 nUnits;
+  jpegdec_band_t* pBands;
+  OMX_U32 nBands;
+  OMX_U32 nPendingBands; /**< Bands not decoded yet, protected by decodeMutex */
+  OMX_BOOL bFailed;
+  struct jpegdec_image_t* next; /**< Images are returned in the order they have been received */
+} jpegdec_image_t;
+
 /** Jpeg Decoder component private structure.
  */
 DERIVEDCLASS(omx_jpegdec_component_PrivateType, omx_base_filter_PrivateType)
@@ -88,7 +142,25 @@ DERIVEDCLASS(omx_jpegdec_component_PrivateType, omx_base_filter_PrivateType)
   OMX_BUFFERHEADERTYPE* pInBuffer; \
   OMX_COMPONENTTYPE* hMarkTargetComponent; \
   OMX_PTR            pMarkData; \
-  OMX_U32            nFlags;
+  OMX_U32            nFlags; \
+  /** @param nDecodeThreads number of decoding threads, 0 when decoding on the buffer management thread */ \
+  OMX_U32 nDecodeThreads; \
+  /** @param nRunningThreads number of decoding threads started, joined by omx_jpegdec_component_StopDecodeThreads */ \
+  OMX_U32 nRunningThreads; \
+  pthread_t* decodeThreads; \
+  /** @param decodeMutex protects the band queue and the pending bands of the images */ \
+  pthread_mutex_t decodeMutex; \
+  /** @param decodeSem counts the bands queued for the decoding threads */ \
+  tsem_t* decodeSem; \
+  jpegdec_band_t* pBandHead; \
+  jpegdec_band_t* pBandTail; \
+  /** @param nActiveBands bands queued or being decoded */ \
+  OMX_U32 nActiveBands; \
+  /** @param pImageHead images submitted and not returned yet, oldest first */ \
+  jpegdec_image_t* pImageHead; \
+  jpegdec_image_t* pImageTail; \
+  /** @param pCurrentImage image being received from the input port */ \
+  jpegdec_image_t* pCurrentImage;
 ENDCLASS(omx_jpegdec_component_PrivateType)
 
 
@@ -99,6 +171,8 @@ OMX_ERRORTYPE omx_jpegdec_component_Init(OMX_COMPONENTTYPE *openmaxStandComp);
 OMX_ERRORTYPE omx_jpegdec_component_Deinit(OMX_COMPONENTTYPE *openmaxStandComp);
 OMX_ERRORTYPE omx_jpegdec_decoder_MessageHandler(OMX_COMPONENTTYPE*,internalRequestMessageType*);
 void* omx_jpegdec_component_BufferMgmtFunction(void* param);
+void* omx_jpegdec_component_PoolBufferMgmtFunction(void* param);
+void* omx_jpegdec_component_DecodeFunction(void* param);
 
 void omx_jpegdec_component_BufferMgmtCallback(
   OMX_COMPONENTTYPE *openmaxStandComp,
@@ -115,6 +189,11 @@ OMX_ERRORTYPE omx_jpegdec_component_SetParameter(
   OMX_IN  OMX_INDEXTYPE nParamIndex,
   OMX_IN  OMX_PTR ComponentParameterStructure);
 
+OMX_ERRORTYPE omx_jpegdec_component_GetExtensionIndex(
+  OMX_IN  OMX_HANDLETYPE hComponent,
+  OMX_IN  OMX_STRING cParameterName,
+  OMX_OUT OMX_INDEXTYPE* pIndexType);
+
 void jpeg_data_src (
   j_decompress_ptr cinfo, 
   omx_jpegdec_component_PrivateType *omx_jpegdec_component_Private);
@@ -201,6 +201,8 @@ OMX_ERRORTYPE omx_jpegenc_component_Constructor(OMX_COMPONENTTYPE *openmaxStandC
   omx_jpegenc_component_Private->hMarkTargetComponent = NULL;
   omx_jpegenc_component_Private->nFlags = 0x0;
   omx_jpegenc_component_Private->BufferMgmtFunction = omx_jpegenc_component_BufferMgmtFunction;
+  /* The own loop blocks, it cannot run on the shared executor */
+  omx_jpegenc_component_Private->BufferMgmtStep = NULL;
   omx_jpegenc_component_Private->messageHandler = omx_jpegenc_encoder_MessageHandler;
   omx_jpegenc_component_Private->destructor = omx_jpegenc_component_Destructor;
   openmaxStandComp->SetParameter = omx_jpegenc_component_SetParameter;
@@ -428,6 +430,7 @@ void* omx_jpegenc_component_BufferMgmtFunction(void* param)
   OMX_BOOL isInputBufferNeeded=OMX_TRUE,isOutputBufferNeeded=OMX_TRUE;
   int inBufExchanged=0,outBufExchanged=0;
   static OMX_S32 first=1;
+  OMX_U64 nPerfTime;
   JDIMENSION num_scanlines;
 
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
@@ -473,7 +476,9 @@ void* omx_jpegenc_component_BufferMgmtFunction(void* param)
       (omx_jpegenc_component_Private->state != OMX_StateLoaded && omx_jpegenc_component_Private->state != OMX_StateInvalid)) {
       //Signalled from EmptyThisBuffer or FillThisBuffer or some thing else
       DEBUG(DEB_LEV_FULL_SEQ, "Waiting for next input/output buffer\n");
+      nPerfTime = omx_base_component_PerfTime();
       tsem_down(omx_jpegenc_component_Private->bMgmtSem);
+      PERF_COUNTER_ADD(omx_jpegenc_component_Private->sPerfCounters.nMgmtWaitTime, omx_base_component_PerfTime() - nPerfTime);
 
     }
     if(omx_jpegenc_component_Private->state == OMX_StateLoaded || omx_jpegenc_component_Private->state == OMX_StateInvalid) {
@@ -489,7 +494,9 @@ void* omx_jpegenc_component_BufferMgmtFunction(void* param)
        !(PORT_IS_BEING_FLUSHED(pInPort) || PORT_IS_BEING_FLUSHED(pOutPort))) {
       //Signalled from EmptyThisBuffer or FillThisBuffer or some thing else
       DEBUG(DEB_LEV_FULL_SEQ, "Waiting for next input/output buffer\n");
+      nPerfTime = omx_base_component_PerfTime();
       tsem_down(omx_jpegenc_component_Private->bMgmtSem);
+      PERF_COUNTER_ADD(omx_jpegenc_component_Private->sPerfCounters.nMgmtWaitTime, omx_base_component_PerfTime() - nPerfTime);
 
     }
     if(omx_jpegenc_component_Private->state == OMX_StateLoaded || omx_jpegenc_component_Private->state == OMX_StateInvalid) {
@@ -499,7 +506,7 @@ void* omx_jpegenc_component_BufferMgmtFunction(void* param)
 
     if(pInputSem->semval>0 && isInputBufferNeeded==OMX_TRUE ) {
       tsem_down(pInputSem);
-      if(pInputQueue->nelem>0){
+      if(getquenelem(pInputQueue)>0){
         inBufExchanged++;
         isInputBufferNeeded=OMX_FALSE;
         pInputBuffer = dequeue(pInputQueue);
@@ -513,12 +520,12 @@ void* omx_jpegenc_component_BufferMgmtFunction(void* param)
     /*When we have input buffer to process then get one output buffer*/
     if(pOutputSem->semval>0 && isOutputBufferNeeded==OMX_TRUE) {
       tsem_down(pOutputSem);
-      if(pOutputQueue->nelem>0){
+      if(getquenelem(pOutputQueue)>0){
         outBufExchanged++;
         isOutputBufferNeeded=OMX_FALSE;
         pOutputBuffer = dequeue(pOutputQueue);
         if(pOutputBuffer == NULL){
-          DEBUG(DEB_LEV_ERR, "Had NULL output buffer!! op is=%d,iq=%d\n",pOutputSem->semval,pOutputQueue->nelem);
+          DEBUG(DEB_LEV_ERR, "Had NULL output buffer!! op is=%d,iq=%d\n",pOutputSem->semval,getquenelem(pOutputQueue));
           break;
         }
       }
@@ -526,6 +533,7 @@ void* omx_jpegenc_component_BufferMgmtFunction(void* param)
 
     if(first==1 && isOutputBufferNeeded==OMX_FALSE && isInputBufferNeeded==OMX_FALSE && pInputBuffer->nFilledLen != 0) {
       first=2;
+      nPerfTime = omx_base_component_PerfTime();
 
       DEBUG(DEB_LEV_FULL_SEQ, "In %s: input buffer fill length=%d\n", __func__,(int)pInputBuffer->nFilledLen);
 
@@ -563,6 +571,8 @@ void* omx_jpegenc_component_BufferMgmtFunction(void* param)
 
       pOutputBuffer->nFilledLen = len;
       pInputBuffer->nFilledLen = 0;
+      PERF_COUNTER_ADD(omx_jpegenc_component_Private->sPerfCounters.nCallbackTime, omx_base_component_PerfTime() - nPerfTime);
+      PERF_COUNTER_ADD(omx_jpegenc_component_Private->sPerfCounters.nCallbacks, 1);
 
       if(omx_jpegenc_component_Private->pMark.hMarkTargetComponent != NULL){
         pOutputBuffer->hMarkTargetComponent = omx_jpegenc_component_Private->pMark.hMarkTargetComponent;
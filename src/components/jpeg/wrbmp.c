@@ -388,9 +388,14 @@ finish_output_bmp (j_decompress_ptr cinfo, djpeg_dest_ptr dinfo)
     ERREXIT(cinfo, JERR_FILE_WRITE);
 }
 
-LOCAL(void)
-write_bmp_header_buf (j_decompress_ptr cinfo, bmp_dest_ptr dest,char* buf)
-/* Write a Windows-style BMP file header, including colormap if needed */
+/*
+ * Write a Windows-style BMP file header to memory, without colormap.
+ * Used for images whose rows are written straight to the output buffer.
+ */
+
+GLOBAL(void)
+write_bmp_header_mem (j_decompress_ptr cinfo, JDIMENSION row_width,
+		      JDIMENSION height, char* buf)
 {
   char bmpfileheader[14];
   char bmpinfoheader[40];
@@ -424,7 +429,7 @@ write_bmp_header_buf (j_decompress_ptr cinfo, bmp_dest_ptr dest,char* buf)
   }
   /* File size */
   headersize = 14 + 40 + cmap_entries * 4; /* Header and colormap */
-  bfSize = headersize + (INT32) dest->row_width * (INT32) cinfo->output_height;
+  bfSize = headersize + (INT32) row_width * (INT32) height;
 
   /* Set unused fields of header to 0 */
   MEMZERO(bmpfileheader, SIZEOF(bmpfileheader));
@@ -440,7 +445,7 @@ write_bmp_header_buf (j_decompress_ptr cinfo, bmp_dest_ptr dest,char* buf)
   /* Fill the info header (Microsoft calls this a BITMAPINFOHEADER) */
   PUT_2B(bmpinfoheader, 0, 40);	/* biSize */
   PUT_4B(bmpinfoheader, 4, cinfo->output_width); /* biWidth */
-  PUT_4B(bmpinfoheader, 8, cinfo->output_height); /* biHeight */
+  PUT_4B(bmpinfoheader, 8, height); /* biHeight */
   PUT_2B(bmpinfoheader, 12, 1);	/* biPlanes - must be 1 */
   PUT_2B(bmpinfoheader, 14, bits_per_pixel); /* biBitCount */
   /* we leave biCompression = 0, for none */
@@ -453,16 +458,17 @@ write_bmp_header_buf (j_decompress_ptr cinfo, bmp_dest_ptr dest,char* buf)
   /* we leave biClrImportant = 0 */
 
 
-	memcpy(&(**dest->pub.buffer),&bmpfileheader,14);
-	memcpy(&(*(*dest->pub.buffer+14)),&bmpinfoheader,40);
+	memcpy(buf,&bmpfileheader,14);
+	memcpy(buf+14,&bmpinfoheader,40);
 
 	/*Write I'm not supporting 256 color*/
-	/*
-  if (cmap_entries > 0) {
-		printf("cmap_entries >0\n");
-    write_colormap_buf(cinfo, dest, cmap_entries, 4,buf);
-		}
-		*/
+}
+
+LOCAL(void)
+write_bmp_header_buf (j_decompress_ptr cinfo, bmp_dest_ptr dest,char* buf)
+/* Write a Windows-style BMP file header, including colormap if needed */
+{
+  write_bmp_header_mem(cinfo, dest->row_width, cinfo->output_height, (char *) *dest->pub.buffer);
 }
 GLOBAL(void)
 finish_output_bmp_buf (j_decompress_ptr cinfo, djpeg_dest_ptr dinfo,char *buf)
@@ -798,7 +798,7 @@ OMX_ERRORTYPE omx_mux_component_GetExtensionIndex(
   if(strcmp(cParameterName,"OMX.ST.index.param.outputfilename") == 0) {
     *pIndexType = OMX_IndexVendorOutputFilename;
   } else {
-    return OMX_ErrorBadParameter;
+    return omx_base_component_GetExtensionIndex(hComponent, cParameterName, pIndexType);
   }
   return OMX_ErrorNone;
 }
@@ -625,7 +625,8 @@ OMX_ERRORTYPE videosrc_port_AllocateTunnelBuffer(omx_base_PortType *openmaxStand
   omx_videosrc_component_PrivateType* omx_videosrc_component_Private = (omx_videosrc_component_PrivateType*)omx_base_component_Private;
   OMX_U8* pBuffer=NULL;
   OMX_ERRORTYPE eError=OMX_ErrorNone;
-  OMX_U32 numRetry=0;
+  struct timespec deadline;
+  unsigned int nTunnelGen;
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
 
   if (nPortIndex != openmaxStandPort->sPortParam.nPortIndex) {
@@ -644,6 +645,7 @@ OMX_ERRORTYPE videosrc_port_AllocateTunnelBuffer(omx_base_PortType *openmaxStand
     }
   }
   
+  tsem_deadline(&deadline, TUNNEL_USE_BUFFER_TIMEOUT_MSEC);
   for(i=0; i < openmaxStandPort->sPortParam.nBufferCountActual; i++){
     if (openmaxStandPort->bBufferStateAllocated[i] == BUFFER_FREE) {
       /* Map the buffer with the device's memory area*/
@@ -654,18 +656,17 @@ OMX_ERRORTYPE videosrc_port_AllocateTunnelBuffer(omx_base_PortType *openmaxStand
       omx_videosrc_component_Private->bOutBufferMemoryMapped = OMX_TRUE;
       pBuffer = omx_videosrc_component_Private->buffers[i].start;
 
-      /*Retry more than once, if the tunneled component is not in Loaded->Idle State*/
-      while(numRetry <TUNNEL_USE_BUFFER_RETRY) {
+      /*Retry until the deadline, if the tunneled component is not in Loaded->Idle State*/
+      while(1) {
+        nTunnelGen = base_port_GetTunnelStateGen();
         eError=OMX_UseBuffer(openmaxStandPort->hTunneledComponent,&openmaxStandPort->pInternalBufferStorage[i],
                              openmaxStandPort->nTunneledPort,NULL,nSizeBytes,pBuffer); 
         if(eError!=OMX_ErrorNone) {
-          DEBUG(DEB_LEV_FULL_SEQ,"Tunneled Component Couldn't Use buffer %i From Comp=%s Retry=%d\n",
-          i,omx_base_component_Private->name,(int)numRetry);
+          DEBUG(DEB_LEV_FULL_SEQ,"Tunneled Component Couldn't Use buffer %i From Comp=%s\n",
+          i,omx_base_component_Private->name);
 
-          if((eError ==  OMX_ErrorIncorrectStateTransition) && numRetry<TUNNEL_USE_BUFFER_RETRY) {
-            DEBUG(DEB_LEV_FULL_SEQ,"Waiting for next try %i \n",(int)numRetry);
-            usleep(TUNNEL_USE_BUFFER_RETRY_USLEEP_TIME);
-            numRetry++;
+          if((eError ==  OMX_ErrorIncorrectStateTransition) && base_port_WaitTunnelStateChange(nTunnelGen, &deadline) == 0) {
+            DEBUG(DEB_LEV_FULL_SEQ,"Trying again after a tunnel state change\n");
             continue;
           }
           return eError;
@@ -683,7 +684,10 @@ OMX_ERRORTYPE videosrc_port_AllocateTunnelBuffer(omx_base_PortType *openmaxStand
         openmaxStandPort->bIsFullOfBuffers = OMX_TRUE;
         DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s nPortIndex=%d\n",__func__, (int)nPortIndex);
       }
-      queue(openmaxStandPort->pBufferQueue, openmaxStandPort->pInternalBufferStorage[i]);
+      if (queue(openmaxStandPort->pBufferQueue, openmaxStandPort->pInternalBufferStorage[i]) != 0) {
+        DEBUG(DEB_LEV_ERR, "In %s: buffer queue of port %d is full\n", __func__, (int)nPortIndex);
+        return OMX_ErrorInsufficientResources;
+      }
     }
   }
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s Allocated all buffers\n",__func__);
@@ -697,7 +701,8 @@ OMX_ERRORTYPE videosrc_port_FreeTunnelBuffer(omx_base_PortType *openmaxStandPort
   omx_base_component_PrivateType* omx_base_component_Private = (omx_base_component_PrivateType*)omxComponent->pComponentPrivate;
   omx_videosrc_component_PrivateType* omx_videosrc_component_Private = (omx_videosrc_component_PrivateType*)omx_base_component_Private;
   OMX_ERRORTYPE eError=OMX_ErrorNone;
-  OMX_U32 numRetry=0;
+  struct timespec deadline;
+  unsigned int nTunnelGen;
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s\n", __func__);
 
   if (nPortIndex != openmaxStandPort->sPortParam.nPortIndex) {
@@ -722,6 +727,7 @@ OMX_ERRORTYPE videosrc_port_FreeTunnelBuffer(omx_base_PortType *openmaxStandPort
     }
   }
 
+  tsem_deadline(&deadline, TUNNEL_USE_BUFFER_TIMEOUT_MSEC);
   for(i=0; i < openmaxStandPort->sPortParam.nBufferCountActual; i++){
     if (openmaxStandPort->bBufferStateAllocated[i] & (BUFFER_ASSIGNED | BUFFER_ALLOCATED)) {
 
@@ -730,15 +736,14 @@ OMX_ERRORTYPE videosrc_port_FreeTunnelBuffer(omx_base_PortType *openmaxStandPort
         openmaxStandPort->pInternalBufferStorage[i]->pBuffer = NULL;
         omx_videosrc_component_Private->bOutBufferMemoryMapped = OMX_FALSE;
       }
-      /*Retry more than once, if the tunneled component is not in Idle->Loaded State*/
-      while(numRetry <TUNNEL_USE_BUFFER_RETRY) {
+      /*Retry until the deadline, if the tunneled component is not in Idle->Loaded State*/
+      while(1) {
+        nTunnelGen = base_port_GetTunnelStateGen();
         eError=OMX_FreeBuffer(openmaxStandPort->hTunneledComponent,openmaxStandPort->nTunneledPort,openmaxStandPort->pInternalBufferStorage[i]);
         if(eError!=OMX_ErrorNone) {
           DEBUG(DEB_LEV_ERR,"Tunneled Component Couldn't free buffer %i \n",i);
-          if((eError ==  OMX_ErrorIncorrectStateTransition) && numRetry<TUNNEL_USE_BUFFER_RETRY) {
-            DEBUG(DEB_LEV_ERR,"Waiting for next try %i \n",(int)numRetry);
-            usleep(TUNNEL_USE_BUFFER_RETRY_USLEEP_TIME);
-            numRetry++;
+          if((eError ==  OMX_ErrorIncorrectStateTransition) && base_port_WaitTunnelStateChange(nTunnelGen, &deadline) == 0) {
+            DEBUG(DEB_LEV_ERR,"Trying again after a tunnel state change\n");
             continue;
           }
           return eError;
@@ -758,7 +763,7 @@ OMX_ERRORTYPE videosrc_port_FreeTunnelBuffer(omx_base_PortType *openmaxStandPort
       }
     }
   }
-  DEBUG(DEB_LEV_FUNCTION_NAME, "In %s Qelem=%d BSem=%d\n", __func__,openmaxStandPort->pBufferQueue->nelem,openmaxStandPort->pBufferSem->semval);
+  DEBUG(DEB_LEV_FUNCTION_NAME, "In %s Qelem=%d BSem=%d\n", __func__,getquenelem(openmaxStandPort->pBufferQueue),openmaxStandPort->pBufferSem->semval);
   return OMX_ErrorNone;
 }
 
@@ -0,0 +1,297 @@
+/**
+  @file src/omx_comp_debug_levels.c
+
+  Run time debug level and the buffered log writer used by DEBUG.
+
+  Each thread formats its messages in a buffer of its own. A background
+  thread writes the buffers on standard err every OMX_LOG_FLUSH_MSEC, or
+  as soon as a buffer gets half full, so the threads that log never wait
+  for the terminal. Errors are written at once by the thread that logs
+  them, after the messages still buffered, and never start the writer.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "omx_comp_debug_levels.h"
+
+/** Size of the log buffer of each thread */
+#define OMX_LOG_BUFFER_SIZE 8192
+
+/** Longest time a message waits in a buffer before being written */
+#define OMX_LOG_FLUSH_MSEC 100
+
+/** The log buffer of one thread. The mutex is shared only with the
+ * writer thread, so it is almost never contended
+ */
+typedef struct omx_log_buffer_t {
+  struct omx_log_buffer_t* next;
+  pthread_mutex_t mutex;
+  size_t len;
+  char data[OMX_LOG_BUFFER_SIZE];
+} omx_log_buffer_t;
+
+unsigned int omx_debug_level = DEB_LEV_ERR;
+
+/** List of the buffers of the live threads, protected by logListMutex */
+static omx_log_buffer_t* logBuffers;
+static pthread_mutex_t logListMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t logCondition = PTHREAD_COND_INITIALIZER;
+static pthread_once_t logOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t logKey;
+static pthread_t logWriter;
+static int logWriterRunning;
+/** Set to stop the writer thread when the library is unloaded */
+static int logStop;
+/** Set by the logging threads to have the buffers written at once */
+static int logKick;
+/** Set if the writer thread cannot be started, then messages are written
+ * by the thread that logs them
+ */
+static int logSynchronous;
+
+static void log_write(const char* data, size_t len) {
+  ssize_t n;
+
+  while (len > 0) {
+    n = write(STDERR_FILENO, data, len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    data += n;
+    len -= n;
+  }
+}
+
+/** Writes out the content of a buffer. Called with logListMutex held, so
+ * the output of different threads is not interleaved
+ */
+static void log_drain(omx_log_buffer_t* buffer, char* copy) {
+  size_t len;
+
+  pthread_mutex_lock(&buffer->mutex);
+  len = buffer->len;
+  memcpy(copy, buffer->data, len);
+  buffer->len = 0;
+  pthread_mutex_unlock(&buffer->mutex);
+  log_write(copy, len);
+}
+
+/** Thread exit destructor: writes out and releases the buffer of the thread */
+static void log_thread_exit(void* param) {
+  omx_log_buffer_t* buffer = param;
+  omx_log_buffer_t** link;
+  char* copy = malloc(OMX_LOG_BUFFER_SIZE);
+
+  pthread_mutex_lock(&logListMutex);
+  for (link = &logBuffers; *link != NULL; link = &(*link)->next) {
+    if (*link == buffer) {
+      *link = buffer->next;
+      break;
+    }
+  }
+  if (copy) {
+    log_drain(buffer, copy);
+  } else {
+    log_write(buffer->data, buffer->len);
+  }
+  pthread_mutex_unlock(&logListMutex);
+  free(copy);
+  pthread_mutex_destroy(&buffer->mutex);
+  free(buffer);
+}
+
+static void* log_writer(void* param) {
+  static char copy[OMX_LOG_BUFFER_SIZE];
+  omx_log_buffer_t* buffer;
+  struct timeval now;
+  struct timespec deadline;
+
+  pthread_mutex_lock(&logListMutex);
+  while (!logStop) {
+    if (!__atomic_exchange_n(&logKick, 0, __ATOMIC_ACQUIRE)) {
+      gettimeofday(&now, NULL);
+      deadline.tv_sec = now.tv_sec;
+      deadline.tv_nsec = now.tv_usec * 1000 + OMX_LOG_FLUSH_MSEC * 1000000;
+      if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+      }
+      pthread_cond_timedwait(&logCondition, &logListMutex, &deadline);
+      __atomic_store_n(&logKick, 0, __ATOMIC_RELAXED);
+    }
+    for (buffer = logBuffers; buffer != NULL; buffer = buffer->next) {
+      log_drain(buffer, copy);
+    }
+  }
+  pthread_mutex_unlock(&logListMutex);
+  return NULL;
+}
+
+static void log_init_once(void) {
+  pthread_key_create(&logKey, log_thread_exit);
+  if (pthread_create(&logWriter, NULL, log_writer, NULL) == 0) {
+    logWriterRunning = 1;
+  } else {
+    logSynchronous = 1;
+  }
+}
+
+/** Stops the writer thread and writes out what is left, at exit or when
+ * the library is unloaded. Later messages are written synchronously
+ */
+static void __attribute__((destructor)) log_deinit(void) {
+  if (logWriterRunning) {
+    pthread_mutex_lock(&logListMutex);
+    logStop = 1;
+    pthread_cond_signal(&logCondition);
+    pthread_mutex_unlock(&logListMutex);
+    pthread_join(logWriter, NULL);
+    logWriterRunning = 0;
+    logSynchronous = 1;
+    omx_debug_flush();
+    pthread_key_delete(logKey);
+  }
+}
+
+static omx_log_buffer_t* log_get_buffer(void) {
+  omx_log_buffer_t* buffer;
+
+  pthread_once(&logOnce, log_init_once);
+  buffer = pthread_getspecific(logKey);
+  if (buffer == NULL) {
+    buffer = malloc(sizeof(omx_log_buffer_t));
+    if (buffer == NULL) {
+      return NULL;
+    }
+    pthread_mutex_init(&buffer->mutex, NULL);
+    buffer->len = 0;
+    pthread_setspecific(logKey, buffer);
+    pthread_mutex_lock(&logListMutex);
+    buffer->next = logBuffers;
+    logBuffers = buffer;
+    pthread_mutex_unlock(&logListMutex);
+  }
+  return buffer;
+}
+
+void omx_debug_init(void) {
+  char* value = getenv(OMX_DEBUG_LEVEL_ENV);
+  char* end;
+  unsigned long level;
+
+  if (value != NULL && *value != '\0') {
+    level = strtoul(value, &end, 0);
+    if (*end == '\0') {
+      omx_debug_level = (unsigned int)level;
+    }
+  }
+}
+
+void omx_debug_log(unsigned int level, const char* fmt, ...) {
+  omx_log_buffer_t* buffer = NULL;
+  size_t room;
+  int len;
+  int kick;
+  va_list ap;
+
+  if (level & DEB_LEV_ERR) {
+    /* Errors keep their order with the other output on standard err */
+    omx_debug_flush();
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    return;
+  }
+  if (!logSynchronous) {
+    buffer = log_get_buffer();
+  }
+  if (buffer == NULL || logSynchronous) {
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    return;
+  }
+
+  pthread_mutex_lock(&buffer->mutex);
+  room = OMX_LOG_BUFFER_SIZE - buffer->len;
+  va_start(ap, fmt);
+  len = vsnprintf(buffer->data + buffer->len, room, fmt, ap);
+  va_end(ap);
+  if (len < 0) {
+    len = 0;
+  } else if ((size_t)len >= room) {
+    /* The message does not fit: write out what is buffered and retry,
+     * truncating the message if it is longer than the whole buffer
+     */
+    log_write(buffer->data, buffer->len);
+    buffer->len = 0;
+    va_start(ap, fmt);
+    len = vsnprintf(buffer->data, OMX_LOG_BUFFER_SIZE, fmt, ap);
+    va_end(ap);
+    if (len < 0) {
+      len = 0;
+    } else if (len >= OMX_LOG_BUFFER_SIZE) {
+      len = OMX_LOG_BUFFER_SIZE - 1;
+    }
+  }
+  buffer->len += len;
+  kick = buffer->len > OMX_LOG_BUFFER_SIZE / 2;
+  pthread_mutex_unlock(&buffer->mutex);
+
+  /* The writer is signalled without taking logListMutex. A lost wake up
+   * only delays the output until the next periodic flush
+   */
+  if (kick) {
+    __atomic_store_n(&logKick, 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&logCondition);
+  }
+}
+
+void omx_debug_flush(void) {
+  char* copy;
+  omx_log_buffer_t* buffer;
+
+  copy = malloc(OMX_LOG_BUFFER_SIZE);
+  if (copy == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&logListMutex);
+  for (buffer = logBuffers; buffer != NULL; buffer = buffer->next) {
+    log_drain(buffer, copy);
+  }
+  pthread_mutex_unlock(&logListMutex);
+  free(copy);
+}
@@ -66,10 +66,39 @@
  */
 #define DEB_ALL_MESS   255
 
-/** \def DEBUG_LEVEL is the current level do debug output on standard err */
-#define DEBUG_LEVEL (DEB_LEV_ERR)
+/** Environment variable read by OMX_Init to select the levels printed at
+ * run time, a mask of the DEB_LEV_* values, e.g. OMX_BELLAGIO_DEBUG_LEVEL=0x5
+ */
+#define OMX_DEBUG_LEVEL_ENV "OMX_BELLAGIO_DEBUG_LEVEL"
+
+/** \def DEBUG_LEVEL is the set of levels compiled in, all of them unless
+ * defined at build time. The levels actually printed on standard err are
+ * the ones also set in omx_debug_level, errors only by default.
+ * Define it to 0 to remove all the debug output lines
+ */
+#ifndef DEBUG_LEVEL
+#define DEBUG_LEVEL (DEB_ALL_MESS)
+#endif
+
+/** The levels printed at run time, DEB_LEV_ERR unless changed by the
+ * OMX_BELLAGIO_DEBUG_LEVEL environment variable
+ */
+extern unsigned int omx_debug_level;
+
+/** Reads the run time debug level from the environment. Called by OMX_Init */
+void omx_debug_init(void);
+
+/** Appends a message to the log buffer of the calling thread. The buffers
+ * are written on standard err by a background thread. Errors are written
+ * at once, after the messages still buffered
+ */
+void omx_debug_log(unsigned int level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/** Writes out the messages still buffered by all the threads */
+void omx_debug_flush(void);
+
 #if DEBUG_LEVEL > 0
-#define DEBUG(n, fmt, args...) do { if (DEBUG_LEVEL & (n)){fprintf(stderr, "OMX-" fmt, ##args);} } while (0)
+#define DEBUG(n, fmt, args...) do { if ((DEBUG_LEVEL & (n)) && __builtin_expect(omx_debug_level & (n), 0)) {omx_debug_log((n), "OMX-" fmt, ##args);} } while (0)
 #else
 #define DEBUG(n, fmt, args...)
 #endif
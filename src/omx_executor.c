@@ -0,0 +1,289 @@
+/**
+  @file src/omx_executor.c
+
+  Shared executor: a fixed pool of worker threads running the buffer
+  management steps of the components as tasks.
+
+  A step never blocks: it returns what it waits for, and the task is queued
+  again when a tsem_up or tsem_signal on that semaphore wakes it. A task runs
+  on one worker at a time, and a step runs entirely on one worker, so the
+  thread local state of the components stays consistent within a step.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "omx_executor.h"
+#include "omx_comp_debug_levels.h"
+
+/** Steps a task runs in a row before it goes back to the end of the run
+ * queue, so that a busy task does not hold a worker
+ */
+#define EXECUTOR_STEPS_PER_RUN 64
+
+/** Task states */
+#define TASK_STOPPED 0 /**< Not started, or finished */
+#define TASK_WAITING 1 /**< Waiting for omx_task_wake */
+#define TASK_QUEUED  2 /**< In the run queue */
+#define TASK_RUNNING 3 /**< Running on a worker */
+#define TASK_WOKEN   4 /**< Woken while running, queued again if its wait is not over */
+
+struct omx_task_t {
+  omx_task_step_t step;
+  void* arg;
+  omx_task_wait_t wait; /**< What the next step waits for */
+  int state; /**< One of the TASK_ states, protected by the executor mutex */
+  int bStarted; /**< Set by omx_task_start, cleared by omx_task_join */
+  struct omx_task_t* next; /**< Run queue link */
+};
+
+typedef struct omx_executor_t {
+  pthread_mutex_t mutex;
+  pthread_cond_t condition; /**< Signalled when a task is queued */
+  pthread_cond_t finished; /**< Broadcast when a task is finished */
+  omx_task_t* head; /**< Run queue */
+  omx_task_t* tail;
+  pthread_t* workers;
+  int nWorkers;
+  int nTasks; /**< Tasks started and not joined yet */
+  int bStop;
+} omx_executor_t;
+
+static omx_executor_t executor = {
+  PTHREAD_MUTEX_INITIALIZER,
+  PTHREAD_COND_INITIALIZER,
+  PTHREAD_COND_INITIALIZER,
+  NULL, NULL, NULL, 0, 0, 0
+};
+
+static int executorEnabled;
+
+/** Queues a task, called with the executor mutex held */
+static void executor_push(omx_task_t* task) {
+  task->state = TASK_QUEUED;
+  task->next = NULL;
+  if (executor.tail) {
+    executor.tail->next = task;
+  } else {
+    executor.head = task;
+  }
+  executor.tail = task;
+  pthread_cond_signal(&executor.condition);
+}
+
+/** @return 0 if the wait is over, and consumes the semaphore value it waited for */
+static int executor_trywait(omx_task_wait_t* wait) {
+  if (wait->tsem == NULL) {
+    return 0;
+  }
+  if (wait->bGeneration) {
+    if (tsem_get_gen(wait->tsem) == wait->gen) {
+      return -1;
+    }
+  } else if (tsem_trydown(wait->tsem) != 0) {
+    return -1;
+  }
+  wait->tsem = NULL;
+  return 0;
+}
+
+static void* executor_thread(void* param) {
+  omx_task_t* task;
+  int nSteps, bFinished;
+
+  pthread_mutex_lock(&executor.mutex);
+  for (;;) {
+    while (executor.head == NULL && !executor.bStop) {
+      pthread_cond_wait(&executor.condition, &executor.mutex);
+    }
+    if (executor.head == NULL) {
+      break;
+    }
+    task = executor.head;
+    executor.head = task->next;
+    if (executor.head == NULL) {
+      executor.tail = NULL;
+    }
+    task->state = TASK_RUNNING;
+    pthread_mutex_unlock(&executor.mutex);
+
+    bFinished = 0;
+    for (nSteps = 0; nSteps < EXECUTOR_STEPS_PER_RUN && executor_trywait(&task->wait) == 0; nSteps++) {
+      if (task->step(task->arg, &task->wait)) {
+        bFinished = 1;
+        break;
+      }
+    }
+
+    pthread_mutex_lock(&executor.mutex);
+    if (bFinished) {
+      task->state = TASK_STOPPED;
+      pthread_cond_broadcast(&executor.finished);
+    } else if (nSteps == EXECUTOR_STEPS_PER_RUN || task->state == TASK_WOKEN) {
+      /* Still runnable, or woken after its wait has been checked */
+      executor_push(task);
+    } else {
+      task->state = TASK_WAITING;
+    }
+  }
+  pthread_mutex_unlock(&executor.mutex);
+  return NULL;
+}
+
+int omx_executor_init(void) {
+  char* value = getenv(OMX_EXECUTOR_ENV);
+  long nWorkers;
+  int i;
+
+  if (executorEnabled || value == NULL || *value == '\0') {
+    return 0;
+  }
+  if (strcmp(value, "auto") == 0) {
+    nWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nWorkers < 1) {
+      nWorkers = 1;
+    }
+  } else {
+    nWorkers = strtol(value, NULL, 0);
+    if (nWorkers <= 0) {
+      return 0;
+    }
+  }
+
+  executor.workers = calloc(nWorkers, sizeof(pthread_t));
+  if (executor.workers == NULL) {
+    return -1;
+  }
+  executor.bStop = 0;
+  for (i = 0; i < nWorkers; i++) {
+    if (pthread_create(&executor.workers[i], NULL, executor_thread, NULL) != 0) {
+      DEBUG(DEB_LEV_ERR, "In %s cannot start worker %d\n", __func__, i);
+      break;
+    }
+  }
+  executor.nWorkers = i;
+  if (i == 0) {
+    free(executor.workers);
+    executor.workers = NULL;
+    return -1;
+  }
+  DEBUG(DEB_LEV_SIMPLE_SEQ, "In %s started %d workers\n", __func__, executor.nWorkers);
+  executorEnabled = 1;
+  return 0;
+}
+
+void omx_executor_deinit(void) {
+  int i;
+
+  if (!executorEnabled) {
+    return;
+  }
+  pthread_mutex_lock(&executor.mutex);
+  if (executor.nTasks > 0) {
+    DEBUG(DEB_LEV_ERR, "In %s %d tasks still started, workers left running\n", __func__, executor.nTasks);
+    pthread_mutex_unlock(&executor.mutex);
+    return;
+  }
+  executor.bStop = 1;
+  pthread_cond_broadcast(&executor.condition);
+  pthread_mutex_unlock(&executor.mutex);
+
+  for (i = 0; i < executor.nWorkers; i++) {
+    pthread_join(executor.workers[i], NULL);
+  }
+  free(executor.workers);
+  executor.workers = NULL;
+  executor.nWorkers = 0;
+  executorEnabled = 0;
+}
+
+int omx_executor_enabled(void) {
+  return executorEnabled;
+}
+
+omx_task_t* omx_task_create(omx_task_step_t step, void* arg) {
+  omx_task_t* task = calloc(1, sizeof(omx_task_t));
+
+  if (task == NULL) {
+    return NULL;
+  }
+  task->step = step;
+  task->arg = arg;
+  task->state = TASK_STOPPED;
+  return task;
+}
+
+void omx_task_destroy(omx_task_t* task) {
+  free(task);
+}
+
+void omx_task_start(omx_task_t* task) {
+  pthread_mutex_lock(&executor.mutex);
+  executor.nTasks++;
+  task->bStarted = 1;
+  task->wait.tsem = NULL;
+  executor_push(task);
+  pthread_mutex_unlock(&executor.mutex);
+}
+
+int omx_task_join(omx_task_t* task) {
+  pthread_mutex_lock(&executor.mutex);
+  if (!task->bStarted) {
+    pthread_mutex_unlock(&executor.mutex);
+    return -1;
+  }
+  while (task->state != TASK_STOPPED) {
+    pthread_cond_wait(&executor.finished, &executor.mutex);
+  }
+  task->bStarted = 0;
+  executor.nTasks--;
+  pthread_mutex_unlock(&executor.mutex);
+  return 0;
+}
+
+void omx_task_wake(void* arg) {
+  omx_task_t* task = (omx_task_t*)arg;
+
+  pthread_mutex_lock(&executor.mutex);
+  if (task->state == TASK_WAITING) {
+    executor_push(task);
+  } else if (task->state == TASK_RUNNING) {
+    task->state = TASK_WOKEN;
+  }
+  pthread_mutex_unlock(&executor.mutex);
+}
+
+void omx_task_wait(const omx_task_wait_t* wait) {
+  if (wait->tsem == NULL) {
+    return;
+  }
+  if (wait->bGeneration) {
+    tsem_wait_gen(wait->tsem, wait->gen);
+  } else {
+    tsem_down(wait->tsem);
+  }
+}
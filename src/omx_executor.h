@@ -0,0 +1,105 @@
+/**
+  @file src/omx_executor.h
+
+  Optional shared executor running the buffer management steps of the
+  components as tasks on a fixed pool of threads.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#ifndef __OMX_EXECUTOR_H__
+#define __OMX_EXECUTOR_H__
+
+#include "tsemaphore.h"
+
+/** Environment variable read by OMX_Init. Unset or 0 keeps one buffer
+ * management thread per component, "auto" starts one worker per online
+ * core, a number starts that many workers
+ */
+#define OMX_EXECUTOR_ENV "OMX_BELLAGIO_EXECUTOR"
+
+/** What a task waits for before its next step */
+typedef struct omx_task_wait_t {
+  tsem_t* tsem; /**< The semaphore waited on, NULL if the next step can run at once */
+  int bGeneration; /**< Wait for a tsem_signal after gen, like tsem_wait_gen, instead of a tsem_down */
+  unsigned int gen; /**< The generation returned by tsem_get_gen */
+} omx_task_wait_t;
+
+/** A step runs until it would block, and never blocks itself: it fills
+ * wait with what it waits for, and the next step runs once that wait is
+ * over. The semaphores waited on must call omx_task_wake, see
+ * tsem_set_notify
+ *
+ * @return 0 if another step has to run, non zero when the task is finished
+ */
+typedef int (*omx_task_step_t)(void* arg, omx_task_wait_t* wait);
+
+/** A task runs its steps on any of the workers, one step at a time */
+typedef struct omx_task_t omx_task_t;
+
+/** Starts the worker pool if requested by OMX_BELLAGIO_EXECUTOR.
+ * Called by OMX_Init
+ *
+ * @return 0 on success, -1 if the workers cannot be started
+ */
+int omx_executor_init(void);
+
+/** Stops the worker pool if no task is left. Called by OMX_Deinit */
+void omx_executor_deinit(void);
+
+/** @return non zero if the worker pool is started */
+int omx_executor_enabled(void);
+
+/** Creates a task running step(arg) until it is finished
+ *
+ * @return the task, or NULL if it cannot be allocated
+ */
+omx_task_t* omx_task_create(omx_task_step_t step, void* arg);
+
+/** Releases a task. It must not be started, and no semaphore may still
+ * call omx_task_wake on it
+ */
+void omx_task_destroy(omx_task_t* task);
+
+/** Queues the first step of a task for execution */
+void omx_task_start(omx_task_t* task);
+
+/** Waits for the end of a started task, like pthread_join. The task
+ * can be started again afterwards
+ *
+ * @return 0 once the task is finished, -1 if it was not started
+ */
+int omx_task_join(omx_task_t* task);
+
+/** Queues the next step of a task if it waits, or has it check its wait
+ * again if it runs. Has the omx_task_t as argument, to be passed to
+ * tsem_set_notify
+ */
+void omx_task_wake(void* task);
+
+/** Blocks the calling thread until a wait is over, to run the steps of
+ * a task on a thread of its own
+ */
+void omx_task_wait(const omx_task_wait_t* wait);
+
+#endif
@@ -0,0 +1,197 @@
+/**
+  @file src/omx_trace.c
+
+  Per-thread trace rings of the buffer path, enabled with --enable-trace.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#include "omx_trace.h"
+
+#ifdef OMX_TRACE_ENABLED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include "omx_comp_debug_levels.h"
+
+/** The ring of one thread. Only the owner thread writes it; the dump
+ * reads it when the components are gone
+ */
+typedef struct omx_trace_ring_t {
+  struct omx_trace_ring_t* next; /**< Next ring in the list of all the rings */
+  uint64_t nCount; /**< Records written since the last dump */
+  uint32_t nThread;
+  int bFree; /**< Set when the owner thread has exited, the ring can be taken by a new thread */
+  omx_trace_record_t records[OMX_TRACE_RING_SIZE];
+} omx_trace_ring_t;
+
+/** Rings of all the threads that took a record. Rings are never removed,
+ * so the list is pushed with a compare and swap and never locked. The
+ * ring of an exited thread is flagged free and taken over by the next
+ * thread that needs one, which keeps its records until overwritten: a
+ * buffer management thread is started at every Loaded to Idle transition,
+ * and the memory is only bound by the number of threads alive at once
+ */
+static omx_trace_ring_t* traceRings;
+
+static __thread omx_trace_ring_t* threadRing;
+
+static pthread_once_t traceOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t traceKey;
+static int traceEnabled;
+
+/** Hands the ring of an exiting thread over to the next thread, called through traceKey */
+static void omx_trace_release_ring(void* arg) {
+  omx_trace_ring_t* ring = (omx_trace_ring_t*)arg;
+
+  __atomic_store_n(&ring->bFree, 1, __ATOMIC_RELEASE);
+}
+
+static void omx_trace_init(void) {
+  const char* path = getenv(OMX_TRACE_FILE_ENV);
+
+  if (path == NULL || *path == '\0') {
+    return;
+  }
+  if (pthread_key_create(&traceKey, omx_trace_release_ring) != 0) {
+    DEBUG(DEB_LEV_ERR, "In %s cannot create the trace key, tracing disabled\n", __func__);
+    return;
+  }
+  traceEnabled = 1;
+}
+
+static omx_trace_ring_t* omx_trace_get_ring(void) {
+  omx_trace_ring_t* ring = threadRing;
+  int bFree;
+
+  if (ring == NULL) {
+    for (ring = __atomic_load_n(&traceRings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+      bFree = 1;
+      if (__atomic_load_n(&ring->bFree, __ATOMIC_RELAXED) &&
+          __atomic_compare_exchange_n(&ring->bFree, &bFree, 0, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        break;
+      }
+    }
+    if (ring == NULL) {
+      ring = calloc(1, sizeof(omx_trace_ring_t));
+      if (ring == NULL) {
+        return NULL;
+      }
+      ring->next = __atomic_load_n(&traceRings, __ATOMIC_RELAXED);
+      while (!__atomic_compare_exchange_n(&traceRings, &ring->next, ring, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        ;
+      }
+    }
+    ring->nThread = (uint32_t)syscall(SYS_gettid);
+    pthread_setspecific(traceKey, ring);
+    threadRing = ring;
+  }
+  return ring;
+}
+
+void omx_trace_record(OMX_TRACE_EVENT eEvent, const char* name, uint32_t nPortIndex, const void* pBuffer, uint32_t nFilledLen) {
+  omx_trace_ring_t* ring;
+  omx_trace_record_t* record;
+  struct timespec now;
+  uint64_t nCount;
+
+  pthread_once(&traceOnce, omx_trace_init);
+  if (!traceEnabled) {
+    return;
+  }
+  ring = omx_trace_get_ring();
+  if (ring == NULL) {
+    return;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  nCount = __atomic_load_n(&ring->nCount, __ATOMIC_RELAXED);
+  record = &ring->records[nCount % OMX_TRACE_RING_SIZE];
+  record->nTimestamp = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+  record->nBuffer = (uint64_t)(uintptr_t)pBuffer;
+  record->nEvent = eEvent;
+  record->nPortIndex = nPortIndex;
+  record->nThread = ring->nThread;
+  record->nFilledLen = nFilledLen;
+  strncpy(record->name, name ? name : "", OMX_TRACE_NAME_LEN - 1);
+  record->name[OMX_TRACE_NAME_LEN - 1] = '\0';
+  __atomic_store_n(&ring->nCount, nCount + 1, __ATOMIC_RELEASE);
+}
+
+int omx_trace_dump(void) {
+  omx_trace_file_header_t header;
+  omx_trace_ring_t* ring;
+  uint64_t nCount, nFirst, i;
+  const char* path;
+  FILE* fd;
+  int err = 0;
+
+  path = getenv(OMX_TRACE_FILE_ENV);
+  if (path == NULL || *path == '\0') {
+    return 0;
+  }
+  fd = fopen(path, "wb");
+  if (fd == NULL) {
+    DEBUG(DEB_LEV_ERR, "In %s cannot open trace file %s\n", __func__, path);
+    return -1;
+  }
+
+  memset(&header, 0, sizeof(header));
+  header.nMagic = OMX_TRACE_MAGIC;
+  header.nVersion = OMX_TRACE_VERSION;
+  header.nRecordSize = sizeof(omx_trace_record_t);
+  for (ring = __atomic_load_n(&traceRings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+    nCount = __atomic_load_n(&ring->nCount, __ATOMIC_ACQUIRE);
+    header.nRecords += nCount < OMX_TRACE_RING_SIZE ? nCount : OMX_TRACE_RING_SIZE;
+  }
+  if (fwrite(&header, sizeof(header), 1, fd) != 1) {
+    err = -1;
+  }
+
+  /* Each ring is written oldest record first */
+  for (ring = __atomic_load_n(&traceRings, __ATOMIC_ACQUIRE); ring != NULL && err == 0; ring = ring->next) {
+    nCount = __atomic_load_n(&ring->nCount, __ATOMIC_ACQUIRE);
+    nFirst = nCount < OMX_TRACE_RING_SIZE ? 0 : nCount - OMX_TRACE_RING_SIZE;
+    for (i = nFirst; i < nCount; i++) {
+      if (fwrite(&ring->records[i % OMX_TRACE_RING_SIZE], sizeof(omx_trace_record_t), 1, fd) != 1) {
+        err = -1;
+        break;
+      }
+    }
+    __atomic_store_n(&ring->nCount, 0, __ATOMIC_RELAXED);
+  }
+
+  if (fclose(fd) != 0) {
+    err = -1;
+  }
+  if (err) {
+    DEBUG(DEB_LEV_ERR, "In %s error writing trace file %s\n", __func__, path);
+  }
+  return err;
+}
+
+#endif
@@ -0,0 +1,121 @@
+/**
+  @file src/omx_trace.h
+
+  Optional tracing of the path of each buffer through the components.
+  The trace points record a monotonic timestamp, the buffer header and the
+  component name in a per-thread ring, dumped to a binary file by OMX_Deinit
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#ifndef __OMX_TRACE_H__
+#define __OMX_TRACE_H__
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+
+/** Environment variable holding the path of the trace file. Nothing is
+ * recorded nor written if it is not set when the first record is taken
+ */
+#define OMX_TRACE_FILE_ENV "OMX_BELLAGIO_TRACE"
+
+/** Number of records kept by each thread. When the ring is full the
+ * oldest records are overwritten
+ */
+#define OMX_TRACE_RING_SIZE 16384
+
+/** Length of the component name stored in each record, terminator included */
+#define OMX_TRACE_NAME_LEN 32
+
+/** Magic number at the beginning of the trace file: "OMXTRACE" */
+#define OMX_TRACE_MAGIC 0x4543415254584d4fULL
+#define OMX_TRACE_VERSION 1
+
+/** The points of the buffer path where a record is taken */
+typedef enum OMX_TRACE_EVENT {
+  OMX_TRACE_EMPTY_THIS_BUFFER = 0, /**< Entry of EmptyThisBuffer */
+  OMX_TRACE_FILL_THIS_BUFFER,      /**< Entry of FillThisBuffer */
+  OMX_TRACE_DEQUEUE,               /**< Buffer taken from the port queue by the buffer management thread */
+  OMX_TRACE_CALLBACK_START,        /**< Before the buffer management callback */
+  OMX_TRACE_CALLBACK_END,          /**< After the buffer management callback */
+  OMX_TRACE_RETURN_BUFFER,         /**< Entry of the port ReturnBufferFunction */
+  OMX_TRACE_EVENT_MAX
+} OMX_TRACE_EVENT;
+
+/** One trace record, as stored in the ring and in the trace file.
+ * The layout uses fixed size types so that the file can be read by
+ * test/tools/omxtrace2json on any host
+ */
+typedef struct omx_trace_record_t {
+  uint64_t nTimestamp; /**< CLOCK_MONOTONIC time in nanoseconds */
+  uint64_t nBuffer; /**< Address of the buffer header */
+  uint32_t nEvent; /**< One of OMX_TRACE_EVENT */
+  uint32_t nPortIndex; /**< Port the buffer belongs to */
+  uint32_t nThread; /**< Kernel id of the thread that took the record */
+  uint32_t nFilledLen; /**< nFilledLen of the buffer at the trace point */
+  char name[OMX_TRACE_NAME_LEN]; /**< Component name, possibly truncated */
+} omx_trace_record_t;
+
+/** Header of the trace file, followed by nRecords records */
+typedef struct omx_trace_file_header_t {
+  uint64_t nMagic;
+  uint32_t nVersion;
+  uint32_t nRecordSize; /**< sizeof(omx_trace_record_t) */
+  uint64_t nRecords;
+} omx_trace_file_header_t;
+
+#ifdef OMX_TRACE_ENABLED
+
+/** Appends a record to the ring of the calling thread. Only the calling
+ * thread writes its ring, so no lock is taken
+ */
+void omx_trace_record(OMX_TRACE_EVENT eEvent, const char* name, uint32_t nPortIndex, const void* pBuffer, uint32_t nFilledLen);
+
+/** Writes the records of all the threads to the file named by the
+ * OMX_BELLAGIO_TRACE environment variable and empties the rings.
+ * Called by OMX_Deinit, when no component is running
+ *
+ * @return 0 on success or if tracing is not requested, -1 on error
+ */
+int omx_trace_dump(void);
+
+/** Takes a trace record of the buffer header buf, on port nPortIndex of
+ * the component with the given name. Compiled to nothing unless configured
+ * with --enable-trace
+ */
+#define OMX_TRACE(event, name, nPortIndex, buf) \
+  omx_trace_record((event), (name), (uint32_t)(nPortIndex), (buf), (uint32_t)(buf)->nFilledLen)
+
+#define OMX_TRACE_DUMP() omx_trace_dump()
+
+#else
+
+#define OMX_TRACE(event, name, nPortIndex, buf) do { } while (0)
+#define OMX_TRACE_DUMP() do { } while (0)
+
+#endif
+
+#endif
@@ -44,6 +44,8 @@
 
 #include "omxcore.h"
 #include "omx_create_loaders.h"
+#include "omx_trace.h"
+#include "omx_executor.h"
 
 extern CPresult file_pipe_Constructor(CP_PIPETYPE* pPipe, CPstring szURI);
 extern CPresult inet_pipe_Constructor(CP_PIPETYPE* pPipe, CPstring szURI);
@@ -98,10 +100,15 @@ OMX_ERRORTYPE OMX_Init() {
   int i = 0;
   OMX_ERRORTYPE err;
 
+  omx_debug_init();
   DEBUG(DEB_LEV_FUNCTION_NAME, "In %s \n", __func__);
   if(initialized == 0) {
     initialized = 1;
 
+    if (omx_executor_init()) {
+      DEBUG(DEB_LEV_ERR, "The shared executor cannot be started, using a thread per component\n");
+    }
+
     if (createComponentLoaders()) {
     	return OMX_ErrorInsufficientResources;
     }
@@ -138,8 +145,11 @@ OMX_ERRORTYPE OMX_Deinit() {
   free(loadersList);
   loadersList = 0;
   initialized = 0;
+  omx_executor_deinit();
+  OMX_TRACE_DUMP();
   bosa_loaders = 0;
   DEBUG(DEB_LEV_FUNCTION_NAME, "Out of %s\n", __func__);
+  omx_debug_flush();
   return OMX_ErrorNone;
 }
 
@@ -1,7 +1,7 @@
 /**
   @file src/queue.c
 
-  Implements a simple LIFO structure used for queueing OMX buffers.
+  Implements a simple FIFO structure used for queueing OMX buffers.
 
   Copyright (C) 2007-2008 STMicroelectronics
   Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
@@ -33,28 +33,46 @@
 #include "queue.h"
 #include "omx_comp_debug_levels.h"
 
+/* The SPSC backend relies on the compiler providing the C11 memory model
+ * builtins; without them every queue keeps using the mutex backend.
+ */
+#if defined(__GCC_ATOMIC_INT_LOCK_FREE) && defined(__GCC_ATOMIC_POINTER_LOCK_FREE)
+#define QUEUE_HAVE_ATOMICS 1
+#endif
+
+/* Number of elements between the given head and tail indexes */
+static int queue_count(queue_t* queue, unsigned int head, unsigned int tail) {
+  return (int)(tail >= head ? tail - head : tail + queue->size - head);
+}
+
 /** Initialize a queue descriptor
  *
  * @param queue The queue descriptor to initialize.
  * The user needs to allocate the queue
  */
-void queue_init(queue_t* queue) {
-  int i;
-  qelem_t* newelem;
-  qelem_t* current;
-  queue->first = malloc(sizeof(qelem_t));
-  memset(queue->first, 0, sizeof(qelem_t));
-  current = queue->last = queue->first;
-  queue->nelem = 0;
-  for (i = 0; i<MAX_QUEUE_ELEMENTS - 2; i++) {
-    newelem = malloc(sizeof(qelem_t));
-    memset(newelem, 0, sizeof(qelem_t));
-    current->q_forw = newelem;
-    current = newelem;
-  }
-  current->q_forw = queue->first;
+int queue_init(queue_t* queue) {
+  return queue_init_size(queue, MAX_QUEUE_ELEMENTS - 1);
+}
+
+/** Initialize a queue descriptor able to hold a given number of elements
+ *
+ * @param queue The queue descriptor to initialize.
+ * The user needs to allocate the queue
+ *
+ * @param capacity the number of elements the queue can hold
+ */
+int queue_init_size(queue_t* queue, int capacity) {
+  if (capacity < 1) {
+    capacity = 1;
+  }
+  queue->ring = calloc(capacity + 1, sizeof(void*));
+  queue->size = queue->ring ? capacity + 1 : 0;
+  queue->type = QUEUE_TYPE_MUTEX;
+  queue->head = 0;
+  queue->tail = 0;
 
   pthread_mutex_init(&queue->mutex, NULL);
+  return queue->ring ? 0 : -1;
 }
 
 /** Deinitialize a queue descriptor
@@ -63,22 +81,148 @@ void queue_init(queue_t* queue) {
  * @param queue the queue descriptor to dump
  */
 void queue_deinit(queue_t* queue) {
-  int i;
-  qelem_t* current;
-  current = queue->first;
-  for (i = 0; i<MAX_QUEUE_ELEMENTS - 2; i++) {
-    if (current != NULL) {
-      current = current->q_forw;
-      free(queue->first);
-      queue->first = current;
+  if(queue->ring) {
+    free(queue->ring);
+    queue->ring = NULL;
+  }
+  queue->size = 0;
+  queue->head = 0;
+  queue->tail = 0;
+  pthread_mutex_destroy(&queue->mutex);
+}
+
+/* Move the queued elements to a ring of capacity slots; the caller holds
+ * the queue mutex */
+static int queue_resize_locked(queue_t* queue, int capacity) {
+  void** ring;
+  unsigned int i, n;
+  int nelem;
+
+  if ((unsigned int)capacity + 1 == queue->size) {
+    return 0;
+  }
+  nelem = queue_count(queue, queue->head, queue->tail);
+  if (nelem > capacity) {
+    DEBUG(DEB_LEV_ERR, "In %s cannot shrink a queue holding %d elements to %d\n", __func__, nelem, capacity);
+    return -1;
+  }
+  if ((ring = calloc(capacity + 1, sizeof(void*))) == NULL) {
+    return -1;
+  }
+  /* Move the queued elements, oldest first, to the start of the new ring */
+  for (n = 0, i = queue->head; i != queue->tail; n++) {
+    ring[n] = queue->ring[i];
+    if (++i == queue->size) {
+      i = 0;
     }
   }
-  if(queue->first) {
-    free(queue->first);
-    queue->first = NULL;
+  free(queue->ring);
+  queue->ring = ring;
+  queue->size = capacity + 1;
+  queue->head = 0;
+  queue->tail = n;
+  return 0;
+}
+
+/** Change the number of elements a queue can hold
+ *
+ * @param queue the queue descriptor
+ *
+ * @param capacity the new number of elements the queue can hold
+ */
+int queue_resize(queue_t* queue, int capacity) {
+  int ret;
+
+  if (capacity < 1) {
+    capacity = 1;
   }
-  pthread_mutex_destroy(&queue->mutex);
+  pthread_mutex_lock(&queue->mutex);
+  ret = queue_resize_locked(queue, capacity);
+  pthread_mutex_unlock(&queue->mutex);
+  return ret;
+}
+
+/** Double the number of elements a queue can hold
+ *
+ * The current capacity is read under the queue mutex, so concurrent
+ * producers of a mutex queue grow it consistently.
+ *
+ * @param queue the queue descriptor
+ */
+int queue_grow(queue_t* queue) {
+  int ret;
+
+  pthread_mutex_lock(&queue->mutex);
+  ret = queue_resize_locked(queue, 2 * (queue->size - 1));
+  pthread_mutex_unlock(&queue->mutex);
+  return ret;
+}
+
+/** Select the backend of a queue
+ *
+ * The queue must be empty and not in use by any other thread.
+ *
+ * @param queue the queue descriptor
+ *
+ * @param type the requested backend
+ *
+ * @return 0 on success, -1 if the backend could not be changed
+ */
+int queue_set_type(queue_t* queue, QUEUE_TYPE type) {
+  if (queue->type == type) {
+    return 0;
+  }
+  if (queue->head != queue->tail) {
+    DEBUG(DEB_LEV_ERR, "In %s cannot change the type of a non empty queue\n", __func__);
+    return -1;
+  }
+#ifndef QUEUE_HAVE_ATOMICS
+  if (type == QUEUE_TYPE_SPSC) {
+    return -1;
+  }
+#endif
+  queue->head = 0;
+  queue->tail = 0;
+  queue->type = type;
+  return 0;
+}
+
+#ifdef QUEUE_HAVE_ATOMICS
+/* Lock-free single producer/single consumer access to the ring. The
+ * producer publishes a slot with a release store of tail, the consumer
+ * frees it with a release store of head. Each side only writes its own
+ * index, so no cache line is written by both.
+ */
+static int queue_spsc(queue_t* queue, void* data) {
+  unsigned int tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+  unsigned int next = tail + 1;
+  if (next == queue->size) {
+    next = 0;
+  }
+  if (next == __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE)) {
+    return -1;
+  }
+  queue->ring[tail] = data;
+  __atomic_store_n(&queue->tail, next, __ATOMIC_RELEASE);
+  return 0;
+}
+
+static void* dequeue_spsc(queue_t* queue) {
+  void* data;
+  unsigned int head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+  unsigned int next;
+  if (head == __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE)) {
+    return NULL;
+  }
+  data = queue->ring[head];
+  next = head + 1;
+  if (next == queue->size) {
+    next = 0;
+  }
+  __atomic_store_n(&queue->head, next, __ATOMIC_RELEASE);
+  return data;
 }
+#endif
 
 /** Enqueue an element to the given queue descriptor
  *
@@ -86,15 +230,26 @@ void queue_deinit(queue_t* queue) {
  *
  * @param data the data to be enqueued
  */
-void queue(queue_t* queue, void* data) {
-  if (queue->last->data != NULL) {
-    return;
+int queue(queue_t* queue, void* data) {
+  unsigned int next;
+#ifdef QUEUE_HAVE_ATOMICS
+  if (queue->type == QUEUE_TYPE_SPSC) {
+    return queue_spsc(queue, data);
   }
+#endif
   pthread_mutex_lock(&queue->mutex);
-  queue->last->data = data;
-  queue->last = queue->last->q_forw;
-  queue->nelem++;
+  next = queue->tail + 1;
+  if (next == queue->size) {
+    next = 0;
+  }
+  if (next == queue->head) {
+    pthread_mutex_unlock(&queue->mutex);
+    return -1;
+  }
+  queue->ring[queue->tail] = data;
+  queue->tail = next;
   pthread_mutex_unlock(&queue->mutex);
+  return 0;
 }
 
 /** Dequeue an element from the given queue descriptor
@@ -106,14 +261,20 @@ void queue(queue_t* queue, void* data) {
  */
 void* dequeue(queue_t* queue) {
   void* data;
-  if (queue->first->data == NULL) {
-    return NULL;
+#ifdef QUEUE_HAVE_ATOMICS
+  if (queue->type == QUEUE_TYPE_SPSC) {
+    return dequeue_spsc(queue);
   }
+#endif
   pthread_mutex_lock(&queue->mutex);
-  data = queue->first->data;
-  queue->first->data = NULL;
-  queue->first = queue->first->q_forw;
-  queue->nelem--;
+  if (queue->head == queue->tail) {
+    pthread_mutex_unlock(&queue->mutex);
+    return NULL;
+  }
+  data = queue->ring[queue->head];
+  if (++queue->head == queue->size) {
+    queue->head = 0;
+  }
   pthread_mutex_unlock(&queue->mutex);
 
   return data;
@@ -127,8 +288,25 @@ void* dequeue(queue_t* queue) {
  */
 int getquenelem(queue_t* queue) {
   int qelem;
+#ifdef QUEUE_HAVE_ATOMICS
+  if (queue->type == QUEUE_TYPE_SPSC) {
+    /* A snapshot: the other side may move its index right after */
+    unsigned int head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    return queue_count(queue, head, __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE));
+  }
+#endif
   pthread_mutex_lock(&queue->mutex);
-  qelem = queue->nelem;
+  qelem = queue_count(queue, queue->head, queue->tail);
   pthread_mutex_unlock(&queue->mutex);
   return qelem;
 }
+
+/** Returns the number of elements the queue can hold
+ *
+ * @param queue the requested queue
+ *
+ * @return the capacity of the queue
+ */
+int getquecapacity(queue_t* queue) {
+  return queue->size ? (int)queue->size - 1 : 0;
+}
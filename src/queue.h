@@ -1,7 +1,7 @@
 /**
   @file src/queue.h
 
-  Implements a simple LIFO structure used for queueing OMX buffers.
+  Implements a simple FIFO structure used for queueing OMX buffers.
 
   Copyright (C) 2007-2008 STMicroelectronics
   Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
@@ -30,32 +30,63 @@
 #define __TQUEUE_H__
 
 #include <pthread.h>
-/** Maximum number of elements in a queue
+/** Default number of slots of a queue. One slot is always kept free,
+ * so a queue initialized with queue_init() holds up to
+ * MAX_QUEUE_ELEMENTS - 1 elements
  */
 #define MAX_QUEUE_ELEMENTS 10
-/** Output port queue element. Contains an OMX buffer header type
+
+/** Size of a cache line, used to keep the producer and the consumer
+ * indexes of a lock-free queue on separate lines
  */
-typedef struct qelem_t qelem_t;
-struct qelem_t{
-  qelem_t* q_forw;
-  void* data;
-};
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
 
-/** This structure contains the queue
+/** The queue backends. The mutex queue can be used from any number of
+ * threads. The SPSC queue is lock-free but only one thread may enqueue
+ * and only one thread may dequeue at any given time
+ */
+typedef enum QUEUE_TYPE {
+  QUEUE_TYPE_MUTEX = 0,
+  QUEUE_TYPE_SPSC
+} QUEUE_TYPE;
+
+/** This structure contains the queue. Both backends store the elements
+ * in the same contiguous ring of slots, the number of elements is the
+ * distance from head to tail
  */
 typedef struct queue_t{
-  qelem_t* first; /**< Output buffer queue head */
-  qelem_t* last; /**< Output buffer queue tail */
-  int nelem; /**< Number of elements in the queue */
+  void** ring; /**< The slots, size entries long */
+  unsigned int size; /**< Number of slots, the capacity plus one */
   pthread_mutex_t mutex;
+  QUEUE_TYPE type; /**< The backend currently in use */
+  char pad_head[CACHE_LINE_SIZE];
+  unsigned int head; /**< Index of the oldest element, written only by the consumer */
+  char pad_tail[CACHE_LINE_SIZE - sizeof(unsigned int)];
+  unsigned int tail; /**< Index of the first free slot, written only by the producer */
+  char pad_end[CACHE_LINE_SIZE - sizeof(unsigned int)];
 } queue_t;
 
 /** Initialize a queue descriptor
  *
  * @param queue The queue descriptor to initialize.
  * The user needs to allocate the queue
+ *
+ * @return 0 on success, -1 if the slots could not be allocated
+ */
+int queue_init(queue_t* queue);
+
+/** Initialize a queue descriptor able to hold a given number of elements
+ *
+ * @param queue The queue descriptor to initialize.
+ * The user needs to allocate the queue
+ *
+ * @param capacity the number of elements the queue can hold
+ *
+ * @return 0 on success, -1 if the slots could not be allocated
  */
-void queue_init(queue_t* queue);
+int queue_init_size(queue_t* queue, int capacity);
 
 /** Deinitialize a queue descriptor
  * flushing all of its internal data
@@ -64,13 +95,55 @@ void queue_init(queue_t* queue);
  */
 void queue_deinit(queue_t* queue);
 
+/** Change the number of elements a queue can hold
+ *
+ * The queued elements are kept. A SPSC queue must not be in use by any
+ * other thread.
+ *
+ * @param queue the queue descriptor
+ *
+ * @param capacity the new number of elements the queue can hold
+ *
+ * @return 0 on success, -1 if the queue holds more than capacity elements
+ * or the slots could not be allocated
+ */
+int queue_resize(queue_t* queue, int capacity);
+
+/** Double the number of elements a queue can hold
+ *
+ * The queued elements are kept. A SPSC queue must not be in use by any
+ * other thread.
+ *
+ * @param queue the queue descriptor
+ *
+ * @return 0 on success, -1 if the slots could not be allocated
+ */
+int queue_grow(queue_t* queue);
+
+/** Select the backend of a queue
+ *
+ * The queue must be empty and not in use by any other thread. If the
+ * SPSC backend is not available on this platform the queue is left
+ * unchanged.
+ *
+ * @param queue the queue descriptor
+ *
+ * @param type the requested backend
+ *
+ * @return 0 on success, -1 if the backend could not be changed
+ */
+int queue_set_type(queue_t* queue, QUEUE_TYPE type);
+
 /** Enqueue an element to the given queue descriptor
  *
  * @param queue the queue descritpor where to queue data
  *
  * @param data the data to be enqueued
+ *
+ * @return 0 on success, -1 if the queue is full. The element is not
+ * queued in that case
  */
-void queue(queue_t* queue, void* data);
+int queue(queue_t* queue, void* data);
 
 /** Dequeue an element from the given queue descriptor
  *
@@ -89,4 +162,12 @@ void* dequeue(queue_t* queue);
  */
 int getquenelem(queue_t* queue);
 
+/** Returns the number of elements the queue can hold
+ *
+ * @param queue the requested queue
+ *
+ * @return the capacity of the queue
+ */
+int getquecapacity(queue_t* queue);
+
 #endif
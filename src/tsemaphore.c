@@ -27,12 +27,40 @@
   Author $Author$
 */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <pthread.h>
+#include <unistd.h>
+#include <time.h>
 #include <sys/time.h>
 #include <errno.h>
 #include "tsemaphore.h"
 #include "omx_comp_debug_levels.h"
 
+/* tsem_up and tsem_down only enter the kernel when a thread has to block
+ * or has to be woken up, if futexes and the atomic builtins are available.
+ */
+#if defined(HAVE_LINUX_FUTEX_H) && defined(__GCC_ATOMIC_INT_LOCK_FREE)
+#define TSEM_USE_FUTEX 1
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+static inline void futex_wait(unsigned int* addr, unsigned int val) {
+  syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static inline int futex_wait_until(unsigned int* addr, unsigned int val, const struct timespec* deadline) {
+  /* FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC time */
+  return syscall(SYS_futex, addr, FUTEX_WAIT_BITSET_PRIVATE, val, deadline, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+static inline void futex_wake(unsigned int* addr, int nwake) {
+  syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, nwake, NULL, NULL, 0);
+}
+#endif
+
 /** Initializes the semaphore at a given value
  *
  * @param tsem the semaphore to initialize
@@ -40,9 +68,36 @@
  *
  */
 void tsem_init(tsem_t* tsem, unsigned int val) {
-  pthread_cond_init(&tsem->condition, NULL);
+  pthread_condattr_t attr;
+
+  pthread_condattr_init(&attr);
+#ifdef _POSIX_MONOTONIC_CLOCK
+  /* Deadlines of tsem_timed_down are on the monotonic clock */
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+  pthread_cond_init(&tsem->condition, &attr);
+  pthread_condattr_destroy(&attr);
   pthread_mutex_init(&tsem->mutex, NULL);
   tsem->semval = val;
+  tsem->nwaiters = 0;
+  tsem->gen = 0;
+  tsem->notify = NULL;
+  tsem->notify_arg = NULL;
+}
+
+/** Calls the notify function of the semaphore, if any */
+static inline void tsem_notify(tsem_t* tsem) {
+  void (*notify)(void* arg);
+#ifdef __GCC_ATOMIC_POINTER_LOCK_FREE
+  notify = __atomic_load_n(&tsem->notify, __ATOMIC_ACQUIRE);
+#else
+  pthread_mutex_lock(&tsem->mutex);
+  notify = tsem->notify;
+  pthread_mutex_unlock(&tsem->mutex);
+#endif
+  if (notify) {
+    notify(tsem->notify_arg);
+  }
 }
 
 /** Destroy the semaphore
@@ -60,12 +115,91 @@ void tsem_deinit(tsem_t* tsem) {
  * @param tsem the semaphore to decrease
  */
 void tsem_down(tsem_t* tsem) {
+#ifdef TSEM_USE_FUTEX
+  unsigned int val;
+  for (;;) {
+    val = __atomic_load_n(&tsem->semval, __ATOMIC_RELAXED);
+    while (val > 0) {
+      if (__atomic_compare_exchange_n(&tsem->semval, &val, val - 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+      }
+    }
+    /* The kernel puts us to sleep only if semval is still zero, and
+     * tsem_up checks nwaiters after publishing the new value */
+    __atomic_add_fetch(&tsem->nwaiters, 1, __ATOMIC_SEQ_CST);
+    futex_wait(&tsem->semval, 0);
+    __atomic_sub_fetch(&tsem->nwaiters, 1, __ATOMIC_RELAXED);
+  }
+#else
   pthread_mutex_lock(&tsem->mutex);
   while (tsem->semval == 0) {
     pthread_cond_wait(&tsem->condition, &tsem->mutex);
   }
   tsem->semval--;
   pthread_mutex_unlock(&tsem->mutex);
+#endif
+}
+
+/** Decreases the value of the semaphore. Blocks if the semaphore
+ * value is zero, but not beyond the given deadline.
+ *
+ * @param tsem the semaphore to decrease
+ * @param deadline absolute time on CLOCK_MONOTONIC
+ *
+ * @return 0 if the semaphore has been decreased, -1 if the deadline expired
+ */
+int tsem_timed_down(tsem_t* tsem, const struct timespec* deadline) {
+#ifdef TSEM_USE_FUTEX
+  unsigned int val;
+  int timedout = 0;
+  for (;;) {
+    val = __atomic_load_n(&tsem->semval, __ATOMIC_RELAXED);
+    while (val > 0) {
+      if (__atomic_compare_exchange_n(&tsem->semval, &val, val - 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return 0;
+      }
+    }
+    if (timedout) {
+      return -1;
+    }
+    __atomic_add_fetch(&tsem->nwaiters, 1, __ATOMIC_SEQ_CST);
+    if (futex_wait_until(&tsem->semval, 0, deadline) == -1 && errno == ETIMEDOUT) {
+      timedout = 1;
+    }
+    __atomic_sub_fetch(&tsem->nwaiters, 1, __ATOMIC_RELAXED);
+  }
+#else
+  int ret = 0;
+  pthread_mutex_lock(&tsem->mutex);
+  while (tsem->semval == 0) {
+    if (pthread_cond_timedwait(&tsem->condition, &tsem->mutex, deadline) == ETIMEDOUT) {
+      if (tsem->semval == 0) {
+        ret = -1;
+      }
+      break;
+    }
+  }
+  if (ret == 0) {
+    tsem->semval--;
+  }
+  pthread_mutex_unlock(&tsem->mutex);
+  return ret;
+#endif
+}
+
+/** Computes a deadline for tsem_timed_down
+ *
+ * @param deadline filled with the current CLOCK_MONOTONIC time plus msec
+ * @param msec the timeout in milliseconds
+ */
+void tsem_deadline(struct timespec* deadline, unsigned int msec) {
+  clock_gettime(CLOCK_MONOTONIC, deadline);
+  deadline->tv_sec += msec / 1000;
+  deadline->tv_nsec += (msec % 1000) * 1000000L;
+  if (deadline->tv_nsec >= 1000000000L) {
+    deadline->tv_sec++;
+    deadline->tv_nsec -= 1000000000L;
+  }
 }
 
 /** Increases the value of the semaphore
@@ -73,10 +207,67 @@ void tsem_down(tsem_t* tsem) {
  * @param tsem the semaphore to increase
  */
 void tsem_up(tsem_t* tsem) {
+#ifdef TSEM_USE_FUTEX
+  __atomic_add_fetch(&tsem->semval, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&tsem->nwaiters, __ATOMIC_SEQ_CST) > 0) {
+    futex_wake(&tsem->semval, 1);
+  }
+#else
   pthread_mutex_lock(&tsem->mutex);
   tsem->semval++;
   pthread_cond_signal(&tsem->condition);
   pthread_mutex_unlock(&tsem->mutex);
+#endif
+  tsem_notify(tsem);
+}
+
+/** Decreases the value of the semaphore if it is not zero
+ *
+ * @param tsem the semaphore to decrease
+ *
+ * @return 0 if the semaphore has been decreased, -1 if it was zero
+ */
+int tsem_trydown(tsem_t* tsem) {
+#ifdef TSEM_USE_FUTEX
+  unsigned int val = __atomic_load_n(&tsem->semval, __ATOMIC_RELAXED);
+  while (val > 0) {
+    if (__atomic_compare_exchange_n(&tsem->semval, &val, val - 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      return 0;
+    }
+  }
+  return -1;
+#else
+  int ret = -1;
+  pthread_mutex_lock(&tsem->mutex);
+  if (tsem->semval > 0) {
+    tsem->semval--;
+    ret = 0;
+  }
+  pthread_mutex_unlock(&tsem->mutex);
+  return ret;
+#endif
+}
+
+/** Sets a function called after every tsem_up and tsem_signal
+ *
+ * @param tsem the semaphore
+ * @param notify the function, or NULL to remove it
+ * @param arg the argument of notify
+ */
+void tsem_set_notify(tsem_t* tsem, void (*notify)(void* arg), void* arg) {
+#ifdef __GCC_ATOMIC_POINTER_LOCK_FREE
+  if (notify) {
+    tsem->notify_arg = arg;
+  }
+  __atomic_store_n(&tsem->notify, notify, __ATOMIC_RELEASE);
+#else
+  pthread_mutex_lock(&tsem->mutex);
+  if (notify) {
+    tsem->notify_arg = arg;
+  }
+  tsem->notify = notify;
+  pthread_mutex_unlock(&tsem->mutex);
+#endif
 }
 
 /** Reset the value of the semaphore
@@ -84,28 +275,100 @@ void tsem_up(tsem_t* tsem) {
  * @param tsem the semaphore to reset
  */
 void tsem_reset(tsem_t* tsem) {
+#ifdef TSEM_USE_FUTEX
+  __atomic_store_n(&tsem->semval, 0, __ATOMIC_RELEASE);
+#else
   pthread_mutex_lock(&tsem->mutex);
   tsem->semval=0;
   pthread_mutex_unlock(&tsem->mutex);
+#endif
 }
 
-/** Wait on the condition.
+/** Wait on the condition. A signal sent before the call is lost.
  *
  * @param tsem the semaphore to wait
  */
 void tsem_wait(tsem_t* tsem) {
+  unsigned int gen;
+  pthread_mutex_lock(&tsem->mutex);
+  gen = tsem->gen;
+  while (tsem->gen == gen) {
+    pthread_cond_wait(&tsem->condition, &tsem->mutex);
+  }
+  pthread_mutex_unlock(&tsem->mutex);
+}
+
+/** Returns the current signal generation of the semaphore
+ *
+ * Every change done by the signalling thread before tsem_signal is
+ * visible to the caller if the returned generation is the new one.
+ * The mutex is only taken where the atomic builtins are missing.
+ *
+ * @param tsem the semaphore
+ */
+unsigned int tsem_get_gen(tsem_t* tsem) {
+#ifdef __GCC_ATOMIC_INT_LOCK_FREE
+  return __atomic_load_n(&tsem->gen, __ATOMIC_ACQUIRE);
+#else
+  unsigned int gen;
   pthread_mutex_lock(&tsem->mutex);
-  pthread_cond_wait(&tsem->condition, &tsem->mutex);
+  gen = tsem->gen;
   pthread_mutex_unlock(&tsem->mutex);
+  return gen;
+#endif
 }
 
-/** Signal the condition,if waiting
+/** Wait on the condition until it is signalled after the generation
+ * has been read.
+ *
+ * @param tsem the semaphore to wait
+ * @param gen the generation returned by tsem_get_gen
+ */
+void tsem_wait_gen(tsem_t* tsem, unsigned int gen) {
+  pthread_mutex_lock(&tsem->mutex);
+  while (tsem->gen == gen) {
+    pthread_cond_wait(&tsem->condition, &tsem->mutex);
+  }
+  pthread_mutex_unlock(&tsem->mutex);
+}
+
+/** Wait on the condition until it is signalled after the generation
+ * has been read, but not beyond the given deadline.
+ *
+ * @param tsem the semaphore to wait
+ * @param gen the generation returned by tsem_get_gen
+ * @param deadline absolute time on CLOCK_MONOTONIC
+ *
+ * @return 0 if the condition has been signalled, -1 if the deadline expired
+ */
+int tsem_timed_wait_gen(tsem_t* tsem, unsigned int gen, const struct timespec* deadline) {
+  int ret = 0;
+  pthread_mutex_lock(&tsem->mutex);
+  while (tsem->gen == gen) {
+    if (pthread_cond_timedwait(&tsem->condition, &tsem->mutex, deadline) == ETIMEDOUT) {
+      if (tsem->gen == gen) {
+        ret = -1;
+      }
+      break;
+    }
+  }
+  pthread_mutex_unlock(&tsem->mutex);
+  return ret;
+}
+
+/** Signal the condition to all the waiting threads, and start a new
+ * generation
  *
  * @param tsem the semaphore to signal
  */
 void tsem_signal(tsem_t* tsem) {
   pthread_mutex_lock(&tsem->mutex);
-  pthread_cond_signal(&tsem->condition);
+#ifdef __GCC_ATOMIC_INT_LOCK_FREE
+  __atomic_store_n(&tsem->gen, tsem->gen + 1, __ATOMIC_RELEASE);
+#else
+  tsem->gen++;
+#endif
+  pthread_cond_broadcast(&tsem->condition);
   pthread_mutex_unlock(&tsem->mutex);
+  tsem_notify(tsem);
 }
-
@@ -31,12 +31,21 @@
 #ifndef __TSEMAPHORE_H__
 #define __TSEMAPHORE_H__
 
-/** The structure contains the semaphore value, mutex and green light flag
+#include <pthread.h>
+#include <time.h>
+
+/** The structure contains the semaphore value, mutex and green light flag.
+ * Where futexes are available semval is also the futex word, and the
+ * mutex is only used by tsem_wait and tsem_signal
  */
 typedef struct tsem_t{
   pthread_cond_t condition;
   pthread_mutex_t mutex;
   unsigned int semval;
+  unsigned int nwaiters; /**< Threads blocked in tsem_down, futex path only */
+  unsigned int gen; /**< Incremented by every tsem_signal */
+  void (*notify)(void* arg); /**< Called by tsem_up and tsem_signal if set, see tsem_set_notify */
+  void* notify_arg; /**< The argument of notify */
 }tsem_t;
 
 /** Initializes the semaphore at a given value
@@ -66,19 +75,94 @@ void tsem_down(tsem_t* tsem);
  */
 void tsem_up(tsem_t* tsem);
 
+/** Decreases the value of the semaphore if it is not zero, without
+ * blocking
+ *
+ * @param tsem the semaphore to decrease
+ *
+ * @return 0 if the semaphore has been decreased, -1 if it was zero
+ */
+int tsem_trydown(tsem_t* tsem);
+
+/** Sets a function called after every tsem_up and tsem_signal, once the
+ * new value or generation is visible. It is used by the shared executor
+ * to run a task waiting on the semaphore, see omx_executor.h
+ *
+ * @param tsem the semaphore
+ *
+ * @param notify the function, or NULL to remove it. A call already
+ * started may still happen after it has been removed
+ *
+ * @param arg the argument of notify, it must stay valid as long as
+ * the semaphore is used
+ */
+void tsem_set_notify(tsem_t* tsem, void (*notify)(void* arg), void* arg);
+
 /** Reset the value of the semaphore
  *
  * @param tsem the semaphore to reset
  */
 void tsem_reset(tsem_t* tsem);
 
-/** Wait on the condition.
+/** Decreases the value of the semaphore. Blocks if the semaphore
+ * value is zero, but not beyond the given deadline.
+ *
+ * @param tsem the semaphore to decrease
+ *
+ * @param deadline absolute time on CLOCK_MONOTONIC, see tsem_deadline
+ *
+ * @return 0 if the semaphore has been decreased, -1 if the deadline expired
+ */
+int tsem_timed_down(tsem_t* tsem, const struct timespec* deadline);
+
+/** Computes a deadline for tsem_timed_down
+ *
+ * @param deadline filled with the current CLOCK_MONOTONIC time plus msec
+ *
+ * @param msec the timeout in milliseconds
+ */
+void tsem_deadline(struct timespec* deadline, unsigned int msec);
+
+/** Wait on the condition. A signal sent before the call is lost, use
+ * tsem_get_gen and tsem_wait_gen when the wait depends on a state that
+ * another thread changes before signalling.
  *
  * @param tsem the semaphore to wait
  */
 void tsem_wait(tsem_t* tsem);
 
-/** Signal the condition,if waiting
+/** Returns the current signal generation of the semaphore
+ *
+ * @param tsem the semaphore
+ *
+ * @return the generation, to be passed to tsem_wait_gen
+ */
+unsigned int tsem_get_gen(tsem_t* tsem);
+
+/** Wait on the condition until it is signalled after the generation
+ * has been read. Returns immediately if a signal already happened.
+ *
+ * @param tsem the semaphore to wait
+ *
+ * @param gen the generation returned by tsem_get_gen
+ */
+void tsem_wait_gen(tsem_t* tsem, unsigned int gen);
+
+/** Wait on the condition until it is signalled after the generation
+ * has been read, but not beyond the given deadline.
+ *
+ * @param tsem the semaphore to wait
+ *
+ * @param gen the generation returned by tsem_get_gen
+ *
+ * @param deadline absolute time on CLOCK_MONOTONIC, see tsem_deadline
+ *
+ * @return 0 if the condition has been signalled, -1 if the deadline expired
+ */
+int tsem_timed_wait_gen(tsem_t* tsem, unsigned int gen, const struct timespec* deadline);
+
+/** Signal the condition to all the waiting threads, and start a new
+ * generation
  *
  * @param tsem the semaphore to signal
  */
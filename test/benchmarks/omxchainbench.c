@@ -0,0 +1,560 @@
+/**
+  @file test/benchmarks/omxchainbench.c
+
+  Measures the buffer round trip of the base framework. A null source, up
+  to MAX_CHAIN_LENGTH null filters and a null sink, built on the base
+  source, filter and sink, are chained either with tunnels or through the
+  IL client. The components do not touch the payloads, so the time spent
+  is the one of the ports, the queues and the semaphores.
+
+  For each chain length, buffer size and buffer count the benchmark
+  prints a CSV line with the throughput and the median and 99th
+  percentile latency from the source to the sink.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#include <getopt.h>
+
+#include <omx_comp_debug_levels.h>
+#include <omx_executor.h>
+
+#include "omxchainbench.h"
+
+static benchRunType run;
+
+static OMX_CALLBACKTYPE callbacks = {
+  .EventHandler = benchEventHandler,
+  .EmptyBufferDone = benchEmptyBufferDone,
+  .FillBufferDone = benchFillBufferDone
+};
+
+static OMX_S64 now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (OMX_S64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/** Destructor shared by the null components */
+static OMX_ERRORTYPE omx_null_component_Destructor(OMX_COMPONENTTYPE *openmaxStandComp) {
+  omx_base_component_PrivateType* omx_base_component_Private = openmaxStandComp->pComponentPrivate;
+  OMX_U32 i;
+
+  if (omx_base_component_Private->ports) {
+    for (i = 0; i < omx_base_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts; i++) {
+      if (omx_base_component_Private->ports[i]) {
+        omx_base_component_Private->ports[i]->PortDestructor(omx_base_component_Private->ports[i]);
+      }
+    }
+    free(omx_base_component_Private->ports);
+    omx_base_component_Private->ports = NULL;
+  }
+  return omx_base_component_Destructor(openmaxStandComp);
+}
+
+/** Creates the audio ports of a null component, the input one first */
+static OMX_ERRORTYPE omx_null_component_CreatePorts(OMX_COMPONENTTYPE *openmaxStandComp, OMX_BOOL hasInput, OMX_BOOL hasOutput) {
+  omx_base_component_PrivateType* omx_base_component_Private = openmaxStandComp->pComponentPrivate;
+  OMX_U32 nPorts = (hasInput ? 1 : 0) + (hasOutput ? 1 : 0);
+  OMX_U32 i;
+
+  omx_base_component_Private->sPortTypesParam[OMX_PortDomainAudio].nStartPortNumber = 0;
+  omx_base_component_Private->sPortTypesParam[OMX_PortDomainAudio].nPorts = nPorts;
+  omx_base_component_Private->ports = calloc(nPorts, sizeof(omx_base_PortType *));
+  if (!omx_base_component_Private->ports) {
+    return OMX_ErrorInsufficientResources;
+  }
+  for (i = 0; i < nPorts; i++) {
+    omx_base_component_Private->ports[i] = calloc(1, sizeof(omx_base_audio_PortType));
+    if (!omx_base_component_Private->ports[i]) {
+      return OMX_ErrorInsufficientResources;
+    }
+    base_audio_port_Constructor(openmaxStandComp, &omx_base_component_Private->ports[i], i, (hasInput && i == 0) ? OMX_TRUE : OMX_FALSE);
+    omx_base_component_Private->ports[i]->sPortParam.nBufferSize = run.nBufferSize;
+    omx_base_component_Private->ports[i]->sPortParam.nBufferCountActual = run.nBufferCount;
+    if (omx_base_component_Private->ports[i]->sPortParam.nBufferCountMin > run.nBufferCount) {
+      omx_base_component_Private->ports[i]->sPortParam.nBufferCountMin = run.nBufferCount;
+    }
+  }
+  omx_base_component_Private->destructor = omx_null_component_Destructor;
+  return OMX_ErrorNone;
+}
+
+/** Produces run.nBuffers full buffers stamped with the current time */
+static void omx_null_source_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandComp, OMX_BUFFERHEADERTYPE* pOutputBuffer) {
+  if (run.nSent == run.nBuffers) {
+    /* Everything sent: keep the buffer without spinning until the chain is stopped */
+    usleep(1000);
+    return;
+  }
+  pOutputBuffer->nOffset = 0;
+  pOutputBuffer->nFilledLen = pOutputBuffer->nAllocLen;
+  pOutputBuffer->nTimeStamp = now_ns();
+  if (run.nSent == 0) {
+    run.nStartTime = pOutputBuffer->nTimeStamp;
+  }
+  run.nSent++;
+}
+
+/** Passes the input buffer on without reading it */
+static void omx_null_filter_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandComp, OMX_BUFFERHEADERTYPE* pInputBuffer, OMX_BUFFERHEADERTYPE* pOutputBuffer) {
+  pOutputBuffer->nOffset = 0;
+  pOutputBuffer->nFilledLen = pInputBuffer->nFilledLen;
+  pInputBuffer->nFilledLen = 0;
+}
+
+/** Records the latency of each buffer and signals the end of the run */
+static void omx_null_sink_BufferMgmtCallback(OMX_COMPONENTTYPE *openmaxStandComp, OMX_BUFFERHEADERTYPE* pInputBuffer) {
+  OMX_S64 now = now_ns();
+
+  pInputBuffer->nFilledLen = 0;
+  if (run.nReceived == run.nBuffers) {
+    return;
+  }
+  run.pLatencies[run.nReceived++] = now - pInputBuffer->nTimeStamp;
+  if (run.nReceived == run.nBuffers) {
+    run.nEndTime = now;
+    tsem_up(&run.doneSem);
+  }
+}
+
+OMX_ERRORTYPE omx_null_source_Constructor(OMX_COMPONENTTYPE *openmaxStandComp, OMX_STRING cComponentName) {
+  omx_base_source_PrivateType* omx_base_source_Private;
+  OMX_ERRORTYPE err;
+
+  openmaxStandComp->pComponentPrivate = calloc(1, sizeof(omx_base_source_PrivateType));
+  if (openmaxStandComp->pComponentPrivate == NULL) {
+    return OMX_ErrorInsufficientResources;
+  }
+  err = omx_base_source_Constructor(openmaxStandComp, cComponentName);
+  if (err != OMX_ErrorNone) {
+    return err;
+  }
+  omx_base_source_Private = openmaxStandComp->pComponentPrivate;
+  omx_base_source_Private->BufferMgmtCallback = omx_null_source_BufferMgmtCallback;
+  return omx_null_component_CreatePorts(openmaxStandComp, OMX_FALSE, OMX_TRUE);
+}
+
+OMX_ERRORTYPE omx_null_filter_Constructor(OMX_COMPONENTTYPE *openmaxStandComp, OMX_STRING cComponentName) {
+  omx_base_filter_PrivateType* omx_base_filter_Private;
+  OMX_ERRORTYPE err;
+
+  openmaxStandComp->pComponentPrivate = calloc(1, sizeof(omx_base_filter_PrivateType));
+  if (openmaxStandComp->pComponentPrivate == NULL) {
+    return OMX_ErrorInsufficientResources;
+  }
+  err = omx_base_filter_Constructor(openmaxStandComp, cComponentName);
+  if (err != OMX_ErrorNone) {
+    return err;
+  }
+  omx_base_filter_Private = openmaxStandComp->pComponentPrivate;
+  omx_base_filter_Private->BufferMgmtCallback = omx_null_filter_BufferMgmtCallback;
+  return omx_null_component_CreatePorts(openmaxStandComp, OMX_TRUE, OMX_TRUE);
+}
+
+OMX_ERRORTYPE omx_null_sink_Constructor(OMX_COMPONENTTYPE *openmaxStandComp, OMX_STRING cComponentName) {
+  omx_base_sink_PrivateType* omx_base_sink_Private;
+  OMX_ERRORTYPE err;
+
+  openmaxStandComp->pComponentPrivate = calloc(1, sizeof(omx_base_sink_PrivateType));
+  if (openmaxStandComp->pComponentPrivate == NULL) {
+    return OMX_ErrorInsufficientResources;
+  }
+  err = omx_base_sink_Constructor(openmaxStandComp, cComponentName);
+  if (err != OMX_ErrorNone) {
+    return err;
+  }
+  omx_base_sink_Private = openmaxStandComp->pComponentPrivate;
+  omx_base_sink_Private->BufferMgmtCallback = omx_null_sink_BufferMgmtCallback;
+  return omx_null_component_CreatePorts(openmaxStandComp, OMX_TRUE, OMX_FALSE);
+}
+
+/* Callbacks implementation */
+OMX_ERRORTYPE benchEventHandler(
+  OMX_OUT OMX_HANDLETYPE hComponent,
+  OMX_OUT OMX_PTR pAppData,
+  OMX_OUT OMX_EVENTTYPE eEvent,
+  OMX_OUT OMX_U32 Data1,
+  OMX_OUT OMX_U32 Data2,
+  OMX_IN OMX_PTR pEventData) {
+
+  if (eEvent == OMX_EventCmdComplete) {
+    tsem_up(&run.eventSem);
+  } else if (eEvent == OMX_EventError) {
+    fprintf(stderr, "omxchainbench: error %x from component %p\n", (int)Data1, hComponent);
+  }
+  return OMX_ErrorNone;
+}
+
+/** The downstream component is done with an input buffer: give the
+ * payload back to the upstream component
+ */
+OMX_ERRORTYPE benchEmptyBufferDone(
+  OMX_OUT OMX_HANDLETYPE hComponent,
+  OMX_OUT OMX_PTR pAppData,
+  OMX_OUT OMX_BUFFERHEADERTYPE* pBuffer) {
+  hopBufferType* hop = pBuffer->pAppPrivate;
+
+  if (run.bStopping) {
+    return OMX_ErrorNone;
+  }
+  hop->pPeer->nFilledLen = 0;
+  hop->pPeer->nOffset = 0;
+  return OMX_FillThisBuffer(hop->hPeer, hop->pPeer);
+}
+
+/** The upstream component has filled an output buffer: pass the payload
+ * to the downstream component
+ */
+OMX_ERRORTYPE benchFillBufferDone(
+  OMX_OUT OMX_HANDLETYPE hComponent,
+  OMX_OUT OMX_PTR pAppData,
+  OMX_OUT OMX_BUFFERHEADERTYPE* pBuffer) {
+  hopBufferType* hop = pBuffer->pAppPrivate;
+
+  if (run.bStopping) {
+    return OMX_ErrorNone;
+  }
+  hop->pPeer->nFilledLen = pBuffer->nFilledLen;
+  hop->pPeer->nOffset = pBuffer->nOffset;
+  hop->pPeer->nTimeStamp = pBuffer->nTimeStamp;
+  hop->pPeer->nFlags = pBuffer->nFlags;
+  return OMX_EmptyThisBuffer(hop->hPeer, hop->pPeer);
+}
+
+/** Sends a state command to all the components and waits for their completion */
+static OMX_ERRORTYPE setChainState(OMX_HANDLETYPE* handles, OMX_U32 nHandles, OMX_STATETYPE eState) {
+  OMX_ERRORTYPE err = OMX_ErrorNone;
+  OMX_U32 i;
+
+  /* Downstream components first, so that they accept buffers when the upstream ones start */
+  for (i = nHandles; i > 0; i--) {
+    err = OMX_SendCommand(handles[i - 1], OMX_CommandStateSet, eState, NULL);
+    if (err != OMX_ErrorNone) {
+      return err;
+    }
+  }
+  for (i = 0; i < nHandles; i++) {
+    tsem_down(&run.eventSem);
+  }
+  return OMX_ErrorNone;
+}
+
+static int compareLatencies(const void* a, const void* b) {
+  OMX_S64 la = *(const OMX_S64*)a;
+  OMX_S64 lb = *(const OMX_S64*)b;
+
+  return (la > lb) - (la < lb);
+}
+
+/** Runs one configuration and prints its CSV line
+ *
+ * @return 0 on success, -1 if the chain cannot be set up
+ */
+static int runChain(void) {
+  OMX_HANDLETYPE handles[MAX_CHAIN_LENGTH + 2];
+  OMX_BUFFERHEADERTYPE** outBuffers = NULL;
+  OMX_BUFFERHEADERTYPE** inBuffers = NULL;
+  hopBufferType* hops = NULL;
+  OMX_COMPONENTTYPE* component;
+  OMX_ERRORTYPE err = OMX_ErrorNone;
+  OMX_U32 nHandles = run.nLength + 2;
+  OMX_U32 nHops = nHandles - 1;
+  OMX_U32 i, j, n;
+  double elapsed;
+
+  run.nSent = 0;
+  run.nReceived = 0;
+  run.bStopping = OMX_FALSE;
+  memset(handles, 0, sizeof(handles));
+
+  for (i = 0; i < nHandles && err == OMX_ErrorNone; i++) {
+    component = calloc(1, sizeof(OMX_COMPONENTTYPE));
+    if (component == NULL) {
+      err = OMX_ErrorInsufficientResources;
+      break;
+    }
+    handles[i] = component;
+    if (i == 0) {
+      err = omx_null_source_Constructor(component, "OMX.st.bench.null_source");
+    } else if (i == nHandles - 1) {
+      err = omx_null_sink_Constructor(component, "OMX.st.bench.null_sink");
+    } else {
+      err = omx_null_filter_Constructor(component, "OMX.st.bench.null_filter");
+    }
+    if (err == OMX_ErrorNone) {
+      err = component->SetCallbacks(component, &callbacks, NULL);
+    }
+  }
+  if (err != OMX_ErrorNone) {
+    fprintf(stderr, "omxchainbench: cannot create the components: %x\n", (int)err);
+    goto out;
+  }
+
+  if (run.bTunneled) {
+    for (i = 0; i < nHops; i++) {
+      err = OMX_SetupTunnel(handles[i], i == 0 ? 0 : 1, handles[i + 1], 0);
+      if (err != OMX_ErrorNone) {
+        fprintf(stderr, "omxchainbench: cannot set up tunnel %d: %x\n", (int)i, (int)err);
+        goto out;
+      }
+    }
+    err = setChainState(handles, nHandles, OMX_StateIdle);
+  } else {
+    n = nHops * run.nBufferCount;
+    outBuffers = calloc(n, sizeof(OMX_BUFFERHEADERTYPE*));
+    inBuffers = calloc(n, sizeof(OMX_BUFFERHEADERTYPE*));
+    hops = calloc(2 * n, sizeof(hopBufferType));
+    if (outBuffers == NULL || inBuffers == NULL || hops == NULL) {
+      err = OMX_ErrorInsufficientResources;
+      goto out;
+    }
+    for (i = nHandles; i > 0; i--) {
+      OMX_SendCommand(handles[i - 1], OMX_CommandStateSet, OMX_StateIdle, NULL);
+    }
+    /* Each input buffer uses the payload of the output buffer feeding it */
+    for (i = 0; i < nHops && err == OMX_ErrorNone; i++) {
+      for (j = 0; j < run.nBufferCount && err == OMX_ErrorNone; j++) {
+        n = i * run.nBufferCount + j;
+        err = OMX_AllocateBuffer(handles[i], &outBuffers[n], i == 0 ? 0 : 1, NULL, run.nBufferSize);
+        if (err == OMX_ErrorNone) {
+          err = OMX_UseBuffer(handles[i + 1], &inBuffers[n], 0, NULL, run.nBufferSize, outBuffers[n]->pBuffer);
+        }
+        if (err == OMX_ErrorNone) {
+          hops[2 * n].hPeer = handles[i + 1];
+          hops[2 * n].pPeer = inBuffers[n];
+          outBuffers[n]->pAppPrivate = &hops[2 * n];
+          hops[2 * n + 1].hPeer = handles[i];
+          hops[2 * n + 1].pPeer = outBuffers[n];
+          inBuffers[n]->pAppPrivate = &hops[2 * n + 1];
+        }
+      }
+    }
+    if (err != OMX_ErrorNone) {
+      fprintf(stderr, "omxchainbench: cannot allocate the buffers: %x\n", (int)err);
+      goto out;
+    }
+    for (i = 0; i < nHandles; i++) {
+      tsem_down(&run.eventSem);
+    }
+  }
+  if (err == OMX_ErrorNone) {
+    err = setChainState(handles, nHandles, OMX_StateExecuting);
+  }
+  if (err != OMX_ErrorNone) {
+    fprintf(stderr, "omxchainbench: cannot start the chain: %x\n", (int)err);
+    goto out;
+  }
+
+  if (!run.bTunneled) {
+    for (n = 0; n < nHops * run.nBufferCount; n++) {
+      OMX_FillThisBuffer(hops[2 * n + 1].hPeer, outBuffers[n]);
+    }
+  }
+  tsem_down(&run.doneSem);
+
+  run.bStopping = OMX_TRUE;
+  setChainState(handles, nHandles, OMX_StateIdle);
+  if (run.bTunneled) {
+    setChainState(handles, nHandles, OMX_StateLoaded);
+  } else {
+    for (i = nHandles; i > 0; i--) {
+      OMX_SendCommand(handles[i - 1], OMX_CommandStateSet, OMX_StateLoaded, NULL);
+    }
+    /* The input buffers first: they do not own their payload */
+    for (i = 0; i < nHops; i++) {
+      for (j = 0; j < run.nBufferCount; j++) {
+        n = i * run.nBufferCount + j;
+        OMX_FreeBuffer(handles[i + 1], 0, inBuffers[n]);
+        OMX_FreeBuffer(handles[i], i == 0 ? 0 : 1, outBuffers[n]);
+      }
+    }
+    for (i = 0; i < nHandles; i++) {
+      tsem_down(&run.eventSem);
+    }
+  }
+
+  qsort(run.pLatencies, run.nBuffers, sizeof(OMX_S64), compareLatencies);
+  elapsed = (run.nEndTime - run.nStartTime) / 1e9;
+  printf("%s,%d,%d,%d,%d,%.0f,%.3f,%.3f\n",
+    run.bTunneled ? "tunnel" : "client",
+    (int)run.nLength, (int)run.nBufferSize, (int)run.nBufferCount, (int)run.nBuffers,
+    elapsed > 0 ? run.nBuffers / elapsed : 0,
+    run.pLatencies[run.nBuffers / 2] / 1e3,
+    run.pLatencies[(run.nBuffers * 99) / 100] / 1e3);
+  fflush(stdout);
+
+out:
+  for (i = 0; i < nHandles; i++) {
+    if (handles[i]) {
+      component = handles[i];
+      if (component->pComponentPrivate) {
+        component->ComponentDeInit(component);
+      }
+      free(component);
+    }
+  }
+  free(outBuffers);
+  free(inBuffers);
+  free(hops);
+  return err == OMX_ErrorNone ? 0 : -1;
+}
+
+/** Parses a comma separated list of positive numbers
+ *
+ * @return the number of values, 0 if the list is not valid
+ */
+static int parseList(const char* list, OMX_U32* values, OMX_U32 nMax, OMX_U32 nLimit) {
+  char* end;
+  unsigned long value;
+  OMX_U32 n = 0;
+
+  while (*list != '\0') {
+    value = strtoul(list, &end, 10);
+    if (end == list || value == 0 || value > nLimit || n == nMax) {
+      return 0;
+    }
+    values[n++] = value;
+    list = end;
+    if (*list == ',') {
+      list++;
+    } else if (*list != '\0') {
+      return 0;
+    }
+  }
+  return n;
+}
+
+void display_help() {
+  printf("\n");
+  printf("Usage: omxchainbench [-n buffers] [-l lengths] [-s sizes] [-c counts] [-m tunnel|client|both]\n");
+  printf("\n");
+  printf("       -n buffers: buffers sent through the chain in each run (default %d)\n", DEFAULT_BUFFERS);
+  printf("       -l lengths: comma separated numbers of null filters, up to %d (default 1,2,4,8,16)\n", MAX_CHAIN_LENGTH);
+  printf("       -s sizes:   comma separated buffer sizes in bytes (default 64,4096,65536)\n");
+  printf("       -c counts:  comma separated nBufferCountActual values (default 2,4,8)\n");
+  printf("       -m mode:    chain the components with tunnels, through the client or both (default both)\n");
+  printf("\n");
+  printf("       Prints one CSV line per configuration: the throughput in buffers per second\n");
+  printf("       and the median and 99th percentile latency from source to sink in microseconds.\n");
+  printf("       The shared executor is used if OMX_BELLAGIO_EXECUTOR is set, as with OMX_Init.\n");
+  printf("\n");
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  OMX_U32 lengths[MAX_SWEEP_VALUES] = { 1, 2, 4, 8, 16 };
+  OMX_U32 sizes[MAX_SWEEP_VALUES] = { 64, 4096, 65536 };
+  OMX_U32 counts[MAX_SWEEP_VALUES] = { 2, 4, 8 };
+  int nLengths = 5, nSizes = 3, nCounts = 3;
+  int tunnelModes = 3; /* bit 0 tunnel, bit 1 client */
+  int mode, l, s, c, opt;
+  unsigned long nBuffers = DEFAULT_BUFFERS;
+
+  while ((opt = getopt(argc, argv, "n:l:s:c:m:h")) != -1) {
+    switch (opt) {
+    case 'n':
+      nBuffers = strtoul(optarg, NULL, 10);
+      if (nBuffers == 0) {
+        display_help();
+      }
+      break;
+    case 'l':
+      nLengths = parseList(optarg, lengths, MAX_SWEEP_VALUES, MAX_CHAIN_LENGTH);
+      if (nLengths == 0) {
+        display_help();
+      }
+      break;
+    case 's':
+      nSizes = parseList(optarg, sizes, MAX_SWEEP_VALUES, 0x10000000);
+      if (nSizes == 0) {
+        display_help();
+      }
+      break;
+    case 'c':
+      nCounts = parseList(optarg, counts, MAX_SWEEP_VALUES, 256);
+      if (nCounts == 0) {
+        display_help();
+      }
+      break;
+    case 'm':
+      if (strcmp(optarg, "tunnel") == 0) {
+        tunnelModes = 1;
+      } else if (strcmp(optarg, "client") == 0) {
+        tunnelModes = 2;
+      } else if (strcmp(optarg, "both") == 0) {
+        tunnelModes = 3;
+      } else {
+        display_help();
+      }
+      break;
+    default:
+      display_help();
+    }
+  }
+  if (optind != argc) {
+    display_help();
+  }
+
+  /* The components are created directly, without the registry: do what OMX_Init would */
+  omx_debug_init();
+  if (omx_executor_init()) {
+    fprintf(stderr, "omxchainbench: the shared executor cannot be started\n");
+  }
+
+  run.nBuffers = nBuffers;
+  run.pLatencies = malloc(nBuffers * sizeof(OMX_S64));
+  if (run.pLatencies == NULL) {
+    fprintf(stderr, "omxchainbench: out of memory\n");
+    return 1;
+  }
+  tsem_init(&run.eventSem, 0);
+  tsem_init(&run.doneSem, 0);
+
+  printf("mode,length,buffer_size,buffer_count,buffers,buffers_per_sec,p50_us,p99_us\n");
+  for (mode = 0; mode < 2; mode++) {
+    if (!(tunnelModes & (1 << mode))) {
+      continue;
+    }
+    run.bTunneled = mode == 0 ? OMX_TRUE : OMX_FALSE;
+    for (l = 0; l < nLengths; l++) {
+      for (s = 0; s < nSizes; s++) {
+        for (c = 0; c < nCounts; c++) {
+          run.nLength = lengths[l];
+          run.nBufferSize = sizes[s];
+          run.nBufferCount = counts[c];
+          if (runChain() != 0) {
+            return 1;
+          }
+        }
+      }
+    }
+  }
+
+  tsem_deinit(&run.eventSem);
+  tsem_deinit(&run.doneSem);
+  free(run.pLatencies);
+  omx_executor_deinit();
+  return 0;
+}
@@ -0,0 +1,109 @@
+/**
+  @file test/benchmarks/omxchainbench.h
+
+  Null components and run parameters of the buffer round trip benchmark.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#ifndef __OMXCHAINBENCH_H__
+#define __OMXCHAINBENCH_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <OMX_Core.h>
+#include <OMX_Component.h>
+#include <OMX_Types.h>
+#include <OMX_Audio.h>
+
+#include <tsemaphore.h>
+#include <omx_base_source.h>
+#include <omx_base_filter.h>
+#include <omx_base_sink.h>
+#include <omx_base_audio_port.h>
+
+/** Longest chain: number of null filters between the null source and the null sink */
+#define MAX_CHAIN_LENGTH 16
+
+/** Default number of buffers sent through the chain in each run */
+#define DEFAULT_BUFFERS 10000
+
+/** Largest number of values in each swept list */
+#define MAX_SWEEP_VALUES 16
+
+/** Buffers exchanged by the client between two non tunneled components.
+ * The input buffer header of the downstream component shares the payload
+ * of the output buffer header of the upstream one
+ */
+typedef struct hopBufferType {
+  OMX_HANDLETYPE hPeer; /**< Component the peer buffer header belongs to */
+  OMX_BUFFERHEADERTYPE* pPeer; /**< Header sharing the payload */
+} hopBufferType;
+
+/** State of a run, shared by the null components and the client */
+typedef struct benchRunType {
+  OMX_BOOL bTunneled;
+  OMX_U32 nLength; /**< Number of null filters */
+  OMX_U32 nBufferSize;
+  OMX_U32 nBufferCount; /**< nBufferCountActual of every port */
+  OMX_U32 nBuffers; /**< Buffers produced by the null source */
+  OMX_U32 nSent; /**< Buffers produced so far, updated by the source */
+  OMX_U32 nReceived; /**< Buffers consumed so far, updated by the sink */
+  OMX_S64 nStartTime; /**< When the first buffer was produced, in ns */
+  OMX_S64 nEndTime; /**< When the last buffer was consumed, in ns */
+  OMX_S64* pLatencies; /**< Source to sink time of each buffer, in ns */
+  OMX_BOOL bStopping; /**< Set before leaving Executing: the client stops relaying buffers */
+  tsem_t eventSem;
+  tsem_t doneSem;
+} benchRunType;
+
+/* Null components */
+OMX_ERRORTYPE omx_null_source_Constructor(OMX_COMPONENTTYPE *openmaxStandComp, OMX_STRING cComponentName);
+OMX_ERRORTYPE omx_null_filter_Constructor(OMX_COMPONENTTYPE *openmaxStandComp, OMX_STRING cComponentName);
+OMX_ERRORTYPE omx_null_sink_Constructor(OMX_COMPONENTTYPE *openmaxStandComp, OMX_STRING cComponentName);
+
+/* Callback prototypes */
+OMX_ERRORTYPE benchEventHandler(
+  OMX_OUT OMX_HANDLETYPE hComponent,
+  OMX_OUT OMX_PTR pAppData,
+  OMX_OUT OMX_EVENTTYPE eEvent,
+  OMX_OUT OMX_U32 Data1,
+  OMX_OUT OMX_U32 Data2,
+  OMX_IN OMX_PTR pEventData);
+
+OMX_ERRORTYPE benchEmptyBufferDone(
+  OMX_OUT OMX_HANDLETYPE hComponent,
+  OMX_OUT OMX_PTR pAppData,
+  OMX_OUT OMX_BUFFERHEADERTYPE* pBuffer);
+
+OMX_ERRORTYPE benchFillBufferDone(
+  OMX_OUT OMX_HANDLETYPE hComponent,
+  OMX_OUT OMX_PTR pAppData,
+  OMX_OUT OMX_BUFFERHEADERTYPE* pBuffer);
+
+#endif
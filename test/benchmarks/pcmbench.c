@@ -0,0 +1,400 @@
+/**
+  @file test/benchmarks/pcmbench.c
+
+  Measures the throughput of the PCM kernels of the audio effect components
+  with each instruction set and sample format, after checking that they all
+  give the results of the C kernels.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "omx_pcm_kernels.h"
+
+#define DEFAULT_ITERATIONS 20000
+
+/** Samples in each buffer: 1024 stereo frames, as the volume component gets */
+#define BUFFER_SAMPLES 2048
+
+/** Largest number of streams mixed */
+#define MIX_INPUTS 16
+
+static const char* levelNames[] = { "c", "sse2", "avx2" };
+static const char* formatNames[] = { "s16", "s24", "s32", "f32" };
+
+static unsigned long iterations = DEFAULT_ITERATIONS;
+static OMX_S16 input[BUFFER_SAMPLES];
+static OMX_S16 output[BUFFER_SAMPLES];
+static OMX_S16 reference[BUFFER_SAMPLES];
+static OMX_S16 mixInput[MIX_INPUTS][BUFFER_SAMPLES];
+static const OMX_S16* mixInputs[MIX_INPUTS];
+static OMX_U32 mixSamples[MIX_INPUTS];
+static OMX_S32 mixWeights[MIX_INPUTS];
+
+/* Samples of the formats wider than 16 bits */
+static OMX_U8 wideInput[MIX_INPUTS][BUFFER_SAMPLES * 4];
+static OMX_U8 wideOutput[BUFFER_SAMPLES * 4];
+static OMX_U8 wideReference[BUFFER_SAMPLES * 4];
+static const void* wideInputs[MIX_INPUTS];
+
+static double seconds(struct timeval* start, struct timeval* end) {
+  return (end->tv_sec - start->tv_sec) + (end->tv_usec - start->tv_usec) / 1e6;
+}
+
+/** The per sample float computation the volume component used to do. The
+ * sample count is read at run time, as the component took it from
+ * nFilledLen, so that the loop is not compiled for a constant length
+ */
+static double run_float(float gain) {
+  volatile int sampleCount = BUFFER_SAMPLES;
+  struct timeval start, end;
+  unsigned long n;
+  int i;
+
+  gettimeofday(&start, NULL);
+  for (n = 0; n < iterations; n++) {
+    for (i = 0; i < sampleCount; i++) {
+      output[i] = (OMX_S16)(input[i] * (gain / 100.0f));
+    }
+    __asm__ __volatile__("" : : "r"(output) : "memory");
+  }
+  gettimeofday(&end, NULL);
+  return iterations * (double)BUFFER_SAMPLES / seconds(&start, &end);
+}
+
+static double run_gain(OMX_S32 nStartGain, OMX_S32 nEndGain) {
+  struct timeval start, end;
+  unsigned long n;
+
+  gettimeofday(&start, NULL);
+  for (n = 0; n < iterations; n++) {
+    omx_pcm_gain_s16(output, input, BUFFER_SAMPLES, 2, nStartGain, nEndGain);
+    __asm__ __volatile__("" : : "r"(output) : "memory");
+  }
+  gettimeofday(&end, NULL);
+  return iterations * (double)BUFFER_SAMPLES / seconds(&start, &end);
+}
+
+/** The per port pass and divide the audio mixer component used to do */
+static double run_mix_divide(OMX_U32 nInputs) {
+  struct timeval start, end;
+  unsigned long n;
+  OMX_U32 p;
+  int i;
+
+  gettimeofday(&start, NULL);
+  for (n = 0; n < iterations; n++) {
+    for (p = 0; p < nInputs; p++) {
+      for (i = 0; i < BUFFER_SAMPLES; i++) {
+        if (p == 0) {
+          output[i] = (OMX_S16)((mixInputs[p][i] * 100) / (OMX_S32)(nInputs * 100));
+        } else {
+          output[i] += (OMX_S16)((mixInputs[p][i] * 100) / (OMX_S32)(nInputs * 100));
+        }
+      }
+    }
+    __asm__ __volatile__("" : : "r"(output) : "memory");
+  }
+  gettimeofday(&end, NULL);
+  return iterations * (double)BUFFER_SAMPLES / seconds(&start, &end);
+}
+
+static double run_mix(OMX_U32 nInputs) {
+  struct timeval start, end;
+  unsigned long n;
+  OMX_U32 p;
+
+  for (p = 0; p < nInputs; p++) {
+    mixSamples[p] = BUFFER_SAMPLES;
+    mixWeights[p] = OMX_PCM_UNITY_GAIN / nInputs;
+  }
+  gettimeofday(&start, NULL);
+  for (n = 0; n < iterations; n++) {
+    omx_pcm_mix_s16(output, mixInputs, mixSamples, mixWeights, nInputs);
+    __asm__ __volatile__("" : : "r"(output) : "memory");
+  }
+  gettimeofday(&end, NULL);
+  return iterations * (double)BUFFER_SAMPLES / seconds(&start, &end);
+}
+
+/** Compares the mix of every SIMD level with the C one, with random weights
+ * adding up to unity at most and streams of different lengths
+ */
+static int check_mix(omx_pcm_simd_t maxLevel) {
+  omx_pcm_simd_t level;
+  OMX_U32 nInputs, p, nRef, nOut, round;
+
+  for (round = 0; round < 200; round++) {
+    nInputs = 1 + round % MIX_INPUTS;
+    for (p = 0; p < nInputs; p++) {
+      mixSamples[p] = round < 100 ? (OMX_U32)(rand() % 100) : BUFFER_SAMPLES - (OMX_U32)(rand() % 3);
+      mixWeights[p] = round % 5 == 0 ? OMX_PCM_UNITY_GAIN / nInputs : rand() % (OMX_PCM_UNITY_GAIN / nInputs + 1);
+    }
+    omx_pcm_simd_select(OMX_PCM_SIMD_NONE);
+    memset(reference, 0, sizeof(reference));
+    nRef = omx_pcm_mix_s16(reference, mixInputs, mixSamples, mixWeights, nInputs);
+    for (level = OMX_PCM_SIMD_SSE2; level <= maxLevel; level++) {
+      omx_pcm_simd_select(level);
+      memset(output, 0, sizeof(output));
+      nOut = omx_pcm_mix_s16(output, mixInputs, mixSamples, mixWeights, nInputs);
+      if (nOut != nRef || memcmp(output, reference, sizeof(output))) {
+        fprintf(stderr, "pcmbench: %s mix of %i streams differs from c\n", levelNames[level], (int)nInputs);
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+static double run_format_gain(omx_pcm_format_t eFormat, OMX_S32 nGain) {
+  struct timeval start, end;
+  unsigned long n;
+
+  gettimeofday(&start, NULL);
+  for (n = 0; n < iterations; n++) {
+    omx_pcm_gain(eFormat, wideOutput, wideInput[0], BUFFER_SAMPLES, 2, nGain, nGain);
+    __asm__ __volatile__("" : : "r"(wideOutput) : "memory");
+  }
+  gettimeofday(&end, NULL);
+  return iterations * (double)BUFFER_SAMPLES / seconds(&start, &end);
+}
+
+static double run_format_mix(omx_pcm_format_t eFormat, OMX_U32 nInputs) {
+  struct timeval start, end;
+  unsigned long n;
+  OMX_U32 p;
+
+  for (p = 0; p < nInputs; p++) {
+    mixSamples[p] = BUFFER_SAMPLES;
+    mixWeights[p] = OMX_PCM_UNITY_GAIN / nInputs;
+  }
+  gettimeofday(&start, NULL);
+  for (n = 0; n < iterations; n++) {
+    omx_pcm_mix(eFormat, wideOutput, wideInputs, mixSamples, mixWeights, nInputs);
+    __asm__ __volatile__("" : : "r"(wideOutput) : "memory");
+  }
+  gettimeofday(&end, NULL);
+  return iterations * (double)BUFFER_SAMPLES / seconds(&start, &end);
+}
+
+/** Fills the wide inputs with random samples of a format, the first two of
+ * each input being the extreme ones
+ */
+static void fill_wide(omx_pcm_format_t eFormat) {
+  OMX_U32 p, i;
+  OMX_S32 value;
+  float sample;
+
+  for (p = 0; p < MIX_INPUTS; p++) {
+    for (i = 0; i < BUFFER_SAMPLES * 4; i++) {
+      wideInput[p][i] = (OMX_U8)rand();
+    }
+    switch (eFormat) {
+    case OMX_PCM_FORMAT_S24:
+      memcpy(wideInput[p], "\x00\x00\x80\xff\xff\x7f", 6);
+      break;
+    case OMX_PCM_FORMAT_S32:
+      value = -2147483647 - 1;
+      memcpy(wideInput[p], &value, 4);
+      value = 2147483647;
+      memcpy(wideInput[p] + 4, &value, 4);
+      break;
+    case OMX_PCM_FORMAT_F32:
+      for (i = 0; i < BUFFER_SAMPLES; i++) {
+        sample = (float)rand() / RAND_MAX * 3.0f - 1.5f;
+        memcpy(wideInput[p] + 4 * i, &sample, 4);
+      }
+      break;
+    default:
+      break;
+    }
+    wideInputs[p] = wideInput[p];
+  }
+}
+
+/** Compares every SIMD level with the C kernels on the formats wider than
+ * 16 bits, as check and check_mix do on 16 bits
+ */
+static int check_formats(omx_pcm_simd_t maxLevel) {
+  static const OMX_S32 gains[] = { 0, 1, 16384, 16385, 32767, OMX_PCM_UNITY_GAIN };
+  omx_pcm_format_t eFormat;
+  omx_pcm_simd_t level;
+  OMX_U32 g, nSamples, nInputs, p, nRef, nOut, round;
+
+  for (eFormat = OMX_PCM_FORMAT_S24; eFormat <= OMX_PCM_FORMAT_F32; eFormat++) {
+    fill_wide(eFormat);
+    for (level = OMX_PCM_SIMD_SSE2; level <= maxLevel; level++) {
+      for (g = 0; g < sizeof(gains) / sizeof(gains[0]); g++) {
+        for (nSamples = 0; nSamples <= 300; nSamples += nSamples < 40 ? 1 : 37) {
+          omx_pcm_simd_select(OMX_PCM_SIMD_NONE);
+          memset(wideReference, 0, sizeof(wideReference));
+          omx_pcm_gain(eFormat, wideReference, wideInput[0], nSamples, 2, gains[g], gains[g]);
+          omx_pcm_simd_select(level);
+          memset(wideOutput, 0, sizeof(wideOutput));
+          omx_pcm_gain(eFormat, wideOutput, wideInput[0], nSamples, 2, gains[g], gains[g]);
+          if (memcmp(wideOutput, wideReference, sizeof(wideOutput))) {
+            fprintf(stderr, "pcmbench: %s %s gain %i differs from c on %i samples\n",
+                    levelNames[level], formatNames[eFormat], (int)gains[g], (int)nSamples);
+            return 1;
+          }
+        }
+      }
+    }
+
+    for (round = 0; round < 200; round++) {
+      nInputs = 1 + round % MIX_INPUTS;
+      for (p = 0; p < nInputs; p++) {
+        mixSamples[p] = round < 100 ? (OMX_U32)(rand() % 300) : BUFFER_SAMPLES - (OMX_U32)(rand() % 3);
+        mixWeights[p] = round % 5 == 0 ? OMX_PCM_UNITY_GAIN / nInputs : rand() % (OMX_PCM_UNITY_GAIN / nInputs + 1);
+      }
+      omx_pcm_simd_select(OMX_PCM_SIMD_NONE);
+      memset(wideReference, 0, sizeof(wideReference));
+      nRef = omx_pcm_mix(eFormat, wideReference, wideInputs, mixSamples, mixWeights, nInputs);
+      for (level = OMX_PCM_SIMD_SSE2; level <= maxLevel; level++) {
+        omx_pcm_simd_select(level);
+        memset(wideOutput, 0, sizeof(wideOutput));
+        nOut = omx_pcm_mix(eFormat, wideOutput, wideInputs, mixSamples, mixWeights, nInputs);
+        if (nOut != nRef || memcmp(wideOutput, wideReference, sizeof(wideOutput))) {
+          fprintf(stderr, "pcmbench: %s %s mix of %i streams differs from c\n",
+                  levelNames[level], formatNames[eFormat], (int)nInputs);
+          return 1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+/** Compares every SIMD level with the C kernels on all the lengths up to a
+ * buffer, extreme samples and gains included
+ */
+static int check(omx_pcm_simd_t maxLevel) {
+  static const OMX_S32 gains[] = { 0, 1, 16384, 16385, 32767, OMX_PCM_UNITY_GAIN };
+  omx_pcm_simd_t level;
+  OMX_U32 g, nSamples;
+
+  for (level = OMX_PCM_SIMD_SSE2; level <= maxLevel; level++) {
+    for (g = 0; g < sizeof(gains) / sizeof(gains[0]); g++) {
+      for (nSamples = 0; nSamples <= 100; nSamples++) {
+        omx_pcm_simd_select(OMX_PCM_SIMD_NONE);
+        memset(reference, 0, sizeof(reference));
+        omx_pcm_gain_s16(reference, input, nSamples, 2, gains[g], gains[g]);
+        omx_pcm_simd_select(level);
+        memset(output, 0, sizeof(output));
+        omx_pcm_gain_s16(output, input, nSamples, 2, gains[g], gains[g]);
+        if (memcmp(output, reference, sizeof(output))) {
+          fprintf(stderr, "pcmbench: %s gain %i differs from c on %i samples\n",
+                  levelNames[level], (int)gains[g], (int)nSamples);
+          return 1;
+        }
+      }
+    }
+  }
+
+  /* In place, and a ramp going one frame step down on the first frame and
+   * ending on the target gain
+   */
+  omx_pcm_simd_select(maxLevel);
+  memcpy(output, input, sizeof(output));
+  omx_pcm_gain_s16(output, output, BUFFER_SAMPLES, 2, OMX_PCM_UNITY_GAIN, 0);
+  if (output[0] != (OMX_S16)((input[0] * (OMX_PCM_UNITY_GAIN - OMX_PCM_UNITY_GAIN / (BUFFER_SAMPLES / 2)) + 16384) >> 15) ||
+      output[BUFFER_SAMPLES - 2] != 0 || output[BUFFER_SAMPLES - 1] != 0) {
+    fprintf(stderr, "pcmbench: wrong ramp\n");
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  omx_pcm_simd_t maxLevel, level;
+  omx_pcm_format_t eFormat;
+  double float_rate, rate;
+  OMX_S32 nGain = omx_pcm_gain_from_percent(50);
+  OMX_U32 p;
+  int i;
+
+  if (argc > 1) {
+    iterations = strtoul(argv[1], NULL, 10);
+    if (iterations == 0) {
+      fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  srand(1);
+  for (i = 0; i < BUFFER_SAMPLES; i++) {
+    input[i] = (OMX_S16)(rand() & 0xffff);
+  }
+  input[0] = -32768;
+  input[1] = 32767;
+  for (p = 0; p < MIX_INPUTS; p++) {
+    for (i = 0; i < BUFFER_SAMPLES; i++) {
+      mixInput[p][i] = (OMX_S16)(rand() & 0xffff);
+    }
+    /* Full scale on all the streams at once, to hit the saturation */
+    mixInput[p][0] = -32768;
+    mixInput[p][1] = 32767;
+    mixInputs[p] = mixInput[p];
+  }
+
+  maxLevel = omx_pcm_simd_level();
+  if (check(maxLevel) || check_mix(maxLevel) || check_formats(maxLevel)) {
+    return 1;
+  }
+
+  float_rate = run_float(50);
+  printf("gain float:         %.1f Msamples/sec\n", float_rate / 1e6);
+  for (level = OMX_PCM_SIMD_NONE; level <= maxLevel; level++) {
+    omx_pcm_simd_select(level);
+    rate = run_gain(nGain, nGain);
+    printf("gain q15 %-4s:      %.1f Msamples/sec (%.2fx)\n", levelNames[level], rate / 1e6, rate / float_rate);
+  }
+  rate = run_gain(OMX_PCM_UNITY_GAIN, nGain);
+  printf("gain q15 ramp:      %.1f Msamples/sec (%.2fx)\n", rate / 1e6, rate / float_rate);
+
+  for (p = 2; p <= MIX_INPUTS; p *= 2) {
+    float_rate = run_mix_divide(p);
+    printf("mix %2i divide:      %.1f Msamples/sec\n", (int)p, float_rate / 1e6);
+    for (level = OMX_PCM_SIMD_NONE; level <= maxLevel; level++) {
+      omx_pcm_simd_select(level);
+      rate = run_mix(p);
+      printf("mix %2i q15 %-4s:    %.1f Msamples/sec (%.2fx)\n", (int)p, levelNames[level], rate / 1e6, rate / float_rate);
+    }
+  }
+
+  for (eFormat = OMX_PCM_FORMAT_S24; eFormat <= OMX_PCM_FORMAT_F32; eFormat++) {
+    fill_wide(eFormat);
+    for (level = OMX_PCM_SIMD_NONE; level <= maxLevel; level++) {
+      omx_pcm_simd_select(level);
+      rate = run_format_gain(eFormat, nGain);
+      printf("gain %s %-4s:      %.1f Msamples/sec\n", formatNames[eFormat], levelNames[level], rate / 1e6);
+      rate = run_format_mix(eFormat, 4);
+      printf("mix  4 %s %-4s:    %.1f Msamples/sec\n", formatNames[eFormat], levelNames[level], rate / 1e6);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+/**
+  @file test/benchmarks/queuebench.c
+
+  Measures the throughput of the queue_t backends when one thread enqueues
+  and another one dequeues, as happens on a tunneled port buffer queue.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/time.h>
+
+#include "queue.h"
+
+#define DEFAULT_ITERATIONS 2000000
+
+static unsigned long iterations = DEFAULT_ITERATIONS;
+
+static void* producer(void* param) {
+  queue_t* q = (queue_t*)param;
+  unsigned long i;
+
+  for (i = 1; i <= iterations; i++) {
+    while (queue(q, (void*)i) != 0) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+static void* consumer(void* param) {
+  queue_t* q = (queue_t*)param;
+  unsigned long i;
+  unsigned long expected = 1;
+  void* data;
+
+  for (i = 0; i < iterations; i++) {
+    while ((data = dequeue(q)) == NULL) {
+      sched_yield();
+    }
+    if ((unsigned long)data != expected) {
+      fprintf(stderr, "queuebench: got %lu, expected %lu\n", (unsigned long)data, expected);
+      exit(1);
+    }
+    expected++;
+  }
+  return NULL;
+}
+
+static double run(QUEUE_TYPE type) {
+  queue_t q;
+  pthread_t prod, cons;
+  struct timeval start, end;
+  double elapsed;
+
+  memset(&q, 0, sizeof(q));
+  queue_init(&q);
+  if (queue_set_type(&q, type) != 0) {
+    queue_deinit(&q);
+    return 0;
+  }
+
+  gettimeofday(&start, NULL);
+  pthread_create(&cons, NULL, consumer, &q);
+  pthread_create(&prod, NULL, producer, &q);
+  pthread_join(prod, NULL);
+  pthread_join(cons, NULL);
+  gettimeofday(&end, NULL);
+
+  queue_deinit(&q);
+  elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+  return iterations / elapsed;
+}
+
+int main(int argc, char** argv) {
+  double mutex_ops, spsc_ops;
+
+  if (argc > 1) {
+    iterations = strtoul(argv[1], NULL, 10);
+    if (iterations == 0) {
+      fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  mutex_ops = run(QUEUE_TYPE_MUTEX);
+  spsc_ops = run(QUEUE_TYPE_SPSC);
+
+  printf("queue mutex: %.0f ops/sec\n", mutex_ops);
+  if (spsc_ops > 0) {
+    printf("queue spsc:  %.0f ops/sec (%.2fx)\n", spsc_ops, spsc_ops / mutex_ops);
+  } else {
+    printf("queue spsc:  not available\n");
+  }
+  return 0;
+}
@@ -0,0 +1,206 @@
+/**
+  @file test/benchmarks/resamplerbench.c
+
+  Measures the throughput of the sample rate converter of the resampler
+  component for each quality tier and instruction set, after checking that
+  the SIMD filters agree with the C ones and measuring the signal to noise
+  ratio of each tier on a sine.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include "omx_pcm_kernels.h"
+#include "omx_pcm_resampler.h"
+
+#define DEFAULT_ITERATIONS 500
+
+#define CHANNELS 2
+
+/** Input frames of each buffer, as the resampler component gets */
+#define BUFFER_FRAMES 1024
+
+/** Input frames of the quality and agreement checks */
+#define SIGNAL_FRAMES 8192
+
+/** Largest difference allowed between the SIMD and the C outputs, which
+ * only differ by the order of the additions
+ */
+#define SIMD_TOLERANCE 1e-5
+
+static const char* levelNames[] = { "c", "sse2", "avx2" };
+static const char* qualityNames[] = { "fast", "medium", "best" };
+
+static const struct {
+  OMX_U32 nInputRate;
+  OMX_U32 nOutputRate;
+} conversions[] = {
+  { 44100, 48000 },
+  { 48000, 44100 },
+  { 8000, 48000 }
+};
+
+static unsigned long iterations = DEFAULT_ITERATIONS;
+static float input[SIGNAL_FRAMES * CHANNELS];
+static float output[SIGNAL_FRAMES * 8 * CHANNELS];
+static float reference[SIGNAL_FRAMES * 8 * CHANNELS];
+
+static double seconds(struct timeval* start, struct timeval* end) {
+  return (end->tv_sec - start->tv_sec) + (end->tv_usec - start->tv_usec) / 1e6;
+}
+
+/** Resamples the whole input by buffers then drains the resampler
+ *
+ * @return the number of frames written
+ */
+static OMX_U32 resample(omx_pcm_resampler_t* pResampler, float* pOutput, OMX_U32 nOutputFrames) {
+  OMX_U32 nDone = 0, nOffset = 0, nFrames;
+
+  omx_pcm_resampler_reset(pResampler);
+  while (nOffset < SIGNAL_FRAMES) {
+    nFrames = SIGNAL_FRAMES - nOffset < BUFFER_FRAMES ? SIGNAL_FRAMES - nOffset : BUFFER_FRAMES;
+    nDone += omx_pcm_resampler_process(pResampler, input + nOffset * CHANNELS, &nFrames,
+                                       pOutput + nDone * CHANNELS, nOutputFrames - nDone);
+    nOffset += nFrames;
+  }
+  return nDone + omx_pcm_resampler_drain(pResampler, pOutput + nDone * CHANNELS, nOutputFrames - nDone);
+}
+
+/** @return the signal to noise ratio in dB of the resampled sine, away
+ * from the edges of the stream
+ */
+static double sine_snr(const float* pOutput, OMX_U32 nFrames, double dFrequency, OMX_U32 nOutputRate) {
+  double dSignal = 0.0, dNoise = 0.0, dIdeal, dError;
+  OMX_U32 i;
+
+  for (i = nFrames / 8; i < nFrames - nFrames / 8; i++) {
+    dIdeal = 0.5 * sin(2.0 * M_PI * dFrequency * i / nOutputRate);
+    dError = pOutput[i * CHANNELS] - dIdeal;
+    dSignal += dIdeal * dIdeal;
+    dNoise += dError * dError;
+  }
+  return 10.0 * log10(dSignal / dNoise);
+}
+
+/** Checks the number of frames written and that every SIMD level agrees
+ * with C, then prints the quality of each tier
+ */
+static int check(omx_pcm_simd_t maxLevel) {
+  omx_pcm_resampler_t* pResampler;
+  omx_pcm_simd_t level;
+  OMX_U32 c, q, nFrames, nExpected, i;
+  double dFrequency = 1000.0;
+
+  for (c = 0; c < sizeof(conversions) / sizeof(conversions[0]); c++) {
+    nExpected = (OMX_U32)(((unsigned long long)SIGNAL_FRAMES * conversions[c].nOutputRate + conversions[c].nInputRate - 1) / conversions[c].nInputRate);
+    for (i = 0; i < SIGNAL_FRAMES; i++) {
+      input[i * CHANNELS] = (float)(0.5 * sin(2.0 * M_PI * dFrequency * i / conversions[c].nInputRate));
+      input[i * CHANNELS + 1] = (float)rand() / RAND_MAX - 0.5f;
+    }
+    for (q = 0; q < OMX_PCM_RESAMPLER_QUALITIES; q++) {
+      omx_pcm_simd_select(OMX_PCM_SIMD_NONE);
+      pResampler = omx_pcm_resampler_create(conversions[c].nInputRate, conversions[c].nOutputRate, CHANNELS, q);
+      nFrames = resample(pResampler, reference, SIGNAL_FRAMES * 8);
+      omx_pcm_resampler_destroy(pResampler);
+      if (nFrames != nExpected) {
+        fprintf(stderr, "resamplerbench: %i Hz to %i Hz %s wrote %i frames instead of %i\n",
+                (int)conversions[c].nInputRate, (int)conversions[c].nOutputRate, qualityNames[q], (int)nFrames, (int)nExpected);
+        return 1;
+      }
+      for (level = OMX_PCM_SIMD_SSE2; level <= maxLevel; level++) {
+        omx_pcm_simd_select(level);
+        pResampler = omx_pcm_resampler_create(conversions[c].nInputRate, conversions[c].nOutputRate, CHANNELS, q);
+        resample(pResampler, output, SIGNAL_FRAMES * 8);
+        omx_pcm_resampler_destroy(pResampler);
+        for (i = 0; i < nFrames * CHANNELS; i++) {
+          if (fabs(output[i] - reference[i]) > SIMD_TOLERANCE) {
+            fprintf(stderr, "resamplerbench: %s %s differs from c at sample %i\n", levelNames[level], qualityNames[q], (int)i);
+            return 1;
+          }
+        }
+      }
+      printf("%5i Hz to %5i Hz %-6s: %.1f dB SNR on a 1 kHz sine\n", (int)conversions[c].nInputRate, (int)conversions[c].nOutputRate,
+             qualityNames[q], sine_snr(reference, nFrames, dFrequency, conversions[c].nOutputRate));
+    }
+  }
+  return 0;
+}
+
+/** @return the input samples, all the channels included, resampled per second */
+static double run(OMX_U32 nInputRate, OMX_U32 nOutputRate, omx_pcm_resampler_quality_t eQuality) {
+  omx_pcm_resampler_t* pResampler = omx_pcm_resampler_create(nInputRate, nOutputRate, CHANNELS, eQuality);
+  struct timeval start, end;
+  unsigned long n;
+  OMX_U32 nFrames;
+
+  gettimeofday(&start, NULL);
+  for (n = 0; n < iterations; n++) {
+    nFrames = BUFFER_FRAMES;
+    omx_pcm_resampler_process(pResampler, input, &nFrames, output, SIGNAL_FRAMES * 8);
+    __asm__ __volatile__("" : : "r"(output) : "memory");
+  }
+  gettimeofday(&end, NULL);
+  omx_pcm_resampler_destroy(pResampler);
+  return iterations * (double)BUFFER_FRAMES * CHANNELS / seconds(&start, &end);
+}
+
+int main(int argc, char** argv) {
+  omx_pcm_simd_t maxLevel, level;
+  OMX_U32 c, q;
+  double c_rate, rate;
+
+  if (argc > 1) {
+    iterations = strtoul(argv[1], NULL, 10);
+    if (iterations == 0) {
+      fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  srand(1);
+  maxLevel = omx_pcm_simd_level();
+  if (check(maxLevel)) {
+    return 1;
+  }
+
+  for (c = 0; c < 2; c++) {
+    for (q = 0; q < OMX_PCM_RESAMPLER_QUALITIES; q++) {
+      c_rate = 0.0;
+      for (level = OMX_PCM_SIMD_NONE; level <= maxLevel; level++) {
+        omx_pcm_simd_select(level);
+        rate = run(conversions[c].nInputRate, conversions[c].nOutputRate, q);
+        if (level == OMX_PCM_SIMD_NONE) {
+          c_rate = rate;
+        }
+        printf("%5i Hz to %5i Hz %-6s %-4s: %.1f Msamples/sec (%.2fx)\n", (int)conversions[c].nInputRate, (int)conversions[c].nOutputRate,
+               qualityNames[q], levelNames[level], rate / 1e6, rate / c_rate);
+      }
+    }
+  }
+  return 0;
+}
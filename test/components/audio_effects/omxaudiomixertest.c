@@ -29,6 +29,7 @@
 */
 
 #include "omxaudiomixertest.h"
+#include "omx_pcm_kernels.h"
 #include "ctype.h"
 
 #define SINK_NAME "OMX.st.alsa.alsasink"
@@ -58,14 +59,16 @@ static void setHeader(OMX_PTR header, OMX_U32 size) {
 
 void display_help() {
   printf("\n");
-  printf("Usage: omxaudiomixertest [-o outfile] [-gi gain] -t -r 44100 -n 2 filename1 filename2\n");
+  printf("Usage: omxaudiomixertest [-o outfile] [-gi gain] [-p ports] [-f format] -t -r 44100 -n 2 filename1 filename2\n");
   printf("\n");
   printf("       -o outfile: If this option is specified, the output stream is written to outfile\n");
   printf("                   otherwise redirected to std output; Can't be used with -t\n");
   printf("       -gi       : Gain of stream i[0..3] data [0...100]\n");
   printf("       -t        : The audio mixer is tunneled with the alsa sink; Can't be used with -o\n");
   printf("       -r 44100  : Sample Rate [Default 44100]\n");
-  printf("       -n 2      : Number of channel [Default 2]\n\n");
+  printf("       -n 2      : Number of channel [Default 2]\n");
+  printf("       -p ports  : Number of input ports of the mixer [2..64], the unused ones are disabled [Default 4]\n");
+  printf("       -f format : Sample format of the streams, s16, s24, s32 or f32 [Default s16]\n\n");
   printf("       -h        : Displays this help\n");
   printf("\n");
   exit(1);
@@ -83,6 +86,8 @@ int flagPlaybackOn;
 int flagSetupTunnel;
 int flagSampleRate;
 int flagChannel;
+int flagInputPorts;
+int flagPcmFormat;
 char *input_file[2], *output_file;
 static OMX_BOOL bEOS1=OMX_FALSE,bEOS2=OMX_FALSE;
 FILE *outfile;
@@ -90,6 +95,9 @@ FILE *outfile;
 OMX_BUFFERHEADERTYPE *inBuffer[4], *outBuffer[2],*inBufferSink[2];
 static OMX_BOOL isPortDisabled[4];
 static int iBufferDropped[2];
+/* The output port follows the input ports */
+static OMX_U32 nInputPorts = 4;
+static char* pcmFormat = NULL;
 
 int main(int argc, char** argv) {
 
@@ -98,6 +106,8 @@ int main(int argc, char** argv) {
   OMX_PARAM_PORTDEFINITIONTYPE sPortDef;
   OMX_AUDIO_CONFIG_VOLUMETYPE sVolume;
   OMX_AUDIO_PARAM_PCMMODETYPE sPcmModeType;
+  OMX_PARAM_U32TYPE sInputPorts;
+  OMX_INDEXTYPE eIndexInputPorts;
   int gain[4];
   int argn_dec;
   int i=0,fd2;
@@ -122,6 +132,8 @@ int main(int argc, char** argv) {
     flagSetupTunnel = 0;
     flagSampleRate = 0;
     flagChannel = 0;
+    flagInputPorts = 0;
+    flagPcmFormat = 0;
 
     argn_dec = 1;
     while (argn_dec<argc) {
@@ -154,6 +166,12 @@ int main(int argc, char** argv) {
         case 'n':
           flagChannel = 1;
           break;
+        case 'p':
+          flagInputPorts = 1;
+          break;
+        case 'f':
+          flagPcmFormat = 1;
+          break;
         default:
           display_help();
         }
@@ -178,6 +196,15 @@ int main(int argc, char** argv) {
         } else if (flagChannel) {
           nchannel = (int)atoi(argv[argn_dec]);
           flagChannel = 0;
+        } else if (flagInputPorts) {
+          nInputPorts = (int)atoi(argv[argn_dec]);
+          flagInputPorts = 0;
+          if(nInputPorts < 2 || nInputPorts > 64) {
+            display_help();
+          }
+        } else if (flagPcmFormat) {
+          pcmFormat = argv[argn_dec];
+          flagPcmFormat = 0;
         } else {
           input_file[i] = malloc(strlen(argv[argn_dec]) * sizeof(char) + 1);
           strcpy(input_file[i],argv[argn_dec]);
@@ -258,6 +285,44 @@ int main(int argc, char** argv) {
     DEBUG(DEB_LEV_ERR, "Audio Mixer OMX_GetHandle failed\n");
     exit(1);
   }
+  if (nInputPorts != 4) {
+    err = OMX_GetExtensionIndex(appPriv->handle, "OMX.st.index.param.audiomixer.inputs", &eIndexInputPorts);
+    if(err != OMX_ErrorNone) {
+      DEBUG(DEB_LEV_ERR,"The number of input ports cannot be set\n");
+      exit(1);
+    }
+    setHeader(&sInputPorts, sizeof(OMX_PARAM_U32TYPE));
+    sInputPorts.nU32 = nInputPorts;
+    err = OMX_SetParameter(appPriv->handle, eIndexInputPorts, &sInputPorts);
+    if(err != OMX_ErrorNone) {
+      DEBUG(DEB_LEV_ERR,"Error %08x setting %i input ports\n", err, (int)nInputPorts);
+      exit(1);
+    }
+  }
+  if (pcmFormat) {
+    setHeader(&sPcmModeType, sizeof(OMX_AUDIO_PARAM_PCMMODETYPE));
+    sPcmModeType.nPortIndex = 0;
+    err = OMX_GetParameter(appPriv->handle, OMX_IndexParamAudioPcm, &sPcmModeType);
+    sPcmModeType.eNumData = OMX_NumericalDataSigned;
+    if (!strcmp(pcmFormat, "s24")) {
+      sPcmModeType.nBitPerSample = 24;
+    } else if (!strcmp(pcmFormat, "s32")) {
+      sPcmModeType.nBitPerSample = 32;
+    } else if (!strcmp(pcmFormat, "f32")) {
+      sPcmModeType.eNumData = OMX_NumericalDataVendorFloat;
+      sPcmModeType.nBitPerSample = 32;
+    } else {
+      sPcmModeType.nBitPerSample = 16;
+    }
+    if (nchannel) {
+      sPcmModeType.nChannels = nchannel;
+    }
+    err = OMX_SetParameter(appPriv->handle, OMX_IndexParamAudioPcm, &sPcmModeType);
+    if(err != OMX_ErrorNone) {
+      DEBUG(DEB_LEV_ERR,"Error %08x setting the %s sample format\n", err, pcmFormat);
+      exit(1);
+    }
+  }
   if (flagPlaybackOn) {
     err = OMX_GetHandle(&appPriv->audiosinkhandle, SINK_NAME, NULL , &audiosinkcallbacks);
     if(err != OMX_ErrorNone){
@@ -300,7 +365,7 @@ int main(int argc, char** argv) {
   }
 
   if (flagSetupTunnel) {
-    err = OMX_SetupTunnel(appPriv->handle, 4, appPriv->audiosinkhandle, 0);
+    err = OMX_SetupTunnel(appPriv->handle, nInputPorts, appPriv->audiosinkhandle, 0);
     if(err != OMX_ErrorNone) {
       DEBUG(DEB_LEV_ERR, "Set up Tunnel Failed\n");
       exit(1);
@@ -337,13 +402,16 @@ int main(int argc, char** argv) {
     exit(1);
   }
 
-  /*Disable 2 out of 4 ports*/
-  isPortDisabled[2] = OMX_TRUE;
-  isPortDisabled[3] = OMX_TRUE;
-  err = OMX_SendCommand(appPriv->handle, OMX_CommandPortDisable, 2, NULL);
-  err = OMX_SendCommand(appPriv->handle, OMX_CommandPortDisable, 3, NULL);
-  tsem_down(appPriv->eventSem);
-  tsem_down(appPriv->eventSem);
+  /*Disable all the input ports but 2*/
+  for(j=2;j<nInputPorts;j++) {
+    if(j < 4) {
+      isPortDisabled[j] = OMX_TRUE;
+    }
+    err = OMX_SendCommand(appPriv->handle, OMX_CommandPortDisable, j, NULL);
+  }
+  for(j=2;j<nInputPorts;j++) {
+    tsem_down(appPriv->eventSem);
+  }
 
 
   err = OMX_SendCommand(appPriv->handle, OMX_CommandStateSet, OMX_StateIdle, NULL);
@@ -368,7 +436,7 @@ int main(int argc, char** argv) {
 
   if (!flagSetupTunnel) {
     for(j=0;j<BUFFER_COUNT_ACTUAL;j++) {
-      err = OMX_AllocateBuffer(appPriv->handle, &outBuffer[j], 4, NULL, BUFFER_IN_SIZE);
+      err = OMX_AllocateBuffer(appPriv->handle, &outBuffer[j], nInputPorts, NULL, BUFFER_IN_SIZE);
       if (err != OMX_ErrorNone) {
         DEBUG(DEB_LEV_ERR, "Error on AllocateBuffer out %i %i\n",(int)j, err);
         exit(1);
@@ -563,7 +631,7 @@ int main(int argc, char** argv) {
 
   if (!flagSetupTunnel) {
     for(j=0;j<BUFFER_COUNT_ACTUAL;j++) {
-      err = OMX_FreeBuffer(appPriv->handle, 4, outBuffer[j]);
+      err = OMX_FreeBuffer(appPriv->handle, nInputPorts, outBuffer[j]);
     }
   }
 
@@ -0,0 +1,314 @@
+/**
+  @file test/components/jpeg/jpegsimdtest.c
+
+  Checks that the SIMD routines of the libjpeg used by the jpeg components
+  compute exactly what the C routines compute.
+
+  The islow DCTs are compared block by block on random, extreme and
+  out of range data; the color conversions and the fancy upsampling are
+  compared by compressing and decompressing odd sized images with the
+  SIMD routines and with JPEGSIMD=0.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JPEG_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jdct.h"
+#include "jsimd.h"
+
+#define IDCT_BLOCKS 200000
+#define FDCT_BLOCKS 100000
+
+static int errors = 0;
+
+/** Random number in [lo, hi] */
+static int rnd(int lo, int hi) {
+  return lo + (int)((double)rand() / ((double)RAND_MAX + 1.0) * (hi - lo + 1));
+}
+
+/** Post-IDCT range limit table, filled as in jdmaster.c */
+static JSAMPLE range_table[5 * (MAXJSAMPLE+1) + CENTERJSAMPLE];
+
+static void prepare_range_limit_table(j_decompress_ptr cinfo) {
+  JSAMPLE* table = range_table + (MAXJSAMPLE+1);
+  int i;
+
+  cinfo->sample_range_limit = table;
+  memset(table - (MAXJSAMPLE+1), 0, MAXJSAMPLE+1);
+  for (i = 0; i <= MAXJSAMPLE; i++) {
+    table[i] = (JSAMPLE) i;
+  }
+  table += CENTERJSAMPLE;
+  for (i = CENTERJSAMPLE; i < 2*(MAXJSAMPLE+1); i++) {
+    table[i] = MAXJSAMPLE;
+  }
+  memset(table + 2*(MAXJSAMPLE+1), 0, 2*(MAXJSAMPLE+1) - CENTERJSAMPLE);
+  memcpy(table + 4*(MAXJSAMPLE+1) - CENTERJSAMPLE, cinfo->sample_range_limit, CENTERJSAMPLE);
+}
+
+/** Fills a block of coefficients and its quantization table for one of the test cases */
+static void fill_idct_block(int n, JCOEF* coef, ISLOW_MULT_TYPE* quant) {
+  int i, amp;
+
+  memset(coef, 0, DCTSIZE2 * sizeof(JCOEF));
+  for (i = 0; i < DCTSIZE2; i++) {
+    quant[i] = rnd(1, n % 7 == 0 ? 255 : 16);
+  }
+  switch (n % 6) {
+  case 0: /* Only the DC */
+    coef[0] = rnd(-2048, 2047);
+    break;
+  case 1: /* A few low frequencies, as in most real images */
+    for (i = 0; i < 6; i++) {
+      coef[rnd(0, 20)] = rnd(-64, 64);
+    }
+    break;
+  case 2: /* Some zero AC columns and rows */
+    for (i = 0; i < DCTSIZE2; i++) {
+      if ((i & 7) < 2 || i < 8) {
+        coef[i] = rnd(-300, 300);
+      }
+    }
+    break;
+  case 3: /* Extreme values of the same sign pattern as the basis functions */
+    amp = rnd(0, 1) ? 12000 : 32767;
+    for (i = 0; i < DCTSIZE2; i++) {
+      quant[i] = 1;
+      coef[i] = (JCOEF) ((((i >> 3) + (i & 7) + (n >> 3)) & 1) ? -amp : amp);
+    }
+    break;
+  default: /* Anything */
+    amp = rnd(0, 1) ? 1023 : 32767;
+    for (i = 0; i < DCTSIZE2; i++) {
+      coef[i] = rnd(-amp - 1, amp);
+    }
+    break;
+  }
+}
+
+static void test_idct(void) {
+  struct jpeg_decompress_struct cinfo;
+  jpeg_component_info comp;
+  ISLOW_MULT_TYPE quant[DCTSIZE2];
+  JCOEF coef[DCTSIZE2];
+  JSAMPLE c_rows[DCTSIZE][DCTSIZE + 5], simd_rows[DCTSIZE][DCTSIZE + 5];
+  JSAMPROW c_buf[DCTSIZE], simd_buf[DCTSIZE];
+  int n, row;
+
+  memset(&cinfo, 0, sizeof(cinfo));
+  memset(&comp, 0, sizeof(comp));
+  prepare_range_limit_table(&cinfo);
+  comp.dct_table = quant;
+  for (row = 0; row < DCTSIZE; row++) {
+    c_buf[row] = c_rows[row];
+    simd_buf[row] = simd_rows[row];
+  }
+
+  for (n = 0; n < IDCT_BLOCKS; n++) {
+    fill_idct_block(n, coef, quant);
+    memset(c_rows, 0, sizeof(c_rows));
+    memset(simd_rows, 0, sizeof(simd_rows));
+    jpeg_idct_islow(&cinfo, &comp, coef, c_buf, 5);
+    jsimd_idct_islow(&cinfo, &comp, coef, simd_buf, 5);
+    if (memcmp(c_rows, simd_rows, sizeof(c_rows))) {
+      printf("IDCT mismatch on block %i\n", n);
+      errors++;
+      return;
+    }
+  }
+  printf("IDCT: %i blocks compared\n", IDCT_BLOCKS);
+}
+
+static void test_fdct(void) {
+  JSAMPLE rows[DCTSIZE][DCTSIZE + 3];
+  JSAMPROW buf[DCTSIZE];
+  DCTELEM c_data[DCTSIZE2], simd_data[DCTSIZE2];
+  int n, row, col;
+
+  for (row = 0; row < DCTSIZE; row++) {
+    buf[row] = rows[row];
+  }
+  for (n = 0; n < FDCT_BLOCKS; n++) {
+    for (row = 0; row < DCTSIZE; row++) {
+      for (col = 0; col < DCTSIZE + 3; col++) {
+        switch (n % 4) {
+        case 0:
+          rows[row][col] = rnd(0, MAXJSAMPLE);
+          break;
+        case 1: /* Checkerboards give the largest coefficients */
+          rows[row][col] = ((row + col + n / 4) & 1) ? MAXJSAMPLE : 0;
+          break;
+        case 2:
+          rows[row][col] = (n / 4) & 1 ? MAXJSAMPLE : 0;
+          break;
+        default:
+          rows[row][col] = rnd(100, 140);
+          break;
+        }
+      }
+    }
+    jpeg_fdct_islow(c_data, buf, 3);
+    jsimd_fdct_islow(simd_data, buf, 3);
+    if (memcmp(c_data, simd_data, sizeof(c_data))) {
+      printf("FDCT mismatch on block %i\n", n);
+      errors++;
+      return;
+    }
+  }
+  printf("FDCT: %i blocks compared\n", FDCT_BLOCKS);
+}
+
+/** Compresses an RGB image into a file with the given sampling of the luma,
+ * decompresses it and returns the decompressed pixels
+ */
+static JSAMPLE* round_trip(JSAMPLE* image, int width, int height, int h_samp, int v_samp, FILE* file) {
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_decompress_struct dinfo;
+  struct jpeg_error_mgr jerr;
+  JSAMPLE* output;
+  JSAMPROW row;
+
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  rewind(file);
+  jpeg_stdio_dest(&cinfo, file);
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, 95, TRUE);
+  cinfo.comp_info[0].h_samp_factor = h_samp;
+  cinfo.comp_info[0].v_samp_factor = v_samp;
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    row = image + cinfo.next_scanline * width * 3;
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  fflush(file);
+
+  dinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_decompress(&dinfo);
+  rewind(file);
+  jpeg_stdio_src(&dinfo, file);
+  jpeg_read_header(&dinfo, TRUE);
+  jpeg_start_decompress(&dinfo);
+  output = malloc(width * height * 3);
+  while (dinfo.output_scanline < dinfo.output_height) {
+    row = output + dinfo.output_scanline * width * 3;
+    jpeg_read_scanlines(&dinfo, &row, 1);
+  }
+  jpeg_finish_decompress(&dinfo);
+  jpeg_destroy_decompress(&dinfo);
+  return output;
+}
+
+/** Reads back the compressed data written by round_trip() */
+static long read_file(FILE* file, unsigned char* data, long size) {
+  rewind(file);
+  return fread(data, 1, size, file);
+}
+
+static void test_image(int width, int height, int h_samp, int v_samp) {
+  JSAMPLE *image, *c_out, *simd_out;
+  unsigned char *c_data, *simd_data;
+  long c_size, simd_size, size = width * height * 3 + 4096;
+  FILE *c_file, *simd_file;
+  int i, x, y;
+
+  image = malloc(width * height * 3);
+  c_data = malloc(size);
+  simd_data = malloc(size);
+  for (y = 0; y < height; y++) {
+    for (x = 0; x < width; x++) {
+      i = (y * width + x) * 3;
+      /* Smooth gradients with noise and a saturated band, to hit the clamping */
+      image[i] = (x * 255 / width + rnd(0, 20)) & 0xff;
+      image[i + 1] = y < height / 3 ? 255 : (y * 255 / height);
+      image[i + 2] = (x + y) & 8 ? 0 : rnd(0, 255);
+    }
+  }
+
+  c_file = tmpfile();
+  simd_file = tmpfile();
+  if (!c_file || !simd_file) {
+    printf("Cannot create the temporary files\n");
+    errors++;
+    return;
+  }
+  setenv("JPEGSIMD", "0", 1);
+  c_out = round_trip(image, width, height, h_samp, v_samp, c_file);
+  unsetenv("JPEGSIMD");
+  simd_out = round_trip(image, width, height, h_samp, v_samp, simd_file);
+
+  c_size = read_file(c_file, c_data, size);
+  simd_size = read_file(simd_file, simd_data, size);
+  if (c_size != simd_size || memcmp(c_data, simd_data, c_size)) {
+    printf("Compressed data mismatch on %ix%i image, sampling %ix%i\n", width, height, h_samp, v_samp);
+    errors++;
+  } else if (memcmp(c_out, simd_out, width * height * 3)) {
+    printf("Decompressed image mismatch on %ix%i image, sampling %ix%i\n", width, height, h_samp, v_samp);
+    errors++;
+  } else {
+    printf("Image %ix%i, sampling %ix%i: %li bytes identical\n", width, height, h_samp, v_samp, c_size);
+  }
+
+  fclose(c_file);
+  fclose(simd_file);
+  free(c_out);
+  free(simd_out);
+  free(c_data);
+  free(simd_data);
+  free(image);
+}
+
+int main(int argc, char** argv) {
+  if (!jsimd_can_idct_islow() || !jsimd_can_fdct_islow()) {
+    printf("No SIMD routines on this machine, nothing to test\n");
+    return 0;
+  }
+  srand(1);
+
+  test_idct();
+  test_fdct();
+  test_image(37, 21, 2, 2);
+  test_image(37, 21, 2, 1);
+  test_image(1, 1, 2, 2);
+  test_image(640, 17, 2, 2);
+  test_image(333, 9, 1, 1);
+
+  if (errors) {
+    printf("%i tests failed\n", errors);
+    return 1;
+  }
+  printf("All tests passed\n");
+  return 0;
+}
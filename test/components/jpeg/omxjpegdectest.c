@@ -51,9 +51,10 @@
 
 void display_help() {
   printf("\n");
-  printf("Usage: omxjpegdectest [-o output_file] [-i] infile\n");
+  printf("Usage: omxjpegdectest [-o output_file] [-t threads] [-i] infile\n");
   printf("\n");
   printf("       -o output_file: If this option is specified, the decoded frame is written to output_file\n");
+  printf("       -t threads: Decodes on that many threads instead of the buffer management thread\n");
   printf("       -i infile: Input Jpeg File Name\n");
   printf("       -h: Displays this help\n");
   printf("\n");
@@ -67,6 +68,7 @@ OMX_U32 filesize,size=BUFFER_SIZE;
 OMX_S32 nextBuffer = 0;
 
 int flagIsOutputExpected;
+int flagIsThreadsExpected;
 int flagIsInputExpected;
 int flagOutputReceived;
 int flagInputReceived;
@@ -75,9 +77,14 @@ OMX_S32 fd;
 FILE *infile ,*outfile;
 char *input_file;
 static OMX_BOOL bEOS=OMX_FALSE;
+/* Keeps the file order between the buffers sent by main and the ones sent again by the callback */
+static pthread_mutex_t readMutex = PTHREAD_MUTEX_INITIALIZER;
 
 int main(int argc, char** argv){
   OMX_S32 argn_dec;
+  OMX_U32 nThreads = 0;
+  OMX_INDEXTYPE eIndexThreads;
+  OMX_PARAM_U32TYPE sThreads;
   int data_read;
   OMX_STRING compName="OMX.st.image_decoder.jpeg";
   OMX_ERRORTYPE err;
@@ -100,6 +107,7 @@ int main(int argc, char** argv){
     display_help();
   } else {
     flagIsOutputExpected = 0;
+    flagIsThreadsExpected = 0;
     flagIsInputExpected = 0;
     flagOutputReceived = 0;
     flagInputReceived = 0;
@@ -117,6 +125,9 @@ int main(int argc, char** argv){
         case 'o':
           flagIsOutputExpected = 1;
           break;
+        case 't':
+          flagIsThreadsExpected = 1;
+          break;
         case 'i':
           flagIsInputExpected = 1;
           break;
@@ -129,6 +140,9 @@ int main(int argc, char** argv){
           strcpy(appPriv->output_file,argv[argn_dec]);
           flagIsOutputExpected = 0;
           flagOutputReceived = 1;
+        } else if (flagIsThreadsExpected) {
+          nThreads = atoi(argv[argn_dec]);
+          flagIsThreadsExpected = 0;
         } else if(flagIsInputExpected) {
           input_file = malloc(strlen(argv[argn_dec]) + 1);
           strcpy(input_file,argv[argn_dec]);
@@ -169,6 +183,18 @@ int main(int argc, char** argv){
     DEBUG(DEB_LEV_ERR,"No %s template found\n",compName);
     exit(1);
     }
+
+  if (nThreads > 0) {
+    err = OMX_GetExtensionIndex(appPriv->handle, "OMX.st.index.param.jpegdec.threads", &eIndexThreads);
+    if(err != OMX_ErrorNone) {
+      DEBUG(DEB_LEV_ERR,"The decoding threads are not supported\n");
+      exit(1);
+    }
+    setHeader(&sThreads, sizeof(OMX_PARAM_U32TYPE));
+    sThreads.nPortIndex = 0;
+    sThreads.nU32 = nThreads;
+    err = OMX_SetParameter(appPriv->handle, eIndexThreads, &sThreads);
+  }
   /* Get component information. Name, version, etc
    * Think there is a bug in the prototype here. Shouldnt be
    * a OMX_STRING, not a OMX_STRING* ?
@@ -216,12 +242,14 @@ int main(int argc, char** argv){
 
   /* Get input file handle */
 
+  pthread_mutex_lock(&readMutex);
   data_read = read(fd, appPriv->pInBuffer[0]->pBuffer, size);
-  appPriv->pInBuffer[0]->nFilledLen = size;
+  appPriv->pInBuffer[0]->nFilledLen = data_read;
   data_read = read(fd, appPriv->pInBuffer[1]->pBuffer, size);
-  appPriv->pInBuffer[1]->nFilledLen = size;
+  appPriv->pInBuffer[1]->nFilledLen = data_read;
   err = OMX_EmptyThisBuffer(appPriv->handle, appPriv->pInBuffer[0]);
   err = OMX_EmptyThisBuffer(appPriv->handle, appPriv->pInBuffer[1]);
+  pthread_mutex_unlock(&readMutex);
 
 
   tsem_down(&appPriv->eosSem);
@@ -316,6 +344,7 @@ OMX_ERRORTYPE jpegDecEmptyBufferDone(
   static int iBufferDropped=0;
   DEBUG(DEB_LEV_FULL_SEQ, "Hi there, I am in the %s callback.\n", __func__);
 
+  pthread_mutex_lock(&readMutex);
   data_read = read(fd, pBuffer->pBuffer, size);
   pBuffer->nFilledLen = data_read;
   pBuffer->nOffset = 0;
@@ -323,12 +352,14 @@ OMX_ERRORTYPE jpegDecEmptyBufferDone(
     DEBUG(DEB_LEV_SIMPLE_SEQ, "In the %s no more input data available\n", __func__);
     iBufferDropped++;
     if(iBufferDropped>=2) {
+      pthread_mutex_unlock(&readMutex);
       return OMX_ErrorNone;
     }
     pBuffer->nFilledLen=0;
     pBuffer->nFlags = OMX_BUFFERFLAG_EOS;
     bEOS=OMX_TRUE;
     err = OMX_EmptyThisBuffer(hComponent, pBuffer);
+    pthread_mutex_unlock(&readMutex);
     return OMX_ErrorNone;
   }
   pBuffer->nFilledLen = data_read;
@@ -338,6 +369,7 @@ OMX_ERRORTYPE jpegDecEmptyBufferDone(
   } else {
     DEBUG(DEB_LEV_FULL_SEQ, "In %s Dropping Empty This buffer to Audio Dec\n", __func__);
   }
+  pthread_mutex_unlock(&readMutex);
   return OMX_ErrorNone;
 }
 
@@ -165,6 +165,8 @@ int setPortParameters() {
     err = OMX_GetParameter(appPriv->colorconv_handle, OMX_IndexParamPortDefinition, &omx_colorconvPortDefinition);  
     omx_colorconvPortDefinition.format.video.nFrameWidth = new_out_width;
     omx_colorconvPortDefinition.format.video.nFrameHeight = new_out_height;
+    /** the decoder may pad the pictures with rows, it sends them as its slice height tells */
+    omx_colorconvPortDefinition.format.video.nSliceHeight = paramPort.format.video.nSliceHeight;
     err = OMX_SetParameter(appPriv->colorconv_handle, OMX_IndexParamPortDefinition, &omx_colorconvPortDefinition);
     if(err!=OMX_ErrorNone) {
       DEBUG(DEB_LEV_ERR, "In %s Setting Input Port Definition Error=%x\n",__func__,err); 
@@ -0,0 +1,208 @@
+/**
+  @file test/tools/omxtrace2json.c
+
+  Converts the buffer trace written by a library configured with
+  --enable-trace into the JSON trace event format, which can be loaded
+  in chrome://tracing or Perfetto.
+
+  Each component callback is shown as a slice on the thread that ran it,
+  the other trace points as instant events. The records of a buffer header
+  are joined by a flow, so the path of a buffer through the tunnels can be
+  followed hop by hop.
+
+  Copyright (C) 2007-2008 STMicroelectronics
+  Copyright (C) 2007-2008 Nokia Corporation and/or its subsidiary(-ies).
+
+  This library is free software; you can redistribute it and/or modify it under
+  the terms of the GNU Lesser General Public License as published by the Free
+  Software Foundation; either version 2.1 of the License, or (at your option)
+  any later version.
+
+  This library is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+  FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+  details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this library; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin St, Fifth Floor, Boston, MA
+  02110-1301  USA
+
+  $Date$
+  Revision $Rev$
+  Author $Author$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "omx_trace.h"
+
+static const char* eventNames[OMX_TRACE_EVENT_MAX] = {
+  "EmptyThisBuffer",
+  "FillThisBuffer",
+  "Dequeue",
+  "Callback",
+  "Callback",
+  "ReturnBuffer"
+};
+
+/** Buffers already seen, to start a flow at the first record of each */
+typedef struct seen_buffers_t {
+  uint64_t* buffers;
+  size_t count;
+  size_t size;
+} seen_buffers_t;
+
+static int compare_records(const void* a, const void* b) {
+  const omx_trace_record_t* ra = a;
+  const omx_trace_record_t* rb = b;
+
+  if (ra->nTimestamp != rb->nTimestamp) {
+    return ra->nTimestamp < rb->nTimestamp ? -1 : 1;
+  }
+  return 0;
+}
+
+/** Returns 1 if the buffer was already seen, otherwise adds it and returns 0 */
+static int buffer_seen(seen_buffers_t* seen, uint64_t nBuffer) {
+  size_t i;
+
+  for (i = 0; i < seen->count; i++) {
+    if (seen->buffers[i] == nBuffer) {
+      return 1;
+    }
+  }
+  if (seen->count == seen->size) {
+    seen->size = seen->size ? seen->size * 2 : 64;
+    seen->buffers = realloc(seen->buffers, seen->size * sizeof(uint64_t));
+    if (seen->buffers == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      exit(1);
+    }
+  }
+  seen->buffers[seen->count++] = nBuffer;
+  return 0;
+}
+
+/** Prints the component name as a JSON string */
+static void print_name(FILE* out, const char* name) {
+  int i;
+
+  fputc('"', out);
+  for (i = 0; i < OMX_TRACE_NAME_LEN && name[i] != '\0'; i++) {
+    if (name[i] == '"' || name[i] == '\\') {
+      fputc('\\', out);
+    }
+    if ((unsigned char)name[i] >= 0x20) {
+      fputc(name[i], out);
+    }
+  }
+  fputc('"', out);
+}
+
+int main(int argc, char** argv) {
+  omx_trace_file_header_t header;
+  omx_trace_record_t* records;
+  omx_trace_record_t* r;
+  seen_buffers_t seen;
+  FILE* in;
+  FILE* out = stdout;
+  uint64_t nStart, i;
+  const char* phase;
+  double ts;
+
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "Usage: %s trace_file [output.json]\n", argv[0]);
+    return 1;
+  }
+  in = fopen(argv[1], "rb");
+  if (in == NULL) {
+    fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+  if (fread(&header, sizeof(header), 1, in) != 1 ||
+      header.nMagic != OMX_TRACE_MAGIC ||
+      header.nVersion != OMX_TRACE_VERSION ||
+      header.nRecordSize != sizeof(omx_trace_record_t)) {
+    fprintf(stderr, "%s is not a trace file of this version\n", argv[1]);
+    fclose(in);
+    return 1;
+  }
+
+  records = malloc(header.nRecords ? header.nRecords * sizeof(omx_trace_record_t) : 1);
+  if (records == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    fclose(in);
+    return 1;
+  }
+  if (fread(records, sizeof(omx_trace_record_t), header.nRecords, in) != header.nRecords) {
+    fprintf(stderr, "%s is truncated\n", argv[1]);
+    free(records);
+    fclose(in);
+    return 1;
+  }
+  fclose(in);
+
+  if (argc == 3) {
+    out = fopen(argv[2], "w");
+    if (out == NULL) {
+      fprintf(stderr, "Cannot open %s\n", argv[2]);
+      free(records);
+      return 1;
+    }
+  }
+
+  qsort(records, header.nRecords, sizeof(omx_trace_record_t), compare_records);
+  nStart = header.nRecords ? records[0].nTimestamp : 0;
+  memset(&seen, 0, sizeof(seen));
+
+  fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  for (i = 0; i < header.nRecords; i++) {
+    r = &records[i];
+    if (r->nEvent >= OMX_TRACE_EVENT_MAX) {
+      continue;
+    }
+    r->name[OMX_TRACE_NAME_LEN - 1] = '\0';
+    ts = (r->nTimestamp - nStart) / 1000.0;
+    switch (r->nEvent) {
+    case OMX_TRACE_CALLBACK_START:
+      phase = "B";
+      break;
+    case OMX_TRACE_CALLBACK_END:
+      phase = "E";
+      break;
+    default:
+      phase = "i";
+      break;
+    }
+
+    fprintf(out, "%s{\"name\":", i ? ",\n" : "");
+    if (r->nEvent == OMX_TRACE_CALLBACK_START || r->nEvent == OMX_TRACE_CALLBACK_END) {
+      print_name(out, r->name);
+    } else {
+      fprintf(out, "\"%s\"", eventNames[r->nEvent]);
+    }
+    fprintf(out, ",\"cat\":\"buffer\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%u", phase, ts, r->nThread);
+    if (*phase == 'i') {
+      fprintf(out, ",\"s\":\"t\"");
+    }
+    fprintf(out, ",\"args\":{\"component\":");
+    print_name(out, r->name);
+    fprintf(out, ",\"buffer\":\"0x%llx\",\"port\":%u,\"filled\":%u}}",
+      (unsigned long long)r->nBuffer, r->nPortIndex, r->nFilledLen);
+
+    /* Flow joining the records of the same buffer header */
+    fprintf(out, ",\n{\"name\":\"buffer\",\"cat\":\"flow\",\"ph\":\"%s\",\"bp\":\"e\",\"id\":\"0x%llx\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+      buffer_seen(&seen, r->nBuffer) ? "t" : "s", (unsigned long long)r->nBuffer, ts, r->nThread);
+  }
+  fprintf(out, "\n]}\n");
+
+  free(seen.buffers);
+  free(records);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}